@@ -28,16 +28,20 @@ component_export_include_dir := \
     $(LOCAL_PATH)/include
 
 component_src_files :=  \
+    src/AudioChannelMatrix.cpp \
     src/AudioConversion.cpp \
     src/AudioConverter.cpp \
+    src/AudioFusedConverter.cpp \
+    src/AudioRateController.cpp \
     src/AudioReformatter.cpp \
+    src/AudioReformatKernels.cpp \
     src/AudioRemapper.cpp \
-    src/AudioResampler.cpp
+    src/AudioResampler.cpp \
+    src/AudioResamplerFilter.cpp
 
 component_includes_common := \
     $(component_export_include_dir) \
     $(call include-path-for, frameworks-av) \
-    $(call include-path-for, audio-utils) \
     external/tinyalsa/include
 
 component_includes_dir_host := \
@@ -114,9 +118,14 @@ include $(BUILD_STATIC_LIBRARY)
 # Component Functional Test Common variables
 
 component_fcttest_src_files := \
-    test/AudioConversionTest.cpp
+    test/AudioChannelMatrixTest.cpp \
+    test/AudioConversionTest.cpp \
+    test/AudioFusedConverterTest.cpp \
+    test/AudioRateControllerTest.cpp \
+    test/AudioReformatKernelsTest.cpp
 
 component_fcttest_c_includes := \
+    $(LOCAL_PATH)/src \
     external/tinyalsa/include \
     frameworks/av/include/media
 
@@ -141,8 +150,6 @@ component_fcttest_static_lib_host := \
     $(foreach lib, $(component_fcttest_static_lib), $(lib)_host) \
     libgtest_host \
     libgtest_main_host \
-    libaudioutils \
-    libspeexresampler \
     liblog
 
 component_fcttest_static_lib_target := \
@@ -152,14 +159,30 @@ component_fcttest_static_lib_target := \
 
 
 component_fcttest_shared_lib_target := \
-    libcutils \
-    libaudioutils
+    libcutils
 
 ifeq ($(USE_ALSA_LIB), 1)
 component_fcttest_shared_lib_target += libasound
 endif
 
 
+#######################################################################
+# Allocation counter Host Build
+# Replaces the allocator of the executable linking it, to check a path does not allocate.
+
+ifeq (ENABLE_HOST_VERSION,1)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := libaudio_allocation_counter_host
+LOCAL_MODULE_OWNER := intel
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/benchmark
+LOCAL_SRC_FILES := benchmark/AllocationCounter.cpp
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+endif
+
 #######################################################################
 # Component Functional Test Host Build
 
@@ -170,10 +193,15 @@ LOCAL_MODULE := audio_conversion_fcttest_host
 LOCAL_MODULE_OWNER := intel
 LOCAL_MODULE_TAGS := optional
 
-LOCAL_SRC_FILES := $(component_fcttest_src_files)
+# The allocations are counted on host only.
+LOCAL_SRC_FILES := \
+    $(component_fcttest_src_files) \
+    test/AudioConversionAllocationTest.cpp
 LOCAL_C_INCLUDES := $(component_fcttest_c_includes_host)
 LOCAL_CFLAGS := $(component_fcttest_defines)
-LOCAL_STATIC_LIBRARIES := $(component_fcttest_static_lib_host)
+LOCAL_STATIC_LIBRARIES := \
+    $(component_fcttest_static_lib_host) \
+    libaudio_allocation_counter_host
 LOCAL_LDFLAGS := $(component_fcttest_static_ldflags_host)
 
 include $(OPTIONAL_QUALITY_COVERAGE_JUMPER)
@@ -183,6 +211,28 @@ include $(OPTIONAL_QUALITY_COVERAGE_JUMPER)
 include $(BUILD_HOST_EXECUTABLE)
 endif
 
+#######################################################################
+# Component Benchmark Host Build
+# Prints the cost of the conversions as JSON, to track performance regressions.
+
+ifeq (ENABLE_HOST_VERSION,1)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := audio_conversion_benchmark_host
+LOCAL_MODULE_OWNER := intel
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := benchmark/AudioConversionBenchmark.cpp
+LOCAL_C_INCLUDES := $(component_fcttest_c_includes_host)
+LOCAL_CFLAGS := $(component_fcttest_defines) -O2
+LOCAL_STATIC_LIBRARIES := \
+    $(foreach lib, $(component_fcttest_static_lib), $(lib)_host) \
+    libaudio_allocation_counter_host \
+    liblog
+
+include $(BUILD_HOST_EXECUTABLE)
+endif
+
 #######################################################################
 # Component Functional Test Target Build
 include $(CLEAR_VARS)
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AllocationCounter.hpp"
+#include <stddef.h>
+
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+}
+
+/** Allocations of each thread, updated without lock, not counting the other threads. */
+static thread_local uint64_t gAllocations = 0;
+
+extern "C" void *malloc(size_t size)
+{
+    gAllocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    gAllocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    gAllocations++;
+    return __libc_realloc(ptr, size);
+}
+
+namespace intel_audio
+{
+
+uint64_t AllocationCounter::getCount()
+{
+    return gAllocations;
+}
+
+}  // namespace intel_audio
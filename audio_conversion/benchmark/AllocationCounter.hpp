@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+/**
+ * Counts the heap allocations of the calling thread.
+ *
+ * The executable linking AllocationCounter.cpp replaces malloc, calloc and realloc by wrappers
+ * of the glibc allocator counting the calls, which also catches new and new[]. Each thread
+ * counts its own allocations, so that a test checking the audio path does not count those of the
+ * other threads of the process. Host only.
+ */
+class AllocationCounter
+{
+public:
+    /** @return allocations done by the calling thread since its start. */
+    static uint64_t getCount();
+};
+
+}  // namespace intel_audio
@@ -0,0 +1,502 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AllocationCounter.hpp"
+#include <AudioConversion.hpp>
+#include <SampleSpec.hpp>
+#include <AudioUtils.hpp>
+#include <media/AudioBufferProvider.h>
+#include <utils/Errors.h>
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+/**
+ * Measures the cost of the conversions covered by the functional tests, and prints it as JSON.
+ *
+ * Each couple of formats, of channel counts and of rates is converted by periods of several sizes,
+ * through convert, the period being given in source frames, and through getConvertedBuffer, the
+ * period being given in destination frames. The first call of each case is not measured, as it
+ * allocates the intermediate buffers.
+ * The remapper is also measured against the former per sample policy lookups, and the fused
+ * kernels against the chain of converters they replace.
+ *
+ * usage: audio_conversion_benchmark_host [iterations per case]
+ */
+
+namespace intel_audio
+{
+
+static const struct
+{
+    audio_format_t format;
+    const char *name;
+} gFormats[] = {
+    { AUDIO_FORMAT_PCM_16_BIT, "s16" },
+    { AUDIO_FORMAT_PCM_8_24_BIT, "s24over32" },
+    { AUDIO_FORMAT_PCM_32_BIT, "s32" },
+    { AUDIO_FORMAT_PCM_24_BIT_PACKED, "s24packed" },
+    { AUDIO_FORMAT_PCM_FLOAT, "float" }
+};
+
+static const uint32_t gChannels[] = { 1, 2, 4, 6, 8 };
+
+static const uint32_t gRates[] = {
+    8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000
+};
+
+static const size_t gPeriods[] = { 64, 240, 960 };
+
+static const uint32_t gDefaultIterations = 200;
+
+/** Frames of the periods of the remapper and fusion cases: 20ms at 48kHz. */
+static const size_t gPeriodFrames = 960;
+
+/** Conversion of a case: the format and channels are swept at 48kHz, the rates in S16 stereo. */
+struct BenchmarkCase
+{
+    SampleSpec ssSrc;
+    SampleSpec ssDst;
+};
+
+/** Result of a case for a period size and an API. */
+struct BenchmarkResult
+{
+    double nsPerFrame; /**< Time per frame of the period. */
+    double allocationsPerCall; /**< Heap allocations per call. */
+};
+
+/**
+ * Gives the same source frames on every request, from a buffer large enough for any period.
+ */
+class LoopBufferProvider : public android::AudioBufferProvider
+{
+public:
+    LoopBufferProvider(std::vector<uint8_t> &source) : mSource(source) {}
+
+    virtual android::status_t getNextBuffer(android::AudioBufferProvider::Buffer *buffer)
+    {
+        buffer->raw = &mSource[0];
+        return android::NO_ERROR;
+    }
+
+    virtual void releaseBuffer(Buffer */*buffer*/) {}
+
+private:
+    std::vector<uint8_t> &mSource;
+};
+
+static uint64_t getNanoseconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static const char *getFormatName(audio_format_t format)
+{
+    for (size_t i = 0; i < sizeof(gFormats) / sizeof(gFormats[0]); i++) {
+        if (gFormats[i].format == format) {
+            return gFormats[i].name;
+        }
+    }
+    return "unknown";
+}
+
+static std::vector<BenchmarkCase> getCases()
+{
+    std::vector<BenchmarkCase> cases;
+    const size_t nbFormats = sizeof(gFormats) / sizeof(gFormats[0]);
+    const size_t nbChannels = sizeof(gChannels) / sizeof(gChannels[0]);
+    const size_t nbRates = sizeof(gRates) / sizeof(gRates[0]);
+
+    for (size_t src = 0; src < nbFormats; src++) {
+        for (size_t dst = 0; dst < nbFormats; dst++) {
+            BenchmarkCase conversion = {
+                SampleSpec(2, gFormats[src].format, 48000),
+                SampleSpec(2, gFormats[dst].format, 48000)
+            };
+            cases.push_back(conversion);
+        }
+    }
+    for (size_t src = 0; src < nbChannels; src++) {
+        for (size_t dst = 0; dst < nbChannels; dst++) {
+            BenchmarkCase conversion = {
+                SampleSpec(gChannels[src], AUDIO_FORMAT_PCM_16_BIT, 48000),
+                SampleSpec(gChannels[dst], AUDIO_FORMAT_PCM_16_BIT, 48000)
+            };
+            cases.push_back(conversion);
+        }
+    }
+    for (size_t src = 0; src < nbRates; src++) {
+        for (size_t dst = 0; dst < nbRates; dst++) {
+            BenchmarkCase conversion = {
+                SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, gRates[src]),
+                SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, gRates[dst])
+            };
+            cases.push_back(conversion);
+        }
+    }
+    return cases;
+}
+
+static void fillSource(std::vector<uint8_t> &source)
+{
+    srand(0xBE4C);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = rand();
+    }
+}
+
+static bool runConvert(const BenchmarkCase &conversion, size_t period, uint32_t iterations,
+                       BenchmarkResult &result)
+{
+    AudioConversion audioConversion;
+    if (audioConversion.configure(conversion.ssSrc, conversion.ssDst) != android::OK) {
+        return false;
+    }
+    std::vector<uint8_t> source(conversion.ssSrc.convertFramesToBytes(period));
+    std::vector<uint8_t> destination(conversion.ssDst.convertFramesToBytes(
+                                         AudioUtils::convertSrcToDstInFrames(
+                                             period, conversion.ssSrc, conversion.ssDst) + 1));
+    fillSource(source);
+
+    uint64_t start = 0;
+    uint64_t allocations = 0;
+    for (uint32_t i = 0; i < iterations + 1; i++) {
+        if (i == 1) {
+            allocations = AllocationCounter::getCount();
+            start = getNanoseconds();
+        }
+        void *dst = &destination[0];
+        size_t outFrames = 0;
+        if (audioConversion.convert(&source[0], &dst, period, &outFrames) != android::OK) {
+            return false;
+        }
+    }
+    result.nsPerFrame = (double)(getNanoseconds() - start) / ((uint64_t)iterations * period);
+    result.allocationsPerCall = (double)(AllocationCounter::getCount() - allocations) / iterations;
+    return true;
+}
+
+static bool runGetConvertedBuffer(const BenchmarkCase &conversion, size_t period,
+                                  uint32_t iterations, BenchmarkResult &result)
+{
+    AudioConversion audioConversion;
+    if (audioConversion.configure(conversion.ssSrc, conversion.ssDst) != android::OK) {
+        return false;
+    }
+    // Room for the frames requested in the worst case, rounded up and with resampler margin.
+    std::vector<uint8_t> source(conversion.ssSrc.convertFramesToBytes(
+                                    AudioUtils::convertSrcToDstInFrames(
+                                        period, conversion.ssDst, conversion.ssSrc) + 64));
+    std::vector<uint8_t> destination(conversion.ssDst.convertFramesToBytes(period));
+    fillSource(source);
+    LoopBufferProvider provider(source);
+
+    uint64_t start = 0;
+    uint64_t allocations = 0;
+    for (uint32_t i = 0; i < iterations + 1; i++) {
+        if (i == 1) {
+            allocations = AllocationCounter::getCount();
+            start = getNanoseconds();
+        }
+        if (audioConversion.getConvertedBuffer(&destination[0], period, &provider) !=
+            android::OK) {
+            return false;
+        }
+    }
+    result.nsPerFrame = (double)(getNanoseconds() - start) / ((uint64_t)iterations * period);
+    result.allocationsPerCall = (double)(AllocationCounter::getCount() - allocations) / iterations;
+    return true;
+}
+
+static void printSampleSpec(const char *name, const SampleSpec &sampleSpec)
+{
+    std::cout << "\"" << name << "\": { \"format\": \""
+              << getFormatName(sampleSpec.getFormat()) << "\", \"channels\": "
+              << sampleSpec.getChannelCount() << ", \"rate\": " << sampleSpec.getSampleRate()
+              << " }";
+}
+
+/**
+ * Former remapping of a frame, looking the channels policy up for every sample, and dividing
+ * for every average. Reference of the remapper cases.
+ */
+static int16_t legacyAveragedSrcFrame(const int16_t *src, const SampleSpec &ssSrc)
+{
+    uint32_t validSrcChannels = 0;
+    uint64_t dst = 0;
+    for (uint32_t channel = 0; channel < ssSrc.getChannelCount(); channel++) {
+        if (ssSrc.getChannelsPolicy(channel) != SampleSpec::Ignore) {
+            dst += src[channel];
+            validSrcChannels += 1;
+        }
+    }
+    if (validSrcChannels) {
+        dst = dst / validSrcChannels;
+    }
+    return dst;
+}
+
+static int16_t legacyConvertSample(const int16_t *src, uint32_t channel,
+                                   const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    SampleSpec::ChannelsPolicy dstPolicy = ssDst.getChannelsPolicy(channel);
+    if (dstPolicy == SampleSpec::Ignore) {
+        return 0;
+    } else if (dstPolicy == SampleSpec::Average) {
+        return legacyAveragedSrcFrame(src, ssSrc);
+    }
+    if (ssSrc.getChannelsPolicy(channel) != SampleSpec::Ignore) {
+        return src[channel];
+    }
+    return legacyAveragedSrcFrame(src, ssSrc);
+}
+
+static void legacyRemap(const int16_t *src, int16_t *dst, size_t frames,
+                        const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    uint32_t srcChannels = ssSrc.getChannelCount();
+    uint32_t dstChannels = ssDst.getChannelCount();
+    for (size_t frame = 0; frame < frames; frame++) {
+        if (dstChannels == 1) {
+            dst[frame] = legacyAveragedSrcFrame(&src[frame * srcChannels], ssSrc);
+            continue;
+        }
+        for (uint32_t channel = 0; channel < dstChannels; channel++) {
+            dst[frame * dstChannels + channel] =
+                legacyConvertSample(&src[frame * srcChannels], channel, ssSrc, ssDst);
+        }
+    }
+}
+
+/**
+ * Measures the remapper against the former policy lookups, for the stereo to mono and CcToAi
+ * remappings, after checking both give the same samples.
+ *
+ * @return number of cases failed.
+ */
+static int runRemapPolicies(uint32_t iterations)
+{
+    static const SampleSpec::ChannelsPolicy stereoCC[] = {
+        SampleSpec::Copy, SampleSpec::Copy
+    };
+    static const SampleSpec::ChannelsPolicy stereoAI[] = {
+        SampleSpec::Average, SampleSpec::Ignore
+    };
+    const std::vector<SampleSpec::ChannelsPolicy> policyCC(stereoCC, stereoCC + 2);
+    const std::vector<SampleSpec::ChannelsPolicy> policyAI(stereoAI, stereoAI + 2);
+    const struct
+    {
+        const char *name;
+        SampleSpec ssSrc;
+        SampleSpec ssDst;
+    } cases[] = {
+        { "remapStereoToMono", SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+          SampleSpec(1, AUDIO_FORMAT_PCM_16_BIT, 48000) },
+        { "remapPolicyCcToAi", SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000, policyCC),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000, policyAI) }
+    };
+
+    std::vector<uint8_t> source(gPeriodFrames * 2 * sizeof(int16_t));
+    fillSource(source);
+    const int16_t *src = reinterpret_cast<const int16_t *>(&source[0]);
+    int failures = 0;
+
+    std::cout << ",\n  \"remap_policies\": [\n";
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const size_t dstSamples = gPeriodFrames * cases[i].ssDst.getChannelCount();
+        std::vector<int16_t> legacy(dstSamples);
+        std::vector<int16_t> remapped(dstSamples);
+
+        AudioConversion conversion;
+        if (conversion.configure(cases[i].ssSrc, cases[i].ssDst) != android::OK) {
+            failures++;
+            continue;
+        }
+        uint64_t start = getNanoseconds();
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+            legacyRemap(src, &legacy[0], gPeriodFrames, cases[i].ssSrc, cases[i].ssDst);
+        }
+        double legacyNs = (double)(getNanoseconds() - start) / ((uint64_t)iterations *
+                                                                 gPeriodFrames);
+        start = getNanoseconds();
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+            void *dst = &remapped[0];
+            size_t outFrames = 0;
+            conversion.convert(src, &dst, gPeriodFrames, &outFrames);
+        }
+        double remappedNs = (double)(getNanoseconds() - start) / ((uint64_t)iterations *
+                                                                   gPeriodFrames);
+        if (memcmp(&legacy[0], &remapped[0], dstSamples * sizeof(int16_t)) != 0) {
+            failures++;
+        }
+        std::cout << (i == 0 ? "" : ",\n") << "    { \"case\": \"" << cases[i].name
+                  << "\", \"policy_lookups_ns_per_frame\": " << legacyNs
+                  << ", \"policy_tables_ns_per_frame\": " << remappedNs << " }";
+    }
+    std::cout << "\n  ]";
+    return failures;
+}
+
+/**
+ * Measures the conversion time per frame of a period, with or without fused kernels.
+ */
+static bool runFusion(const SampleSpec &ssSrc, const SampleSpec &ssDst, bool fusion,
+                      uint32_t iterations, double &nsPerFrame)
+{
+    AudioConversion conversion;
+    conversion.setFusion(fusion);
+    if (conversion.configure(ssSrc, ssDst) != android::OK) {
+        return false;
+    }
+    std::vector<uint8_t> source(gPeriodFrames * ssSrc.getFrameSize());
+    std::vector<uint8_t> destination(gPeriodFrames * ssDst.getFrameSize());
+    fillSource(source);
+
+    uint64_t start = 0;
+    for (uint32_t i = 0; i < iterations + 1; i++) {
+        if (i == 1) {
+            start = getNanoseconds();
+        }
+        void *dst = &destination[0];
+        size_t outFrames = 0;
+        if (conversion.convert(&source[0], &dst, gPeriodFrames, &outFrames) != android::OK) {
+            return false;
+        }
+    }
+    nsPerFrame = (double)(getNanoseconds() - start) / ((uint64_t)iterations * gPeriodFrames);
+    return true;
+}
+
+/**
+ * Measures the memory traffic of the chain against the fused kernel, i.e. the bytes written and
+ * read back in the intermediate buffer, and the time per frame.
+ *
+ * @return number of cases failed.
+ */
+static int runFusions(uint32_t iterations)
+{
+    static const struct
+    {
+        uint32_t srcChannels;
+        audio_format_t srcFormat;
+        uint32_t dstChannels;
+        audio_format_t dstFormat;
+    } cases[] = {
+        { 2, AUDIO_FORMAT_PCM_16_BIT, 4, AUDIO_FORMAT_PCM_32_BIT },
+        { 4, AUDIO_FORMAT_PCM_32_BIT, 2, AUDIO_FORMAT_PCM_16_BIT },
+        { 1, AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_8_24_BIT },
+        { 2, AUDIO_FORMAT_PCM_8_24_BIT, 1, AUDIO_FORMAT_PCM_16_BIT }
+    };
+    int failures = 0;
+
+    std::cout << ",\n  \"fusion\": [\n";
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const SampleSpec ssSrc(cases[i].srcChannels, cases[i].srcFormat, 48000);
+        const SampleSpec ssDst(cases[i].dstChannels, cases[i].dstFormat, 48000);
+
+        // Intermediate frame: channels are removed first and added last.
+        size_t intermediateFrameSize = cases[i].srcChannels > cases[i].dstChannels ?
+                                       cases[i].dstChannels * ssSrc.getFrameSize() /
+                                       cases[i].srcChannels :
+                                       cases[i].srcChannels * ssDst.getFrameSize() /
+                                       cases[i].dstChannels;
+        size_t fusedBytes = ssSrc.getFrameSize() + ssDst.getFrameSize();
+        size_t chainedBytes = fusedBytes + 2 * intermediateFrameSize;
+
+        double chainedNs;
+        double fusedNs;
+        if (!runFusion(ssSrc, ssDst, false, iterations, chainedNs) ||
+            !runFusion(ssSrc, ssDst, true, iterations, fusedNs)) {
+            failures++;
+            continue;
+        }
+        std::cout << (i == 0 ? "" : ",\n") << "    { ";
+        printSampleSpec("src", ssSrc);
+        std::cout << ", ";
+        printSampleSpec("dst", ssDst);
+        std::cout << ", \"chain_bytes_per_frame\": " << chainedBytes
+                  << ", \"chain_ns_per_frame\": " << chainedNs
+                  << ", \"fused_bytes_per_frame\": " << fusedBytes
+                  << ", \"fused_ns_per_frame\": " << fusedNs << " }";
+    }
+    std::cout << "\n  ]";
+    return failures;
+}
+
+static void printResult(const BenchmarkCase &conversion, const char *api, size_t period,
+                        const BenchmarkResult &result, bool first)
+{
+    std::cout << (first ? "" : ",\n") << "    { \"api\": \"" << api << "\", ";
+    printSampleSpec("src", conversion.ssSrc);
+    std::cout << ", ";
+    printSampleSpec("dst", conversion.ssDst);
+    std::cout << ", \"period_frames\": " << period << ", \"ns_per_frame\": " << result.nsPerFrame
+              << ", \"allocations_per_call\": " << result.allocationsPerCall << " }";
+}
+
+static int runBenchmark(uint32_t iterations)
+{
+    std::vector<BenchmarkCase> cases = getCases();
+    int failures = 0;
+    bool first = true;
+
+    std::cout << "{\n  \"benchmark\": \"audio_conversion\",\n  \"iterations\": " << iterations
+              << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < cases.size(); i++) {
+        for (size_t period = 0; period < sizeof(gPeriods) / sizeof(gPeriods[0]); period++) {
+            BenchmarkResult result;
+            if (runConvert(cases[i], gPeriods[period], iterations, result)) {
+                printResult(cases[i], "convert", gPeriods[period], result, first);
+                first = false;
+            } else {
+                failures++;
+            }
+            if (cases[i].ssSrc == cases[i].ssDst) {
+                // No converter, hence nothing to get converted buffers from.
+                continue;
+            }
+            if (runGetConvertedBuffer(cases[i], gPeriods[period], iterations, result)) {
+                printResult(cases[i], "getConvertedBuffer", gPeriods[period], result, first);
+                first = false;
+            } else {
+                failures++;
+            }
+        }
+    }
+    std::cout << "\n  ]";
+    failures += runRemapPolicies(iterations);
+    failures += runFusions(iterations);
+    std::cout << ",\n  \"failures\": " << failures << "\n}" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+}  // namespace intel_audio
+
+int main(int argc, char *argv[])
+{
+    uint32_t iterations = intel_audio::gDefaultIterations;
+    if (argc > 2 || (argc == 2 && (iterations = strtoul(argv[1], NULL, 0)) == 0)) {
+        std::cerr << "usage: " << argv[0] << " [iterations per case]" << std::endl;
+        return 1;
+    }
+    return intel_audio::runBenchmark(iterations);
+}
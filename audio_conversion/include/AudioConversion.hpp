@@ -20,11 +20,15 @@
 #include <media/AudioBufferProvider.h>
 #include <AudioNonCopyable.hpp>
 #include <list>
+#include <sys/types.h>
+#include <time.h>
+#include <vector>
 
 namespace intel_audio
 {
 
 class AudioConverter;
+class AudioRateController;
 
 class AudioConversion : public audio_comms::utilities::NonCopyable
 {
@@ -32,6 +36,28 @@ public:
     typedef std::list<AudioConverter *>::iterator AudioConverterListIterator;
     typedef std::list<AudioConverter *>::const_iterator AudioConverterListConstIterator;
 
+    /**
+     * Resampling quality, trading the filter length (thus the CPU load) against the stop band
+     * attenuation and the pass band width.
+     */
+    enum ResamplerQuality
+    {
+        ResamplerQualityLow,
+        ResamplerQualityMedium,
+        ResamplerQualityHigh,
+        NbResamplerQuality
+    };
+
+    /**
+     * Converted frames handed back without copy, as up to two contiguous parts of the buffer the
+     * conversion chain outputs in.
+     */
+    struct ConvertedSpans
+    {
+        const void *raw[2]; /**< First frame of each part. */
+        size_t frames[2]; /**< Frames of each part, the second one is empty if not needed. */
+    };
+
     AudioConversion();
     virtual ~AudioConversion();
 
@@ -40,6 +66,76 @@ public:
     static bool supportRemap(uint32_t srcChannels, uint32_t dstChannels);
     static bool supportResample(uint32_t srcRate, uint32_t dstRate);
 
+    /**
+     * Enables or disables dithering when float samples are reduced to an integer format.
+     * Float to integer conversions always saturate, dither is disabled by default.
+     *
+     * @param[in] enable true to dither float to integer conversions, false otherwise.
+     */
+    void setDither(bool enable);
+
+    /**
+     * Sets the quality of the resampler. It is taken into account on next configure.
+     * Medium quality is used by default.
+     *
+     * @param[in] quality resampling quality.
+     */
+    void setResamplerQuality(ResamplerQuality quality);
+
+    /**
+     * Enables or disables the fused remap and reformat kernels. It is taken into account on next
+     * configure. Fusion is enabled by default, disabling it is meant for comparison purpose.
+     *
+     * @param[in] enable true to replace remap and reformat couples by a single pass kernel if
+     *                   possible, false to always use the chain of converters.
+     */
+    void setFusion(bool enable);
+
+    /**
+     * Sets the matrix mixing the source channels into the destination channels, in place of the
+     * matrix computed from the channel masks. It is taken into account on next configure, if its
+     * dimensions match the channel counts of the conversion.
+     *
+     * @param[in] matrix one row of coefficients per destination channel, one coefficient per
+     *                   source channel. Empty to use the matrix computed from the channel masks.
+     */
+    void setChannelMatrix(const std::vector<std::vector<float> > &matrix);
+
+    /**
+     * Enables or disables the adaptive rate mode. It is taken into account on next configure.
+     * In adaptive rate mode, the chain always resamples, even between the same rates, and the
+     * ratio is fine tuned by updateRateControl to compensate the drift between the clock of the
+     * source and the clock of the device the converted frames are written to.
+     *
+     * @param[in] enable true to correct the ratio from the device buffer fill level, false to
+     *                   keep the nominal ratio.
+     */
+    void setAdaptiveRate(bool enable);
+
+    /** @return true if the adaptive rate mode is enabled. */
+    bool isAdaptiveRate() const { return mAdaptiveRate; }
+
+    /**
+     * Corrects the resampling ratio from a measure of the buffer of the device the converted
+     * frames are written to, so that its fill level is held. Adaptive rate mode only.
+     *
+     * @param[in] writtenFrames frames written to the device since the previous measure.
+     * @param[in] queuedFrames frames in the device buffer, not consumed yet, negative after an
+     *                         underrun.
+     * @param[in] timestamp time of the measure, monotonic clock.
+     */
+    void updateRateControl(size_t writtenFrames, ssize_t queuedFrames,
+                           const struct timespec &timestamp);
+
+    /**
+     * @return drift of the device rate relative to its nominal rate in parts per million,
+     *         measured in adaptive rate mode.
+     */
+    double getRateDriftPpm() const;
+
+    /** @return correction of the resampling ratio in parts per million. */
+    double getRateCorrectionPpm() const;
+
     /**
      * Configures the conversion chain.
      *
@@ -49,6 +145,10 @@ public:
      * To optimize the convertion and make the processing as light as possible, the
      * order of converter is important.
      *
+     * The last configured chains are kept with their converters and buffers: configuring again
+     * one of them, for instance when a stream is routed back to a previous device, only clears
+     * the state kept from one conversion to the next and does not allocate.
+     *
      * This function will call the recursive function configureAndAddConverter starting
      * from the remapper operation (i.e. the converter working on the number of channels),
      * then the reformatter operation (i.e. converter changing the format of the samples),
@@ -76,6 +176,7 @@ public:
      *                 instance of the converter.
      *                 If no error is returned, the ouput buffer will contain valid data until next
      *                 convert call or configure.
+     *                 A buffer given by the caller must hold getMaxConvertedFrames(inFrames).
      * @param[in] inFrames number of frames in the source sample specification to convert.
      * @param[out] outFrames number of frames in the destination sample specification converted.
      *
@@ -86,6 +187,54 @@ public:
                               const size_t inFrames,
                               size_t *outFrames);
 
+    /**
+     * Gives the largest number of frames convert may output, for instance to convert directly in
+     * the buffer of an audio device.
+     *
+     * @param[in] inFrames number of frames in the source sample specification to convert.
+     *
+     * @return frames in the destination sample specification.
+     */
+    size_t getMaxConvertedFrames(size_t inFrames) const;
+
+    /**
+     * Sizes the buffers of the chain in use, so that converting up to the given numbers of frames
+     * does not allocate: the buffers of the converters and the ring buffer otherwise sized by the
+     * first conversions. To be called after configure, off the audio path, e.g. once a stream is
+     * routed.
+     *
+     * @param[in] inFrames largest number of frames in the source sample specification given at
+     *                     once to convert.
+     * @param[in] outFrames largest number of frames in the destination sample specification
+     *                      requested at once to getConvertedBuffer.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t reserve(size_t inFrames, size_t outFrames);
+
+    /**
+     * Gives the frames converted beyond the ones requested by the frame exact API, kept for the
+     * next call, e.g. to account for them in the position of a capture.
+     *
+     * @return frames in the destination sample specification.
+     */
+    size_t getBufferedFrames() const { return mRingWrite - mRingRead; }
+
+    /**
+     * Gives the group delay of the chain, i.e. of its resampler, the other converters not
+     * delaying the frames.
+     *
+     * @return delay in frames of the destination sample specification.
+     */
+    size_t getDelayFrames() const;
+
+    /**
+     * Gives the latency of the chain: group delay, and frames converted ahead of the request.
+     *
+     * @return latency in frames of the destination sample specification.
+     */
+    size_t getLatencyFrames() const { return getDelayFrames() + getBufferedFrames(); }
+
     /**
      * Converts audio samples and output an exact number of output frames.
      *
@@ -105,7 +254,101 @@ public:
                                          const size_t outFrames,
                                          android::AudioBufferProvider *bufferProvider);
 
+    /**
+     * Converts audio samples and hands back an exact number of output frames without copy.
+     *
+     * Same as the copying variant, but the frames are left in the ring buffer the conversion chain
+     * outputs in. They may wrap around its end, hence are given as two contiguous parts, valid
+     * until next call or configure.
+     *
+     * @param[in] outFrames frames in the destination sample specification requested
+     *            to be outputted.
+     * @param[in:out] bufferProvider object that will provide source buffer.
+     * @param[out] spans parts of the ring buffer holding the frames, in order.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t getConvertedBuffer(const size_t outFrames,
+                                         android::AudioBufferProvider *bufferProvider,
+                                         ConvertedSpans *spans);
+
+    /** @return number of configure calls that reused a previously configured chain. */
+    uint32_t getPlanCacheHits() const { return mPlanCacheHits; }
+
+    /** @return number of configure calls that had to configure a new chain. */
+    uint32_t getPlanCacheMisses() const { return mPlanCacheMisses; }
+
 private:
+    /**
+     * Conversion chain configured for a couple of source and destination sample specifications,
+     * parked while another chain is in use. The chain in use lives in the members of
+     * AudioConversion, a plan is swapped with them to be used again.
+     */
+    struct Plan
+    {
+        Plan();
+
+        SampleSpec ssSrc; /**< Source sample specifications of the chain. */
+        SampleSpec ssDst; /**< Destination sample specifications of the chain. */
+        std::list<AudioConverter *> activeAudioConvList; /**< Converters of the chain. */
+        AudioConverter *audioConverter[NbSampleSpecItems]; /**< Converters owned by the plan. */
+        AudioConverter *fusedConverter; /**< Fused converter owned by the plan. */
+        size_t ringFrames; /**< Capacity of the ring buffer in frames. */
+        size_t ringBytes; /**< Size allocated for the ring buffer. */
+        uint8_t *ringBuffer; /**< Ring buffer of converted frames. */
+    };
+
+    /**
+     * Checks if the chain in use, or a parked one, converts between the given specifications.
+     * Unlike the SampleSpec comparison, the channel masks are taken into account, as they
+     * select the mixing matrix.
+     */
+    static bool isSameConversion(const SampleSpec &ssSrc, const SampleSpec &ssDst,
+                                 const SampleSpec &planSsSrc, const SampleSpec &planSsDst);
+
+    /**
+     * Selects the chain to use for a conversion: a parked plan is swapped in on a hit, otherwise
+     * the least recently used plan, or a new one, gives its converters to be configured.
+     * The chain previously in use is parked if it was configured.
+     *
+     * @return true if a configured chain was found, false if the chain must be configured.
+     */
+    bool selectPlan(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /** Exchanges the chain in use with a parked plan. */
+    void swapPlan(Plan &plan);
+
+    /** Creates the converters of a plan. */
+    static void createConverters(Plan &plan);
+
+    /** Releases the converters and the buffer of a plan. */
+    static void releasePlan(Plan &plan);
+
+    /**
+     * Drops the parked plans and invalidates the chain in use, as a setting they were configured
+     * with changed.
+     */
+    void flushPlans();
+
+    /** Applies the current settings to the converters of the chain in use. */
+    void applySettings();
+
+    /**
+     * Sizes the ring buffer to hold a number of frames, plus the frames a conversion may output
+     * beyond the ones requested. Frames not read yet are kept.
+     *
+     * @param[in] frames largest number of frames requested at once.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t reserveRingBuffer(size_t frames);
+
+    /** Gives the parts of the ring buffer holding the next frames to read. */
+    void getRingSpans(size_t frames, ConvertedSpans *spans) const;
+
+    /** @return frames a conversion may output beyond the frames requested. */
+    static size_t getRingMarginFrames();
+
     /**
      * This function pushes the converter to the list.
      * and alters the source sample spec according to the sample spec reached
@@ -188,6 +431,12 @@ private:
                                                SampleSpec *ssSrc,
                                                const SampleSpec *ssDst);
 
+    /**
+     * Replaces an adjacent remapper and reformatter couple of the active converter list by the
+     * fused converter, if a single pass kernel is available for this conversion.
+     */
+    void fuseConverters();
+
     /**
      * Reset the list of active converter.
      * This function must be called before reconfiguring the conversion chain.
@@ -205,6 +454,31 @@ private:
      */
     AudioConverter *mAudioConverter[NbSampleSpecItems];
 
+    /**
+     * Converter remapping and reformatting in a single pass, used in place of the remapper and
+     * reformatter when possible.
+     */
+    AudioConverter *mFusedConverter;
+
+    bool mFusionEnabled; /**< Fused kernels are used if available when true. */
+    bool mDitherEnabled; /**< Float to integer conversions are dithered when true. */
+    ResamplerQuality mResamplerQuality; /**< Quality of the resampler. */
+    std::vector<std::vector<float> > mChannelMatrix; /**< Mixing matrix set by the client. */
+    bool mAdaptiveRate; /**< Ratio is corrected from the device buffer fill level when true. */
+
+    /** Corrects the ratio in adaptive rate mode, restarted on each configure. */
+    AudioRateController *mRateController;
+
+    /**
+     * Chains configured before the one in use, most recently used first. They are kept in a list
+     * so that a plan moves to the front without allocation.
+     */
+    std::list<Plan> mParkedPlans;
+
+    bool mPlanConfigured; /**< The chain in use is configured, thus may be parked. */
+    uint32_t mPlanCacheHits; /**< Configurations that reused a configured chain. */
+    uint32_t mPlanCacheMisses; /**< Configurations that configured a new chain. */
+
     /**
      * Source audio data sample specifications.
      */
@@ -215,11 +489,13 @@ private:
      */
     SampleSpec mSsDst;
 
-    // Conversion is done into ConvOutBuffer
-    size_t mConvOutBufferIndex; /**< Current position into the Converted buffer. */
-    size_t mConvOutFrames; /**< Number of converted Frames. */
-    size_t mConvOutBufferSizeInFrames; /**< Converted buffer size in Frames. */
-    int16_t *mConvOutBuffer; /**< Converted buffer. */
+    // Conversion is done into a ring buffer of a power of two frames, followed by spare frames
+    // receiving the frames converted past its end until they are copied at its start.
+    size_t mRingRead; /**< Frames read since configure, masked to get the read position. */
+    size_t mRingWrite; /**< Frames converted since configure, masked to get the write position. */
+    size_t mRingFrames; /**< Capacity of the ring buffer in frames, power of two. */
+    size_t mRingBytes; /**< Size allocated for the ring buffer, spare frames included. */
+    uint8_t *mRingBuffer; /**< Ring buffer of converted frames. */
 
     /**
      * Buffer is acquired from the provider into ConvInBuffer.
@@ -234,5 +510,15 @@ private:
      * Multiplication factor used to allocate a big enough conversion buffer.
      */
     static const uint32_t mAllocBufferMultFactor;
+
+    static const size_t mMaxParkedPlans; /**< Chains kept besides the one in use. */
+
+    static const uint32_t mRingBufferMs; /**< Duration the ring buffer is sized for. */
+
+    /**
+     * Largest number of frames converted at once into the ring buffer in adaptive rate mode, so
+     * that the frames added by a ratio correction fit in its spare frames.
+     */
+    static const size_t mMaxAdaptiveFrames;
 };
 }  // namespace intel_audio
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioChannelMatrix.hpp"
+
+namespace intel_audio
+{
+
+const float AudioChannelMatrix::mMinus3dB = 0.70710678f;
+
+audio_channel_mask_t AudioChannelMatrix::getPositionalMask(audio_channel_mask_t mask,
+                                                           uint32_t channels)
+{
+    // Input masks share their bits with output masks: translate the common ones first.
+    switch (mask) {
+    case AUDIO_CHANNEL_IN_MONO:
+        mask = AUDIO_CHANNEL_OUT_MONO;
+        break;
+    case AUDIO_CHANNEL_IN_STEREO:
+        mask = AUDIO_CHANNEL_OUT_STEREO;
+        break;
+    case AUDIO_CHANNEL_IN_FRONT_BACK:
+        mask = AUDIO_CHANNEL_OUT_FRONT_CENTER | AUDIO_CHANNEL_OUT_BACK_CENTER;
+        break;
+    default:
+        break;
+    }
+    if ((mask == AUDIO_CHANNEL_NONE) ||
+        (audio_channel_mask_get_representation(mask) != AUDIO_CHANNEL_REPRESENTATION_POSITION) ||
+        (audio_channel_count_from_out_mask(mask) != channels)) {
+
+        mask = audio_channel_out_mask_from_count(channels);
+    }
+    if ((audio_channel_mask_get_representation(mask) != AUDIO_CHANNEL_REPRESENTATION_POSITION) ||
+        (audio_channel_count_from_out_mask(mask) != channels)) {
+
+        return AUDIO_CHANNEL_NONE;
+    }
+    return mask;
+}
+
+uint32_t AudioChannelMatrix::getIndex(audio_channel_mask_t mask, uint32_t channel)
+{
+    return __builtin_popcount(mask & (channel - 1));
+}
+
+bool AudioChannelMatrix::addTo(Matrix &matrix, audio_channel_mask_t dstMask, uint32_t dstChannel,
+                               uint32_t srcIndex, float coef)
+{
+    if ((dstMask & dstChannel) == 0) {
+        return false;
+    }
+    matrix[getIndex(dstMask, dstChannel)][srcIndex] += coef;
+    return true;
+}
+
+bool AudioChannelMatrix::addToPair(Matrix &matrix, audio_channel_mask_t dstMask,
+                                   uint32_t dstLeft, uint32_t dstRight, uint32_t srcIndex,
+                                   float coef)
+{
+    if ((dstMask & dstLeft) == 0 || (dstMask & dstRight) == 0) {
+        return false;
+    }
+    addTo(matrix, dstMask, dstLeft, srcIndex, coef);
+    addTo(matrix, dstMask, dstRight, srcIndex, coef);
+    return true;
+}
+
+void AudioChannelMatrix::foldChannel(Matrix &matrix, audio_channel_mask_t dstMask,
+                                     uint32_t srcChannel, uint32_t srcIndex)
+{
+    switch (srcChannel) {
+    case AUDIO_CHANNEL_OUT_FRONT_LEFT:
+    case AUDIO_CHANNEL_OUT_FRONT_RIGHT:
+        addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_CENTER, srcIndex, 1);
+        break;
+    case AUDIO_CHANNEL_OUT_FRONT_CENTER:
+        addToPair(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_LEFT, AUDIO_CHANNEL_OUT_FRONT_RIGHT,
+                  srcIndex, mMinus3dB);
+        break;
+    case AUDIO_CHANNEL_OUT_LOW_FREQUENCY:
+        // Speakers without subwoofer are not expected to render it.
+        break;
+    case AUDIO_CHANNEL_OUT_BACK_LEFT:
+        if (!addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_SIDE_LEFT, srcIndex, 1)) {
+            addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_LEFT, srcIndex, mMinus3dB);
+        }
+        break;
+    case AUDIO_CHANNEL_OUT_BACK_RIGHT:
+        if (!addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_SIDE_RIGHT, srcIndex, 1)) {
+            addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_RIGHT, srcIndex, mMinus3dB);
+        }
+        break;
+    case AUDIO_CHANNEL_OUT_SIDE_LEFT:
+        if (!addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_BACK_LEFT, srcIndex, 1)) {
+            addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_LEFT, srcIndex, mMinus3dB);
+        }
+        break;
+    case AUDIO_CHANNEL_OUT_SIDE_RIGHT:
+        if (!addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_BACK_RIGHT, srcIndex, 1)) {
+            addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_RIGHT, srcIndex, mMinus3dB);
+        }
+        break;
+    case AUDIO_CHANNEL_OUT_BACK_CENTER:
+        if (!addToPair(matrix, dstMask, AUDIO_CHANNEL_OUT_BACK_LEFT,
+                       AUDIO_CHANNEL_OUT_BACK_RIGHT, srcIndex, mMinus3dB) &&
+            !addToPair(matrix, dstMask, AUDIO_CHANNEL_OUT_SIDE_LEFT,
+                       AUDIO_CHANNEL_OUT_SIDE_RIGHT, srcIndex, mMinus3dB)) {
+            addToPair(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_LEFT,
+                      AUDIO_CHANNEL_OUT_FRONT_RIGHT, srcIndex, 0.5f);
+        }
+        break;
+    case AUDIO_CHANNEL_OUT_FRONT_LEFT_OF_CENTER:
+    case AUDIO_CHANNEL_OUT_TOP_FRONT_LEFT:
+    case AUDIO_CHANNEL_OUT_TOP_BACK_LEFT:
+        addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_LEFT, srcIndex, mMinus3dB);
+        break;
+    case AUDIO_CHANNEL_OUT_FRONT_RIGHT_OF_CENTER:
+    case AUDIO_CHANNEL_OUT_TOP_FRONT_RIGHT:
+    case AUDIO_CHANNEL_OUT_TOP_BACK_RIGHT:
+        addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_RIGHT, srcIndex, mMinus3dB);
+        break;
+    default:
+        // Top center channels.
+        addToPair(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_LEFT, AUDIO_CHANNEL_OUT_FRONT_RIGHT,
+                  srcIndex, 0.5f);
+        break;
+    }
+}
+
+AudioChannelMatrix::Matrix AudioChannelMatrix::getMixMatrix(audio_channel_mask_t srcMask,
+                                                            uint32_t srcChannels,
+                                                            audio_channel_mask_t dstMask,
+                                                            uint32_t dstChannels)
+{
+    Matrix matrix(dstChannels, std::vector<float>(srcChannels, 0));
+    srcMask = getPositionalMask(srcMask, srcChannels);
+    dstMask = getPositionalMask(dstMask, dstChannels);
+
+    if (srcMask == AUDIO_CHANNEL_NONE || dstMask == AUDIO_CHANNEL_NONE) {
+        // Channel positions unknown: match the channels by index.
+        for (uint32_t dst = 0; dst < dstChannels; dst++) {
+            for (uint32_t src = 0; src < srcChannels; src++) {
+                if (dst == src || dstChannels == 1 || srcChannels == 1) {
+                    matrix[dst][src] = 1;
+                }
+            }
+        }
+    } else {
+        uint32_t srcIndex = 0;
+        for (uint32_t srcChannel = 1; srcChannel != 0 && srcChannel <= srcMask; srcChannel <<= 1) {
+            if ((srcMask & srcChannel) == 0) {
+                continue;
+            }
+            if (dstMask == AUDIO_CHANNEL_OUT_MONO) {
+                if (srcChannel != AUDIO_CHANNEL_OUT_LOW_FREQUENCY) {
+                    matrix[0][srcIndex] = 1;
+                }
+            } else if (srcMask == AUDIO_CHANNEL_OUT_MONO) {
+                addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_LEFT, srcIndex, 1);
+                addTo(matrix, dstMask, AUDIO_CHANNEL_OUT_FRONT_RIGHT, srcIndex, 1);
+            } else if (!addTo(matrix, dstMask, srcChannel, srcIndex, 1)) {
+                foldChannel(matrix, dstMask, srcChannel, srcIndex);
+            }
+            srcIndex++;
+        }
+    }
+
+    for (uint32_t dst = 0; dst < dstChannels; dst++) {
+        float sum = 0;
+        for (uint32_t src = 0; src < srcChannels; src++) {
+            sum += matrix[dst][src];
+        }
+        if (sum > 1) {
+            for (uint32_t src = 0; src < srcChannels; src++) {
+                matrix[dst][src] /= sum;
+            }
+        }
+    }
+    return matrix;
+}
+
+}  // namespace intel_audio
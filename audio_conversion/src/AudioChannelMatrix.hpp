@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <system/audio.h>
+#include <stdint.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+/**
+ * Computes the mixing matrix of a channel layout change from the channel masks.
+ *
+ * The matrix has one row per destination channel and one column per source channel, in the
+ * order of the channels in the interleaved frames. Channels present on both sides are copied,
+ * the others are folded on the nearest destination channels following the usual downmix rules:
+ * center at -3dB on the front pair, back and side channels on each other or at -3dB on the front
+ * pair, LFE dropped. A mono destination takes the average of the source channels, a mono source
+ * feeds the front pair. Upmixing leaves the channels without source silent.
+ * The coefficients of a row are normalized so that they sum to one at most, hence the mix can
+ * not saturate.
+ */
+class AudioChannelMatrix
+{
+public:
+    typedef std::vector<std::vector<float> > Matrix;
+
+    /**
+     * Computes the mixing matrix.
+     *
+     * If a mask does not describe its channels, i.e. is null, an index mask or does not match the
+     * channel count, the default positional mask of the channel count is used. If there is none,
+     * the channels are matched by index.
+     *
+     * @param[in] srcMask channel mask of the source, input or output one.
+     * @param[in] srcChannels channel count of the source.
+     * @param[in] dstMask channel mask of the destination, input or output one.
+     * @param[in] dstChannels channel count of the destination.
+     *
+     * @return matrix of dstChannels rows by srcChannels columns.
+     */
+    static Matrix getMixMatrix(audio_channel_mask_t srcMask, uint32_t srcChannels,
+                               audio_channel_mask_t dstMask, uint32_t dstChannels);
+
+    /**
+     * Gives the output positional mask describing the channels of a mask.
+     * Input stereo, mono and front back masks are translated to their output counterparts.
+     *
+     * @param[in] mask channel mask, input or output one.
+     * @param[in] channels channel count.
+     *
+     * @return output positional mask, AUDIO_CHANNEL_NONE if the channel positions are unknown.
+     */
+    static audio_channel_mask_t getPositionalMask(audio_channel_mask_t mask, uint32_t channels);
+
+private:
+    /**
+     * Adds the contribution of a source channel to a destination channel, if the latter exists.
+     *
+     * @return true if the destination has the channel, false otherwise.
+     */
+    static bool addTo(Matrix &matrix, audio_channel_mask_t dstMask, uint32_t dstChannel,
+                      uint32_t srcIndex, float coef);
+
+    /**
+     * Adds the contribution of a source channel to a pair of destination channels, if both exist.
+     *
+     * @return true if the destination has both channels, false otherwise.
+     */
+    static bool addToPair(Matrix &matrix, audio_channel_mask_t dstMask, uint32_t dstLeft,
+                          uint32_t dstRight, uint32_t srcIndex, float coef);
+
+    /**
+     * Folds a source channel absent from the destination on the nearest destination channels.
+     */
+    static void foldChannel(Matrix &matrix, audio_channel_mask_t dstMask, uint32_t srcChannel,
+                            uint32_t srcIndex);
+
+    /** @return index of a channel in the interleaved frame of a positional mask. */
+    static uint32_t getIndex(audio_channel_mask_t mask, uint32_t channel);
+
+    static const float mMinus3dB; /**< Gain of a channel spread on two channels. */
+};
+
+}  // namespace intel_audio
@@ -18,6 +18,8 @@
 
 #include "AudioConversion.hpp"
 #include "AudioConverter.hpp"
+#include "AudioFusedConverter.hpp"
+#include "AudioRateController.hpp"
 #include "AudioReformatter.hpp"
 #include "AudioRemapper.hpp"
 #include "AudioResampler.hpp"
@@ -25,6 +27,7 @@
 #include <AudioCommsAssert.hpp>
 #include <utilities/Log.hpp>
 #include <media/AudioBufferProvider.h>
+#include <algorithm>
 #include <stdlib.h>
 
 using audio_comms::utilities::Log;
@@ -40,27 +43,68 @@ const uint32_t AudioConversion::mMinRate = 8000;
 
 const uint32_t AudioConversion::mAllocBufferMultFactor = 2;
 
+const size_t AudioConversion::mMaxParkedPlans = 3;
+
+const uint32_t AudioConversion::mRingBufferMs = 40;
+
+const size_t AudioConversion::mMaxAdaptiveFrames = 8192;
+
+AudioConversion::Plan::Plan()
+    : fusedConverter(NULL),
+      ringFrames(0),
+      ringBytes(0),
+      ringBuffer(NULL)
+{
+    for (int i = 0; i < NbSampleSpecItems; i++) {
+
+        audioConverter[i] = NULL;
+    }
+}
+
 AudioConversion::AudioConversion()
-    : mConvOutBufferIndex(0),
-      mConvOutFrames(0),
-      mConvOutBufferSizeInFrames(0),
-      mConvOutBuffer(NULL)
+    : mFusedConverter(NULL),
+      mFusionEnabled(true),
+      mDitherEnabled(false),
+      mResamplerQuality(ResamplerQualityMedium),
+      mAdaptiveRate(false),
+      mRateController(new AudioRateController()),
+      mPlanConfigured(false),
+      mPlanCacheHits(0),
+      mPlanCacheMisses(0),
+      mRingRead(0),
+      mRingWrite(0),
+      mRingFrames(0),
+      mRingBytes(0),
+      mRingBuffer(NULL)
 {
-    mAudioConverter[ChannelCountSampleSpecItem] = new AudioRemapper(ChannelCountSampleSpecItem);
-    mAudioConverter[FormatSampleSpecItem] = new AudioReformatter(FormatSampleSpecItem);
-    mAudioConverter[RateSampleSpecItem] = new AudioResampler(RateSampleSpecItem);
+    for (int i = 0; i < NbSampleSpecItems; i++) {
+
+        mAudioConverter[i] = NULL;
+    }
+    Plan plan;
+    createConverters(plan);
+    swapPlan(plan);
 }
 
 AudioConversion::~AudioConversion()
 {
+    for (list<Plan>::iterator it = mParkedPlans.begin(); it != mParkedPlans.end(); ++it) {
+
+        releasePlan(*it);
+    }
     for (int i = 0; i < NbSampleSpecItems; i++) {
 
         delete mAudioConverter[i];
         mAudioConverter[i] = NULL;
     }
+    delete mFusedConverter;
+    mFusedConverter = NULL;
+
+    free(mRingBuffer);
+    mRingBuffer = NULL;
 
-    free(mConvOutBuffer);
-    mConvOutBuffer = NULL;
+    delete mRateController;
+    mRateController = NULL;
 }
 
 bool AudioConversion::supportConversion(const SampleSpec &ssSrc, const SampleSpec &ssDst)
@@ -84,24 +128,118 @@ bool AudioConversion::supportResample(uint32_t srcRate, uint32_t dstRate)
     return AudioResampler::supportResample(srcRate, dstRate);
 }
 
+void AudioConversion::setDither(bool enable)
+{
+    // Dither does not change the chain, parked plans are updated rather than dropped.
+    mDitherEnabled = enable;
+    for (list<Plan>::iterator it = mParkedPlans.begin(); it != mParkedPlans.end(); ++it) {
+
+        static_cast<AudioReformatter *>(it->audioConverter[FormatSampleSpecItem])->setDither(
+            enable);
+    }
+    applySettings();
+}
+
+void AudioConversion::setResamplerQuality(ResamplerQuality quality)
+{
+    if (quality == mResamplerQuality) {
+
+        return;
+    }
+    mResamplerQuality = quality;
+    flushPlans();
+    applySettings();
+}
+
+void AudioConversion::setFusion(bool enable)
+{
+    if (enable == mFusionEnabled) {
+
+        return;
+    }
+    mFusionEnabled = enable;
+    flushPlans();
+}
+
+void AudioConversion::setChannelMatrix(const std::vector<std::vector<float> > &matrix)
+{
+    // Set on each routing, only a new matrix invalidates the configured chains.
+    if (matrix == mChannelMatrix) {
+
+        return;
+    }
+    mChannelMatrix = matrix;
+    flushPlans();
+    applySettings();
+}
+
+void AudioConversion::setAdaptiveRate(bool enable)
+{
+    if (enable == mAdaptiveRate) {
+
+        return;
+    }
+    mAdaptiveRate = enable;
+    flushPlans();
+    applySettings();
+}
+
+void AudioConversion::updateRateControl(size_t writtenFrames, ssize_t queuedFrames,
+                                        const struct timespec &timestamp)
+{
+    if (!mAdaptiveRate || !mPlanConfigured) {
+
+        return;
+    }
+    double correction = mRateController->update(
+        writtenFrames, queuedFrames, (int64_t)timestamp.tv_sec * 1000000000ll + timestamp.tv_nsec);
+    static_cast<AudioResampler *>(mAudioConverter[RateSampleSpecItem])->setRateCorrection(
+        correction);
+}
+
+double AudioConversion::getRateDriftPpm() const
+{
+    return mRateController->getDriftPpm();
+}
+
+double AudioConversion::getRateCorrectionPpm() const
+{
+    return static_cast<AudioResampler *>(mAudioConverter[RateSampleSpecItem])->getRateCorrection();
+}
+
 status_t AudioConversion::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
 {
     status_t ret = NO_ERROR;
 
-    emptyConversionChain();
+    mRingRead = 0;
+    mRingWrite = 0;
+    mRateController->reset(ssDst.getSampleRate());
 
-    free(mConvOutBuffer);
+    if (selectPlan(ssSrc, ssDst)) {
 
-    mConvOutBuffer = NULL;
-    mConvOutBufferIndex = 0;
-    mConvOutFrames = 0;
-    mConvOutBufferSizeInFrames = 0;
+        Log::Debug() << __FUNCTION__ << ": reuse the chain configured for these specifications";
+        mPlanCacheHits++;
+        AudioConverterListIterator it;
+        for (it = mActiveAudioConvList.begin(); it != mActiveAudioConvList.end(); ++it) {
+
+            (*it)->reset();
+        }
+        return NO_ERROR;
+    }
+    mPlanCacheMisses++;
+    mPlanConfigured = false;
+
+    emptyConversionChain();
+
+    // The ring buffer of the chain is kept, it is sized again once the chain is configured.
+    mRingFrames = 0;
 
     mSsSrc = ssSrc;
     mSsDst = ssDst;
 
-    if (ssSrc == ssDst) {
+    if (ssSrc == ssDst && !mAdaptiveRate) {
         Log::Debug() << __FUNCTION__ << ": no convertion required";
+        mPlanConfigured = true;
         return ret;
     }
 
@@ -112,6 +250,10 @@ status_t AudioConversion::configure(const SampleSpec &ssSrc, const SampleSpec &s
                  << " format=" << static_cast<int32_t>(ssDst.getFormat())
                  << " channels=" << ssDst.getChannelCount();
 
+    // Intermediate sample specifications keep the source channel mask whatever the channel count.
+    static_cast<AudioRemapper *>(mAudioConverter[ChannelCountSampleSpecItem])->setChannelMasks(
+        ssSrc.getChannelMask(), ssDst.getChannelMask());
+
     SampleSpec tmpSsSrc = ssSrc;
 
     // Start by adding the remapper, it will add consequently the reformatter and resampler
@@ -121,7 +263,21 @@ status_t AudioConversion::configure(const SampleSpec &ssSrc, const SampleSpec &s
 
         return ret;
     }
-    return tmpSsSrc == ssDst ? OK : INVALID_OPERATION;
+    if (tmpSsSrc != ssDst) {
+
+        return INVALID_OPERATION;
+    }
+    if (mFusionEnabled) {
+
+        fuseConverters();
+    }
+    ret = reserveRingBuffer(mSsDst.getSampleRate() * mRingBufferMs / 1000);
+    if (ret != NO_ERROR) {
+
+        return ret;
+    }
+    mPlanConfigured = true;
+    return OK;
 }
 
 status_t AudioConversion::getConvertedBuffer(void *dst,
@@ -132,6 +288,28 @@ status_t AudioConversion::getConvertedBuffer(void *dst,
         Log::Error() << __FUNCTION__ << ": Invalid buffer";
         return BAD_VALUE;
     }
+    ConvertedSpans spans;
+    status_t status = getConvertedBuffer(outFrames, bufferProvider, &spans);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+    size_t firstBytes = mSsDst.convertFramesToBytes(spans.frames[0]);
+    memcpy(dst, spans.raw[0], firstBytes);
+    memcpy(static_cast<char *>(dst) + firstBytes, spans.raw[1],
+           mSsDst.convertFramesToBytes(spans.frames[1]));
+
+    return NO_ERROR;
+}
+
+status_t AudioConversion::getConvertedBuffer(const size_t outFrames,
+                                             AudioBufferProvider *bufferProvider,
+                                             ConvertedSpans *spans)
+{
+    if (!bufferProvider || !spans) {
+        Log::Error() << __FUNCTION__ << ": Invalid buffer";
+        return BAD_VALUE;
+    }
 
     status_t status = NO_ERROR;
 
@@ -140,46 +318,35 @@ status_t AudioConversion::getConvertedBuffer(void *dst,
         return NO_INIT;
     }
 
-    //
-    // Realloc the Output of the conversion if required (with margin of the worst case)
-    //
-    if (mConvOutBufferSizeInFrames < outFrames) {
-
-        mConvOutBufferSizeInFrames = outFrames +
-                                     (mMaxRate / mMinRate) * mAllocBufferMultFactor;
-        int16_t *reallocBuffer =
-            static_cast<int16_t *>(realloc(mConvOutBuffer,
-                                           mSsDst.convertFramesToBytes(
-                                               mConvOutBufferSizeInFrames)));
-        if (reallocBuffer == NULL) {
-            Log::Error() << __FUNCTION__ << ": (frames=" << outFrames << " ): realloc failed";
-            return NO_MEMORY;
-        }
-        mConvOutBuffer = reallocBuffer;
-    }
-
-    size_t framesRequested = outFrames;
+    if (outFrames + 2 * getRingMarginFrames() > mRingFrames) {
 
-    //
-    // Frames are already available from the ConvOutBuffer, empty it first!
-    //
-    if (mConvOutFrames) {
+        Log::Warning() << __FUNCTION__ << ": " << outFrames
+                       << " frames requested at once, growing the ring buffer";
+        status = reserveRingBuffer(outFrames);
+        if (status != NO_ERROR) {
 
-        size_t frameToCopy = min(framesRequested, mConvOutFrames);
-        framesRequested -= frameToCopy;
-        mConvOutBufferIndex += mSsDst.convertFramesToBytes(frameToCopy);
+            return status;
+        }
     }
 
     //
-    // Frames still needed? (_pConvOutBuffer emptied!)
+    // Convert until the ring buffer holds the requested frames. Frames left from the previous
+    // call are read first.
     //
-    while (framesRequested != 0) {
+    while (mRingWrite - mRingRead < outFrames) {
 
-        //
-        // Outputs in the convOutBuffer
-        //
         AudioBufferProvider::Buffer &buffer(mConvInBuffer);
 
+        // Convert up to the end of the ring buffer at most, so that the few frames a conversion
+        // may output beyond the ones requested fit in the spare frames following it.
+        size_t writeOffset = mRingWrite & (mRingFrames - 1);
+        size_t framesRequested = min(outFrames - (mRingWrite - mRingRead),
+                                     mRingFrames - writeOffset);
+        if (mAdaptiveRate) {
+
+            framesRequested = min(framesRequested, mMaxAdaptiveFrames);
+        }
+
         // Calculate the frames we need to get from buffer provider
         // (Runs at ssSrc sample spec)
         // Note that is is rounded up.
@@ -198,20 +365,21 @@ status_t AudioConversion::getConvertedBuffer(void *dst,
         // Convert
         //
         size_t convertedFrames;
-        char *convBuf = reinterpret_cast<char *>(mConvOutBuffer) + mConvOutBufferIndex;
-        status = convert(buffer.raw, reinterpret_cast<void **>(&convBuf),
-                         buffer.frameCount, &convertedFrames);
+        void *convBuf = mRingBuffer + mSsDst.convertFramesToBytes(writeOffset);
+        status = convert(buffer.raw, &convBuf, buffer.frameCount, &convertedFrames);
         if (status != NO_ERROR) {
 
             bufferProvider->releaseBuffer(&buffer);
             return status;
         }
 
-        mConvOutFrames += convertedFrames;
-        mConvOutBufferIndex += mSsDst.convertFramesToBytes(convertedFrames);
+        // Frames converted past the end are moved to the start of the ring buffer.
+        if (writeOffset + convertedFrames > mRingFrames) {
 
-        size_t framesToCopy = min(framesRequested, convertedFrames);
-        framesRequested -= framesToCopy;
+            memcpy(mRingBuffer, mRingBuffer + mSsDst.convertFramesToBytes(mRingFrames),
+                   mSsDst.convertFramesToBytes(writeOffset + convertedFrames - mRingFrames));
+        }
+        mRingWrite += convertedFrames;
 
         //
         // Release the buffer
@@ -219,25 +387,8 @@ status_t AudioConversion::getConvertedBuffer(void *dst,
         bufferProvider->releaseBuffer(&buffer);
     }
 
-    //
-    // Copy requested outFrames from the output buffer of the conversion.
-    // Move the remaining frames to the beginning of the convOut buffer
-    //
-    memcpy(dst, mConvOutBuffer, mSsDst.convertFramesToBytes(outFrames));
-    mConvOutFrames -= outFrames;
-
-    //
-    // Move the remaining frames to the beginning of the convOut buffer
-    //
-    if (mConvOutFrames) {
-
-        memmove(mConvOutBuffer,
-                reinterpret_cast<char *>(mConvOutBuffer) + mSsDst.convertFramesToBytes(outFrames),
-                mSsDst.convertFramesToBytes(mConvOutFrames));
-    }
-
-    // Reset buffer Index
-    mConvOutBufferIndex = 0;
+    getRingSpans(outFrames, spans);
+    mRingRead += outFrames;
 
     return NO_ERROR;
 }
@@ -302,6 +453,265 @@ status_t AudioConversion::convert(const void *src,
     return status;
 }
 
+size_t AudioConversion::getMaxConvertedFrames(size_t inFrames) const
+{
+    size_t frames = inFrames;
+    AudioConverterListConstIterator it;
+    for (it = mActiveAudioConvList.begin(); it != mActiveAudioConvList.end(); ++it) {
+
+        frames = (*it)->getMaxOutFrames(frames);
+    }
+    return frames;
+}
+
+status_t AudioConversion::reserve(size_t inFrames, size_t outFrames)
+{
+    if (mActiveAudioConvList.empty()) {
+
+        return NO_ERROR;
+    }
+    // getConvertedBuffer converts at most the source frames of the frames requested.
+    size_t frames = max(inFrames, AudioUtils::convertSrcToDstInFrames(outFrames, mSsDst, mSsSrc));
+    AudioConverterListIterator it;
+    for (it = mActiveAudioConvList.begin(); it != mActiveAudioConvList.end(); ++it) {
+
+        status_t status = (*it)->reserve(frames);
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+        frames = (*it)->getMaxOutFrames(frames);
+    }
+    if (outFrames + 2 * getRingMarginFrames() > mRingFrames) {
+
+        return reserveRingBuffer(outFrames);
+    }
+    return NO_ERROR;
+}
+
+size_t AudioConversion::getDelayFrames() const
+{
+    // Only the resampler changes the rate: the delays are all at the destination rate.
+    size_t frames = 0;
+    AudioConverterListConstIterator it;
+    for (it = mActiveAudioConvList.begin(); it != mActiveAudioConvList.end(); ++it) {
+
+        frames += (*it)->getDelayFrames();
+    }
+    return frames;
+}
+
+void AudioConversion::fuseConverters()
+{
+    AudioConverter *remapper = mAudioConverter[ChannelCountSampleSpecItem];
+    AudioConverter *reformatter = mAudioConverter[FormatSampleSpecItem];
+
+    AudioConverterListIterator it;
+    for (it = mActiveAudioConvList.begin(); it != mActiveAudioConvList.end(); ++it) {
+
+        AudioConverterListIterator next = it;
+        ++next;
+        if (next == mActiveAudioConvList.end()) {
+
+            return;
+        }
+        if (!((*it == remapper && *next == reformatter) ||
+              (*it == reformatter && *next == remapper))) {
+
+            continue;
+        }
+        if (static_cast<AudioRemapper *>(remapper)->isMatrixMixing()) {
+
+            // Fused kernels only implement the default layouts.
+            return;
+        }
+        if (mFusedConverter->configure((*it)->getSrcSampleSpec(),
+                                       (*next)->getDstSampleSpec()) != NO_ERROR) {
+
+            // No fused kernel, keep the chain.
+            return;
+        }
+        Log::Debug() << __FUNCTION__ << ": remap and reformat fused in a single pass";
+        it = mActiveAudioConvList.erase(it, ++next);
+        mActiveAudioConvList.insert(it, mFusedConverter);
+        return;
+    }
+}
+
+bool AudioConversion::isSameConversion(const SampleSpec &ssSrc, const SampleSpec &ssDst,
+                                       const SampleSpec &planSsSrc, const SampleSpec &planSsDst)
+{
+    return ssSrc == planSsSrc && ssDst == planSsDst &&
+           ssSrc.getChannelMask() == planSsSrc.getChannelMask() &&
+           ssDst.getChannelMask() == planSsDst.getChannelMask();
+}
+
+bool AudioConversion::selectPlan(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    if (mPlanConfigured && isSameConversion(ssSrc, ssDst, mSsSrc, mSsDst)) {
+
+        return true;
+    }
+    list<Plan>::iterator it;
+    for (it = mParkedPlans.begin(); it != mParkedPlans.end(); ++it) {
+
+        if (isSameConversion(ssSrc, ssDst, it->ssSrc, it->ssDst)) {
+
+            break;
+        }
+    }
+    bool hit = (it != mParkedPlans.end());
+
+    if (!mPlanConfigured) {
+
+        if (hit) {
+
+            // Nothing worth parking in the chain in use: drop it for the configured one.
+            swapPlan(*it);
+            releasePlan(*it);
+            mParkedPlans.erase(it);
+        }
+        return hit;
+    }
+    if (!hit) {
+
+        if (mParkedPlans.size() < mMaxParkedPlans) {
+
+            mParkedPlans.push_front(Plan());
+            it = mParkedPlans.begin();
+            createConverters(*it);
+        } else {
+
+            // The least recently used plan gives its converters to the new chain.
+            it = --mParkedPlans.end();
+        }
+    }
+    // Park the chain in use in place of the selected plan, as the most recently used one.
+    swapPlan(*it);
+    mParkedPlans.splice(mParkedPlans.begin(), mParkedPlans, it);
+    if (!hit) {
+
+        applySettings();
+    }
+    return hit;
+}
+
+void AudioConversion::swapPlan(Plan &plan)
+{
+    swap(mSsSrc, plan.ssSrc);
+    swap(mSsDst, plan.ssDst);
+    mActiveAudioConvList.swap(plan.activeAudioConvList);
+    for (int i = 0; i < NbSampleSpecItems; i++) {
+
+        swap(mAudioConverter[i], plan.audioConverter[i]);
+    }
+    swap(mFusedConverter, plan.fusedConverter);
+    swap(mRingFrames, plan.ringFrames);
+    swap(mRingBytes, plan.ringBytes);
+    swap(mRingBuffer, plan.ringBuffer);
+}
+
+void AudioConversion::createConverters(Plan &plan)
+{
+    plan.audioConverter[ChannelCountSampleSpecItem] =
+        new AudioRemapper(ChannelCountSampleSpecItem);
+    plan.audioConverter[FormatSampleSpecItem] = new AudioReformatter(FormatSampleSpecItem);
+    plan.audioConverter[RateSampleSpecItem] = new AudioResampler(RateSampleSpecItem);
+    plan.fusedConverter = new AudioFusedConverter();
+}
+
+void AudioConversion::releasePlan(Plan &plan)
+{
+    for (int i = 0; i < NbSampleSpecItems; i++) {
+
+        delete plan.audioConverter[i];
+        plan.audioConverter[i] = NULL;
+    }
+    delete plan.fusedConverter;
+    plan.fusedConverter = NULL;
+
+    free(plan.ringBuffer);
+    plan.ringBuffer = NULL;
+    plan.ringBytes = 0;
+    plan.activeAudioConvList.clear();
+}
+
+void AudioConversion::flushPlans()
+{
+    for (list<Plan>::iterator it = mParkedPlans.begin(); it != mParkedPlans.end(); ++it) {
+
+        releasePlan(*it);
+    }
+    mParkedPlans.clear();
+    mPlanConfigured = false;
+}
+
+void AudioConversion::applySettings()
+{
+    static_cast<AudioRemapper *>(mAudioConverter[ChannelCountSampleSpecItem])->setChannelMatrix(
+        mChannelMatrix);
+    static_cast<AudioReformatter *>(mAudioConverter[FormatSampleSpecItem])->setDither(
+        mDitherEnabled);
+    static_cast<AudioResampler *>(mAudioConverter[RateSampleSpecItem])->setQuality(
+        mResamplerQuality);
+    static_cast<AudioResampler *>(mAudioConverter[RateSampleSpecItem])->setAdaptive(
+        mAdaptiveRate);
+}
+
+size_t AudioConversion::getRingMarginFrames()
+{
+    return (mMaxRate / mMinRate) * mAllocBufferMultFactor;
+}
+
+status_t AudioConversion::reserveRingBuffer(size_t frames)
+{
+    size_t ringFrames = 1;
+    while (ringFrames < frames + 2 * getRingMarginFrames()) {
+
+        ringFrames <<= 1;
+    }
+    size_t bytes = mSsDst.convertFramesToBytes(ringFrames + getRingMarginFrames());
+    size_t readFrames = mRingWrite - mRingRead;
+
+    if (bytes <= mRingBytes && readFrames == 0) {
+
+        mRingFrames = ringFrames;
+        mRingRead = 0;
+        mRingWrite = 0;
+        return NO_ERROR;
+    }
+    uint8_t *ringBuffer = static_cast<uint8_t *>(malloc(max(bytes, mRingBytes)));
+    if (ringBuffer == NULL) {
+        Log::Error() << __FUNCTION__ << ": (frames=" << frames << " ): malloc failed";
+        return NO_MEMORY;
+    }
+    if (readFrames != 0) {
+
+        ConvertedSpans spans;
+        getRingSpans(readFrames, &spans);
+        size_t firstBytes = mSsDst.convertFramesToBytes(spans.frames[0]);
+        memcpy(ringBuffer, spans.raw[0], firstBytes);
+        memcpy(ringBuffer + firstBytes, spans.raw[1],
+               mSsDst.convertFramesToBytes(spans.frames[1]));
+    }
+    free(mRingBuffer);
+    mRingBuffer = ringBuffer;
+    mRingBytes = max(bytes, mRingBytes);
+    mRingFrames = ringFrames;
+    mRingRead = 0;
+    mRingWrite = readFrames;
+    return NO_ERROR;
+}
+
+void AudioConversion::getRingSpans(size_t frames, ConvertedSpans *spans) const
+{
+    size_t readOffset = mRingRead & (mRingFrames - 1);
+    spans->raw[0] = mRingBuffer + mSsDst.convertFramesToBytes(readOffset);
+    spans->frames[0] = min(frames, mRingFrames - readOffset);
+    spans->raw[1] = mRingBuffer;
+    spans->frames[1] = frames - spans->frames[0];
+}
+
 void AudioConversion::emptyConversionChain()
 {
     mActiveAudioConvList.clear();
@@ -361,8 +771,12 @@ status_t AudioConversion::configureAndAddConverter(SampleSpecItem sampleSpecItem
     }
 
     // Handle the case of destination sample spec item is higher than input sample spec
-    // or destination and source channels policy are different
-    if (!SampleSpec::isSampleSpecItemEqual(sampleSpecItem, *ssSrc, *ssDst)) {
+    // or destination and source channels policy are different.
+    // In adaptive rate mode, the same rates are resampled too, for the ratio to be corrected.
+    if (!SampleSpec::isSampleSpecItemEqual(sampleSpecItem, *ssSrc, *ssDst) ||
+        (sampleSpecItem == RateSampleSpecItem && mAdaptiveRate &&
+         find(mActiveAudioConvList.begin(), mActiveAudioConvList.end(),
+              mAudioConverter[RateSampleSpecItem]) == mActiveAudioConvList.end())) {
 
         return doConfigureAndAddConverter(sampleSpecItem, ssSrc, ssDst);
     }
@@ -50,7 +50,7 @@ AudioConverter::~AudioConverter()
 void *AudioConverter::getOutputBuffer(ssize_t inFrames)
 {
     status_t ret = NO_ERROR;
-    size_t outBufSizeInBytes = mSsDst.convertFramesToBytes(convertSrcToDstInFrames(inFrames));
+    size_t outBufSizeInBytes = mSsDst.convertFramesToBytes(getMaxOutFrames(inFrames));
 
     if (outBufSizeInBytes > mConvertBufSize) {
 
@@ -64,6 +64,11 @@ void *AudioConverter::getOutputBuffer(ssize_t inFrames)
     return (void *)mConvertBuf;
 }
 
+status_t AudioConverter::reserve(size_t inFrames)
+{
+    return getOutputBuffer(inFrames) != NULL ? NO_ERROR : NO_MEMORY;
+}
+
 status_t AudioConverter::allocateConvertBuffer(ssize_t bytes)
 {
     status_t ret = NO_ERROR;
@@ -72,7 +77,7 @@ status_t AudioConverter::allocateConvertBuffer(ssize_t bytes)
     mConvertBufSize = bytes +
                       (audio_bytes_per_sample(mSsDst.getFormat()) * mSsDst.getChannelCount());
 
-    free(mConvertBuf);
+    delete[] mConvertBuf;
     mConvertBuf = NULL;
 
     mConvertBuf = new char[mConvertBufSize];
@@ -94,7 +99,8 @@ status_t AudioConverter::configure(const SampleSpec &ssSrc, const SampleSpec &ss
 
         if (i == mSampleSpecItem) {
 
-            if (SampleSpec::isSampleSpecItemEqual(static_cast<SampleSpecItem>(i), ssSrc, ssDst)) {
+            if (SampleSpec::isSampleSpecItemEqual(static_cast<SampleSpecItem>(i), ssSrc, ssDst) &&
+                !isIdentityAllowed()) {
 
                 // The Sample spec items on which the converter is working
                 // are the same...
@@ -88,6 +88,49 @@ public:
                                       size_t inFrames,
                                       size_t *outFrames);
 
+    /**
+     * Clears the state kept from one conversion to the next, as if the stream was starting.
+     * The configuration and the buffers are kept. Stateless converters have nothing to clear.
+     */
+    virtual void reset() {}
+
+    /**
+     * Sizes the buffers of the converter, so that converting up to a number of frames does not
+     * allocate. To be called after configure, off the audio path.
+     *
+     * @param[in] inFrames largest number of frames in the source sample spec converted at once.
+     *
+     * @return status OK, error code otherwise.
+     */
+    virtual android::status_t reserve(size_t inFrames);
+
+    /**
+     * Gives the group delay of the converter: a converter keeping a history of the frames
+     * outputs each frame late by this delay. Stateless converters do not delay the frames.
+     *
+     * @return delay in frames of the destination sample spec.
+     */
+    virtual size_t getDelayFrames() const { return 0; }
+
+    /** @return source sample specification the converter was last configured with. */
+    const SampleSpec &getSrcSampleSpec() const { return mSsSrc; }
+
+    /** @return destination sample specification the converter was last configured with. */
+    const SampleSpec &getDstSampleSpec() const { return mSsDst; }
+
+    /**
+     * Gives the largest number of frames a conversion may output, used to size the buffer
+     * allocated by the converter or given by the caller.
+     *
+     * @param[in] inFrames frames in the source sample spec.
+     *
+     * @return frames in the destination sample spec.
+     */
+    virtual size_t getMaxOutFrames(ssize_t inFrames) const
+    {
+        return convertSrcToDstInFrames(inFrames);
+    }
+
 protected:
     /**
      * Converts the number of frames in the destination sample spec in a number of frames in the
@@ -109,6 +152,14 @@ protected:
      */
     size_t convertSrcToDstInFrames(ssize_t frames) const;
 
+    /**
+     * Tells if the converter may be configured although the sample spec item it works on is the
+     * same in source and destination, for a converter that processes the samples anyway.
+     *
+     * @return true if it may, false if configure must fail.
+     */
+    virtual bool isIdentityAllowed() const { return false; }
+
     SampleConverter mConvertSamplesFct;
 
     /**
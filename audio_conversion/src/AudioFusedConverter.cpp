@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioFusedConverter"
+
+#include "AudioFusedConverter.hpp"
+#include "PcmFormat.hpp"
+#include <utilities/Log.hpp>
+
+using audio_comms::utilities::Log;
+using namespace android;
+
+namespace intel_audio
+{
+
+/**
+ * Average of two samples, bit exact with the remapper that sums them on signed 64 bits.
+ */
+template <typename Sample>
+static inline Sample average(Sample first, Sample second)
+{
+    return Sample((static_cast<int64_t>(first) + static_cast<int64_t>(second)) >> 1);
+}
+
+/**
+ * Channel layout changes. Channels are removed in the source format, i.e. before reformatting,
+ * and added in the destination format, i.e. after reformatting, as done by the conversion chain.
+ */
+struct LayoutMonoToStereo
+{
+    static const uint32_t mSrcChannels = 1;
+    static const uint32_t mDstChannels = 2;
+    static const bool mRemapFirst = false;
+
+    template <typename Sample>
+    static void remap(const Sample *src, Sample *dst)
+    {
+        dst[0] = src[0];
+        dst[1] = src[0];
+    }
+};
+
+struct LayoutStereoToMono
+{
+    static const uint32_t mSrcChannels = 2;
+    static const uint32_t mDstChannels = 1;
+    static const bool mRemapFirst = true;
+
+    template <typename Sample>
+    static void remap(const Sample *src, Sample *dst)
+    {
+        dst[0] = average(src[0], src[1]);
+    }
+};
+
+struct LayoutStereoToQuad
+{
+    static const uint32_t mSrcChannels = 2;
+    static const uint32_t mDstChannels = 4;
+    static const bool mRemapFirst = false;
+
+    template <typename Sample>
+    static void remap(const Sample *src, Sample *dst)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = src[1];
+    }
+};
+
+struct LayoutQuadToStereo
+{
+    static const uint32_t mSrcChannels = 4;
+    static const uint32_t mDstChannels = 2;
+    static const bool mRemapFirst = true;
+
+    template <typename Sample>
+    static void remap(const Sample *src, Sample *dst)
+    {
+        dst[0] = average(src[0], src[2]);
+        dst[1] = average(src[1], src[3]);
+    }
+};
+
+#define FUSE(src, srcFormat, dst, dstFormat, layout) \
+    { AUDIO_FORMAT_##src, AUDIO_FORMAT_##dst, layout::mSrcChannels, layout::mDstChannels, \
+      static_cast<SampleConverter>( \
+          &AudioFusedConverter::convertFused<srcFormat, dstFormat, layout>) }
+
+#define FUSE_ALL_LAYOUTS(src, srcFormat, dst, dstFormat) \
+    FUSE(src, srcFormat, dst, dstFormat, LayoutMonoToStereo), \
+    FUSE(src, srcFormat, dst, dstFormat, LayoutStereoToMono), \
+    FUSE(src, srcFormat, dst, dstFormat, LayoutStereoToQuad), \
+    FUSE(src, srcFormat, dst, dstFormat, LayoutQuadToStereo)
+
+/**
+ * Float formats are left to the chain, as float to integer conversions may be dithered.
+ */
+const std::vector<AudioFusedConverter::Fusion> AudioFusedConverter::mSupportedFusions = {
+    FUSE_ALL_LAYOUTS(PCM_16_BIT, FormatS16, PCM_8_24_BIT, FormatS24over32),
+    FUSE_ALL_LAYOUTS(PCM_16_BIT, FormatS16, PCM_32_BIT, FormatS32),
+    FUSE_ALL_LAYOUTS(PCM_16_BIT, FormatS16, PCM_24_BIT_PACKED, FormatS24Packed),
+    FUSE_ALL_LAYOUTS(PCM_8_24_BIT, FormatS24over32, PCM_16_BIT, FormatS16),
+    FUSE_ALL_LAYOUTS(PCM_8_24_BIT, FormatS24over32, PCM_32_BIT, FormatS32),
+    FUSE_ALL_LAYOUTS(PCM_8_24_BIT, FormatS24over32, PCM_24_BIT_PACKED, FormatS24Packed),
+    FUSE_ALL_LAYOUTS(PCM_32_BIT, FormatS32, PCM_16_BIT, FormatS16),
+    FUSE_ALL_LAYOUTS(PCM_32_BIT, FormatS32, PCM_8_24_BIT, FormatS24over32),
+    FUSE_ALL_LAYOUTS(PCM_32_BIT, FormatS32, PCM_24_BIT_PACKED, FormatS24Packed),
+    FUSE_ALL_LAYOUTS(PCM_24_BIT_PACKED, FormatS24Packed, PCM_16_BIT, FormatS16),
+    FUSE_ALL_LAYOUTS(PCM_24_BIT_PACKED, FormatS24Packed, PCM_8_24_BIT, FormatS24over32),
+    FUSE_ALL_LAYOUTS(PCM_24_BIT_PACKED, FormatS24Packed, PCM_32_BIT, FormatS32)
+};
+
+#undef FUSE_ALL_LAYOUTS
+#undef FUSE
+
+AudioFusedConverter::AudioFusedConverter()
+    : AudioConverter(ChannelCountSampleSpecItem)
+{
+}
+
+const AudioFusedConverter::Fusion *AudioFusedConverter::findFusion(const SampleSpec &ssSrc,
+                                                                   const SampleSpec &ssDst)
+{
+    if (ssSrc.getSampleRate() != ssDst.getSampleRate()) {
+        return NULL;
+    }
+    // Ignored channels require the channels policy aware remapping of the chain.
+    for (uint32_t channel = 0; channel < ssSrc.getChannelCount(); channel++) {
+        if (ssSrc.getChannelsPolicy(channel) == SampleSpec::Ignore) {
+            return NULL;
+        }
+    }
+    for (uint32_t channel = 0; channel < ssDst.getChannelCount(); channel++) {
+        if (ssDst.getChannelsPolicy(channel) == SampleSpec::Ignore) {
+            return NULL;
+        }
+    }
+    for (auto &candidate : mSupportedFusions) {
+        if (candidate.srcFormat == ssSrc.getFormat() && candidate.dstFormat == ssDst.getFormat() &&
+            candidate.srcChannels == ssSrc.getChannelCount() &&
+            candidate.dstChannels == ssDst.getChannelCount()) {
+            return &candidate;
+        }
+    }
+    return NULL;
+}
+
+bool AudioFusedConverter::supportFusion(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    return findFusion(ssSrc, ssDst) != NULL;
+}
+
+status_t AudioFusedConverter::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    mConvertSamplesFct = NULL;
+
+    const Fusion *fusion = findFusion(ssSrc, ssDst);
+    if (fusion == NULL) {
+        return INVALID_OPERATION;
+    }
+    mSsSrc = ssSrc;
+    mSsDst = ssDst;
+    mConvertSamplesFct = fusion->convertFct;
+    return OK;
+}
+
+template <typename SrcFormat, typename DstFormat, typename Layout>
+status_t AudioFusedConverter::convertFused(const void *src,
+                                           void *dst,
+                                           const size_t inFrames,
+                                           size_t *outFrames)
+{
+    const typename SrcFormat::Sample *srcTyped =
+        static_cast<const typename SrcFormat::Sample *>(src);
+    typename DstFormat::Sample *dstTyped = static_cast<typename DstFormat::Sample *>(dst);
+
+    for (size_t frame = 0; frame < inFrames; frame++) {
+        if (Layout::mRemapFirst) {
+            typename SrcFormat::Sample remapped[Layout::mDstChannels];
+            Layout::remap(srcTyped, remapped);
+            for (uint32_t channel = 0; channel < Layout::mDstChannels; channel++) {
+                dstTyped[channel] = DstFormat::fromQ31(SrcFormat::toQ31(remapped[channel]));
+            }
+        } else {
+            typename DstFormat::Sample reformatted[Layout::mSrcChannels];
+            for (uint32_t channel = 0; channel < Layout::mSrcChannels; channel++) {
+                reformatted[channel] = DstFormat::fromQ31(SrcFormat::toQ31(srcTyped[channel]));
+            }
+            Layout::remap(reformatted, dstTyped);
+        }
+        srcTyped += Layout::mSrcChannels;
+        dstTyped += Layout::mDstChannels;
+    }
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
+}
+}  // namespace intel_audio
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "AudioConverter.hpp"
+#include <vector>
+
+namespace intel_audio
+{
+
+/**
+ * Converter changing both the channel count and the format of the samples in a single pass.
+ *
+ * It replaces an adjacent (remapper, reformatter) or (reformatter, remapper) couple of the
+ * conversion chain for the most common layouts, so that the intermediate buffer is neither written
+ * nor read back. The output is bit exact with the one of the couple it replaces: channels are
+ * removed before reformatting and added after, as the chain does.
+ */
+class AudioFusedConverter : public AudioConverter
+{
+public:
+    AudioFusedConverter();
+
+    /**
+     * Checks if a fused kernel is available for a conversion.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specifications, at the source rate.
+     *
+     * @return true if a fused kernel may replace the remapper and reformatter couple.
+     */
+    static bool supportFusion(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+private:
+    /**
+     * Configures the fused converter.
+     * Unlike other converters, both the channel count and the format may change.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specifications, at the source rate.
+     *
+     * @return OK if a fused kernel is available, INVALID_OPERATION otherwise.
+     */
+    virtual android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Remaps and reformats frames in a single pass.
+     *
+     * @tparam SrcFormat traits of the source format.
+     * @tparam DstFormat traits of the destination format.
+     * @tparam Layout channel layout change, that also tells if remapping comes first.
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, the caller must ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    template <typename SrcFormat, typename DstFormat, typename Layout>
+    android::status_t convertFused(const void *src,
+                                   void *dst,
+                                   const size_t inFrames,
+                                   size_t *outFrames);
+
+    struct Fusion
+    {
+        audio_format_t srcFormat;
+        audio_format_t dstFormat;
+        uint32_t srcChannels;
+        uint32_t dstChannels;
+        SampleConverter convertFct;
+    };
+
+    /**
+     * @return fused kernel description matching the conversion, NULL if none.
+     */
+    static const Fusion *findFusion(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    static const std::vector<Fusion> mSupportedFusions;
+};
+
+}  // namespace intel_audio
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioRateController.hpp"
+#include <algorithm>
+#include <math.h>
+
+namespace intel_audio
+{
+
+// Critically damped loop with a natural pulsation of 0.025 rad/s: the fill error of a period
+// jitter moves the ratio by a few hundred ppm at most, a drift is absorbed within a few minutes.
+const double AudioRateController::mProportionalGain = 50000;
+
+const double AudioRateController::mIntegralGain = 625;
+
+const double AudioRateController::mMaxCorrectionPpm = 500;
+
+const int64_t AudioRateController::mSettleNs = 1000000000ll;
+
+const int64_t AudioRateController::mMinDriftMeasureNs = 1000000000ll;
+
+AudioRateController::AudioRateController()
+{
+    reset(0);
+}
+
+void AudioRateController::reset(uint32_t rate)
+{
+    mRate = rate;
+    mMeasures = 0;
+    mStartNs = 0;
+    mLastNs = 0;
+    mWrittenFrames = 0;
+    mQueuedSum = 0;
+    mSettled = false;
+    mTargetFrames = 0;
+    mReferenceNs = 0;
+    mReferenceFrames = 0;
+    mIntegral = 0;
+    mCorrectionPpm = 0;
+    mDriftPpm = 0;
+}
+
+double AudioRateController::update(size_t writtenFrames, ssize_t queuedFrames, int64_t timeNs)
+{
+    if (mRate == 0) {
+
+        return 0;
+    }
+    if (queuedFrames < 0) {
+        queuedFrames = 0;
+    }
+    mWrittenFrames += writtenFrames;
+    int64_t consumedFrames = mWrittenFrames - (int64_t)queuedFrames;
+
+    if (mMeasures++ == 0) {
+
+        mStartNs = timeNs;
+    }
+    if (!mSettled) {
+
+        // The fill level is averaged while the stream starts, nothing is corrected yet.
+        mQueuedSum += queuedFrames;
+        mLastNs = timeNs;
+        if (timeNs - mStartNs < mSettleNs) {
+
+            return mCorrectionPpm;
+        }
+        mSettled = true;
+        mTargetFrames = mQueuedSum / mMeasures;
+        mReferenceNs = timeNs;
+        mReferenceFrames = consumedFrames;
+        return mCorrectionPpm;
+    }
+
+    double elapsed = (timeNs - mLastNs) / 1e9;
+    mLastNs = timeNs;
+    if (elapsed <= 0) {
+
+        return mCorrectionPpm;
+    }
+    // Too many frames queued means that the ratio produces more frames than consumed.
+    double error = (queuedFrames - mTargetFrames) / mRate;
+    double integral = mIntegral + error * elapsed;
+    double correction = -(mProportionalGain * error + mIntegralGain * integral);
+    if (fabs(correction) < mMaxCorrectionPpm) {
+
+        mIntegral = integral;
+    } else {
+
+        // Saturated: the integral is frozen, so that it does not wind up.
+        correction = std::max(-mMaxCorrectionPpm, std::min(mMaxCorrectionPpm, correction));
+    }
+    mCorrectionPpm = correction;
+
+    int64_t measureNs = timeNs - mReferenceNs;
+    if (measureNs >= mMinDriftMeasureNs) {
+
+        double consumedRate = (consumedFrames - mReferenceFrames) * 1e9 / measureNs;
+        mDriftPpm = (consumedRate / mRate - 1) * 1e6;
+    }
+    return mCorrectionPpm;
+}
+
+}  // namespace intel_audio
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace intel_audio
+{
+
+/**
+ * Proportional integral control of the resampling ratio, compensating the drift between the clock
+ * the frames are produced on and the clock of the device consuming them.
+ *
+ * The device buffer is measured after each write. The fill level it settles on during the first
+ * second of the stream becomes the target, then the fill error, in seconds, is fed to the
+ * controller which outputs the correction of the ratio in parts per million. The integral term
+ * converges on the relative drift of the two clocks, the proportional one brings the buffer back
+ * to its target fill level. A producer paced by the device itself keeps the target fill level,
+ * thus is not corrected.
+ *
+ * Besides, the rate the device actually consumes at is measured against the timestamps of the
+ * measures, and reported as a drift in parts per million.
+ */
+class AudioRateController
+{
+public:
+    AudioRateController();
+
+    /**
+     * Restarts the control and the drift measure, as the device or its rate changed.
+     *
+     * @param[in] rate nominal rate of the device.
+     */
+    void reset(uint32_t rate);
+
+    /**
+     * Updates the control with a measure of the device buffer.
+     *
+     * @param[in] writtenFrames frames written into the device since the previous measure.
+     * @param[in] queuedFrames frames in the device buffer, not consumed yet. Negative after an
+     *                         underrun, the device having consumed beyond the frames written:
+     *                         measured as an empty buffer.
+     * @param[in] timeNs time of the measure in nanoseconds, monotonic clock.
+     *
+     * @return correction of the ratio to apply, in parts per million.
+     */
+    double update(size_t writtenFrames, ssize_t queuedFrames, int64_t timeNs);
+
+    /** @return correction of the ratio, in parts per million. */
+    double getCorrectionPpm() const { return mCorrectionPpm; }
+
+    /**
+     * @return drift of the device rate relative to its nominal rate in parts per million,
+     *         positive if the device consumes faster. Null until measured.
+     */
+    double getDriftPpm() const { return mDriftPpm; }
+
+    /** @return fill level of the device buffer held, null while settling. */
+    double getTargetFrames() const { return mTargetFrames; }
+
+private:
+    uint32_t mRate; /**< Nominal rate of the device. */
+    uint32_t mMeasures; /**< Measures made since reset. */
+    int64_t mStartNs; /**< Time of the first measure. */
+    int64_t mLastNs; /**< Time of the previous measure. */
+    int64_t mWrittenFrames; /**< Frames written since reset. */
+    double mQueuedSum; /**< Sum of the fill levels measured while settling. */
+    bool mSettled; /**< The target fill level is known, the ratio is corrected. */
+    double mTargetFrames; /**< Fill level to hold, null while settling. */
+    int64_t mReferenceNs; /**< Time the drift is measured from, end of the settling. */
+    int64_t mReferenceFrames; /**< Frames consumed by the device at mReferenceNs. */
+    double mIntegral; /**< Integral of the fill error, in seconds squared. */
+    double mCorrectionPpm; /**< Last correction computed. */
+    double mDriftPpm; /**< Last drift measured. */
+
+    /** Proportional gain, in parts per million per second of fill error. */
+    static const double mProportionalGain;
+
+    /** Integral gain, in parts per million per second squared of fill error. */
+    static const double mIntegralGain;
+
+    /** Largest correction, far above the drift of real clocks. */
+    static const double mMaxCorrectionPpm;
+
+    /** Time the fill level is averaged over to get the target, before any correction. */
+    static const int64_t mSettleNs;
+
+    /**
+     * Shortest time the drift is measured over. Frames are consumed by periods, the longer the
+     * measure, the lower the error.
+     */
+    static const int64_t mMinDriftMeasureNs;
+};
+
+}  // namespace intel_audio
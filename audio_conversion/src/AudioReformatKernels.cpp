@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioReformatKernels.hpp"
+#include <stdint.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define REFORMAT_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define REFORMAT_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace intel_audio
+{
+
+/**
+ * Shifts used to move a 16 bits sample within a 32 bits container.
+ * 8_24 format is Q8.23: sign and magnitude held by the 24 least significant bits.
+ * 32 bits format is left justified.
+ */
+static const uint32_t gShiftLeft16 = 16;
+static const uint32_t gShiftRight8 = 8;
+
+//
+// Scalar kernels, reference implementation.
+//
+static void scalarS16ToS24over32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+        dst32[i] = (uint32_t)((int32_t)src16[i] << gShiftLeft16) >> gShiftRight8;
+    }
+}
+
+static void scalarS24over32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+        dst16[i] = (int16_t)(((int32_t)src32[i] << gShiftRight8) >> gShiftLeft16);
+    }
+}
+
+static void scalarS16ToS32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+        dst32[i] = (uint32_t)((int32_t)src16[i] << gShiftLeft16);
+    }
+}
+
+static void scalarS32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+        dst16[i] = (int16_t)((int32_t)src32[i] >> gShiftLeft16);
+    }
+}
+
+static const AudioReformatKernels::Set gScalarKernels = {
+    scalarS16ToS24over32,
+    scalarS24over32ToS16,
+    scalarS16ToS32,
+    scalarS32ToS16
+};
+
+#ifdef REFORMAT_HAVE_X86
+//
+// SSE4.1 kernels: 4 samples per iteration, scalar tail.
+// Built with a target attribute so that the library may still run on CPU without SSE4.1, the
+// kernels are only selected after the CPU has been probed.
+//
+#define REFORMAT_SSE41 __attribute__((target("sse4.1")))
+
+REFORMAT_SSE41
+static void sse41S16ToS24over32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 4 <= samples; i += 4) {
+        __m128i s = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)(src16 + i)));
+        s = _mm_srli_epi32(_mm_slli_epi32(s, gShiftLeft16), gShiftRight8);
+        _mm_storeu_si128((__m128i *)(dst32 + i), s);
+    }
+    scalarS16ToS24over32(src16 + i, dst32 + i, samples - i);
+}
+
+REFORMAT_SSE41
+static void sse41S24over32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src32 + i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src32 + i + 4));
+        lo = _mm_srai_epi32(_mm_slli_epi32(lo, gShiftRight8), gShiftLeft16);
+        hi = _mm_srai_epi32(_mm_slli_epi32(hi, gShiftRight8), gShiftLeft16);
+        // Values already fit on 16 bits, saturation of the pack is never hit.
+        _mm_storeu_si128((__m128i *)(dst16 + i), _mm_packs_epi32(lo, hi));
+    }
+    scalarS24over32ToS16(src32 + i, dst16 + i, samples - i);
+}
+
+REFORMAT_SSE41
+static void sse41S16ToS32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 4 <= samples; i += 4) {
+        __m128i s = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *)(src16 + i)));
+        _mm_storeu_si128((__m128i *)(dst32 + i), _mm_slli_epi32(s, gShiftLeft16));
+    }
+    scalarS16ToS32(src16 + i, dst32 + i, samples - i);
+}
+
+REFORMAT_SSE41
+static void sse41S32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src32 + i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src32 + i + 4));
+        lo = _mm_srai_epi32(lo, gShiftLeft16);
+        hi = _mm_srai_epi32(hi, gShiftLeft16);
+        _mm_storeu_si128((__m128i *)(dst16 + i), _mm_packs_epi32(lo, hi));
+    }
+    scalarS32ToS16(src32 + i, dst16 + i, samples - i);
+}
+
+static const AudioReformatKernels::Set gSse41Kernels = {
+    sse41S16ToS24over32,
+    sse41S24over32ToS16,
+    sse41S16ToS32,
+    sse41S32ToS16
+};
+
+//
+// AVX2 kernels: 8 samples per iteration, SSE4.1 kernels handle the tail.
+//
+#define REFORMAT_AVX2 __attribute__((target("avx2")))
+
+REFORMAT_AVX2
+static void avx2S16ToS24over32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src16 + i)));
+        s = _mm256_srli_epi32(_mm256_slli_epi32(s, gShiftLeft16), gShiftRight8);
+        _mm256_storeu_si256((__m256i *)(dst32 + i), s);
+    }
+    sse41S16ToS24over32(src16 + i, dst32 + i, samples - i);
+}
+
+REFORMAT_AVX2
+static void avx2S24over32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 16 <= samples; i += 16) {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(src32 + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(src32 + i + 8));
+        lo = _mm256_srai_epi32(_mm256_slli_epi32(lo, gShiftRight8), gShiftLeft16);
+        hi = _mm256_srai_epi32(_mm256_slli_epi32(hi, gShiftRight8), gShiftLeft16);
+        // Pack works per 128 bits lane, restore the sample order afterwards.
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dst16 + i), packed);
+    }
+    sse41S24over32ToS16(src32 + i, dst16 + i, samples - i);
+}
+
+REFORMAT_AVX2
+static void avx2S16ToS32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src16 + i)));
+        _mm256_storeu_si256((__m256i *)(dst32 + i), _mm256_slli_epi32(s, gShiftLeft16));
+    }
+    sse41S16ToS32(src16 + i, dst32 + i, samples - i);
+}
+
+REFORMAT_AVX2
+static void avx2S32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 16 <= samples; i += 16) {
+        __m256i lo = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src32 + i)),
+                                       gShiftLeft16);
+        __m256i hi = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(src32 + i + 8)),
+                                       gShiftLeft16);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dst16 + i), packed);
+    }
+    sse41S32ToS16(src32 + i, dst16 + i, samples - i);
+}
+
+static const AudioReformatKernels::Set gAvx2Kernels = {
+    avx2S16ToS24over32,
+    avx2S24over32ToS16,
+    avx2S16ToS32,
+    avx2S32ToS16
+};
+#endif /* REFORMAT_HAVE_X86 */
+
+#ifdef REFORMAT_HAVE_NEON
+//
+// NEON kernels: 8 samples per iteration, scalar tail.
+//
+static void neonS16ToS24over32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t s = vld1q_s16(src16 + i);
+        uint32x4_t lo = vreinterpretq_u32_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(s)),
+                                                          gShiftLeft16));
+        uint32x4_t hi = vreinterpretq_u32_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(s)),
+                                                          gShiftLeft16));
+        vst1q_u32(dst32 + i, vshrq_n_u32(lo, gShiftRight8));
+        vst1q_u32(dst32 + i + 4, vshrq_n_u32(hi, gShiftRight8));
+    }
+    scalarS16ToS24over32(src16 + i, dst32 + i, samples - i);
+}
+
+static void neonS24over32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        int32x4_t lo = vshlq_n_s32(vreinterpretq_s32_u32(vld1q_u32(src32 + i)), gShiftRight8);
+        int32x4_t hi = vshlq_n_s32(vreinterpretq_s32_u32(vld1q_u32(src32 + i + 4)),
+                                   gShiftRight8);
+        vst1q_s16(dst16 + i, vcombine_s16(vshrn_n_s32(lo, gShiftLeft16),
+                                          vshrn_n_s32(hi, gShiftLeft16)));
+    }
+    scalarS24over32ToS16(src32 + i, dst16 + i, samples - i);
+}
+
+static void neonS16ToS32(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t s = vld1q_s16(src16 + i);
+        int32x4_t lo = vshlq_n_s32(vmovl_s16(vget_low_s16(s)), gShiftLeft16);
+        int32x4_t hi = vshlq_n_s32(vmovl_s16(vget_high_s16(s)), gShiftLeft16);
+        vst1q_u32(dst32 + i, vreinterpretq_u32_s32(lo));
+        vst1q_u32(dst32 + i + 4, vreinterpretq_u32_s32(hi));
+    }
+    scalarS16ToS32(src16 + i, dst32 + i, samples - i);
+}
+
+static void neonS32ToS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i = 0;
+
+    for (; i + 8 <= samples; i += 8) {
+        int32x4_t lo = vreinterpretq_s32_u32(vld1q_u32(src32 + i));
+        int32x4_t hi = vreinterpretq_s32_u32(vld1q_u32(src32 + i + 4));
+        vst1q_s16(dst16 + i, vcombine_s16(vshrn_n_s32(lo, gShiftLeft16),
+                                          vshrn_n_s32(hi, gShiftLeft16)));
+    }
+    scalarS32ToS16(src32 + i, dst16 + i, samples - i);
+}
+
+static const AudioReformatKernels::Set gNeonKernels = {
+    neonS16ToS24over32,
+    neonS24over32ToS16,
+    neonS16ToS32,
+    neonS32ToS16
+};
+#endif /* REFORMAT_HAVE_NEON */
+
+bool AudioReformatKernels::isSupported(Isa isa)
+{
+    switch (isa) {
+    case Scalar:
+        return true;
+#ifdef REFORMAT_HAVE_X86
+    case Sse41:
+        return __builtin_cpu_supports("sse4.1");
+    case Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef REFORMAT_HAVE_NEON
+    case Neon:
+        // NEON is part of the ABI whenever the compiler is allowed to emit it.
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+const AudioReformatKernels::Set *AudioReformatKernels::getKernels(Isa isa)
+{
+    if (!isSupported(isa)) {
+        return NULL;
+    }
+    switch (isa) {
+#ifdef REFORMAT_HAVE_X86
+    case Sse41:
+        return &gSse41Kernels;
+    case Avx2:
+        return &gAvx2Kernels;
+#endif
+#ifdef REFORMAT_HAVE_NEON
+    case Neon:
+        return &gNeonKernels;
+#endif
+    default:
+        return &gScalarKernels;
+    }
+}
+
+static AudioReformatKernels::Isa probeBestIsa()
+{
+    static const AudioReformatKernels::Isa preferred[] = {
+        AudioReformatKernels::Avx2,
+        AudioReformatKernels::Sse41,
+        AudioReformatKernels::Neon
+    };
+    for (auto isa : preferred) {
+        if (AudioReformatKernels::isSupported(isa)) {
+            return isa;
+        }
+    }
+    return AudioReformatKernels::Scalar;
+}
+
+AudioReformatKernels::Isa AudioReformatKernels::getBestIsa()
+{
+    // Thread safe initialization guaranteed by C++11 function static.
+    static const Isa bestIsa = probeBestIsa();
+    return bestIsa;
+}
+
+const char *AudioReformatKernels::getIsaName(Isa isa)
+{
+    static const char *const names[NbIsa] = {
+        "scalar", "sse4.1", "avx2", "neon"
+    };
+    return (isa < NbIsa) ? names[isa] : "unknown";
+}
+
+}  // namespace intel_audio
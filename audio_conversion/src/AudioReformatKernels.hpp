@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stddef.h>
+
+namespace intel_audio
+{
+
+/**
+ * Sample reformatting kernels.
+ *
+ * Each kernel works on a flat array of interleaved samples, it does not care about channels.
+ * Several implementations of the same kernel may be available according to the instruction set
+ * supported by the CPU. All implementations of a given kernel are bit exact with the scalar one.
+ */
+class AudioReformatKernels
+{
+public:
+    /**
+     * Instruction sets for which kernels may be provided.
+     */
+    enum Isa
+    {
+        Scalar,
+        Sse41,
+        Avx2,
+        Neon,
+        NbIsa
+    };
+
+    /**
+     * Reformat kernel prototype.
+     *
+     * @param[in] src source samples.
+     * @param[out] dst destination samples.
+     * @param[in] samples number of samples (i.e. frames x channels) to reformat.
+     */
+    typedef void (*Kernel)(const void *src, void *dst, size_t samples);
+
+    /**
+     * Set of reformat kernels implemented for a given instruction set.
+     */
+    struct Set
+    {
+        Kernel s16ToS24over32; /**< signed 16 bits to signed 24 bits over 32 bits (Q8.23). */
+        Kernel s24over32ToS16; /**< signed 24 bits over 32 bits (Q8.23) to signed 16 bits. */
+        Kernel s16ToS32; /**< signed 16 bits to signed 32 bits (left justified). */
+        Kernel s32ToS16; /**< signed 32 bits (left justified) to signed 16 bits. */
+    };
+
+    /**
+     * Checks if the kernels of an instruction set are both built in and supported by the CPU.
+     *
+     * @param[in] isa instruction set to check.
+     *
+     * @return true if the kernels of this instruction set can be used, false otherwise.
+     */
+    static bool isSupported(Isa isa);
+
+    /**
+     * Get the kernels of a given instruction set.
+     *
+     * @param[in] isa instruction set requested.
+     *
+     * @return kernel set of the instruction set if supported, NULL otherwise.
+     */
+    static const Set *getKernels(Isa isa);
+
+    /**
+     * Get the most efficient instruction set supported by the running CPU.
+     * CPU features are probed once, upon first call.
+     *
+     * @return most efficient instruction set, Scalar in the worst case.
+     */
+    static Isa getBestIsa();
+
+    /**
+     * @param[in] isa instruction set.
+     *
+     * @return literal name of the instruction set.
+     */
+    static const char *getIsaName(Isa isa);
+};
+
+}  // namespace intel_audio
@@ -18,7 +18,9 @@
 #define LOG_TAG "AudioReformatter"
 
 #include "AudioReformatter.hpp"
+#include "PcmFormat.hpp"
 #include <utilities/Log.hpp>
+#include <math.h>
 #include <utility>
 #include <vector>
 
@@ -28,26 +30,63 @@ using namespace android;
 namespace intel_audio
 {
 
-static const std::vector<std::pair<audio_format_t, audio_format_t> > mSupportedConversions = {
-    { AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_8_24_BIT },
-    { AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_32_BIT },
-    { AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_16_BIT },
-    { AUDIO_FORMAT_PCM_32_BIT, AUDIO_FORMAT_PCM_16_BIT }
+#define REFORMAT(src, dst, fct) \
+    { AUDIO_FORMAT_##src, AUDIO_FORMAT_##dst, static_cast<SampleConverter>(fct) }
+
+const std::vector<AudioReformatter::Reformat> AudioReformatter::mSupportedConversions = {
+    REFORMAT(PCM_16_BIT, PCM_8_24_BIT, &AudioReformatter::convertS16toS24over32),
+    REFORMAT(PCM_16_BIT, PCM_32_BIT, &AudioReformatter::convertS16toS32),
+    REFORMAT(PCM_16_BIT, PCM_24_BIT_PACKED,
+             (&AudioReformatter::convertGeneric<FormatS16, FormatS24Packed>)),
+    REFORMAT(PCM_16_BIT, PCM_FLOAT, (&AudioReformatter::convertGeneric<FormatS16, FormatFloat>)),
+
+    REFORMAT(PCM_8_24_BIT, PCM_16_BIT, &AudioReformatter::convertS24over32toS16),
+    REFORMAT(PCM_8_24_BIT, PCM_32_BIT,
+             (&AudioReformatter::convertGeneric<FormatS24over32, FormatS32>)),
+    REFORMAT(PCM_8_24_BIT, PCM_24_BIT_PACKED,
+             (&AudioReformatter::convertGeneric<FormatS24over32, FormatS24Packed>)),
+    REFORMAT(PCM_8_24_BIT, PCM_FLOAT,
+             (&AudioReformatter::convertGeneric<FormatS24over32, FormatFloat>)),
+
+    REFORMAT(PCM_32_BIT, PCM_16_BIT, &AudioReformatter::convertS32toS16),
+    REFORMAT(PCM_32_BIT, PCM_8_24_BIT,
+             (&AudioReformatter::convertGeneric<FormatS32, FormatS24over32>)),
+    REFORMAT(PCM_32_BIT, PCM_24_BIT_PACKED,
+             (&AudioReformatter::convertGeneric<FormatS32, FormatS24Packed>)),
+    REFORMAT(PCM_32_BIT, PCM_FLOAT, (&AudioReformatter::convertGeneric<FormatS32, FormatFloat>)),
+
+    REFORMAT(PCM_24_BIT_PACKED, PCM_16_BIT,
+             (&AudioReformatter::convertGeneric<FormatS24Packed, FormatS16>)),
+    REFORMAT(PCM_24_BIT_PACKED, PCM_8_24_BIT,
+             (&AudioReformatter::convertGeneric<FormatS24Packed, FormatS24over32>)),
+    REFORMAT(PCM_24_BIT_PACKED, PCM_32_BIT,
+             (&AudioReformatter::convertGeneric<FormatS24Packed, FormatS32>)),
+    REFORMAT(PCM_24_BIT_PACKED, PCM_FLOAT,
+             (&AudioReformatter::convertGeneric<FormatS24Packed, FormatFloat>)),
+
+    REFORMAT(PCM_FLOAT, PCM_16_BIT, &AudioReformatter::convertFromFloat<FormatS16>),
+    REFORMAT(PCM_FLOAT, PCM_8_24_BIT, &AudioReformatter::convertFromFloat<FormatS24over32>),
+    REFORMAT(PCM_FLOAT, PCM_32_BIT, &AudioReformatter::convertFromFloat<FormatS32>),
+    REFORMAT(PCM_FLOAT, PCM_24_BIT_PACKED, &AudioReformatter::convertFromFloat<FormatS24Packed>)
 };
 
+#undef REFORMAT
 
-const uint32_t AudioReformatter::mReformatterShiftLeft16 = 16;
-const uint32_t AudioReformatter::mReformatterShiftRight8 = 8;
+/** Seed of the dither generator, any non null value would do. */
+static const uint32_t gDitherSeed = 0x1F2E3D4C;
 
 AudioReformatter::AudioReformatter(SampleSpecItem sampleSpecItem)
-    : AudioConverter(sampleSpecItem)
+    : AudioConverter(sampleSpecItem),
+      mKernels(NULL),
+      mDitherEnabled(false),
+      mDitherSeed(gDitherSeed)
 {
 }
 
 bool AudioReformatter::supportReformat(audio_format_t srcFormat, audio_format_t dstFormat)
 {
     for (auto &candidate : mSupportedConversions) {
-        if (candidate.first == srcFormat && dstFormat == candidate.second) {
+        if (candidate.srcFormat == srcFormat && dstFormat == candidate.dstFormat) {
             return true;
         }
     }
@@ -60,39 +99,28 @@ status_t AudioReformatter::configure(const SampleSpec &ssSrc, const SampleSpec &
     if (status != NO_ERROR) {
         return status;
     }
-    if (not supportReformat(ssSrc.getFormat(), ssDst.getFormat())) {
-        Log::Error() << __FUNCTION__ << ": reformatter not available";
-        return INVALID_OPERATION;
-    }
+    // CPU features are probed only once, best kernels are then picked for the whole process.
+    AudioReformatKernels::Isa isa = AudioReformatKernels::getBestIsa();
+    mKernels = AudioReformatKernels::getKernels(isa);
+    Log::Verbose() << __FUNCTION__ << ": using " << AudioReformatKernels::getIsaName(isa)
+                   << " kernels";
 
-    switch (ssSrc.getFormat()) {
-    case AUDIO_FORMAT_PCM_16_BIT:
-        if (ssDst.getFormat() == AUDIO_FORMAT_PCM_8_24_BIT) {
-            mConvertSamplesFct =
-                static_cast<SampleConverter>(&AudioReformatter::convertS16toS24over32);
-            return OK;
-        } else if (ssDst.getFormat() == AUDIO_FORMAT_PCM_32_BIT) {
-            mConvertSamplesFct =
-                static_cast<SampleConverter>(&AudioReformatter::convertS16toS32);
-            return OK;
-        }
-        return INVALID_OPERATION;
-    case AUDIO_FORMAT_PCM_8_24_BIT:
-        if (ssDst.getFormat() == AUDIO_FORMAT_PCM_16_BIT) {
-            mConvertSamplesFct =
-                static_cast<SampleConverter>(&AudioReformatter::convertS24over32toS16);
-            return OK;
-        }
-        return INVALID_OPERATION;
-    case AUDIO_FORMAT_PCM_32_BIT:
-        if (ssDst.getFormat() == AUDIO_FORMAT_PCM_16_BIT) {
-            mConvertSamplesFct =
-                static_cast<SampleConverter>(&AudioReformatter::convertS32toS16);
+    reset();
+
+    for (auto &candidate : mSupportedConversions) {
+        if (candidate.srcFormat == ssSrc.getFormat() &&
+            candidate.dstFormat == ssDst.getFormat()) {
+            mConvertSamplesFct = candidate.convertFct;
             return OK;
         }
-    default:
-        return INVALID_OPERATION;
     }
+    Log::Error() << __FUNCTION__ << ": reformatter not available";
+    return INVALID_OPERATION;
+}
+
+void AudioReformatter::reset()
+{
+    mDitherSeed = gDitherSeed;
 }
 
 status_t AudioReformatter::convertS16toS24over32(const void *src,
@@ -100,16 +128,7 @@ status_t AudioReformatter::convertS16toS24over32(const void *src,
                                                  const size_t inFrames,
                                                  size_t *outFrames)
 {
-    size_t frameIndex;
-    const int16_t *src16 = (const int16_t *)src;
-    uint32_t *dst32 = (uint32_t *)dst;
-    size_t n = inFrames * mSsSrc.getChannelCount();
-
-    for (frameIndex = 0; frameIndex < n; frameIndex++) {
-
-        *(dst32 + frameIndex) = (uint32_t)((int32_t)*(src16 + frameIndex) <<
-                                           mReformatterShiftLeft16) >> mReformatterShiftRight8;
-    }
+    mKernels->s16ToS24over32(src, dst, inFrames * mSsSrc.getChannelCount());
 
     // Transformation is "iso" frames
     *outFrames = inFrames;
@@ -122,17 +141,7 @@ status_t AudioReformatter::convertS24over32toS16(const void *src,
                                                  const size_t inFrames,
                                                  size_t *outFrames)
 {
-    const uint32_t *src32 = (const uint32_t *)src;
-    int16_t *dst16 = (int16_t *)dst;
-    size_t frameIndex;
-
-    size_t n = inFrames * mSsSrc.getChannelCount();
-
-    for (frameIndex = 0; frameIndex < n; frameIndex++) {
-
-        *(dst16 + frameIndex) = (int16_t)(((int32_t)(*(src32 + frameIndex)) <<
-                                           mReformatterShiftRight8) >> mReformatterShiftLeft16);
-    }
+    mKernels->s24over32ToS16(src, dst, inFrames * mSsSrc.getChannelCount());
 
     // Transformation is "iso" frames
     *outFrames = inFrames;
@@ -143,13 +152,8 @@ status_t AudioReformatter::convertS24over32toS16(const void *src,
 status_t AudioReformatter::convertS16toS32(const void *src, void *dst, const size_t inFrames,
                                            size_t *outFrames)
 {
-    const int16_t *src16 = (const int16_t *)src;
-    uint32_t *dst32 = (uint32_t *)dst;
+    mKernels->s16ToS32(src, dst, inFrames * mSsSrc.getChannelCount());
 
-    for (size_t frameIndex = 0; frameIndex < inFrames * mSsSrc.getChannelCount(); frameIndex++) {
-        *(dst32 + frameIndex) = (uint32_t)((int32_t)*(src16 + frameIndex) <<
-                                           mReformatterShiftLeft16);
-    }
     // Transformation is "iso" frames
     *outFrames = inFrames;
     return NO_ERROR;
@@ -158,15 +162,84 @@ status_t AudioReformatter::convertS16toS32(const void *src, void *dst, const siz
 status_t AudioReformatter::convertS32toS16(const void *src, void *dst, const size_t inFrames,
                                            size_t *outFrames)
 {
-    const uint32_t *src32 = (const uint32_t *)src;
-    int16_t *dst16 = (int16_t *)dst;
+    mKernels->s32ToS16(src, dst, inFrames * mSsSrc.getChannelCount());
 
-    for (size_t frameIndex = 0; frameIndex < inFrames * mSsSrc.getChannelCount(); frameIndex++) {
-        *(dst16 + frameIndex) = (int16_t)(((int32_t)(*(src32 + frameIndex))) >>
-                                          mReformatterShiftLeft16);
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
+}
+
+template <typename SrcFormat, typename DstFormat>
+status_t AudioReformatter::convertGeneric(const void *src,
+                                          void *dst,
+                                          const size_t inFrames,
+                                          size_t *outFrames)
+{
+    const typename SrcFormat::Sample *srcTyped =
+        static_cast<const typename SrcFormat::Sample *>(src);
+    typename DstFormat::Sample *dstTyped = static_cast<typename DstFormat::Sample *>(dst);
+    size_t n = inFrames * mSsSrc.getChannelCount();
+
+    for (size_t i = 0; i < n; i++) {
+        dstTyped[i] = DstFormat::fromQ31(SrcFormat::toQ31(srcTyped[i]));
     }
     // Transformation is "iso" frames
     *outFrames = inFrames;
     return NO_ERROR;
 }
+
+template <typename DstFormat>
+status_t AudioReformatter::convertFromFloat(const void *src,
+                                            void *dst,
+                                            const size_t inFrames,
+                                            size_t *outFrames)
+{
+    const float *srcFloat = static_cast<const float *>(src);
+    typename DstFormat::Sample *dstTyped = static_cast<typename DstFormat::Sample *>(dst);
+    size_t n = inFrames * mSsSrc.getChannelCount();
+
+    // Full scale of the destination, and its bounds, in LSB of the destination resolution.
+    const double scale = static_cast<double>(1ull << (DstFormat::mResolution - 1));
+    const double maxValue = scale - 1;
+    const double minValue = -scale;
+    const uint32_t shift = 32 - DstFormat::mResolution;
+    // Dithering a 32 bits destination is meaningless, float mantissa is only 24 bits.
+    const bool dither = mDitherEnabled && (DstFormat::mResolution < 32);
+
+    for (size_t i = 0; i < n; i++) {
+        double sample = srcFloat[i] * scale;
+        if (dither) {
+            sample += getNextDither();
+        }
+        sample = floor(sample + 0.5);
+        // Saturate, written so that NaN ends up as silence.
+        if (sample > maxValue) {
+            sample = maxValue;
+        } else if (sample < minValue) {
+            sample = minValue;
+        } else if (!(sample == sample)) {
+            sample = 0;
+        }
+        dstTyped[i] = DstFormat::fromQ31((int32_t)((uint32_t)(int32_t)sample << shift));
+    }
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
+}
+
+float AudioReformatter::getNextDither()
+{
+    // Numerical Recipes LCG, cheap and good enough for noise generation.
+    static const uint32_t multiplier = 1664525;
+    static const uint32_t increment = 1013904223;
+    static const float scale = 1.0f / 4294967296.0f;
+
+    mDitherSeed = mDitherSeed * multiplier + increment;
+    float first = mDitherSeed * scale;
+    mDitherSeed = mDitherSeed * multiplier + increment;
+    float second = mDitherSeed * scale;
+
+    // Difference of two uniform distributions gives a triangular distribution.
+    return first - second;
+}
 }  // namespace intel_audio
@@ -18,6 +18,9 @@
 #pragma once
 
 #include "AudioConverter.hpp"
+#include "AudioReformatKernels.hpp"
+#include "Pcm24Packed.hpp"
+#include <vector>
 
 namespace intel_audio
 {
@@ -30,7 +33,32 @@ public:
 
     static bool supportReformat(audio_format_t srcFormat, audio_format_t dstFormat);
 
+    /**
+     * Enables or disables the dither applied when reducing float samples to integer samples.
+     * Dither is a triangular (TPDF) noise of +/-1 LSB of the destination format, it decorrelates
+     * the quantization error from the signal. It is disabled by default.
+     *
+     * @param[in] enable true to dither, false to only round.
+     */
+    void setDither(bool enable) { mDitherEnabled = enable; }
+
+    /**
+     * Restarts the dither sequence, so that a given stream is reproducible.
+     */
+    virtual void reset();
+
 private:
+    /**
+     * Reformatting operation supported, and function implementing it.
+     */
+    struct Reformat
+    {
+        audio_format_t srcFormat;
+        audio_format_t dstFormat;
+        SampleConverter convertFct;
+    };
+    static const std::vector<Reformat> mSupportedConversions;
+
     /**
      * Configures the context of reformatting operation to do.
      *
@@ -115,13 +143,58 @@ private:
                                       size_t *outFrames);
 
     /**
-     * Used to do 8-bits right shitfs during reformatting operation.
+     * Converts (Reformats) audio samples between two integer formats or from an integer format to
+     * float. Samples are moved through a left justified signed 32 bits representation, which is
+     * lossless for all integer formats supported.
+     *
+     * @tparam SrcFormat source format traits.
+     * @tparam DstFormat destination format traits.
+     * @param[in]  src Source buffer containing audio samples to reformat.
+     * @param[out] dst Destination buffer for reformatted audio samples.
+     * @param[in]  inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return status NO_ERROR is always returned.
+     */
+    template <typename SrcFormat, typename DstFormat>
+    android::status_t convertGeneric(const void *src,
+                                     void *dst,
+                                     const size_t inFrames,
+                                     size_t *outFrames);
+
+    /**
+     * Converts (Reformats) float audio samples to an integer format.
+     * Samples are scaled to the resolution of the destination format, optionally dithered,
+     * rounded to nearest and saturated.
+     *
+     * @tparam DstFormat destination format traits.
+     * @param[in]  src Source buffer containing audio samples to reformat.
+     * @param[out] dst Destination buffer for reformatted audio samples.
+     * @param[in]  inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return status NO_ERROR is always returned.
+     */
+    template <typename DstFormat>
+    android::status_t convertFromFloat(const void *src,
+                                       void *dst,
+                                       const size_t inFrames,
+                                       size_t *outFrames);
+
+    /**
+     * Computes the next triangular dither value.
+     *
+     * @return dither, in LSB, within ]-1, 1[.
      */
-    static const uint32_t mReformatterShiftRight8;
+    inline float getNextDither();
 
     /**
-     * Used to do 16-bits left shitfs during reformatting operation.
+     * Kernels used to reformat the samples, selected at configure step according to the
+     * instruction sets supported by the CPU.
      */
-    static const uint32_t mReformatterShiftLeft16;
+    const AudioReformatKernels::Set *mKernels;
+
+    bool mDitherEnabled; /**< true if float to integer conversions shall be dithered. */
+    uint32_t mDitherSeed; /**< State of the pseudo random generator used for dithering. */
 };
 }  // namespace intel_audio
@@ -18,7 +18,10 @@
 #define LOG_TAG "AudioRemapper"
 
 #include "AudioRemapper.hpp"
+#include "PcmFormat.hpp"
 #include <utilities/Log.hpp>
+#include <algorithm>
+#include <cmath>
 
 using namespace android;
 using audio_comms::utilities::Log;
@@ -32,84 +35,160 @@ template <>
 struct AudioRemapper::formatSupported<uint32_t> {};
 template <>
 struct AudioRemapper::formatSupported<int32_t> {};
+template <>
+struct AudioRemapper::formatSupported<Pcm24Packed> {};
+template <>
+struct AudioRemapper::formatSupported<float> {};
+
+/**
+ * Type used to sum samples of a frame.
+ * Integer samples are summed on signed 64 bits to prevent from overflow, and the sum is divided
+ * rounding to the lower integer, as an arithmetic shift does. Float samples are summed as is.
+ */
+template <typename type>
+struct AudioRemapper::Accumulator
+{
+    typedef int64_t Type;
+
+    static Type divide(Type sum, const ChannelAverage &average)
+    {
+        if (average.shift >= 0) {
+            return sum >> average.shift;
+        }
+        // Estimate from the reciprocal, then fix the last unit lost by the rounding of the
+        // reciprocal, which is cheaper than a division.
+        Type count = average.count;
+        Type quotient = std::floor(sum * average.reciprocal);
+        if (quotient * count > sum) {
+            quotient--;
+        } else if ((quotient + 1) * count <= sum) {
+            quotient++;
+        }
+        return quotient;
+    }
+};
+
+template <>
+struct AudioRemapper::Accumulator<float>
+{
+    typedef float Type;
+
+    static Type divide(Type sum, const ChannelAverage &average)
+    {
+        return sum * static_cast<float>(average.reciprocal);
+    }
+};
 
 static const size_t mono = 1;
 static const size_t stereo = 2;
 static const size_t quad = 4;
-static const size_t multichan8 = 8;
 
-const std::vector < std::pair < uint32_t, uint32_t >> AudioRemapper::mSupportedConversions = {
+const size_t AudioRemapper::mMatrixBlockFrames;
+
+const std::vector < std::pair < uint32_t, uint32_t >> AudioRemapper::mPolicyAwareConversions = {
     { mono, stereo },
     { mono, quad },
-    { mono, multichan8 },
     { stereo, stereo },
     { stereo, mono },
     { stereo, quad },
-    { stereo, multichan8 },
     { quad, mono },
-    { quad, stereo },
-    { multichan8, mono },
-    { multichan8, stereo }
+    { quad, stereo }
 };
 
 AudioRemapper::AudioRemapper(SampleSpecItem sampleSpecItem)
-    : AudioConverter(sampleSpecItem)
+    : AudioConverter(sampleSpecItem),
+      mSrcChannelMask(AUDIO_CHANNEL_NONE),
+      mDstChannelMask(AUDIO_CHANNEL_NONE),
+      mMatrixMixing(false)
 {
 }
 
 bool AudioRemapper::supportRemap(uint32_t srcChannels, uint32_t dstChannels)
 {
-    for (auto &candidate : mSupportedConversions) {
-        if (candidate.first == srcChannels && dstChannels == candidate.second) {
-            return true;
-        }
-    }
-    return false;
+    // Couples without policy aware routine are mixed through a matrix.
+    return (srcChannels != 0) && (dstChannels != 0);
+}
+
+void AudioRemapper::setChannelMasks(audio_channel_mask_t srcMask, audio_channel_mask_t dstMask)
+{
+    mSrcChannelMask = srcMask;
+    mDstChannelMask = dstMask;
+}
+
+void AudioRemapper::setChannelMatrix(const AudioChannelMatrix::Matrix &matrix)
+{
+    mChannelMatrix = matrix;
 }
 
 status_t AudioRemapper::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
 {
+    mMatrixMixing = false;
+
     status_t ret = AudioConverter::configure(ssSrc, ssDst);
     if (ret != NO_ERROR) {
         return ret;
     }
     switch (ssSrc.getFormat()) {
     case AUDIO_FORMAT_PCM_16_BIT:
-        return configure<int16_t>();
+        return configure<FormatS16>();
     case AUDIO_FORMAT_PCM_8_24_BIT:
-        return configure<uint32_t>();
+        return configure<FormatS24over32>();
     case AUDIO_FORMAT_PCM_32_BIT:
-        return configure<int32_t>();
+        return configure<FormatS32>();
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        return configure<FormatS24Packed>();
+    case AUDIO_FORMAT_PCM_FLOAT:
+        return configure<FormatFloat>();
     default:
         return INVALID_OPERATION;
     }
 }
 
 
-template <typename type>
+template <typename Format>
 android::status_t AudioRemapper::configure()
 {
+    typedef typename Format::Sample type;
     formatSupported<type>();
 
-    if (not supportRemap(mSsSrc.getChannelCount(), mSsDst.getChannelCount())) {
+    uint32_t srcChannels = mSsSrc.getChannelCount();
+    uint32_t dstChannels = mSsDst.getChannelCount();
+    if (not supportRemap(srcChannels, dstChannels)) {
         Log::Error() << __FUNCTION__ << ": remapper not available";
         return INVALID_OPERATION;
     }
 
-    switch (mSsSrc.getChannelCount()) {
-    case mono:
-        switch (mSsDst.getChannelCount()) {
-        case stereo:
-        case quad:
-        case multichan8:
-            mConvertSamplesFct =
-                static_cast<SampleConverter>(&AudioRemapper::convertMultiNToMultiM<type> );
-            return OK;
+    bool policyAware = false;
+    for (auto &candidate : mPolicyAwareConversions) {
+        if (candidate.first == srcChannels && candidate.second == dstChannels) {
+            policyAware = true;
         }
-        return INVALID_OPERATION;
+    }
+    bool matrixSet = (mChannelMatrix.size() == dstChannels) &&
+                     (mChannelMatrix[0].size() == srcChannels);
+    if (not policyAware || matrixSet) {
+        configureMatrix();
+        mConvertSamplesFct = static_cast<SampleConverter>(&AudioRemapper::convertMatrix<Format>);
+        mMatrixMixing = true;
+        return OK;
+    }
+
+    configurePolicies();
+
+    switch (srcChannels) {
+    case mono:
+        mConvertSamplesFct =
+            static_cast<SampleConverter>(&AudioRemapper::convertMultiNToMultiM<type> );
+        return OK;
     case stereo:
-        switch (mSsDst.getChannelCount()) {
+        switch (dstChannels) {
         case mono:
+            if (mSrcAverage.count == stereo && mValidDstChannelCount == mono) {
+
+                mConvertSamplesFct =
+                    static_cast<SampleConverter>(&AudioRemapper::convertStereoToMono<type> );
+                return OK;
+            }
             mConvertSamplesFct =
                 static_cast<SampleConverter>(&AudioRemapper::convertMultiNToMultiM<type> );
             return OK;
@@ -126,15 +205,11 @@ android::status_t AudioRemapper::configure()
             mConvertSamplesFct =
                 static_cast<SampleConverter>(&AudioRemapper::convertStereoToQuad<type> );
             return OK;
-        case multichan8:
-            mConvertSamplesFct =
-                static_cast<SampleConverter>(&AudioRemapper::convertMultiNToMultiM<type> );
-            return OK;
         }
         return INVALID_OPERATION;
 
     case quad:
-        switch (mSsDst.getChannelCount()) {
+        switch (dstChannels) {
         case mono:
             mConvertSamplesFct =
                 static_cast<SampleConverter>(&AudioRemapper::convertMultiNToMultiM<type> );
@@ -144,18 +219,169 @@ android::status_t AudioRemapper::configure()
                 static_cast<SampleConverter>(&AudioRemapper::convertQuadToStereo<type> );
             return OK;
         }
-    case multichan8:
-        switch (mSsDst.getChannelCount()) {
-        case mono:
-        case stereo:
-            mConvertSamplesFct =
-                static_cast<SampleConverter>(&AudioRemapper::convertMultiNToMultiM<type> );
-            return OK;
-        }
     }
     return INVALID_OPERATION;
 }
 
+void AudioRemapper::setChannelAverage(const uint32_t *channels, uint32_t count,
+                                      ChannelAverage &average) const
+{
+    average.count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (mSsSrc.getChannelsPolicy(channels[i]) != SampleSpec::Ignore) {
+            average.channels[average.count++] = channels[i];
+        }
+    }
+    average.shift = -1;
+    for (int32_t shift = 0; (1u << shift) <= average.count; shift++) {
+        if ((1u << shift) == average.count) {
+            average.shift = shift;
+        }
+    }
+    if (average.count == 0) {
+        // Null sum of no channel gives a null sample.
+        average.shift = 0;
+    }
+    average.reciprocal = average.count ? 1.0 / average.count : 0;
+}
+
+void AudioRemapper::configurePolicies()
+{
+    uint32_t srcChannels = mSsSrc.getChannelCount();
+    uint32_t channels[mMaxChannels] = { 0 };
+    for (uint32_t channel = 0; channel < srcChannels; channel++) {
+        channels[channel] = channel;
+    }
+    setChannelAverage(channels, srcChannels, mSrcAverage);
+
+    if (srcChannels == quad) {
+        const uint32_t left[] = { Left, BackLeft };
+        const uint32_t right[] = { Right, BackRight };
+        setChannelAverage(left, stereo, mLeftAverage);
+        setChannelAverage(right, stereo, mRightAverage);
+    }
+
+    mValidDstChannelCount = 0;
+    for (uint32_t channel = 0; channel < mSsDst.getChannelCount(); channel++) {
+        if (mSsDst.getChannelsPolicy(channel) != SampleSpec::Ignore) {
+            mValidDstChannels[mValidDstChannelCount++] = channel;
+        }
+    }
+
+    if (srcChannels != stereo || mSsDst.getChannelCount() != stereo) {
+        return;
+    }
+    for (uint32_t channel = Left; channel <= Right; channel++) {
+        ChannelRule &rule = mStereoRules[channel];
+        rule.channel = channel;
+        switch (mSsDst.getChannelsPolicy(channel)) {
+        case SampleSpec::Ignore:
+            rule.source = ChannelRule::Silence;
+            break;
+        case SampleSpec::Average:
+            rule.source = ChannelRule::AverageSource;
+            break;
+        default:
+            // Copy only if the source channel is not ignored, average the others otherwise.
+            rule.source = (mSsSrc.getChannelsPolicy(channel) != SampleSpec::Ignore) ?
+                          ChannelRule::CopySource : ChannelRule::AverageSource;
+            break;
+        }
+    }
+}
+
+void AudioRemapper::configureMatrix()
+{
+    uint32_t srcChannels = mSsSrc.getChannelCount();
+    uint32_t dstChannels = mSsDst.getChannelCount();
+
+    AudioChannelMatrix::Matrix matrix;
+    bool matrixSet = (mChannelMatrix.size() == dstChannels);
+    for (uint32_t dst = 0; matrixSet && dst < dstChannels; dst++) {
+        matrixSet = (mChannelMatrix[dst].size() == srcChannels);
+    }
+    if (matrixSet) {
+        matrix = mChannelMatrix;
+    } else {
+        if (not mChannelMatrix.empty()) {
+            Log::Warning() << __FUNCTION__ << ": matrix ignored, it does not mix " << srcChannels
+                           << " channels into " << dstChannels;
+        }
+        matrix = AudioChannelMatrix::getMixMatrix(mSrcChannelMask, srcChannels,
+                                                  mDstChannelMask, dstChannels);
+        for (uint32_t dst = 0; dst < dstChannels; dst++) {
+            for (uint32_t src = 0; src < srcChannels; src++) {
+                if (mSsSrc.getChannelsPolicy(src) == SampleSpec::Ignore ||
+                    mSsDst.getChannelsPolicy(dst) == SampleSpec::Ignore) {
+                    matrix[dst][src] = 0;
+                }
+            }
+        }
+    }
+
+    mMatrixTerms.clear();
+    mMatrixRows.clear();
+    for (uint32_t dst = 0; dst < dstChannels; dst++) {
+        mMatrixRows.push_back(mMatrixTerms.size());
+        for (uint32_t src = 0; src < srcChannels; src++) {
+            if (matrix[dst][src] != 0) {
+                MatrixTerm term = { src, matrix[dst][src] };
+                mMatrixTerms.push_back(term);
+            }
+        }
+    }
+    mMatrixRows.push_back(mMatrixTerms.size());
+
+    // Sized for the widest accumulator, no allocation happens while converting.
+    mMatrixBlock.resize((srcChannels + 1) * mMatrixBlockFrames * sizeof(double));
+}
+
+template <typename Format>
+status_t AudioRemapper::convertMatrix(const void *src, void *dst, const size_t inFrames,
+                                      size_t *outFrames)
+{
+    typedef typename Format::Sample Sample;
+    typedef typename Format::Accumulator Accumulator;
+
+    const Sample *srcTyped = static_cast<const Sample *>(src);
+    Sample *dstTyped = static_cast<Sample *>(dst);
+    const size_t srcChannels = mSsSrc.getChannelCount();
+    const size_t dstChannels = mSsDst.getChannelCount();
+    Accumulator *planes = reinterpret_cast<Accumulator *>(&mMatrixBlock[0]);
+    Accumulator *mix = planes + srcChannels * mMatrixBlockFrames;
+
+    for (size_t first = 0; first < inFrames; first += mMatrixBlockFrames) {
+        const size_t frames = std::min(inFrames - first, mMatrixBlockFrames);
+
+        const Sample *in = srcTyped + first * srcChannels;
+        for (size_t channel = 0; channel < srcChannels; channel++) {
+            Accumulator *plane = planes + channel * mMatrixBlockFrames;
+            for (size_t frame = 0; frame < frames; frame++) {
+                plane[frame] = Format::load(in[frame * srcChannels + channel]);
+            }
+        }
+
+        Sample *out = dstTyped + first * dstChannels;
+        for (size_t channel = 0; channel < dstChannels; channel++) {
+            std::fill(mix, mix + frames, Accumulator(0));
+            for (size_t term = mMatrixRows[channel]; term < mMatrixRows[channel + 1]; term++) {
+                const Accumulator coef = mMatrixTerms[term].coef;
+                const Accumulator *plane = planes + mMatrixTerms[term].srcChannel *
+                                           mMatrixBlockFrames;
+                for (size_t frame = 0; frame < frames; frame++) {
+                    mix[frame] += coef * plane[frame];
+                }
+            }
+            for (size_t frame = 0; frame < frames; frame++) {
+                out[frame * dstChannels + channel] = Format::store(mix[frame]);
+            }
+        }
+    }
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
+}
+
 template <typename type>
 status_t AudioRemapper::convertMultiNToMultiM(const void *src, void *dst, const size_t inFrames,
                                               size_t *outFrames)
@@ -169,12 +395,10 @@ status_t AudioRemapper::convertMultiNToMultiM(const void *src, void *dst, const
         size_t srcIndex = srcChannels * frames;
         size_t dstIndex = dstChannels * frames;
 
-        type averagedSrc = getAveragedSrcFrame<type>(&srcTyped[srcIndex]);
+        type averagedSrc = getAverage<type>(&srcTyped[srcIndex], mSrcAverage);
 
-        for (size_t channels = 0; channels < dstChannels; channels++) {
-            if (mSsDst.getChannelsPolicy(channels) != SampleSpec::Ignore) {
-                dstTyped[dstIndex + channels] = averagedSrc;
-            }
+        for (size_t channels = 0; channels < mValidDstChannelCount; channels++) {
+            dstTyped[dstIndex + mValidDstChannels[channels]] = averagedSrc;
         }
     }
     // Transformation is "iso" frames
@@ -182,6 +406,23 @@ status_t AudioRemapper::convertMultiNToMultiM(const void *src, void *dst, const
     return NO_ERROR;
 }
 
+template <typename type>
+status_t AudioRemapper::convertStereoToMono(const void *src, void *dst, const size_t inFrames,
+                                            size_t *outFrames)
+{
+    const type *srcTyped = static_cast<const type *>(src);
+    type *dstTyped = static_cast<type *>(dst);
+
+    for (size_t frames = 0; frames < inFrames; frames++) {
+        typename Accumulator<type>::Type sum = srcTyped[2 * frames + Left];
+        sum += srcTyped[2 * frames + Right];
+        dstTyped[frames] = Accumulator<type>::divide(sum, mSrcAverage);
+    }
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
+}
+
 template <typename type>
 status_t AudioRemapper::convertStereoToQuad(const void *src, void *dst, const size_t inFrames,
                                             size_t *outFrames)
@@ -218,35 +459,8 @@ status_t AudioRemapper::convertQuadToStereo(const void *src, void *dst, const si
         size_t srcIndex = srcChannels * frames;
         size_t dstIndex = dstChannels * frames;
 
-        type dstRight = 0;
-        size_t validSrcRightChannels = 0;
-        if (mSsSrc.getChannelsPolicy(Right) != SampleSpec::Ignore) {
-            dstRight += srcTyped[srcIndex + Right];
-            validSrcRightChannels++;
-        }
-        if (mSsSrc.getChannelsPolicy(BackRight) != SampleSpec::Ignore) {
-            dstRight += srcTyped[srcIndex + BackRight];
-            validSrcRightChannels++;
-        }
-        if (validSrcRightChannels) {
-            dstRight = dstRight / validSrcRightChannels;
-        }
-        dstTyped[dstIndex + Right] = dstRight;
-
-        type dstLeft = 0;
-        size_t validSrcLeftChannels = 0;
-        if (mSsSrc.getChannelsPolicy(Left) != SampleSpec::Ignore) {
-            dstLeft += srcTyped[srcIndex + Left];
-            validSrcLeftChannels++;
-        }
-        if (mSsSrc.getChannelsPolicy(BackLeft) != SampleSpec::Ignore) {
-            dstLeft += srcTyped[srcIndex + BackLeft];
-            validSrcLeftChannels++;
-        }
-        if (validSrcLeftChannels) {
-            dstLeft = dstLeft / validSrcLeftChannels;
-        }
-        dstTyped[dstIndex + Left] = dstLeft;
+        dstTyped[dstIndex + Left] = getAverage<type>(&srcTyped[srcIndex], mLeftAverage);
+        dstTyped[dstIndex + Right] = getAverage<type>(&srcTyped[srcIndex], mRightAverage);
     }
     // Transformation is "iso" frames
     *outFrames = inFrames;
@@ -271,8 +485,9 @@ status_t AudioRemapper::convertChannelsPolicyInStereo(const void *src,
 
     for (frames = 0; frames < inFrames; frames++) {
 
-        dstTyped[frames].leftCh = convertSample(&srcTyped[srcChannels * frames], Left);
-        dstTyped[frames].rightCh = convertSample(&srcTyped[srcChannels * frames], Right);
+        dstTyped[frames].leftCh = getSample(&srcTyped[srcChannels * frames], mStereoRules[Left]);
+        dstTyped[frames].rightCh = getSample(&srcTyped[srcChannels * frames],
+                                             mStereoRules[Right]);
     }
 
     // Transformation is "iso" frames
@@ -282,55 +497,27 @@ status_t AudioRemapper::convertChannelsPolicyInStereo(const void *src,
 
 
 template <typename type>
-type AudioRemapper::convertSample(const type *src, Channel channel) const
+type AudioRemapper::getSample(const type *src, const ChannelRule &rule) const
 {
-    SampleSpec::ChannelsPolicy dstPolicy = mSsDst.getChannelsPolicy(channel);
-
-    if (dstPolicy == SampleSpec::Ignore) {
-
-        // Destination policy is Ignore, so set to null dest sample
+    switch (rule.source) {
+    case ChannelRule::Silence:
         return 0;
-    } else if (dstPolicy == SampleSpec::Average) {
-
-        // Destination policy is average, so average on all channels of the source frame
-        return getAveragedSrcFrame<type>(src);
-    }
-
-    // Destination policy is Copy
-    // so copy only if source channel policy is not ignore
-    if (mSsSrc.getChannelsPolicy(channel) != SampleSpec::Ignore) {
-
-        return src[channel];
+    case ChannelRule::CopySource:
+        return src[rule.channel];
+    default:
+        return getAverage<type>(src, mSrcAverage);
     }
-
-    // Even if policy is Copy, if the source channel is Ignore,
-    // take the average of the other source channels
-    return getAveragedSrcFrame<type>(src);
 }
 
 template <typename type>
-type AudioRemapper::getAveragedSrcFrame(const type *src) const
+type AudioRemapper::getAverage(const type *src, const ChannelAverage &average)
 {
-    uint32_t validSrcChannels = 0;
-    uint64_t dst = 0;
-
-    // Loops on source channels, checks upon the channel policy to take it into account
-    // or not.
-    // Average on all valid source channels
-    for (uint32_t iSrcChannels = 0; iSrcChannels < mSsSrc.getChannelCount(); iSrcChannels++) {
-
-        if (mSsSrc.getChannelsPolicy(iSrcChannels) != SampleSpec::Ignore) {
+    typename Accumulator<type>::Type sum = 0;
 
-            dst += src[iSrcChannels];
-            validSrcChannels += 1;
-        }
-    }
+    for (uint32_t channel = 0; channel < average.count; channel++) {
 
-    if (validSrcChannels) {
-
-        dst = dst / validSrcChannels;
+        sum += src[average.channels[channel]];
     }
-
-    return dst;
+    return Accumulator<type>::divide(sum, average);
 }
 }  // namespace intel_audio
@@ -18,12 +18,21 @@
 #pragma once
 
 #include "AudioConverter.hpp"
+#include "AudioChannelMatrix.hpp"
+#include "Pcm24Packed.hpp"
 #include <utility>
 #include <vector>
 
 namespace intel_audio
 {
 
+/**
+ * Converter changing the number of channels.
+ *
+ * Any channel count couple is supported: the mono, stereo and quad couples keep their channels
+ * policy aware routines, the others are mixed by a matrix computed on configure from the channel
+ * masks, unless a matrix with the right dimensions has been set by the client.
+ */
 class AudioRemapper : public AudioConverter
 {
 private:
@@ -35,7 +44,11 @@ private:
         BackLeft,
         BackRight
     };
-    static const std::vector<std::pair<uint32_t, uint32_t> > mSupportedConversions;
+
+    static const uint32_t mMaxChannels = 32; /**< As sample specifications, up to 32 channels. */
+
+    /** Channel count couples remapped by the channels policy aware routines. */
+    static const std::vector<std::pair<uint32_t, uint32_t> > mPolicyAwareConversions;
 
 public:
     /**
@@ -48,6 +61,28 @@ public:
 
     static bool supportRemap(uint32_t srcChannels, uint32_t dstChannels);
 
+    /**
+     * Sets the channel masks of the source and destination of the conversion, from which the
+     * mixing matrix is computed. It is taken into account on next configure.
+     * Within the conversion chain, the sample specifications only carry a reliable channel count.
+     *
+     * @param[in] srcMask channel mask of the source, AUDIO_CHANNEL_NONE if unknown.
+     * @param[in] dstMask channel mask of the destination, AUDIO_CHANNEL_NONE if unknown.
+     */
+    void setChannelMasks(audio_channel_mask_t srcMask, audio_channel_mask_t dstMask);
+
+    /**
+     * Sets a mixing matrix replacing the one computed from the channel masks. It is taken into
+     * account on next configure, if its dimensions match the channel counts of the conversion.
+     *
+     * @param[in] matrix one row of coefficients per destination channel, one coefficient per
+     *                   source channel. Empty to use the matrix computed from the channel masks.
+     */
+    void setChannelMatrix(const AudioChannelMatrix::Matrix &matrix);
+
+    /** @return true if the remapper is configured to mix channels through a matrix. */
+    bool isMatrixMixing() const { return mMatrixMixing; }
+
 private:
     /**
      * Configures the remapper.
@@ -68,20 +103,49 @@ private:
      * Selects the appropriate remap operation to use according to the source
      * and destination sample specifications.
      *
-     * @tparam type Audio data format from S16 to S32.
+     * @tparam Format traits of the audio data format.
      *
      * @return error code.
      */
-    template <typename type>
+    template <typename Format>
     android::status_t configure();
 
+    /**
+     * Prepares the non null coefficients of the mixing matrix and the mixing buffer.
+     * The matrix set by the client is used if its dimensions match, otherwise the matrix is
+     * computed from the channel masks, and the ignored channels removed from the mix.
+     */
+    void configureMatrix();
+
+    /**
+     * Remap through the mixing matrix in typed format.
+     *
+     * Frames are processed by blocks: source channels are loaded in planes of the accumulator
+     * type, then each destination channel is accumulated plane after plane, so that the inner
+     * loops are straight multiply accumulate loops the compiler vectorizes.
+     *
+     * @tparam Format traits of the audio data format.
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, the caller must ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    template <typename Format>
+    android::status_t convertMatrix(const void *src,
+                                    void *dst,
+                                    const size_t inFrames,
+                                    size_t *outFrames);
+
     /**
      * Remap simply from M-channels to N-channels in typed format.
      *
      * Convert a multi N-channels source in a mutli M-channels destination in typed format
      * by averaging the source and propagating the averaged value on all channels of the destination
      *
-     * @tparam type Audio data format from S16 to S32, no other type allowed.
+     * @tparam type Audio data format: S16, S24, S32 or float, no other type allowed.
      * @param[in] src the source buffer.
      * @param[out] dst the destination buffer, the caller must ensure the destination
      *             is large enough.
@@ -94,6 +158,23 @@ private:
     android::status_t convertMultiNToMultiM(const void *src, void *dst, const size_t inFrames,
                                             size_t *outFrames);
 
+    /**
+     * Remap from stereo to mono in typed format, both source channels being averaged.
+     * Specialization of convertMultiNToMultiM for the most common downmix.
+     *
+     * @tparam type Audio data format: S16, S24, S32 or float, no other type allowed.
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, the caller must ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    template <typename type>
+    android::status_t convertStereoToMono(const void *src, void *dst, const size_t inFrames,
+                                          size_t *outFrames);
+
     template <typename type>
     android::status_t convertStereoToQuad(const void *src,
                                           void *dst,
@@ -112,7 +193,7 @@ private:
      * Convert a stereo source into a stereo destination in typed format
      * with different channels policy.
      *
-     * @tparam type Audio data format from S16 to S32, no other type allowed.
+     * @tparam type Audio data format: S16, S24, S32 or float, no other type allowed.
      * @param[in] src the source buffer.
      * @param[out] dst the destination buffer, the caller must ensure the destination
      *             is large enough.
@@ -128,33 +209,69 @@ private:
                                                     size_t *outFrames);
 
     /**
-     * Convert a source sample in typed format.
+     * Source channels averaged into a destination channel, compiled from the channels policy on
+     * configure so that the conversion loops neither look the policies up nor divide.
+     */
+    struct ChannelAverage
+    {
+        uint8_t channels[mMaxChannels]; /**< Valid source channels. */
+        uint32_t count; /**< Number of valid source channels. */
+        int32_t shift; /**< Shift dividing by the count if a power of 2, negative otherwise. */
+        double reciprocal; /**< Reciprocal of the count, 0 if no valid channel. */
+    };
+
+    /** Origin of a destination channel sample, compiled from the channels policy. */
+    struct ChannelRule
+    {
+        enum Source
+        {
+            Silence, /**< Null sample. */
+            CopySource, /**< Copy of a source channel. */
+            AverageSource /**< Average of the valid source channels. */
+        };
+        Source source;
+        uint32_t channel; /**< Source channel copied. */
+    };
+
+    /**
+     * Compiles the channels policy of the source and destination into averaging tables and
+     * destination channel rules.
+     */
+    void configurePolicies();
+
+    /**
+     * Fills an averaging table with the valid source channels among a set of channels.
      *
-     * Gets destination channel from the source sample according to the destination
-     * channel policy.
+     * @param[in] channels source channels averaged if their policy is not Ignore.
+     * @param[in] count number of channels.
+     * @param[out] average averaging table.
+     */
+    void setChannelAverage(const uint32_t *channels, uint32_t count,
+                           ChannelAverage &average) const;
+
+    /**
+     * Average of source channels in typed format.
      *
-     * @tparam type Audio data format from S16 to S32, no other type allowed.
-     * @param[in] src16 the source frame.
-     * @param[in] channel the channel of the destination.
+     * @tparam type Audio data format: S16, S24, S32 or float, no other type allowed.
+     * @param[in] src the source frame.
+     * @param[in] average the averaging table.
      *
-     * @return destination channel sample.
+     * @return averaged sample, rounded to the lower integer for integer formats.
      */
     template <typename type>
-    type convertSample(const type *src, Channel channel) const;
+    static type getAverage(const type *src, const ChannelAverage &average);
 
     /**
-     * Average source frame in typed format.
+     * Gets a destination channel sample from the source frame according to its rule.
      *
-     * Gets an averaged value of the source audio frame taking into
-     * account the policy of the source channels.
-     *
-     * @tparam type Audio data format from S16 to S32, no other type allowed.
-     * @param[in] src16 the source frame.
+     * @tparam type Audio data format: S16, S24, S32 or float, no other type allowed.
+     * @param[in] src the source frame.
+     * @param[in] rule the rule of the destination channel.
      *
      * @return destination channel sample.
      */
     template <typename type>
-    type getAveragedSrcFrame(const type *src16) const;
+    type getSample(const type *src, const ChannelRule &rule) const;
 
     /**
      * provide a compile time error if no specialization is provided for a given type.
@@ -163,5 +280,38 @@ private:
      */
     template <typename T>
     struct formatSupported;
+
+    /**
+     * Type used to accumulate samples when averaging channels.
+     *
+     * @tparam T: type of the audio data.
+     */
+    template <typename T>
+    struct Accumulator;
+
+    /** Non null coefficient of a source channel in the mix of a destination channel. */
+    struct MatrixTerm
+    {
+        uint32_t srcChannel;
+        float coef;
+    };
+
+    audio_channel_mask_t mSrcChannelMask; /**< Channel mask of the source, may be unknown. */
+    audio_channel_mask_t mDstChannelMask; /**< Channel mask of the destination, may be unknown. */
+    AudioChannelMatrix::Matrix mChannelMatrix; /**< Mixing matrix set by the client. */
+
+    bool mMatrixMixing; /**< True if configured to mix through the matrix. */
+    std::vector<MatrixTerm> mMatrixTerms; /**< Terms of each destination channel in turn. */
+    std::vector<size_t> mMatrixRows; /**< First term of each destination channel, then the end. */
+    std::vector<uint8_t> mMatrixBlock; /**< Source planes and mix of a block of frames. */
+
+    static const size_t mMatrixBlockFrames = 64; /**< Frames mixed per block. */
+
+    ChannelAverage mSrcAverage; /**< Average of all valid source channels. */
+    ChannelAverage mLeftAverage; /**< Average of the valid left channels of a quad source. */
+    ChannelAverage mRightAverage; /**< Average of the valid right channels of a quad source. */
+    ChannelRule mStereoRules[2]; /**< Rules of the channels of a stereo destination. */
+    uint8_t mValidDstChannels[mMaxChannels]; /**< Destination channels written. */
+    uint32_t mValidDstChannelCount; /**< Number of destination channels written. */
 };
 }  // namespace intel_audio
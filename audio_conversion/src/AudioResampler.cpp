@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2013-2015 Intel Corporation
+ * Copyright (C) 2013-2018 Intel Corporation
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,10 +17,12 @@
 #define LOG_TAG "AudioResampler"
 
 #include "AudioResampler.hpp"
+#include "AudioResamplerFilter.hpp"
+#include "PcmFormat.hpp"
 #include <AudioCommsAssert.hpp>
 #include <utilities/Log.hpp>
-#include <audio_utils/resampler.h>
-#include <limits.h>
+#include <algorithm>
+#include <string.h>
 
 using audio_comms::utilities::Log;
 using namespace android;
@@ -28,89 +30,238 @@ using namespace android;
 namespace intel_audio
 {
 
+const double AudioResampler::mMaxCorrectionPpm = 1000;
+
 AudioResampler::AudioResampler(SampleSpecItem sampleSpecItem)
     : AudioConverter(sampleSpecItem),
-      mResampler(NULL)
+      mFilter(NULL),
+      mQuality(AudioConversion::ResamplerQualityMedium),
+      mConfiguredQuality(AudioConversion::ResamplerQualityMedium),
+      mAdaptive(false),
+      mConfiguredAdaptive(false),
+      mPhase(0),
+      mPhaseFraction(0),
+      mPhaseCorrection(0),
+      mCorrectionPpm(0),
+      mNextFrame(0)
 {
 }
 
 AudioResampler::~AudioResampler()
 {
-    if (mResampler != NULL) {
-        release_resampler(mResampler);
-        mResampler = NULL;
-    }
 }
 
 status_t AudioResampler::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
 {
-    if ((ssSrc.getSampleRate() == mSsSrc.getSampleRate()) &&
-        (ssDst.getSampleRate() == mSsDst.getSampleRate()) &&
-        (mResampler != NULL)) {
-        mResampler->reset(mResampler);
-        return NO_ERROR;
-    }
-
     if ((ssSrc.getSampleRate() == 0) ||
         (ssDst.getSampleRate() == 0)) {
         return BAD_VALUE;
     }
 
+    if ((mFilter != NULL) &&
+        (ssSrc.getSampleRate() == mSsSrc.getSampleRate()) &&
+        (ssDst.getSampleRate() == mSsDst.getSampleRate()) &&
+        (ssSrc.getFormat() == mSsSrc.getFormat()) &&
+        (ssSrc.getChannelCount() == mSsSrc.getChannelCount()) &&
+        (mQuality == mConfiguredQuality) &&
+        (mAdaptive == mConfiguredAdaptive)) {
+        reset();
+        return NO_ERROR;
+    }
+
     status_t status = AudioConverter::configure(ssSrc, ssDst);
     if (status != NO_ERROR) {
 
         return status;
     }
-    if (mResampler != NULL) {
-        release_resampler(mResampler);
-        mResampler = NULL;
-    }
-    //  resampler_buffer_provider is NULL since we will be driven by the input...
-    status = create_resampler(ssSrc.getSampleRate(), ssDst.getSampleRate(),
-                              ssSrc.getChannelCount(), RESAMPLER_QUALITY_DEFAULT, NULL,
-                              &mResampler);
-    if (status != OK) {
-        Log::Error() << "cannot instantiate resampler handle, status=" << status;
-        return status;
+
+    switch (ssSrc.getFormat()) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        selectResampleFunction<FormatS16>();
+        break;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        selectResampleFunction<FormatS24over32>();
+        break;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        selectResampleFunction<FormatS32>();
+        break;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        selectResampleFunction<FormatS24Packed>();
+        break;
+    case AUDIO_FORMAT_PCM_FLOAT:
+        selectResampleFunction<FormatFloat>();
+        break;
+    default:
+        Log::Error() << __FUNCTION__ << ": unsupported format " << ssSrc.getFormat();
+        mFilter = NULL;
+        return INVALID_OPERATION;
     }
 
-    AUDIOCOMMS_ASSERT(mResampler != NULL, "Audio Utils failed to instantiate a resampler");
+    mFilter = AudioResamplerFilter::getFilter(ssSrc.getSampleRate(), ssDst.getSampleRate(),
+                                              mQuality, mAdaptive ? mAdaptivePhases : 1);
+    AUDIOCOMMS_ASSERT(mFilter != NULL, "failed to get a resampling filter");
+    mConfiguredQuality = mQuality;
+    mConfiguredAdaptive = mAdaptive;
+    // A corrected phase falls between two tabulated phases, whatever the bank.
+    mInterpolatedCoefs.resize(mFilter->isInterpolated() || mConfiguredAdaptive ?
+                              mFilter->getTaps() : 0);
 
-    mConvertSamplesFct = static_cast<SampleConverter>(&AudioResampler::resampleFrames);
+    reset();
     return OK;
 }
 
+template <typename Format>
+void AudioResampler::selectResampleFunction()
+{
+    switch (mSsSrc.getChannelCount()) {
+    case 1:
+        mConvertSamplesFct =
+            static_cast<SampleConverter>(&AudioResampler::resampleFrames<Format, 1>);
+        break;
+    case 2:
+        mConvertSamplesFct =
+            static_cast<SampleConverter>(&AudioResampler::resampleFrames<Format, 2>);
+        break;
+    default:
+        mConvertSamplesFct =
+            static_cast<SampleConverter>(&AudioResampler::resampleFrames<Format, 0>);
+        break;
+    }
+}
+
+size_t AudioResampler::getDelayFrames() const
+{
+    return mFilter == NULL ? 0 : convertSrcToDstInFrames(mFilter->getDelay());
+}
+
+size_t AudioResampler::getMaxOutFrames(ssize_t inFrames) const
+{
+    size_t frames = convertSrcToDstInFrames(inFrames);
+    if (mConfiguredAdaptive) {
+
+        frames += frames * mMaxCorrectionPpm / 1000000 + 1;
+    }
+    return frames;
+}
+
+void AudioResampler::setRateCorrection(double ppm)
+{
+    if (!mConfiguredAdaptive || (mFilter == NULL)) {
+
+        return;
+    }
+    mCorrectionPpm = std::max(-mMaxCorrectionPpm, std::min(mMaxCorrectionPpm, ppm));
+
+    // Output frames are spaced by M / (1 + correction) phases instead of M. The correction is
+    // far below M, hence the phase never goes back before the previous output frame.
+    double phases = mFilter->getDownFactor() * (1 / (1 + mCorrectionPpm / 1000000) - 1);
+    mPhaseCorrection = (int64_t)(phases * (1ull << 32));
+}
+
+void AudioResampler::reset()
+{
+    mPhase = 0;
+    mPhaseFraction = 0;
+    mPhaseCorrection = 0;
+    mCorrectionPpm = 0;
+    mNextFrame = 0;
+    size_t historyBytes = (mFilter->getTaps() - 1) * mSsSrc.getFrameSize();
+    if (mWorkBuffer.size() < historyBytes) {
+        mWorkBuffer.resize(historyBytes);
+    }
+    memset(&mWorkBuffer[0], 0, historyBytes);
+}
+
+status_t AudioResampler::reserve(size_t inFrames)
+{
+    size_t workBytes = (mFilter->getTaps() - 1 + inFrames) * mSsSrc.getFrameSize();
+    if (mWorkBuffer.size() < workBytes) {
+        mWorkBuffer.resize(workBytes);
+    }
+    return AudioConverter::reserve(inFrames);
+}
+
+template <typename Format, size_t Channels>
 status_t AudioResampler::resampleFrames(const void *src,
                                         void *dst,
                                         const size_t inFrames,
                                         size_t *outFrames)
 {
-    // here we need to cast src and inFrames due to resample_from_input interface
-    int16_t *bufferSrc = static_cast<int16_t *>(const_cast<void *>(src));
-    size_t frameSrc = inFrames;
-    status_t status;
-
-    *outFrames = convertSrcToDstInFrames(inFrames);
-
-    status = mResampler->resample_from_input(mResampler,
-                                             bufferSrc,
-                                             &frameSrc,
-                                             static_cast<int16_t *>(dst), outFrames);
-
-    /* According to resample_from_input() documentation: "[*frameSrc]
-     * and [*outFrames] are updated respectively with the number of
-     * frames remaining in input and written to output."
-     * According to resample_from_input() code, *framesSrc is updated
-     * with the number of frames processed (not "remaining") from
-     * input and *outFrames is updated with the number of frames
-     * successfully written to output.
-     * Relying on the code, on success frameSrc is equal to inFrames.
-     */
-    if (frameSrc != inFrames) {
-        Log::Warning() << __FUNCTION__ << ": buffer not fully consumed ("
-                       << frameSrc << " frames left)";
+    typedef typename Format::Sample SampleType;
+    typedef typename Format::Accumulator Accumulator;
+
+    const size_t channels = (Channels != 0) ? Channels : mSsSrc.getChannelCount();
+    const size_t frameSize = channels * sizeof(SampleType);
+    const size_t taps = mFilter->getTaps();
+    const size_t historyFrames = taps - 1;
+    const uint32_t upFactor = mFilter->getUpFactor();
+    const uint32_t downFactor = mFilter->getDownFactor();
+    const bool interpolated = mFilter->isInterpolated();
+    const bool adaptive = mConfiguredAdaptive;
+    const int64_t phaseCorrection = mPhaseCorrection;
+    const double phaseToTable = (double)mFilter->getTableResolution() / upFactor;
+
+    size_t workBytes = (historyFrames + inFrames) * frameSize;
+    if (mWorkBuffer.size() < workBytes) {
+        mWorkBuffer.resize(workBytes);
+    }
+    memcpy(&mWorkBuffer[historyFrames * frameSize], src, inFrames * frameSize);
+
+    // Window of an output frame ends on frame mNextFrame of the input buffer, it thus starts on
+    // frame mNextFrame of the work buffer, which is shifted by the history length.
+    const SampleType *work = reinterpret_cast<const SampleType *>(&mWorkBuffer[0]);
+    SampleType *out = static_cast<SampleType *>(dst);
+    size_t frame = mNextFrame;
+    uint32_t phase = mPhase;
+    uint32_t phaseFraction = mPhaseFraction;
+    size_t written = 0;
+
+    while (frame < inFrames) {
+        const float *coefs;
+        if (interpolated || adaptive) {
+            double position = (phase + phaseFraction / 4294967296.0) * phaseToTable;
+            uint32_t index = (uint32_t)position;
+            float fraction = position - index;
+            const float *lower = mFilter->getCoefs(index);
+            const float *upper = mFilter->getCoefs(index + 1);
+            for (size_t tap = 0; tap < taps; tap++) {
+                mInterpolatedCoefs[tap] = lower[tap] + fraction * (upper[tap] - lower[tap]);
+            }
+            coefs = &mInterpolatedCoefs[0];
+        } else {
+            coefs = mFilter->getCoefs(phase);
+        }
+
+        const SampleType *window = work + frame * channels;
+        for (size_t channel = 0; channel < channels; channel++) {
+            const SampleType *sample = window + channel;
+            Accumulator accumulator = 0;
+            for (size_t tap = 0; tap < taps; tap++) {
+                accumulator += Format::load(sample[tap * channels]) * coefs[tap];
+            }
+            out[channel] = Format::store(accumulator);
+        }
+        out += channels;
+        written++;
+
+        phase += downFactor;
+        if (adaptive) {
+
+            int64_t corrected = (int64_t)phaseFraction + phaseCorrection;
+            phase += (int32_t)(corrected >> 32);
+            phaseFraction = (uint32_t)corrected;
+        }
+        frame += phase / upFactor;
+        phase %= upFactor;
     }
+    mNextFrame = frame - inFrames;
+    mPhase = phase;
+    mPhaseFraction = phaseFraction;
+
+    // Keep the last frames for the windows straddling this conversion and the next one.
+    memmove(&mWorkBuffer[0], &mWorkBuffer[inFrames * frameSize], historyFrames * frameSize);
 
-    return status;
+    *outFrames = written;
+    return OK;
 }
 }  // namespace intel_audio
@@ -16,12 +16,23 @@
 
 #pragma once
 #include "AudioConverter.hpp"
-#include <audio_utils/resampler.h>
-#include <list>
+#include <AudioConversion.hpp>
+#include <stdint.h>
+#include <vector>
 
 namespace intel_audio
 {
 
+class AudioResamplerFilter;
+
+/**
+ * Polyphase windowed sinc resampler.
+ *
+ * Samples are filtered in their own format (S16, S24 over 32, S32, S24 packed or float) whatever
+ * the number of channels, the filter bank being shared by all the resamplers working on the same
+ * ratio at the same quality. The last input frames are kept from one conversion to the next, so
+ * that the output of successive conversions is the one of a single conversion of the whole stream.
+ */
 class AudioResampler : public AudioConverter
 {
 
@@ -37,11 +48,56 @@ public:
 
     static bool supportResample(uint32_t /*srcRate*/, uint32_t /*dstRate*/) { return true; }
 
+    /**
+     * Sets the resampling quality, taken into account on next configure.
+     *
+     * @param[in] quality resampling quality.
+     */
+    void setQuality(AudioConversion::ResamplerQuality quality) { mQuality = quality; }
+
+    /**
+     * Enables or disables the adaptive mode, taken into account on next configure.
+     * In adaptive mode, the ratio may be corrected while converting, and the resampler may be
+     * configured with the same source and destination rates.
+     *
+     * @param[in] enable true to allow ratio corrections, false otherwise.
+     */
+    void setAdaptive(bool enable) { mAdaptive = enable; }
+
+    /**
+     * Corrects the resampling ratio, in adaptive mode only. The correction applies from the next
+     * output frame, without discontinuity, until the next correction or reset.
+     *
+     * @param[in] ppm relative correction of the destination rate in parts per million, positive
+     *                to output more frames. It is clamped to +/- mMaxCorrectionPpm.
+     */
+    void setRateCorrection(double ppm);
+
+    /** @return correction of the ratio in use, in parts per million. */
+    double getRateCorrection() const { return mCorrectionPpm; }
+
+    /**
+     * Clears the input history and the phase, as if the stream was starting.
+     */
+    virtual void reset();
+
+    /**
+     * Sizes the work buffer holding the input history followed by the input frames, and the
+     * output buffer.
+     */
+    virtual android::status_t reserve(size_t inFrames);
+
+    /**
+     * The input history starts with silence: the window of an output frame is centered on the
+     * input frame half a filter length before the newest one.
+     */
+    virtual size_t getDelayFrames() const;
+
 private:
     /**
      * Configures the resampler.
-     * It configures the resampler that may be used to convert samples from the source
-     * to destination sample rate, with option 'RESAMPLER_QUALITY_DEFAULT'.
+     * It selects the filter bank that may be used to convert samples from the source
+     * to destination sample rate at the requested quality, and clears the input history.
      *
      * @param[in] ssSrc source sample specifications.
      * @param[in] ssDst destination sample specification.
@@ -50,11 +106,27 @@ private:
      */
     virtual android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
 
+    /**
+     * Adds to the output of the ratio the frames a correction may produce.
+     */
+    virtual size_t getMaxOutFrames(ssize_t inFrames) const;
+
+    /**
+     * The same rates are resampled in adaptive mode, to be corrected.
+     */
+    virtual bool isIdentityAllowed() const { return mAdaptive; }
+
     /**
      * Resamples buffer from source to destination sample rate.
      * Resamples input frames of the provided input buffer into the destination buffer already
      * allocated by the converter or given by the client.
      * Before using this function, configure must have been called.
+     * Up to convertSrcToDstInFrames(inFrames) frames are produced, one less at most according to
+     * the phase the previous conversion ended on, or up to getMaxOutFrames(inFrames) if the ratio
+     * is corrected.
+     *
+     * @tparam Format traits of the audio data format.
+     * @tparam Channels number of channels, 0 if only known at run time.
      *
      * @param[in] src the source buffer.
      * @param[out] dst the destination buffer, caller to ensure the destination
@@ -64,12 +136,49 @@ private:
      *
      * @return error code.
      */
+    template <typename Format, size_t Channels>
     android::status_t resampleFrames(const void *src,
                                      void *dst,
                                      const size_t inFrames,
                                      size_t *outFrames);
 
-    struct resampler_itfe *mResampler;
+    /**
+     * Selects the resampling function according to the sample format and channel count.
+     *
+     * @tparam Format traits of the audio data format.
+     */
+    template <typename Format>
+    void selectResampleFunction();
+
+    const AudioResamplerFilter *mFilter; /**< Filter bank, NULL until configured. */
+    AudioConversion::ResamplerQuality mQuality; /**< Quality requested for next configure. */
+    AudioConversion::ResamplerQuality mConfiguredQuality; /**< Quality of mFilter. */
+
+    bool mAdaptive; /**< Adaptive mode requested for next configure. */
+    bool mConfiguredAdaptive; /**< Adaptive mode of mFilter. */
+
+    uint32_t mPhase; /**< Phase of next output frame, from 0 to L - 1. */
+    uint32_t mPhaseFraction; /**< Fractional part of the phase in adaptive mode, Q0.32. */
+    int64_t mPhaseCorrection; /**< Correction of the phase increment, Q32.32 phases. */
+    double mCorrectionPpm; /**< Correction of the ratio, in parts per million. */
+    size_t mNextFrame; /**< Index in next input buffer of the last frame of the next window. */
+
+    /**
+     * History of (taps - 1) frames followed by the frames being resampled, so that the windows
+     * straddling two conversions are contiguous. Only grows, to the largest input seen.
+     */
+    std::vector<uint8_t> mWorkBuffer;
+
+    std::vector<float> mInterpolatedCoefs; /**< Subfilter of the phase being computed. */
+
+    /** Largest correction of the ratio, in parts per million. */
+    static const double mMaxCorrectionPpm;
+
+    /**
+     * Least number of phases of the bank in adaptive mode, so that the coefficients of a
+     * corrected phase are interpolated between close enough phases.
+     */
+    static const uint32_t mAdaptivePhases = 256;
 
 };
 }  // namespace intel_audio
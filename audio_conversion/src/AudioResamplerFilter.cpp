@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "AudioResamplerFilter"
+
+#include "AudioResamplerFilter.hpp"
+#include <AudioCommsAssert.hpp>
+#include <Mutex.hpp>
+#include <utilities/Log.hpp>
+#include <math.h>
+
+using audio_comms::utilities::Log;
+using audio_comms::utilities::Mutex;
+
+namespace intel_audio
+{
+
+/**
+ * Design parameters of each quality level.
+ */
+struct ResamplerQualityParams
+{
+    size_t taps; /**< Subfilter length when upsampling. */
+    double beta; /**< Kaiser window shape, i.e. stop band attenuation. */
+    double rolloff; /**< Cutoff frequency relative to the lowest Nyquist frequency. */
+};
+
+static const ResamplerQualityParams gQualityParams[AudioConversion::NbResamplerQuality] = {
+    { 16, 6.0, 0.85 },  // Low
+    { 32, 8.0, 0.90 },  // Medium
+    { 64, 10.0, 0.94 }  // High
+};
+
+/**
+ * Rates couples for which banks are designed upon first request, both ways.
+ */
+static const uint32_t gCommonRates[][2] = {
+    { 44100, 48000 },
+    { 16000, 48000 }
+};
+
+/** Designed banks, never released. */
+static std::vector<const AudioResamplerFilter *> gFilters;
+
+/** Protects gFilters, banks themselves are immutable. */
+static Mutex gFiltersLock;
+
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+const AudioResamplerFilter *AudioResamplerFilter::getFilter(
+    uint32_t srcRate, uint32_t dstRate, AudioConversion::ResamplerQuality quality,
+    uint32_t minPhases)
+{
+    AUDIOCOMMS_ASSERT(srcRate != 0 && dstRate != 0, "null sample rate");
+    AUDIOCOMMS_ASSERT(quality < AudioConversion::NbResamplerQuality, "invalid quality");
+
+    uint32_t gcd = greatestCommonDivisor(srcRate, dstRate);
+    uint32_t upFactor = dstRate / gcd;
+    uint32_t downFactor = srcRate / gcd;
+    if (upFactor < minPhases) {
+        uint32_t multiplier = (minPhases + upFactor - 1) / upFactor;
+        upFactor *= multiplier;
+        downFactor *= multiplier;
+    }
+
+    Mutex::Locker locker(gFiltersLock);
+    if (gFilters.empty()) {
+        for (size_t i = 0; i < sizeof(gCommonRates) / sizeof(gCommonRates[0]); i++) {
+            uint32_t commonGcd = greatestCommonDivisor(gCommonRates[i][0], gCommonRates[i][1]);
+            uint32_t low = gCommonRates[i][0] / commonGcd;
+            uint32_t high = gCommonRates[i][1] / commonGcd;
+            for (int q = 0; q < AudioConversion::NbResamplerQuality; q++) {
+                AudioConversion::ResamplerQuality commonQuality =
+                    static_cast<AudioConversion::ResamplerQuality>(q);
+                addFilterL(high, low, commonQuality);
+                addFilterL(low, high, commonQuality);
+            }
+        }
+    }
+    const AudioResamplerFilter *filter = findFilterL(upFactor, downFactor, quality);
+    if (filter == NULL) {
+        filter = addFilterL(upFactor, downFactor, quality);
+    }
+    return filter;
+}
+
+const AudioResamplerFilter *AudioResamplerFilter::findFilterL(
+    uint32_t upFactor, uint32_t downFactor, AudioConversion::ResamplerQuality quality)
+{
+    std::vector<const AudioResamplerFilter *>::const_iterator it;
+    for (it = gFilters.begin(); it != gFilters.end(); ++it) {
+        if ((*it)->mUpFactor == upFactor && (*it)->mDownFactor == downFactor &&
+            (*it)->mQuality == quality) {
+            return *it;
+        }
+    }
+    return NULL;
+}
+
+const AudioResamplerFilter *AudioResamplerFilter::addFilterL(
+    uint32_t upFactor, uint32_t downFactor, AudioConversion::ResamplerQuality quality)
+{
+    const AudioResamplerFilter *filter = new AudioResamplerFilter(upFactor, downFactor, quality);
+    gFilters.push_back(filter);
+    Log::Verbose() << __FUNCTION__ << ": L=" << upFactor << " M=" << downFactor
+                   << " taps=" << filter->mTaps << " phases=" << filter->mTableResolution;
+    return filter;
+}
+
+AudioResamplerFilter::AudioResamplerFilter(uint32_t upFactor, uint32_t downFactor,
+                                           AudioConversion::ResamplerQuality quality)
+    : mUpFactor(upFactor),
+      mDownFactor(downFactor),
+      mQuality(quality)
+{
+    const ResamplerQualityParams &params = gQualityParams[quality];
+
+    // When decimating, the cutoff follows the destination Nyquist frequency and the filter is
+    // stretched accordingly to keep the same transition band.
+    double ratio = upFactor < downFactor ? (double)upFactor / downFactor : 1.0;
+    double cutoff = params.rolloff * ratio;
+    mTaps = (size_t)ceil(params.taps / ratio);
+    mTaps = (mTaps + 3) & ~(size_t)3;
+    if (mTaps > mMaxTaps) {
+        mTaps = mMaxTaps;
+    }
+    mTableResolution = upFactor <= mMaxExactPhases ? upFactor : mInterpolatedPhases;
+    mCoefs.resize((mTableResolution + 1) * mTaps);
+
+    double halfLength = mTaps / 2;
+    for (uint32_t phase = 0; phase <= mTableResolution; phase++) {
+        float *coefs = &mCoefs[phase * mTaps];
+        double fraction = (double)phase / mTableResolution;
+        double sum = 0;
+        for (size_t tap = 0; tap < mTaps; tap++) {
+            // Coefficient of the frame that lies (halfLength - 1 - tap + fraction) frames away
+            // from the delayed output position.
+            double time = fraction + halfLength - 1 - tap;
+            double coef = prototype(time, cutoff, halfLength, params.beta);
+            coefs[tap] = coef;
+            sum += coef;
+        }
+        // Unity gain at DC for each phase, otherwise phases modulate the signal.
+        for (size_t tap = 0; tap < mTaps; tap++) {
+            coefs[tap] /= sum;
+        }
+    }
+}
+
+double AudioResamplerFilter::prototype(double time, double cutoff, double halfLength,
+                                       double beta)
+{
+    double position = time / halfLength;
+    if (position <= -1.0 || position >= 1.0) {
+        return 0;
+    }
+    double x = M_PI * cutoff * time;
+    double sinc = (x == 0) ? 1.0 : sin(x) / x;
+    double window = besselI0(beta * sqrt(1.0 - position * position)) / besselI0(beta);
+    return cutoff * sinc * window;
+}
+
+double AudioResamplerFilter::besselI0(double x)
+{
+    // Power series, converges quickly for the beta values in use.
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x / 2;
+    for (int k = 1; term > sum * 1e-12; k++) {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+    }
+    return sum;
+}
+
+}  // namespace intel_audio
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <AudioConversion.hpp>
+#include <AudioNonCopyable.hpp>
+#include <stdint.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+/**
+ * Polyphase bank of Kaiser windowed sinc low pass filters.
+ *
+ * Resampling from srcRate to dstRate is seen as an upsampling by L followed by a decimation by M,
+ * where L / M is the irreducible fraction of dstRate / srcRate. Each of the L phases of the
+ * prototype low pass filter is stored as a subfilter of getTaps() coefficients, so that an output
+ * sample is the dot product of the last getTaps() input frames and the subfilter of its phase.
+ *
+ * If L is too large for the whole bank to be stored, only getTableResolution() phases are
+ * tabulated and the coefficients of a phase are interpolated linearly from the two nearest ones.
+ *
+ * Banks are immutable and shared: they are designed once per ratio and quality, and the common
+ * ratios (44.1kHz <-> 48kHz, 16kHz <-> 48kHz) are all designed upon first request of any bank.
+ */
+class AudioResamplerFilter : public audio_comms::utilities::NonCopyable
+{
+public:
+    /**
+     * Get the filter bank for a given conversion, designing it if not already done.
+     *
+     * @param[in] srcRate source sample rate, not null.
+     * @param[in] dstRate destination sample rate, not null.
+     * @param[in] quality resampling quality.
+     * @param[in] minPhases least number of phases of the bank. If the irreducible fraction has
+     *                      less, both factors are multiplied so that the phase may be fine tuned
+     *                      by the resampler while keeping the same ratio.
+     *
+     * @return filter bank, never destroyed.
+     */
+    static const AudioResamplerFilter *getFilter(uint32_t srcRate, uint32_t dstRate,
+                                                 AudioConversion::ResamplerQuality quality,
+                                                 uint32_t minPhases = 1);
+
+    /** @return upsampling factor L, i.e. number of phases of the bank. */
+    uint32_t getUpFactor() const { return mUpFactor; }
+
+    /** @return decimation factor M, i.e. phase increment between two output frames. */
+    uint32_t getDownFactor() const { return mDownFactor; }
+
+    /** @return number of coefficients of a subfilter, multiple of 4. */
+    size_t getTaps() const { return mTaps; }
+
+    /** @return true if the bank is decimated and coefficients must be interpolated. */
+    bool isInterpolated() const { return mTableResolution != mUpFactor; }
+
+    /** @return number of tabulated phases. */
+    uint32_t getTableResolution() const { return mTableResolution; }
+
+    /**
+     * Get the subfilter of a tabulated phase. The table holds getTableResolution() + 1 phases,
+     * the extra one being the phase 1.0, so that interpolation never wraps.
+     *
+     * @param[in] phase tabulated phase, from 0 to getTableResolution().
+     *
+     * @return getTaps() coefficients, the first one applying to the oldest input frame.
+     */
+    const float *getCoefs(uint32_t phase) const { return &mCoefs[phase * mTaps]; }
+
+    /** @return group delay of the filter in source frames. */
+    size_t getDelay() const { return mTaps / 2; }
+
+private:
+    AudioResamplerFilter(uint32_t upFactor, uint32_t downFactor,
+                         AudioConversion::ResamplerQuality quality);
+
+    /**
+     * Looks for an already designed bank, caller must hold the cache lock.
+     *
+     * @return filter bank if found, NULL otherwise.
+     */
+    static const AudioResamplerFilter *findFilterL(uint32_t upFactor, uint32_t downFactor,
+                                                   AudioConversion::ResamplerQuality quality);
+
+    /**
+     * Designs a bank and adds it to the cache, caller must hold the cache lock.
+     *
+     * @return filter bank.
+     */
+    static const AudioResamplerFilter *addFilterL(uint32_t upFactor, uint32_t downFactor,
+                                                  AudioConversion::ResamplerQuality quality);
+
+    /**
+     * Kaiser windowed sinc prototype.
+     *
+     * @param[in] time in source frames relative to the center of the filter.
+     * @param[in] cutoff cutoff frequency relative to the source Nyquist frequency.
+     * @param[in] halfLength half length of the window, in source frames.
+     * @param[in] beta Kaiser window shape parameter.
+     *
+     * @return value of the impulse response at given time.
+     */
+    static double prototype(double time, double cutoff, double halfLength, double beta);
+
+    /** @return zeroth order modified Bessel function of the first kind. */
+    static double besselI0(double x);
+
+    const uint32_t mUpFactor; /**< L, upsampling factor. */
+    const uint32_t mDownFactor; /**< M, decimation factor. */
+    const AudioConversion::ResamplerQuality mQuality; /**< Quality the bank is designed for. */
+    uint32_t mTableResolution; /**< Number of tabulated phases. */
+    size_t mTaps; /**< Coefficients per subfilter. */
+    std::vector<float> mCoefs; /**< Subfilters, phase after phase. */
+
+    /** Largest bank that is tabulated without interpolation, in phases. */
+    static const uint32_t mMaxExactPhases = 1024;
+
+    /** Number of tabulated phases of an interpolated bank. */
+    static const uint32_t mInterpolatedPhases = 256;
+
+    /** Upper bound of the subfilter length, reached when decimating by large factors. */
+    static const size_t mMaxTaps = 512;
+};
+
+}  // namespace intel_audio
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+/**
+ * Signed 24 bits sample packed on 3 bytes, little endian (AUDIO_FORMAT_PCM_24_BIT_PACKED).
+ *
+ * Converts implicitly from / to a right justified signed 24 bits value held by an int32_t, so that
+ * the typed converters may handle it as any other integer sample.
+ */
+struct Pcm24Packed
+{
+    Pcm24Packed() {}
+
+    Pcm24Packed(int32_t value)
+    {
+        mBytes[0] = static_cast<uint8_t>(value);
+        mBytes[1] = static_cast<uint8_t>(value >> 8);
+        mBytes[2] = static_cast<uint8_t>(value >> 16);
+    }
+
+    operator int32_t() const
+    {
+        // Build the sample in the 24 MSB, then sign extend by the arithmetic right shift.
+        return static_cast<int32_t>((uint32_t)mBytes[0] << 8 | (uint32_t)mBytes[1] << 16 |
+                                    (uint32_t)mBytes[2] << 24) >> 8;
+    }
+
+    uint8_t mBytes[3];
+};
+
+static_assert(sizeof(Pcm24Packed) == 3, "Pcm24Packed must not be padded");
+
+}  // namespace intel_audio
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "Pcm24Packed.hpp"
+#include <cmath>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+template <typename Accumulator>
+static inline Accumulator roundAndClamp(Accumulator value, Accumulator min, Accumulator max)
+{
+    value = std::floor(value + Accumulator(0.5));
+    return value < min ? min : (value > max ? max : value);
+}
+
+/**
+ * Format traits used by the generic reformatting, the fused conversion, the resampling and the
+ * matrix mixing functions.
+ * Integer formats are converted from / to a left justified signed 32 bits sample (Q31), which
+ * holds any of them without loss. Resolution is the number of meaningful bits of the format.
+ * Filtering and mixing are computed on an Accumulator type: samples are loaded at their own
+ * scale, and stored back with rounding and saturation.
+ */
+struct FormatS16
+{
+    typedef int16_t Sample;
+    typedef float Accumulator;
+    static const uint32_t mResolution = 16;
+    static int32_t toQ31(Sample sample) { return (int32_t)sample << 16; }
+    static Sample fromQ31(int32_t sample) { return sample >> 16; }
+    static Accumulator load(Sample sample) { return sample; }
+    static Sample store(Accumulator value)
+    {
+        return roundAndClamp<Accumulator>(value, INT16_MIN, INT16_MAX);
+    }
+};
+
+/** S24 over 32 bits (Q8.23), the most significant byte being zero. */
+struct FormatS24over32
+{
+    typedef uint32_t Sample;
+    typedef double Accumulator;
+    static const uint32_t mResolution = 24;
+    static int32_t toQ31(Sample sample) { return (int32_t)(sample << 8); }
+    static Sample fromQ31(int32_t sample) { return (uint32_t)sample >> 8; }
+    static Accumulator load(Sample sample) { return (int32_t)(sample << 8) >> 8; }
+    static Sample store(Accumulator value)
+    {
+        int32_t sample = roundAndClamp<Accumulator>(value, -(1 << 23), (1 << 23) - 1);
+        return (uint32_t)sample & 0x00FFFFFF;
+    }
+};
+
+struct FormatS32
+{
+    typedef int32_t Sample;
+    typedef double Accumulator;
+    static const uint32_t mResolution = 32;
+    static int32_t toQ31(Sample sample) { return sample; }
+    static Sample fromQ31(int32_t sample) { return sample; }
+    static Accumulator load(Sample sample) { return sample; }
+    static Sample store(Accumulator value)
+    {
+        return roundAndClamp<Accumulator>(value, INT32_MIN, INT32_MAX);
+    }
+};
+
+struct FormatS24Packed
+{
+    typedef Pcm24Packed Sample;
+    typedef double Accumulator;
+    static const uint32_t mResolution = 24;
+    static int32_t toQ31(Sample sample) { return (int32_t)sample << 8; }
+    static Sample fromQ31(int32_t sample) { return Sample(sample >> 8); }
+    static Accumulator load(Sample sample) { return (int32_t)sample; }
+    static Sample store(Accumulator value)
+    {
+        return Sample((int32_t)roundAndClamp<Accumulator>(value, -(1 << 23), (1 << 23) - 1));
+    }
+};
+
+/** Float samples are neither rounded nor saturated, as for the other converters. */
+struct FormatFloat
+{
+    typedef float Sample;
+    typedef float Accumulator;
+    static Sample fromQ31(int32_t sample) { return sample * (1.0f / (1u << 31)); }
+    static Accumulator load(Sample sample) { return sample; }
+    static Sample store(Accumulator value) { return value; }
+};
+
+}  // namespace intel_audio
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioChannelMatrix.hpp>
+#include <AudioConversion.hpp>
+#include <SampleSpec.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+static const float gCoefTolerance = 1e-4f;
+
+/** Converts a single period with the given channel masks. */
+static std::vector<int16_t> convert(audio_channel_mask_t srcMask, audio_channel_mask_t dstMask,
+                                    const std::vector<int16_t> &src,
+                                    const AudioChannelMatrix::Matrix &matrix =
+                                        AudioChannelMatrix::Matrix())
+{
+    SampleSpec ssSrc(0, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    ssSrc.setChannelMask(srcMask, true);
+    SampleSpec ssDst(0, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    ssDst.setChannelMask(dstMask, true);
+
+    AudioConversion conversion;
+    conversion.setChannelMatrix(matrix);
+    EXPECT_EQ(0, conversion.configure(ssSrc, ssDst));
+
+    size_t frames = src.size() / ssSrc.getChannelCount();
+    std::vector<int16_t> dst(frames * ssDst.getChannelCount());
+    void *dstBuf = &dst[0];
+    size_t outFrames = 0;
+    EXPECT_EQ(0, conversion.convert(&src[0], &dstBuf, frames, &outFrames));
+    EXPECT_EQ(frames, outFrames);
+    return dst;
+}
+
+TEST(AudioChannelMatrix, supportAnyChannelCount)
+{
+    EXPECT_TRUE(AudioConversion::supportRemap(6, 2));
+    EXPECT_TRUE(AudioConversion::supportRemap(2, 6));
+    EXPECT_TRUE(AudioConversion::supportRemap(3, 5));
+    EXPECT_TRUE(AudioConversion::supportRemap(8, 1));
+    EXPECT_FALSE(AudioConversion::supportRemap(0, 2));
+}
+
+TEST(AudioChannelMatrix, positionalMask)
+{
+    EXPECT_EQ(AUDIO_CHANNEL_OUT_STEREO,
+              AudioChannelMatrix::getPositionalMask(AUDIO_CHANNEL_IN_STEREO, 2));
+    EXPECT_EQ(AUDIO_CHANNEL_OUT_MONO,
+              AudioChannelMatrix::getPositionalMask(AUDIO_CHANNEL_IN_MONO, 1));
+    EXPECT_EQ(AUDIO_CHANNEL_OUT_5POINT1,
+              AudioChannelMatrix::getPositionalMask(AUDIO_CHANNEL_OUT_5POINT1, 6));
+    // Unknown or inconsistent masks fall back on the default mask of the channel count.
+    EXPECT_EQ(AUDIO_CHANNEL_OUT_7POINT1, AudioChannelMatrix::getPositionalMask(0, 8));
+    EXPECT_EQ(AUDIO_CHANNEL_OUT_QUAD,
+              AudioChannelMatrix::getPositionalMask(AUDIO_CHANNEL_OUT_STEREO, 4));
+    EXPECT_EQ(AUDIO_CHANNEL_OUT_STEREO,
+              AudioChannelMatrix::getPositionalMask(
+                  audio_channel_mask_for_index_assignment_from_count(2), 2));
+}
+
+TEST(AudioChannelMatrix, downmix5Point1ToStereo)
+{
+    AudioChannelMatrix::Matrix matrix = AudioChannelMatrix::getMixMatrix(
+        AUDIO_CHANNEL_OUT_5POINT1, 6, AUDIO_CHANNEL_OUT_STEREO, 2);
+    ASSERT_EQ(2u, matrix.size());
+    ASSERT_EQ(6u, matrix[0].size());
+
+    // Front, center at -3dB, back at -3dB, normalized. LFE is dropped.
+    const float front = 1 / (1 + 2 * 0.70710678f);
+    const float folded = 0.70710678f * front;
+    const float left[] = { front, 0, folded, 0, folded, 0 };
+    const float right[] = { 0, front, folded, 0, 0, folded };
+    for (size_t src = 0; src < 6; src++) {
+        EXPECT_NEAR(left[src], matrix[0][src], gCoefTolerance) << "source " << src;
+        EXPECT_NEAR(right[src], matrix[1][src], gCoefTolerance) << "source " << src;
+    }
+}
+
+TEST(AudioChannelMatrix, downmix7Point1To5Point1)
+{
+    AudioChannelMatrix::Matrix matrix = AudioChannelMatrix::getMixMatrix(
+        AUDIO_CHANNEL_OUT_7POINT1, 8, AUDIO_CHANNEL_OUT_5POINT1, 6);
+    ASSERT_EQ(6u, matrix.size());
+
+    // 7.1 is FL FR FC LFE BL BR SL SR: sides fold on the back channels.
+    const float expected[6][8] = {
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        { 0, 1, 0, 0, 0, 0, 0, 0 },
+        { 0, 0, 1, 0, 0, 0, 0, 0 },
+        { 0, 0, 0, 1, 0, 0, 0, 0 },
+        { 0, 0, 0, 0, 0.5f, 0, 0.5f, 0 },
+        { 0, 0, 0, 0, 0, 0.5f, 0, 0.5f }
+    };
+    for (size_t dst = 0; dst < 6; dst++) {
+        for (size_t src = 0; src < 8; src++) {
+            EXPECT_NEAR(expected[dst][src], matrix[dst][src], gCoefTolerance)
+                << "destination " << dst << ", source " << src;
+        }
+    }
+}
+
+TEST(AudioChannelMatrix, convert5Point1ToStereo)
+{
+    // Center only, then left only with LFE that must not leak.
+    std::vector<int16_t> src = {
+        0, 0, 10000, 0, 0, 0,
+        10000, 0, 0, 32767, 0, 0
+    };
+    std::vector<int16_t> dst = convert(AUDIO_CHANNEL_OUT_5POINT1, AUDIO_CHANNEL_OUT_STEREO, src);
+    ASSERT_EQ(4u, dst.size());
+    EXPECT_EQ(2929, dst[0]);
+    EXPECT_EQ(2929, dst[1]);
+    EXPECT_EQ(4142, dst[2]);
+    EXPECT_EQ(0, dst[3]);
+}
+
+TEST(AudioChannelMatrix, convertStereoTo5Point1)
+{
+    std::vector<int16_t> src = { 1000, -2000, 32767, -32768 };
+    std::vector<int16_t> dst = convert(AUDIO_CHANNEL_OUT_STEREO, AUDIO_CHANNEL_OUT_5POINT1, src);
+    const int16_t expected[] = {
+        1000, -2000, 0, 0, 0, 0,
+        32767, -32768, 0, 0, 0, 0
+    };
+    ASSERT_EQ(sizeof(expected) / sizeof(expected[0]), dst.size());
+    for (size_t i = 0; i < dst.size(); i++) {
+        EXPECT_EQ(expected[i], dst[i]) << "sample " << i;
+    }
+}
+
+/**
+ * Frames are mixed by blocks: check a conversion spanning several blocks and a partial one.
+ */
+TEST(AudioChannelMatrix, convertAcrossBlocks)
+{
+    static const size_t frames = 200;
+    std::vector<int16_t> src(frames * 8);
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (size_t channel = 0; channel < 8; channel++) {
+            src[frame * 8 + channel] = (channel == 3) ? 0 : 7 * frame;
+        }
+    }
+    // 7.1 to mono averages all channels but LFE.
+    std::vector<int16_t> dst = convert(AUDIO_CHANNEL_OUT_7POINT1, AUDIO_CHANNEL_OUT_MONO, src);
+    ASSERT_EQ(frames, dst.size());
+    for (size_t frame = 0; frame < frames; frame++) {
+        EXPECT_EQ((int16_t)(7 * frame), dst[frame]) << "frame " << frame;
+    }
+}
+
+TEST(AudioChannelMatrix, matrixOverride)
+{
+    // Keep the left channel only, instead of averaging both.
+    AudioChannelMatrix::Matrix leftOnly(1, std::vector<float>(2, 0));
+    leftOnly[0][0] = 1;
+    std::vector<int16_t> src = { 1000, 3000, -500, 500 };
+    std::vector<int16_t> dst = convert(AUDIO_CHANNEL_OUT_STEREO, AUDIO_CHANNEL_OUT_MONO, src,
+                                       leftOnly);
+    ASSERT_EQ(2u, dst.size());
+    EXPECT_EQ(1000, dst[0]);
+    EXPECT_EQ(-500, dst[1]);
+
+    // A matrix with other dimensions is ignored.
+    dst = convert(AUDIO_CHANNEL_OUT_QUAD, AUDIO_CHANNEL_OUT_MONO,
+                  std::vector<int16_t>(4, 100), leftOnly);
+    ASSERT_EQ(1u, dst.size());
+    EXPECT_EQ(100, dst[0]);
+}
+
+TEST(AudioChannelMatrix, ignoredChannels)
+{
+    SampleSpec ssSrc(0, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    ssSrc.setChannelMask(AUDIO_CHANNEL_OUT_5POINT1, true);
+    std::vector<SampleSpec::ChannelsPolicy> ignoreRight;
+    ignoreRight.push_back(SampleSpec::Copy);
+    ignoreRight.push_back(SampleSpec::Ignore);
+    SampleSpec ssDst(2, AUDIO_FORMAT_PCM_16_BIT, 48000, ignoreRight);
+
+    AudioConversion conversion;
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssDst));
+    const int16_t src[] = { 0, 10000, 0, 0, 0, 10000 };
+    int16_t dst[] = { -1, -1 };
+    void *dstBuf = dst;
+    size_t outFrames = 0;
+    EXPECT_EQ(0, conversion.convert(src, &dstBuf, 1, &outFrames));
+    EXPECT_EQ(0, dst[0]);
+    EXPECT_EQ(0, dst[1]);
+}
+
+} // namespace intel_audio
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AllocationCounter.hpp>
+#include <AudioConversion.hpp>
+#include <AudioUtils.hpp>
+#include <SampleSpec.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+/** Frames of a 10ms period at 48kHz. */
+static const size_t gPeriodFrames = 480;
+
+/** Periods converted once the buffers are reserved. */
+static const int gPeriods = 50;
+
+struct AllocationCase
+{
+    SampleSpec ssSrc;
+    SampleSpec ssDst;
+    bool adaptive;
+};
+
+static std::vector<AllocationCase> getCases()
+{
+    AllocationCase cases[] = {
+        { SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 44100), false },
+        { SampleSpec(1, AUDIO_FORMAT_PCM_16_BIT, 16000),
+          SampleSpec(2, AUDIO_FORMAT_PCM_FLOAT, 48000), false },
+        { SampleSpec(2, AUDIO_FORMAT_PCM_FLOAT, 44100),
+          SampleSpec(4, AUDIO_FORMAT_PCM_32_BIT, 48000), false },
+        { SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000), true }
+    };
+    return std::vector<AllocationCase>(cases, cases + sizeof(cases) / sizeof(cases[0]));
+}
+
+/** Provides the same frames in loop, from a buffer large enough for any request. */
+class LoopProvider : public android::AudioBufferProvider
+{
+public:
+    LoopProvider(std::vector<uint8_t> &source) : mSource(source) {}
+
+    virtual android::status_t getNextBuffer(android::AudioBufferProvider::Buffer *buffer)
+    {
+        buffer->raw = &mSource[0];
+        return android::NO_ERROR;
+    }
+
+    virtual void releaseBuffer(Buffer */*buffer*/) {}
+
+private:
+    std::vector<uint8_t> &mSource;
+};
+
+/** Playback: the periods written are converted in the buffers of the chain. */
+TEST(AudioConversionAllocation, convertOnceReserved)
+{
+    std::vector<AllocationCase> cases = getCases();
+    for (size_t i = 0; i < cases.size(); i++) {
+        AudioConversion conversion;
+        conversion.setAdaptiveRate(cases[i].adaptive);
+        ASSERT_EQ(android::OK, conversion.configure(cases[i].ssSrc, cases[i].ssDst));
+        ASSERT_EQ(android::OK, conversion.reserve(gPeriodFrames, 0));
+        std::vector<uint8_t> source(cases[i].ssSrc.convertFramesToBytes(gPeriodFrames));
+
+        uint64_t allocations = AllocationCounter::getCount();
+        for (int period = 0; period < gPeriods; period++) {
+            void *dst = NULL;
+            size_t outFrames;
+            ASSERT_EQ(android::OK, conversion.convert(&source[0], &dst, gPeriodFrames,
+                                                      &outFrames));
+        }
+        EXPECT_EQ(0u, AllocationCounter::getCount() - allocations) << "case " << i;
+    }
+}
+
+/** Capture: the periods read are converted in the ring buffer of the chain. */
+TEST(AudioConversionAllocation, getConvertedBufferOnceReserved)
+{
+    std::vector<AllocationCase> cases = getCases();
+    for (size_t i = 0; i < cases.size(); i++) {
+        AudioConversion conversion;
+        conversion.setAdaptiveRate(cases[i].adaptive);
+        ASSERT_EQ(android::OK, conversion.configure(cases[i].ssSrc, cases[i].ssDst));
+        // Room for the frames requested in the worst case, rounded up and with resampler margin.
+        const size_t periodFrames = 4 * gPeriodFrames;
+        ASSERT_EQ(android::OK, conversion.reserve(0, periodFrames));
+        std::vector<uint8_t> source(cases[i].ssSrc.convertFramesToBytes(
+                                        AudioUtils::convertSrcToDstInFrames(
+                                            periodFrames, cases[i].ssDst, cases[i].ssSrc) + 64));
+        std::vector<uint8_t> destination(cases[i].ssDst.convertFramesToBytes(periodFrames));
+        LoopProvider provider(source);
+
+        uint64_t allocations = AllocationCounter::getCount();
+        for (int period = 0; period < gPeriods; period++) {
+            ASSERT_EQ(android::OK, conversion.getConvertedBuffer(&destination[0], periodFrames,
+                                                                 &provider));
+        }
+        EXPECT_EQ(0u, AllocationCounter::getCount() - allocations) << "case " << i;
+    }
+}
+
+/** The sample specifications are copied on the audio path. */
+TEST(AudioConversionAllocation, sampleSpecCopy)
+{
+    SampleSpec sampleSpec(4, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    uint64_t allocations = AllocationCounter::getCount();
+    SampleSpec copy(sampleSpec);
+    copy = sampleSpec;
+    EXPECT_TRUE(copy == sampleSpec);
+    EXPECT_EQ(0u, AllocationCounter::getCount() - allocations);
+}
+
+} // namespace intel_audio
@@ -21,6 +21,11 @@
 #include <media/AudioBufferProvider.h>
 #include <gtest/gtest.h>
 #include <utils/Errors.h>
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
 
 namespace intel_audio
 {
@@ -560,6 +565,172 @@ INSTANTIATE_TEST_CASE_P(reformatS24leToS16,
                             )
                         );
 
+const float sourceBufFloat[] = {
+    0.0f, 0.5f,
+    -0.5f, 0.25f,
+    1.0f, -1.0f,
+    2.0f, -2.0f
+};
+
+const int16_t expectedDstBufFloatToS16[] = {
+    0, 16384,
+    -16384, 8192,
+    32767, -32768,
+    32767, -32768
+};
+
+/**
+ * Test a reformating from float to S16 format in iso-channels and rate, out of range samples
+ * must be saturated.
+ */
+INSTANTIATE_TEST_CASE_P(reformatFloatToS16,
+                        AudioConversionT,
+                        ::testing::Values(
+                            AudioConversionParam(
+                                SampleSpec(2, AUDIO_FORMAT_PCM_FLOAT, 48000),
+                                SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+                                sourceBufFloat,
+                                sizeof(sourceBufFloat),
+                                expectedDstBufFloatToS16,
+                                sizeof(expectedDstBufFloatToS16),
+                                false
+                                )
+                            )
+                        );
+
+const int16_t sourceBufS16ToFloat[] = {
+    0, 16384,
+    -16384, -32768
+};
+
+const float expectedDstBufS16ToFloat[] = {
+    0.0f, 0.5f,
+    -0.5f, -1.0f
+};
+
+/**
+ * Test a reformating from S16 to float format in iso-channels and rate.
+ */
+INSTANTIATE_TEST_CASE_P(reformatS16ToFloat,
+                        AudioConversionT,
+                        ::testing::Values(
+                            AudioConversionParam(
+                                SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+                                SampleSpec(2, AUDIO_FORMAT_PCM_FLOAT, 48000),
+                                sourceBufS16ToFloat,
+                                sizeof(sourceBufS16ToFloat),
+                                expectedDstBufS16ToFloat,
+                                sizeof(expectedDstBufS16ToFloat),
+                                true
+                                )
+                            )
+                        );
+
+const uint16_t sourceBufS16ToPacked24[] = {
+    0x1234, 0x8000,
+    0xFFFF, 0x7FFF
+};
+
+const uint8_t expectedDstBufS16ToPacked24[] = {
+    0x00, 0x34, 0x12, 0x00, 0x00, 0x80,
+    0x00, 0xFF, 0xFF, 0x00, 0xFF, 0x7F
+};
+
+/**
+ * Test a reformating from S16 to packed S24 format in iso-channels and rate.
+ */
+INSTANTIATE_TEST_CASE_P(reformatS16ToPacked24,
+                        AudioConversionT,
+                        ::testing::Values(
+                            AudioConversionParam(
+                                SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+                                SampleSpec(2, AUDIO_FORMAT_PCM_24_BIT_PACKED, 48000),
+                                sourceBufS16ToPacked24,
+                                sizeof(sourceBufS16ToPacked24),
+                                expectedDstBufS16ToPacked24,
+                                sizeof(expectedDstBufS16ToPacked24),
+                                false
+                                )
+                            )
+                        );
+
+const uint8_t sourceBufPacked24ToS16[] = {
+    0x56, 0x34, 0x12, 0xFF, 0xFF, 0xFF,
+    0x00, 0x00, 0x80, 0x00, 0x01, 0x00
+};
+
+const uint16_t expectedDstBufPacked24ToS16[] = {
+    0x1234, 0xFFFF,
+    0x8000, 0x0001
+};
+
+/**
+ * Test a reformating from packed S24 to S16 format in iso-channels and rate.
+ */
+INSTANTIATE_TEST_CASE_P(reformatPacked24ToS16,
+                        AudioConversionT,
+                        ::testing::Values(
+                            AudioConversionParam(
+                                SampleSpec(2, AUDIO_FORMAT_PCM_24_BIT_PACKED, 48000),
+                                SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+                                sourceBufPacked24ToS16,
+                                sizeof(sourceBufPacked24ToS16),
+                                expectedDstBufPacked24ToS16,
+                                sizeof(expectedDstBufPacked24ToS16),
+                                false
+                                )
+                            )
+                        );
+
+const float expectedDstBufFloatStereoToMono[] = {
+    0.25f,
+    -0.125f,
+    0.0f,
+    0.0f
+};
+
+/**
+ * Test a remapping from stereo to mono in float format in iso rate.
+ */
+INSTANTIATE_TEST_CASE_P(remapStereoToMonoInFloat,
+                        AudioConversionT,
+                        ::testing::Values(
+                            AudioConversionParam(
+                                SampleSpec(2, AUDIO_FORMAT_PCM_FLOAT, 48000),
+                                SampleSpec(1, AUDIO_FORMAT_PCM_FLOAT, 48000),
+                                sourceBufFloat,
+                                sizeof(sourceBufFloat),
+                                expectedDstBufFloatStereoToMono,
+                                sizeof(expectedDstBufFloatStereoToMono),
+                                false
+                                )
+                            )
+                        );
+
+/**
+ * Test that dithering a float to S16 reformating only alters the LSB.
+ */
+TEST(AudioConversion, ditherFloatToS16)
+{
+    const SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_FLOAT, 48000);
+    const SampleSpec ssDst(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    const size_t frames = sizeof(sourceBufFloat) / ssSrc.getFrameSize();
+
+    AudioConversion audioConversion;
+    audioConversion.setDither(true);
+    ASSERT_EQ(0, audioConversion.configure(ssSrc, ssDst));
+
+    int16_t dithered[sizeof(expectedDstBufFloatToS16) / sizeof(int16_t)];
+    void *dst = dithered;
+    size_t outFrames = 0;
+    ASSERT_EQ(0, audioConversion.convert(sourceBufFloat, &dst, frames, &outFrames));
+    ASSERT_EQ(frames, outFrames);
+
+    for (size_t i = 0; i < frames * ssSrc.getChannelCount(); i++) {
+        EXPECT_LE(abs(dithered[i] - expectedDstBufFloatToS16[i]), 1) << "sample " << i;
+    }
+}
+
 const uint16_t sourceBuf11[] = {
     10, 20,
     5, 1,
@@ -728,6 +899,224 @@ TEST(AudioConversion, memoryTest)
     delete audioConversion;
 }
 
+/**
+ * Writes a sample given as a float in [-1.0, 1.0[ in the given format.
+ */
+static void writeSample(audio_format_t format, void *buffer, size_t index, double value)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        static_cast<int16_t *>(buffer)[index] = (int16_t)floor(value * (1 << 15) + 0.5);
+        break;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        static_cast<uint32_t *>(buffer)[index] =
+            (uint32_t)(int32_t)floor(value * (1 << 23) + 0.5) & 0x00FFFFFF;
+        break;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        static_cast<int32_t *>(buffer)[index] = (int32_t)floor(value * 2147483648.0 + 0.5);
+        break;
+    case AUDIO_FORMAT_PCM_FLOAT:
+        static_cast<float *>(buffer)[index] = value;
+        break;
+    default:
+        FAIL() << "unexpected format " << format;
+    }
+}
+
+/**
+ * Reads a sample of the given format as a float in [-1.0, 1.0[.
+ */
+static double readSample(audio_format_t format, const void *buffer, size_t index)
+{
+    switch (format) {
+    case AUDIO_FORMAT_PCM_16_BIT:
+        return static_cast<const int16_t *>(buffer)[index] / 32768.0;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        return ((int32_t)(static_cast<const uint32_t *>(buffer)[index] << 8) >> 8) / 8388608.0;
+    case AUDIO_FORMAT_PCM_32_BIT:
+        return static_cast<const int32_t *>(buffer)[index] / 2147483648.0;
+    case AUDIO_FORMAT_PCM_FLOAT:
+        return static_cast<const float *>(buffer)[index];
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Resamples a stream period after period, as the streams do.
+ *
+ * @param[in] ssSrc source sample specifications.
+ * @param[in] ssDst destination sample specifications.
+ * @param[in] quality resampling quality.
+ * @param[in] src source buffer.
+ * @param[in] frames number of source frames.
+ * @param[in] periodFrames source frames converted at once, cycling through the given sizes.
+ * @param[out] dst destination buffer, resized to the frames produced.
+ */
+static void resampleByPeriods(const SampleSpec &ssSrc, const SampleSpec &ssDst,
+                              AudioConversion::ResamplerQuality quality,
+                              const std::vector<uint8_t> &src, size_t frames,
+                              const std::vector<size_t> &periodFrames,
+                              std::vector<uint8_t> &dst)
+{
+    AudioConversion audioConversion;
+    audioConversion.setResamplerQuality(quality);
+    ASSERT_EQ(0, audioConversion.configure(ssSrc, ssDst));
+
+    dst.clear();
+    size_t period = 0;
+    for (size_t frame = 0; frame < frames; period++) {
+        size_t inFrames = std::min(periodFrames[period % periodFrames.size()], frames - frame);
+        void *out = NULL;
+        size_t outFrames = 0;
+        ASSERT_EQ(0, audioConversion.convert(&src[frame * ssSrc.getFrameSize()], &out,
+                                             inFrames, &outFrames));
+        ASSERT_LE(outFrames, AudioUtils::convertSrcToDstInFrames(inFrames, ssSrc, ssDst));
+        const uint8_t *outBytes = static_cast<const uint8_t *>(out);
+        dst.insert(dst.end(), outBytes, outBytes + outFrames * ssDst.getFrameSize());
+        frame += inFrames;
+    }
+}
+
+/**
+ * Sine tone resampling parameters: source and destination specifications (the format and
+ * channels being the same), quality and minimum signal to noise ratio expected in dB.
+ */
+struct ResamplerQualityParam
+{
+    ResamplerQualityParam(uint32_t channels, audio_format_t format, uint32_t srcRate,
+                          uint32_t dstRate, AudioConversion::ResamplerQuality quality,
+                          double minSnr)
+        : ssSrc(channels, format, srcRate),
+          ssDst(channels, format, dstRate),
+          quality(quality),
+          minSnr(minSnr)
+    {}
+
+    SampleSpec ssSrc;
+    SampleSpec ssDst;
+    AudioConversion::ResamplerQuality quality;
+    double minSnr;
+};
+
+class AudioResamplerQualityT : public ::testing::TestWithParam<ResamplerQualityParam>
+{
+};
+
+/**
+ * Resamples a 1kHz tone of one second, by periods of 10ms, and checks that once the filter is
+ * settled, the output is the same tone up to the expected signal to noise ratio. The tone is
+ * fitted on the output, so that the delay of the filter does not matter.
+ */
+TEST_P(AudioResamplerQualityT, sineToneSnr)
+{
+    const ResamplerQualityParam &param = GetParam();
+    const double frequency = 1000;
+    const double amplitude = 0.5;
+    const uint32_t channels = param.ssSrc.getChannelCount();
+    const audio_format_t format = param.ssSrc.getFormat();
+    const size_t frames = param.ssSrc.getSampleRate();
+
+    std::vector<uint8_t> src(frames * param.ssSrc.getFrameSize());
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (uint32_t channel = 0; channel < channels; channel++) {
+            // Channels are out of phase, so that swapping them would be detected.
+            double phase = 2 * M_PI * frequency * frame / param.ssSrc.getSampleRate();
+            writeSample(format, &src[0], frame * channels + channel,
+                        amplitude * sin(phase + channel * M_PI / 2));
+        }
+    }
+
+    std::vector<uint8_t> dst;
+    resampleByPeriods(param.ssSrc, param.ssDst, param.quality, src, frames,
+                      std::vector<size_t>(1, param.ssSrc.getSampleRate() / 100), dst);
+    const size_t dstFrames = dst.size() / param.ssDst.getFrameSize();
+    const size_t expectedFrames = param.ssDst.getSampleRate();
+    ASSERT_LE(dstFrames, expectedFrames);
+    ASSERT_GE(dstFrames + 1, expectedFrames);
+
+    // Skip the first 100ms, then fit on a whole number of periods.
+    const size_t first = param.ssDst.getSampleRate() / 10;
+    const size_t length = param.ssDst.getSampleRate() / 2;
+    const double omega = 2 * M_PI * frequency / param.ssDst.getSampleRate();
+    for (uint32_t channel = 0; channel < channels; channel++) {
+        double sinPart = 0;
+        double cosPart = 0;
+        for (size_t frame = first; frame < first + length; frame++) {
+            double sample = readSample(format, &dst[0], frame * channels + channel);
+            sinPart += sample * sin(omega * frame);
+            cosPart += sample * cos(omega * frame);
+        }
+        sinPart *= 2.0 / length;
+        cosPart *= 2.0 / length;
+        EXPECT_NEAR(amplitude, sqrt(sinPart * sinPart + cosPart * cosPart), 0.01);
+
+        double signal = 0;
+        double noise = 0;
+        for (size_t frame = first; frame < first + length; frame++) {
+            double fit = sinPart * sin(omega * frame) + cosPart * cos(omega * frame);
+            double error = readSample(format, &dst[0], frame * channels + channel) - fit;
+            signal += fit * fit;
+            noise += error * error;
+        }
+        EXPECT_GT(10 * log10(signal / noise), param.minSnr) << "channel " << channel;
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    resampleSineTone,
+    AudioResamplerQualityT,
+    ::testing::Values(
+        ResamplerQualityParam(2, AUDIO_FORMAT_PCM_16_BIT, 44100, 48000,
+                              AudioConversion::ResamplerQualityMedium, 70),
+        ResamplerQualityParam(2, AUDIO_FORMAT_PCM_16_BIT, 48000, 44100,
+                              AudioConversion::ResamplerQualityMedium, 70),
+        ResamplerQualityParam(1, AUDIO_FORMAT_PCM_16_BIT, 16000, 48000,
+                              AudioConversion::ResamplerQualityLow, 50),
+        ResamplerQualityParam(1, AUDIO_FORMAT_PCM_16_BIT, 48000, 16000,
+                              AudioConversion::ResamplerQualityLow, 50),
+        ResamplerQualityParam(2, AUDIO_FORMAT_PCM_8_24_BIT, 44100, 48000,
+                              AudioConversion::ResamplerQualityHigh, 90),
+        ResamplerQualityParam(6, AUDIO_FORMAT_PCM_32_BIT, 48000, 44100,
+                              AudioConversion::ResamplerQualityHigh, 90),
+        ResamplerQualityParam(2, AUDIO_FORMAT_PCM_FLOAT, 44100, 48000,
+                              AudioConversion::ResamplerQualityHigh, 90),
+        ResamplerQualityParam(2, AUDIO_FORMAT_PCM_FLOAT, 44100, 47999,
+                              AudioConversion::ResamplerQualityHigh, 80)
+        )
+    );
+
+/**
+ * Checks that the output does not depend on the way the input is split, i.e. that the history
+ * and the phase are kept from one conversion to the next.
+ */
+TEST(AudioConversion, resampleIsPeriodIndependent)
+{
+    const SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, 44100);
+    const SampleSpec ssDst(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    const size_t frames = 4410;
+
+    std::vector<uint8_t> src(frames * ssSrc.getFrameSize());
+    srand(0x5EED);
+    for (size_t i = 0; i < frames * ssSrc.getChannelCount(); i++) {
+        writeSample(ssSrc.getFormat(), &src[0], i, (rand() % 65536 - 32768) / 65536.0);
+    }
+
+    std::vector<uint8_t> reference;
+    resampleByPeriods(ssSrc, ssDst, AudioConversion::ResamplerQualityMedium, src, frames,
+                      std::vector<size_t>(1, frames), reference);
+    EXPECT_EQ(AudioUtils::convertSrcToDstInFrames(frames, ssSrc, ssDst),
+              reference.size() / ssDst.getFrameSize());
+
+    const size_t periods[] = { 1, 7, 64, 441, 2, 1000 };
+    std::vector<uint8_t> split;
+    resampleByPeriods(ssSrc, ssDst, AudioConversion::ResamplerQualityMedium, src, frames,
+                      std::vector<size_t>(periods, periods + sizeof(periods) / sizeof(periods[0])),
+                      split);
+    ASSERT_EQ(reference.size(), split.size());
+    EXPECT_EQ(0, memcmp(&reference[0], &split[0], reference.size()));
+}
+
 /**
  * Test a configure for every couple of source and destination frequency rates
  * usually used.
@@ -974,4 +1363,324 @@ TEST(AudioConversion, frameExactApi)
     // @todo: quality check of output
 }
 
+/**
+ * Frames converted beyond the ones requested are reported buffered until read by the next call,
+ * and dropped by a new configuration.
+ */
+TEST(AudioConversion, reportsBufferedFrames)
+{
+    const SampleSpec sampleSpecSrc(2, AUDIO_FORMAT_PCM_16_BIT, 8000);
+    const SampleSpec sampleSpecDst(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+
+    AudioConversion audioConversion;
+    EXPECT_EQ(0, audioConversion.configure(sampleSpecSrc, sampleSpecDst));
+    EXPECT_EQ(0u, audioConversion.getBufferedFrames());
+
+    uint16_t sourceBuf[2 * 80] = {};
+    MyAudioBufferProvider bufferProvider(&sourceBuf[0], sizeof(sourceBuf) / sizeof(uint16_t));
+    // A single source frame gives 6 destination frames.
+    uint16_t dstBuf[2 * 4];
+    EXPECT_EQ(0, audioConversion.getConvertedBuffer(static_cast<void *>(dstBuf), 4,
+                                                    &bufferProvider));
+    size_t buffered = audioConversion.getBufferedFrames();
+    EXPECT_GT(buffered, 0u);
+
+    EXPECT_EQ(0, audioConversion.getConvertedBuffer(static_cast<void *>(dstBuf), 1,
+                                                    &bufferProvider));
+    EXPECT_EQ(buffered - 1, audioConversion.getBufferedFrames());
+
+    EXPECT_EQ(0, audioConversion.configure(sampleSpecSrc, sampleSpecDst));
+    EXPECT_EQ(0u, audioConversion.getBufferedFrames());
+}
+
+/**
+ * An impulse comes out of the resampler late by the group delay reported by the chain.
+ */
+TEST(AudioConversion, reportsResamplerDelay)
+{
+    const SampleSpec sampleSpecSrc(1, AUDIO_FORMAT_PCM_16_BIT, 24000);
+    const SampleSpec sampleSpecDst(1, AUDIO_FORMAT_PCM_16_BIT, 48000);
+
+    AudioConversion audioConversion;
+    EXPECT_EQ(0u, audioConversion.getDelayFrames());
+    EXPECT_EQ(0, audioConversion.configure(sampleSpecSrc, sampleSpecDst));
+    size_t delay = audioConversion.getDelayFrames();
+    EXPECT_GT(delay, 0u);
+    EXPECT_EQ(delay, audioConversion.getLatencyFrames());
+
+    const size_t inFrames = 1000;
+    const size_t impulse = 100;
+    std::vector<int16_t> src(inFrames, 0);
+    src[impulse] = 16000;
+    void *dst = NULL;
+    size_t outFrames = 0;
+    ASSERT_EQ(0, audioConversion.convert(&src[0], &dst, inFrames, &outFrames));
+    const int16_t *out = static_cast<const int16_t *>(dst);
+    size_t peak = std::max_element(out, out + outFrames) - out;
+    EXPECT_NEAR(2 * impulse + delay, peak, 1);
+
+    // Same rates, no resampler.
+    EXPECT_EQ(0, audioConversion.configure(sampleSpecDst, sampleSpecDst));
+    EXPECT_EQ(0u, audioConversion.getDelayFrames());
+}
+
+/**
+ * Averages of a number of channels that is not a power of 2 round to the lower integer, as the
+ * others, negative samples included.
+ */
+TEST(AudioConversion, remapAverageOfThreeChannels)
+{
+    std::vector<SampleSpec::ChannelsPolicy> ignoreBackRight(4, SampleSpec::Copy);
+    ignoreBackRight[3] = SampleSpec::Ignore;
+    const SampleSpec ssSrc(4, AUDIO_FORMAT_PCM_16_BIT, 48000, ignoreBackRight);
+    const SampleSpec ssDst(1, AUDIO_FORMAT_PCM_16_BIT, 48000);
+
+    AudioConversion audioConversion;
+    ASSERT_EQ(0, audioConversion.configure(ssSrc, ssDst));
+
+    const int16_t sourceBuf[] = {
+        -1, -1, -2, 1000,
+        -3, -3, -3, 1000,
+        32767, 32767, 32766, -1000,
+        -32768, -32768, -32767, 0
+    };
+    const int16_t expectedDstBuf[] = { -2, -3, 32766, -32768 };
+    int16_t dstBuf[4];
+    void *dst = dstBuf;
+    size_t dstFrames = 0;
+    EXPECT_EQ(0, audioConversion.convert(sourceBuf, &dst, 4, &dstFrames));
+    EXPECT_EQ(4u, dstFrames);
+    for (size_t frame = 0; frame < 4; frame++) {
+        EXPECT_EQ(expectedDstBuf[frame], dstBuf[frame]) << "frame " << frame;
+    }
+}
+
+/**
+ * Converts a period of a ramp, letting the chain provide the destination buffer.
+ *
+ * @return converted samples, the buffer holding them in bufferUsed.
+ */
+static std::vector<int16_t> convertRamp(AudioConversion &conversion, const SampleSpec &ssSrc,
+                                        const SampleSpec &ssDst, void **bufferUsed)
+{
+    static const size_t frames = 480;
+    std::vector<int16_t> src(frames * ssSrc.getChannelCount());
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = 37 * i;
+    }
+    void *dstBuf = NULL;
+    size_t outFrames = 0;
+    EXPECT_EQ(0, conversion.convert(&src[0], &dstBuf, frames, &outFrames));
+    *bufferUsed = dstBuf;
+    const int16_t *dst = static_cast<const int16_t *>(dstBuf);
+    return std::vector<int16_t>(dst, dst + outFrames * ssDst.getChannelCount());
+}
+
+TEST(AudioConversion, planCacheReroute)
+{
+    const SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, 44100);
+    const SampleSpec ssSpeaker(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    const SampleSpec ssHeadset(1, AUDIO_FORMAT_PCM_16_BIT, 16000);
+
+    AudioConversion conversion;
+    void *speakerBuffer = NULL;
+    void *bufferUsed = NULL;
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssSpeaker));
+    convertRamp(conversion, ssSrc, ssSpeaker, &speakerBuffer);
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssHeadset));
+    convertRamp(conversion, ssSrc, ssHeadset, &bufferUsed);
+    EXPECT_EQ(0u, conversion.getPlanCacheHits());
+    EXPECT_EQ(2u, conversion.getPlanCacheMisses());
+
+    // Back to the speaker: the chain and its buffers are reused, the resampler history is not.
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssSpeaker));
+    EXPECT_EQ(1u, conversion.getPlanCacheHits());
+    EXPECT_EQ(2u, conversion.getPlanCacheMisses());
+    std::vector<int16_t> rerouted = convertRamp(conversion, ssSrc, ssSpeaker, &bufferUsed);
+    EXPECT_EQ(speakerBuffer, bufferUsed);
+
+    AudioConversion fresh;
+    ASSERT_EQ(0, fresh.configure(ssSrc, ssSpeaker));
+    std::vector<int16_t> expected = convertRamp(fresh, ssSrc, ssSpeaker, &bufferUsed);
+    ASSERT_EQ(expected.size(), rerouted.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), rerouted.begin()));
+}
+
+TEST(AudioConversion, planCacheEviction)
+{
+    const SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    const uint32_t rates[] = { 8000, 16000, 22050, 32000, 44100 };
+    const size_t nbRates = sizeof(rates) / sizeof(rates[0]);
+
+    AudioConversion conversion;
+    for (size_t i = 0; i < nbRates; i++) {
+        ASSERT_EQ(0, conversion.configure(ssSrc,
+                                          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, rates[i])));
+    }
+    EXPECT_EQ(nbRates, conversion.getPlanCacheMisses());
+
+    // Four chains are kept: the oldest one was evicted, the others are reused.
+    ASSERT_EQ(0, conversion.configure(ssSrc, SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, rates[1])));
+    EXPECT_EQ(1u, conversion.getPlanCacheHits());
+    ASSERT_EQ(0, conversion.configure(ssSrc, SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, rates[0])));
+    EXPECT_EQ(1u, conversion.getPlanCacheHits());
+    EXPECT_EQ(nbRates + 1, conversion.getPlanCacheMisses());
+
+    // Channel masks select the mixing matrix, thus are part of the key.
+    SampleSpec ssSurround(0, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    ssSurround.setChannelMask(AUDIO_CHANNEL_OUT_5POINT1, true);
+    SampleSpec ssSide(0, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    ssSide.setChannelMask(AUDIO_CHANNEL_OUT_5POINT1_SIDE, true);
+    ASSERT_EQ(0, conversion.configure(ssSurround, ssSrc));
+    ASSERT_EQ(0, conversion.configure(ssSide, ssSrc));
+    EXPECT_EQ(nbRates + 3, conversion.getPlanCacheMisses());
+}
+
+TEST(AudioConversion, planCacheSettings)
+{
+    const SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, 44100);
+    const SampleSpec ssDst(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    const std::vector<std::vector<float> > noMatrix;
+
+    AudioConversion conversion;
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssDst));
+
+    // Setting the same values keeps the chain, a new resampler quality needs a new one.
+    conversion.setChannelMatrix(noMatrix);
+    conversion.setResamplerQuality(AudioConversion::ResamplerQualityMedium);
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssDst));
+    EXPECT_EQ(1u, conversion.getPlanCacheHits());
+
+    conversion.setResamplerQuality(AudioConversion::ResamplerQualityHigh);
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssDst));
+    EXPECT_EQ(1u, conversion.getPlanCacheHits());
+    EXPECT_EQ(2u, conversion.getPlanCacheMisses());
+}
+
+/**
+ * Provides the frames of a buffer in order, as many as requested.
+ */
+class RampBufferProvider : public android::AudioBufferProvider
+{
+public:
+    RampBufferProvider(const std::vector<int16_t> &samples, uint32_t channels)
+        : mSamples(samples), mChannels(channels), mFrame(0)
+    {}
+
+    virtual android::status_t getNextBuffer(android::AudioBufferProvider::Buffer *buffer)
+    {
+        if ((mFrame + buffer->frameCount) * mChannels > mSamples.size()) {
+            return android::NOT_ENOUGH_DATA;
+        }
+        buffer->i16 = &mSamples[mFrame * mChannels];
+        mFrame += buffer->frameCount;
+        return android::NO_ERROR;
+    }
+
+    virtual void releaseBuffer(Buffer */*buffer*/) {}
+
+private:
+    std::vector<int16_t> mSamples;
+    uint32_t mChannels;
+    size_t mFrame;
+};
+
+/**
+ * Reads of any size, wrapping around the ring buffer or growing it, give the frames of a single
+ * conversion of the whole stream.
+ */
+TEST(AudioConversion, ringBufferReads)
+{
+    const SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, 44100);
+    const SampleSpec ssDst(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    const size_t reads[] = { 480, 333, 1000, 1, 1999, 4000, 480, 777 };
+    const size_t nbReads = sizeof(reads) / sizeof(reads[0]);
+    size_t totalFrames = 0;
+    for (size_t i = 0; i < nbReads; i++) {
+        totalFrames += reads[i];
+    }
+
+    std::vector<int16_t> src(2 * totalFrames);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = (i * 97) % 20011 - 10000;
+    }
+    AudioConversion reference;
+    ASSERT_EQ(0, reference.configure(ssSrc, ssDst));
+    std::vector<int16_t> expected(2 * (AudioUtils::convertSrcToDstInFrames(totalFrames, ssSrc,
+                                                                          ssDst) + 1));
+    void *expectedBuf = &expected[0];
+    size_t expectedFrames = 0;
+    ASSERT_EQ(0, reference.convert(&src[0], &expectedBuf, totalFrames, &expectedFrames));
+
+    AudioConversion conversion;
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssDst));
+    RampBufferProvider provider(src, 2);
+    std::vector<int16_t> dst;
+    bool wrapped = false;
+    for (size_t i = 0; i < nbReads && dst.size() / 2 + reads[i] <= expectedFrames; i++) {
+        if (i % 2) {
+            std::vector<int16_t> read(2 * reads[i]);
+            ASSERT_EQ(0, conversion.getConvertedBuffer(&read[0], reads[i], &provider));
+            dst.insert(dst.end(), read.begin(), read.end());
+            continue;
+        }
+        AudioConversion::ConvertedSpans spans;
+        ASSERT_EQ(0, conversion.getConvertedBuffer(reads[i], &provider, &spans));
+        ASSERT_EQ(reads[i], spans.frames[0] + spans.frames[1]);
+        wrapped = wrapped || (spans.frames[1] != 0);
+        for (size_t span = 0; span < 2; span++) {
+            const int16_t *samples = static_cast<const int16_t *>(spans.raw[span]);
+            dst.insert(dst.end(), samples, samples + 2 * spans.frames[span]);
+        }
+    }
+    EXPECT_TRUE(wrapped);
+    ASSERT_LE(dst.size(), expected.size());
+    EXPECT_TRUE(std::equal(dst.begin(), dst.end(), expected.begin()));
+}
+
+/**
+ * Converting in a buffer of the caller, as in the buffer of an audio device, gives the frames
+ * converted in the buffer of the chain, and never outputs more than getMaxConvertedFrames.
+ */
+TEST(AudioConversion, convertInCallerBuffer)
+{
+    const SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, 44100);
+    const SampleSpec ssDst(1, AUDIO_FORMAT_PCM_32_BIT, 48000);
+    const size_t periods[] = { 441, 1, 256, 1000, 73 };
+
+    AudioConversion reference;
+    ASSERT_EQ(0, reference.configure(ssSrc, ssDst));
+    AudioConversion conversion;
+    ASSERT_EQ(0, conversion.configure(ssSrc, ssDst));
+    EXPECT_EQ(0u, conversion.getMaxConvertedFrames(0));
+
+    for (size_t i = 0; i < 50; i++) {
+        size_t period = periods[i % (sizeof(periods) / sizeof(periods[0]))];
+        std::vector<int16_t> src(2 * period);
+        for (size_t sample = 0; sample < src.size(); sample++) {
+            src[sample] = ((i + sample) * 131) % 30011 - 15000;
+        }
+        void *expected = NULL;
+        size_t expectedFrames = 0;
+        ASSERT_EQ(0, reference.convert(&src[0], &expected, period, &expectedFrames));
+
+        size_t maxFrames = conversion.getMaxConvertedFrames(period);
+        ASSERT_GE(maxFrames, expectedFrames);
+        // Guard frame to catch any write beyond the maximum.
+        std::vector<int32_t> area(maxFrames + 1, 0x5A5A5A5A);
+        void *dst = &area[0];
+        size_t outFrames = 0;
+        ASSERT_EQ(0, conversion.convert(&src[0], &dst, period, &outFrames));
+        EXPECT_EQ(static_cast<void *>(&area[0]), dst);
+        ASSERT_EQ(expectedFrames, outFrames);
+        EXPECT_EQ(0, memcmp(expected, &area[0], ssDst.convertFramesToBytes(outFrames)));
+        EXPECT_EQ(0x5A5A5A5A, area[maxFrames]);
+    }
+
+    // Without conversion, the frames are copied as they are.
+    const SampleSpec ss(2, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    ASSERT_EQ(0, conversion.configure(ss, ss));
+    EXPECT_EQ(480u, conversion.getMaxConvertedFrames(480));
+}
+
 } // namespace intel_audio
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioFusedConverter.hpp>
+#include <AudioConversion.hpp>
+#include <SampleSpec.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+static const audio_format_t gFusedFormats[] = {
+    AUDIO_FORMAT_PCM_16_BIT,
+    AUDIO_FORMAT_PCM_8_24_BIT,
+    AUDIO_FORMAT_PCM_32_BIT,
+    AUDIO_FORMAT_PCM_24_BIT_PACKED
+};
+
+static const uint32_t gFusedLayouts[][2] = {
+    { 1, 2 },
+    { 2, 1 },
+    { 2, 4 },
+    { 4, 2 }
+};
+
+/** Frames of a 20ms period at 48kHz. */
+static const size_t gPeriodFrames = 960;
+
+static void fillRandom(std::vector<uint8_t> &buffer)
+{
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = rand();
+    }
+}
+
+/**
+ * Converts a buffer with or without fused kernels.
+ *
+ * @return converted frames, in a buffer of the destination frame size.
+ */
+static std::vector<uint8_t> convert(const SampleSpec &ssSrc, const SampleSpec &ssDst,
+                                    const std::vector<uint8_t> &src, bool fusion)
+{
+    AudioConversion conversion;
+    conversion.setFusion(fusion);
+    EXPECT_EQ(0, conversion.configure(ssSrc, ssDst));
+
+    size_t frames = src.size() / ssSrc.getFrameSize();
+    std::vector<uint8_t> dst(frames * ssDst.getFrameSize());
+    void *dstBuf = &dst[0];
+    size_t outFrames = 0;
+    EXPECT_EQ(0, conversion.convert(&src[0], &dstBuf, frames, &outFrames));
+    EXPECT_EQ(frames, outFrames);
+    return dst;
+}
+
+/**
+ * Every fused kernel must be bit exact with the remapper and reformatter couple it replaces.
+ */
+TEST(AudioFusedConverter, bitExactWithChain)
+{
+    srand(0xF05E);
+    for (size_t src = 0; src < sizeof(gFusedFormats) / sizeof(gFusedFormats[0]); src++) {
+        for (size_t dst = 0; dst < sizeof(gFusedFormats) / sizeof(gFusedFormats[0]); dst++) {
+            if (src == dst) {
+                continue;
+            }
+            for (size_t layout = 0; layout < sizeof(gFusedLayouts) / sizeof(gFusedLayouts[0]);
+                 layout++) {
+                const SampleSpec ssSrc(gFusedLayouts[layout][0], gFusedFormats[src], 48000);
+                const SampleSpec ssDst(gFusedLayouts[layout][1], gFusedFormats[dst], 48000);
+                SCOPED_TRACE(testing::Message() << "format " << gFusedFormats[src] << " -> "
+                                                << gFusedFormats[dst] << ", channels "
+                                                << gFusedLayouts[layout][0] << " -> "
+                                                << gFusedLayouts[layout][1]);
+                EXPECT_TRUE(AudioFusedConverter::supportFusion(ssSrc, ssDst));
+
+                std::vector<uint8_t> input(gPeriodFrames * ssSrc.getFrameSize());
+                fillRandom(input);
+                std::vector<uint8_t> chained = convert(ssSrc, ssDst, input, false);
+                std::vector<uint8_t> fused = convert(ssSrc, ssDst, input, true);
+                ASSERT_EQ(chained.size(), fused.size());
+                EXPECT_EQ(0, memcmp(&chained[0], &fused[0], chained.size()));
+            }
+        }
+    }
+}
+
+TEST(AudioFusedConverter, fallbackToChain)
+{
+    std::vector<SampleSpec::ChannelsPolicy> ignoreRight;
+    ignoreRight.push_back(SampleSpec::Copy);
+    ignoreRight.push_back(SampleSpec::Ignore);
+
+    // Float may be dithered, rate change separates remapper and reformatter, ignored channels
+    // need the channels policy aware remapper.
+    EXPECT_FALSE(AudioFusedConverter::supportFusion(
+                     SampleSpec(2, AUDIO_FORMAT_PCM_FLOAT, 48000),
+                     SampleSpec(1, AUDIO_FORMAT_PCM_16_BIT, 48000)));
+    EXPECT_FALSE(AudioFusedConverter::supportFusion(
+                     SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 44100),
+                     SampleSpec(4, AUDIO_FORMAT_PCM_32_BIT, 48000)));
+    EXPECT_FALSE(AudioFusedConverter::supportFusion(
+                     SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000, ignoreRight),
+                     SampleSpec(1, AUDIO_FORMAT_PCM_32_BIT, 48000)));
+    EXPECT_FALSE(AudioFusedConverter::supportFusion(
+                     SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+                     SampleSpec(8, AUDIO_FORMAT_PCM_32_BIT, 48000)));
+
+    // Unfused conversions still succeed through the chain.
+    std::vector<uint8_t> input(gPeriodFrames * 2 * sizeof(int16_t));
+    fillRandom(input);
+    std::vector<uint8_t> output =
+        convert(SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000, ignoreRight),
+                SampleSpec(1, AUDIO_FORMAT_PCM_32_BIT, 48000), input, true);
+    EXPECT_EQ(gPeriodFrames * sizeof(int32_t), output.size());
+}
+
+} // namespace intel_audio
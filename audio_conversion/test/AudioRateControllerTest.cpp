@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioRateController.hpp>
+#include <AudioConversion.hpp>
+#include <SampleSpec.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+static const uint32_t gRate = 48000;
+static const size_t gPeriod = 480;
+static const int64_t gPeriodNs = 10000000;
+
+/**
+ * Device consuming frames at its own rate, fed by periods produced every 10ms of the monotonic
+ * clock and resampled with the correction of the controller.
+ */
+struct SimulatedDevice
+{
+    SimulatedDevice(double driftPpm)
+        : driftPpm(driftPpm), produced(0), queued(2 * gPeriod), timeNs(0) {}
+
+    /** Writes a period, then lets the device consume until the next write. */
+    void write(AudioRateController &controller)
+    {
+        // Whole frames are written, the resampler phase keeps the fractional part.
+        double previous = produced;
+        produced += gPeriod * (1 + controller.getCorrectionPpm() / 1000000);
+        size_t written = (size_t)produced - (size_t)previous;
+        queued += written;
+        controller.update(written, (size_t)queued, timeNs);
+        queued -= gPeriod * (1 + driftPpm / 1000000);
+        timeNs += gPeriodNs;
+    }
+
+    double driftPpm; /**< Drift of the device clock. */
+    double produced; /**< Frames produced by the resampler, fractional part included. */
+    double queued; /**< Frames in the device buffer. */
+    int64_t timeNs; /**< Monotonic time. */
+};
+
+TEST(AudioRateController, compensateDrift)
+{
+    AudioRateController controller;
+    controller.reset(gRate);
+    SimulatedDevice device(200);
+
+    // Ten minutes of playback.
+    for (int i = 0; i < 60000; i++) {
+        device.write(controller);
+    }
+    EXPECT_NEAR(200, controller.getCorrectionPpm(), 10);
+    EXPECT_NEAR(200, controller.getDriftPpm(), 5);
+    EXPECT_NEAR(controller.getTargetFrames(), device.queued + gPeriod, gRate / 1000);
+}
+
+TEST(AudioRateController, noCorrectionWithoutDrift)
+{
+    AudioRateController controller;
+    controller.reset(gRate);
+    SimulatedDevice device(0);
+
+    for (int i = 0; i < 6000; i++) {
+        device.write(controller);
+    }
+    EXPECT_NEAR(0, controller.getCorrectionPpm(), 0.01);
+    EXPECT_NEAR(0, controller.getDriftPpm(), 1);
+}
+
+TEST(AudioRateController, correctionIsBounded)
+{
+    AudioRateController controller;
+    controller.reset(gRate);
+    SimulatedDevice device(-5000);
+
+    for (int i = 0; i < 6000; i++) {
+        device.write(controller);
+        ASSERT_GE(controller.getCorrectionPpm(), -500);
+    }
+    EXPECT_NEAR(-5000, controller.getDriftPpm(), 5);
+
+    controller.reset(gRate);
+    EXPECT_EQ(0, controller.getCorrectionPpm());
+    EXPECT_EQ(0, controller.getDriftPpm());
+    EXPECT_EQ(0, controller.getTargetFrames());
+}
+
+/**
+ * After an underrun, the device reports more room than its buffer size: the measure is the one of
+ * an empty buffer, not a huge fill level.
+ */
+TEST(AudioRateController, underrunIsEmptyBuffer)
+{
+    AudioRateController underrun;
+    AudioRateController empty;
+    underrun.reset(gRate);
+    empty.reset(gRate);
+
+    int64_t timeNs = 0;
+    for (int i = 0; i < 200; i++) {
+        underrun.update(gPeriod, 2 * gPeriod, timeNs);
+        empty.update(gPeriod, 2 * gPeriod, timeNs);
+        timeNs += gPeriodNs;
+    }
+    ASSERT_EQ(2 * gPeriod, underrun.getTargetFrames());
+
+    EXPECT_EQ(empty.update(gPeriod, 0, timeNs), underrun.update(gPeriod, -100, timeNs));
+    EXPECT_GT(underrun.getCorrectionPpm(), 0);
+    EXPECT_LE(underrun.getCorrectionPpm(), 500);
+    EXPECT_EQ(empty.getDriftPpm(), underrun.getDriftPpm());
+}
+
+/**
+ * The chain resamples between the same rates in adaptive rate mode, and outputs more frames once
+ * the device buffer falls below its target fill level.
+ */
+TEST(AudioRateController, adaptiveConversion)
+{
+    const SampleSpec ss(2, AUDIO_FORMAT_PCM_16_BIT, gRate);
+    AudioConversion conversion;
+    conversion.setAdaptiveRate(true);
+    ASSERT_EQ(0, conversion.configure(ss, ss));
+
+    std::vector<int16_t> src(gPeriod * 2, 10000);
+    size_t totalFrames = 0;
+    struct timespec timestamp = { 0, 0 };
+    for (int i = 0; i < 1000; i++) {
+        void *dst = NULL;
+        size_t outFrames = 0;
+        ASSERT_EQ(0, conversion.convert(&src[0], &dst, gPeriod, &outFrames));
+        ASSERT_NE(static_cast<void *>(&src[0]), dst);
+        if (i > 10) {
+            // Constant signal is kept once the filter history is filled.
+            EXPECT_NEAR(10000, static_cast<int16_t *>(dst)[0], 2);
+        }
+        totalFrames += outFrames;
+
+        // Device buffer drains by a frame every period once the target is known.
+        size_t queued = (i < 200) ? 4 * gPeriod : 4 * gPeriod - (i - 200);
+        conversion.updateRateControl(outFrames, queued, timestamp);
+        timestamp.tv_nsec += gPeriodNs;
+        if (timestamp.tv_nsec >= 1000000000) {
+            timestamp.tv_sec++;
+            timestamp.tv_nsec -= 1000000000;
+        }
+    }
+    EXPECT_GT(conversion.getRateCorrectionPpm(), 0);
+    EXPECT_GT(totalFrames, 1000 * gPeriod);
+    EXPECT_LT(totalFrames, 1000 * gPeriod + 1000 * gPeriod / 1000);
+
+    // Configuring again restarts from the nominal ratio.
+    ASSERT_EQ(0, conversion.configure(ss, ss));
+    EXPECT_EQ(0, conversion.getRateCorrectionPpm());
+}
+
+} // namespace intel_audio
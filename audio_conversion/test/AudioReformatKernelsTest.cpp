@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioReformatKernels.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+/**
+ * Number of samples reformatted by each test. Chosen not to be a multiple of any vector width so
+ * that the tail handling of the SIMD kernels is exercised as well.
+ */
+static const size_t gSamples = 8 * 240 + 13;
+
+class AudioReformatKernelsT : public ::testing::TestWithParam<AudioReformatKernels::Isa>
+{
+protected:
+    virtual void SetUp()
+    {
+        mIsa = GetParam();
+        mScalar = AudioReformatKernels::getKernels(AudioReformatKernels::Scalar);
+        mKernels = AudioReformatKernels::getKernels(mIsa);
+
+        srand(0xA0D10);
+        mSrc16.resize(gSamples);
+        mSrc32.resize(gSamples);
+        for (size_t i = 0; i < gSamples; i++) {
+            mSrc16[i] = (int16_t)rand();
+            mSrc32[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        }
+        // Make sure boundaries are covered.
+        const int16_t edges16[] = { INT16_MIN, INT16_MAX, -1, 0, 1 };
+        const uint32_t edges32[] = { 0x80000000, 0x7FFFFFFF, 0xFFFFFFFF, 0, 1, 0x00800000,
+                                     0x007FFFFF, 0xFF800000 };
+        memcpy(&mSrc16[0], edges16, sizeof(edges16));
+        memcpy(&mSrc32[0], edges32, sizeof(edges32));
+    }
+
+    /**
+     * Runs both the scalar kernel and the kernel under test on all unaligned offsets and
+     * lengths from 0 to 33 samples, then on the full buffer, and checks outputs are bit exact.
+     */
+    template <typename SrcType, typename DstType>
+    void checkBitExact(AudioReformatKernels::Kernel reference, AudioReformatKernels::Kernel kernel,
+                       const std::vector<SrcType> &src)
+    {
+        std::vector<DstType> expected(gSamples + 1);
+        std::vector<DstType> result(gSamples + 1);
+
+        for (size_t offset = 0; offset < 2; offset++) {
+            for (size_t samples = 0; samples <= 33; samples++) {
+                std::fill(expected.begin(), expected.end(), 0x5A);
+                std::fill(result.begin(), result.end(), 0x5A);
+                reference(&src[offset], &expected[offset], samples);
+                kernel(&src[offset], &result[offset], samples);
+                ASSERT_EQ(0, memcmp(&expected[0], &result[0], expected.size() * sizeof(DstType)))
+                    << "offset " << offset << " samples " << samples;
+            }
+        }
+        reference(&src[0], &expected[0], gSamples);
+        kernel(&src[0], &result[0], gSamples);
+        EXPECT_EQ(0, memcmp(&expected[0], &result[0], gSamples * sizeof(DstType)));
+    }
+
+    AudioReformatKernels::Isa mIsa;
+    const AudioReformatKernels::Set *mScalar;
+    const AudioReformatKernels::Set *mKernels;
+    std::vector<int16_t> mSrc16;
+    std::vector<uint32_t> mSrc32;
+};
+
+TEST_P(AudioReformatKernelsT, bitExactWithScalar)
+{
+    ASSERT_TRUE(mScalar != NULL);
+    ASSERT_TRUE(mKernels != NULL) << AudioReformatKernels::getIsaName(mIsa);
+    checkBitExact<int16_t, uint32_t>(mScalar->s16ToS24over32, mKernels->s16ToS24over32, mSrc16);
+    checkBitExact<uint32_t, int16_t>(mScalar->s24over32ToS16, mKernels->s24over32ToS16, mSrc32);
+    checkBitExact<int16_t, uint32_t>(mScalar->s16ToS32, mKernels->s16ToS32, mSrc16);
+    checkBitExact<uint32_t, int16_t>(mScalar->s32ToS16, mKernels->s32ToS16, mSrc32);
+}
+
+/**
+ * Instruction sets of the CPU running the test: the others are not instantiated rather than
+ * reported passed. The scalar kernels, checked against themselves, keep the case instantiated on
+ * any CPU.
+ */
+static std::vector<AudioReformatKernels::Isa> getSupportedIsas()
+{
+    std::vector<AudioReformatKernels::Isa> isas;
+    for (int isa = AudioReformatKernels::Scalar; isa < AudioReformatKernels::NbIsa; isa++) {
+        if (AudioReformatKernels::isSupported(static_cast<AudioReformatKernels::Isa>(isa))) {
+            isas.push_back(static_cast<AudioReformatKernels::Isa>(isa));
+        }
+    }
+    return isas;
+}
+
+INSTANTIATE_TEST_CASE_P(
+    reformatKernels,
+    AudioReformatKernelsT,
+    ::testing::ValuesIn(getSupportedIsas())
+    );
+
+TEST(AudioReformatKernels, bestIsaIsSupported)
+{
+    AudioReformatKernels::Isa isa = AudioReformatKernels::getBestIsa();
+    EXPECT_TRUE(AudioReformatKernels::isSupported(isa));
+    EXPECT_TRUE(AudioReformatKernels::getKernels(isa) != NULL);
+}
+
+} // namespace intel_audio
@@ -239,6 +239,40 @@ public:
         }
     }
 
+    /**
+     * Sets the pool the stream routes open their audio device from.
+     *
+     * @param[in] pool pool of the route manager.
+     */
+    void setDevicePool(AudioDevicePool *pool)
+    {
+        for (auto route : *this) {
+            if (route->isMixRoute()) {
+                static_cast<AudioStreamRoute *>(route)->setDevicePool(pool);
+            }
+        }
+    }
+
+    /**
+     * Opens ahead the audio device of the most suitable route for a stream not started yet.
+     *
+     * @param[in] stream for which the device is opened.
+     *
+     * @return OK if the device is opened and parked, error code otherwise.
+     */
+    android::status_t prewarmRouteForStream(const IoStream &stream)
+    {
+        for (auto it : *this) {
+            if (it->isMixRoute()) {
+                AudioStreamRoute *streamRoute = static_cast<AudioStreamRoute *>(it);
+                if (streamRoute->isMatchingWithStream(stream)) {
+                    return streamRoute->prewarm(stream);
+                }
+            }
+        }
+        return android::BAD_VALUE;
+    }
+
     /**
      * Find the most suitable route for a given stream according to its attributes, ie flags,
      * use cases, effects...
@@ -25,6 +25,7 @@
 #include "RoutingStage.hpp"
 
 #include <AudioPlatformState.hpp>
+#include <AudioDevicePool.hpp>
 #include <EventThread.h>
 #include <property/Property.hpp>
 #include <Observer.hpp>
@@ -96,7 +97,8 @@ static const std::string gRoutingStageCriterion = "RoutageState";
 AudioRouteManager::AudioRouteManager()
     : mRoutes(new AudioRouteCollection()),
       mEventThread(new CEventThread(this)),
-      mPlatformState(new AudioPlatformState())
+      mPlatformState(new AudioPlatformState()),
+      mDevicePool(new AudioDevicePool())
 {
 #ifdef EMULATE_UEVENT
     mUEventFd = socket_local_server(uevent_socket_name, ANDROID_SOCKET_NAMESPACE_ABSTRACT,
@@ -129,6 +131,7 @@ AudioRouteManager::AudioRouteManager()
         }
     }
     AUDIOCOMMS_ASSERT(status == NO_ERROR, "AudioRouteManager: could not parse any config file");
+    mRoutes->setDevicePool(mDevicePool);
 
     mPlatformState->setConfig<Audio>(mCriteria, mCriterionTypes, mParameters);
     for (const auto route : *mRoutes) {
@@ -160,7 +163,9 @@ AudioRouteManager::~AudioRouteManager()
     }
     delete mEventThread;
     delete mPlatformState;
+    mDevicePool->releaseAll();
     delete mRoutes;
+    delete mDevicePool;
 }
 
 
@@ -188,6 +193,20 @@ inline const std::string AudioRouteManager::routeMaskToString(uint32_t mask) con
     return mPlatformState->getFormattedState<Audio>(gRouteCriterionType[type], mask);
 }
 
+void AudioRouteManager::prewarmStream(const IoStream &stream)
+{
+    AutoW lock(mRoutingLock);
+    if (!mAudioSubsystemAvailable) {
+
+        return;
+    }
+    if (mRoutes->prewarmRouteForStream(stream) == android::OK) {
+
+        // The event thread sets its alarm to close the device if it is not taken back.
+        reconsiderRoutingUnsafe(false);
+    }
+}
+
 void AudioRouteManager::reconsiderRouting(bool isSynchronous)
 {
     AutoW lock(mRoutingLock);
@@ -238,6 +257,7 @@ void AudioRouteManager::doReconsiderRouting()
         if (mAudioSubsystemAvailable) {
             mPlatformState->commitCriteriaAndApplyConfiguration<Audio>();
         }
+        releaseIdleDevices();
         return;
     }
     Log::Debug() << __FUNCTION__ << ": Route state:"
@@ -266,6 +286,7 @@ void AudioRouteManager::doReconsiderRouting()
                  << routeMaskToString<ROUTE_TYPE_STREAM_PLAYBACK>(mRoutes->needRepathRouteMask(
                                                          ROUTE_TYPE_STREAM_PLAYBACK));
     executeRouting();
+    releaseIdleDevices();
     Log::Debug() << __FUNCTION__ << ": DONE";
 }
 
@@ -277,6 +298,7 @@ void AudioRouteManager::executeRouting()
          */
         mRoutes->disableRoutes();
         mRoutes->postDisableRoutes();
+        mDevicePool->releaseAll();
         return;
     }
     executeMuteRoutingStage();
@@ -290,6 +312,18 @@ void AudioRouteManager::executeRouting()
     executeUnmuteRoutingStage();
 }
 
+void AudioRouteManager::releaseIdleDevices()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t nextExpiryMs = mDevicePool->releaseIdle(now.tv_sec * 1000000000ll + now.tv_nsec);
+    if (nextExpiryMs < 0) {
+        mEventThread->cancelAlarm();
+    } else {
+        mEventThread->setAlarmMs(nextExpiryMs);
+    }
+}
+
 void AudioRouteManager::resetRouting()
 {
     mRoutes->resetAvailability();
@@ -467,6 +501,8 @@ bool AudioRouteManager::onHangup(int)
 void AudioRouteManager::onAlarm()
 {
     Log::Debug() << __FUNCTION__;
+    AutoW lock(mRoutingLock);
+    releaseIdleDevices();
 }
 
 void AudioRouteManager::onPollError()
@@ -616,6 +652,7 @@ android::status_t AudioRouteManager::dump(const int fd, int spaces) const
 
     write(fd, result.string(), result.size());
     mRoutes->dump(fd, spaces + 4);
+    mDevicePool->dump(fd, spaces + 4);
     return android::OK;
 }
 
@@ -18,6 +18,7 @@
 
 #include "AudioStreamRoute.hpp"
 #include <AudioDevice.hpp>
+#include <AudioDevicePool.hpp>
 #include <typeconverter/TypeConverter.hpp>
 #include <AudioUtils.hpp>
 #include <Direction.hpp>
@@ -28,6 +29,7 @@
 #include <policy.h>
 #include <utils/String8.h>
 #include "AudioPort.hpp"
+#include <algorithm>
 #include <unistd.h>
 
 using namespace std;
@@ -36,6 +38,9 @@ using audio_comms::utilities::Log;
 namespace intel_audio
 {
 
+/** Shortest time a device opened ahead is kept for the first write of its stream. */
+static const uint32_t gPrewarmTimeoutMs = 1000;
+
 AudioStreamRoute::AudioStreamRoute(string name, AudioPorts &sinks, AudioPorts &sources,
                                    uint32_t type)
     : AudioRoute(name, sinks, sources, type),
@@ -86,8 +91,7 @@ android::status_t AudioStreamRoute::route(bool isPreEnable)
     AUDIOCOMMS_ASSERT(mAudioDevice != nullptr, "No valid device attached");
     if (isPreEnable == isPreEnableRequired()) {
 
-        android::status_t err = mAudioDevice->open(getCardName(), getPcmDeviceId(),
-                                                   getRouteConfig(), isOut());
+        android::status_t err = openDevice();
         if (err) {
 
             // Failed to open PCM device -> bailing out
@@ -138,7 +142,7 @@ void AudioStreamRoute::unroute(bool isPostDisable)
 
     if (isPostDisable == isPostDisableRequired()) {
 
-        android::status_t err = mAudioDevice->close();
+        android::status_t err = closeDevice();
         if (err) {
 
             return;
@@ -186,6 +190,7 @@ bool AudioStreamRoute::isMatchingWithStream(const IoStream &stream) const
 {
     bool verdict = ((stream.isOut() == isOut()) &&
                     areFlagsMatching(stream.getFlagMask()) &&
+                    (stream.isMmap() == isMmap()) &&
                     areUseCasesMatching(stream.getUseCaseMask()) &&
                     implementsEffects(stream.getEffectRequested()) &&
                     supportDeviceAddress(stream.getDeviceAddress(), stream.getDevices()) &&
@@ -277,6 +282,43 @@ android::status_t AudioStreamRoute::detachCurrentStream()
     return android::OK;
 }
 
+android::status_t AudioStreamRoute::openDevice()
+{
+    if (mDevicePool == nullptr) {
+
+        return mAudioDevice->open(getCardName(), getPcmDeviceId(), getRouteConfig(), isOut());
+    }
+    return mDevicePool->open(*mAudioDevice, getCardName(), getPcmDeviceId(), getRouteConfig(),
+                             isOut());
+}
+
+android::status_t AudioStreamRoute::closeDevice()
+{
+    if (mDevicePool == nullptr) {
+
+        return mAudioDevice->close();
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return mDevicePool->close(*mAudioDevice, mConfig.idleTimeoutMs,
+                              now.tv_sec * 1000000000ll + now.tv_nsec);
+}
+
+android::status_t AudioStreamRoute::prewarm(const IoStream &stream)
+{
+    if (mDevicePool == nullptr || isUsed() || !isPreEnableRequired()) {
+
+        return android::INVALID_OPERATION;
+    }
+    MixPortConfig config = mConfig;
+    config.setCurrentSampleSpec(stream.streamSampleSpec());
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return mDevicePool->prewarm(*mAudioDevice, getCardName(), getPcmDeviceId(), config, isOut(),
+                                std::max(mConfig.idleTimeoutMs, gPrewarmTimeoutMs),
+                                now.tv_sec * 1000000000ll + now.tv_nsec);
+}
+
 void AudioStreamRoute::setEffectSupported(const vector<string> &effects)
 {
     for (auto effect : effects) {
@@ -286,7 +328,8 @@ void AudioStreamRoute::setEffectSupported(const vector<string> &effects)
 
 uint32_t AudioStreamRoute::getLatencyInUs() const
 {
-    return getSampleSpec().convertFramesToUsec(mConfig.periodSize * mConfig.periodCount);
+    return getSampleSpec().convertFramesToUsec(mConfig.periodSize * mConfig.periodCount) +
+           mConfig.dspLatencyUs;
 }
 
 uint32_t AudioStreamRoute::getPeriodInUs() const
@@ -331,6 +374,20 @@ android::status_t AudioStreamRoute::dump(const int fd, int spaces) const
              "",
              mConfig.requirePostDisable);
     result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- adaptiveRate: %d\n", spaces + 4, "", mConfig.adaptiveRate);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- mmap: %d\n", spaces + 4, "", mConfig.mmap);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- zeroCopy: %d\n", spaces + 4, "", mConfig.zeroCopy);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- nonBlocking: %d\n", spaces + 4, "", mConfig.nonBlocking);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- idleTimeoutMs: %u\n", spaces + 4, "", mConfig.idleTimeoutMs);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- dspLatencyUs: %u\n", spaces + 4, "", mConfig.dspLatencyUs);
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- writerCpu: %d\n", spaces + 4, "", mConfig.writerCpu);
+    result.append(buffer);
     snprintf(buffer, SIZE, "%*s- cardName: %s\n", spaces + 4, "", mConfig.cardName.c_str());
     result.append(buffer);
     snprintf(buffer, SIZE, "%*s- deviceId: %d\n", spaces + 4, "", mConfig.deviceId);
@@ -30,6 +30,7 @@ namespace intel_audio
 {
 
 class IAudioDevice;
+class AudioDevicePool;
 
 
 
@@ -63,10 +64,58 @@ public:
      */
     virtual const SampleSpec getSampleSpec() const
     {
-        return SampleSpec(mConfig.getChannelCount(), mConfig.getFormat(),
-                          mConfig.getRate(), mConfig.channelsPolicy);
+        // Channel mask is given to tell the position of the channels to the remapper.
+        SampleSpec sampleSpec(mConfig.getChannelCount(), mConfig.getFormat(), mConfig.getRate());
+        sampleSpec.setChannelMask(mConfig.getChannelMask(), mIsOut);
+        if (not mConfig.channelsPolicy.empty()) {
+            sampleSpec.setChannelsPolicy(mConfig.channelsPolicy);
+        }
+        return sampleSpec;
     }
 
+    /**
+     * Get the channel mixing matrix of this route.
+     * From IStreamRoute, intended to be called by the stream.
+     *
+     * @return matrix from the route configuration, empty if none.
+     */
+    virtual const std::vector<std::vector<float> > &getChannelMatrix() const
+    {
+        return mConfig.channelMatrix;
+    }
+
+    /**
+     * Checks if the resampling ratio follows the clock of the device.
+     * From IStreamRoute, intended to be called by the stream.
+     *
+     * @return adaptive rate flag from the route configuration.
+     */
+    virtual bool isAdaptiveRate() const { return mConfig.adaptiveRate; }
+
+    /**
+     * Checks if the audio device is opened in mmap mode.
+     * From IStreamRoute, intended to be called by the stream.
+     *
+     * @return mmap flag from the route configuration.
+     */
+    virtual bool isMmap() const { return mConfig.mmap; }
+
+    /**
+     * Checks if the frames are converted in place in the buffer of the audio device.
+     * From IStreamRoute, intended to be called by the stream.
+     *
+     * @return zero copy flag from the route configuration.
+     */
+    virtual bool isZeroCopy() const { return mConfig.zeroCopy; }
+
+    /**
+     * Checks if the audio device is opened in non-blocking mode.
+     * From IStreamRoute, intended to be called by the stream.
+     *
+     * @return non-blocking flag from the route configuration.
+     */
+    virtual bool isNonBlocking() const { return mConfig.nonBlocking; }
+
     /**
      * Get Audio Device.
      * From IStreamRoute, intended to be called by the stream.
@@ -89,6 +138,28 @@ public:
         return mConfig.silencePrologInMs;
     }
 
+    /**
+     * Get the latency of the DSP behind the audio device.
+     * From IStreamRoute, intended to be called by the stream.
+     *
+     * @return latency in microseconds (from Route Parameter Manager settings).
+     */
+    virtual uint32_t getDspLatencyUs() const
+    {
+        return mConfig.dspLatencyUs;
+    }
+
+    /**
+     * Get the CPU the writer thread of an asynchronous stream is bound to.
+     * From IStreamRoute, intended to be called by the stream.
+     *
+     * @return CPU index from the route configuration, negative for any CPU.
+     */
+    virtual int32_t getWriterCpu() const
+    {
+        return mConfig.writerCpu;
+    }
+
     /**
      * Set an effect supported by this route.
      * This API is intended to be called by the Route Parameter Manager to add an audio effect
@@ -201,7 +272,7 @@ public:
     /**
      * Get the latency associated with this route.
      * More precisely, it returns the size of the ring buffer configured when using this stream
-     * route, which is a worst case.
+     * route, which is a worst case, plus the latency of the DSP behind the audio device.
      *
      * @return latency in microseconds.
      */
@@ -249,6 +320,24 @@ public:
 
     AudioCapabilities getCapabilities() const { return mConfig.mAudioCapabilities; }
 
+    /**
+     * Sets the pool the audio device is opened from and parked into once unrouted.
+     *
+     * @param[in] pool pool of the route manager, the device is opened and closed directly if null.
+     */
+    void setDevicePool(AudioDevicePool *pool) { mDevicePool = pool; }
+
+    /**
+     * Opens the audio device ahead of the routing of a stream not started yet, and parks it in
+     * the pool prepared: routing the stream once started then takes the device back.
+     * Only for a route whose device is opened before its path is enabled.
+     *
+     * @param[in] stream stream expected to be routed by this route.
+     *
+     * @return OK if the device is opened and parked, error code otherwise.
+     */
+    android::status_t prewarm(const IoStream &stream);
+
     android::status_t dump(const int fd, int spaces = 0) const;
 
 protected:
@@ -325,7 +414,22 @@ private:
      */
     android::status_t detachCurrentStream();
 
+    /**
+     * Opens the audio device, taking it back from the pool if parked with the same config.
+     *
+     * @return OK if opened, error code otherwise.
+     */
+    android::status_t openDevice();
+
+    /**
+     * Closes the audio device, or parks it in the pool for the idle timeout of the route.
+     *
+     * @return OK if closed or parked, error code otherwise.
+     */
+    android::status_t closeDevice();
+
     IAudioDevice *mAudioDevice; /**< Platform dependant audio device. */
+    AudioDevicePool *mDevicePool = nullptr; /**< Pool the device is opened from, if any. */
     bool mIsOut;
 };
 
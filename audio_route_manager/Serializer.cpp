@@ -22,6 +22,7 @@
 #if (defined (USE_ALSA_LIB))
 #include <AlsaAudioDevice.hpp>
 #endif
+#include <SimulatedAudioDevice.hpp>
 #include <TinyAlsaAudioDevice.hpp>
 #include "MixPortConfig.hpp"
 #include <convert.hpp>
@@ -591,6 +592,8 @@ const char MixPortTraits::Attributes::role[] = "role";
 const char MixPortTraits::Attributes::card[] = "card";
 const char MixPortTraits::Attributes::device[] = "device";
 const char MixPortTraits::Attributes::deviceAddress[] = "deviceAddress";
+const char MixPortTraits::Attributes::simulatedCard[] = "simulated";
+const char MixPortTraits::Attributes::simulatedFile[] = "simulatedFile";
 const char MixPortTraits::Attributes::flagMask[] = "flags";
 const char MixPortTraits::Attributes::requirePreEnable[] = "requirePreEnable";
 const char MixPortTraits::Attributes::requirePostDisable[] = "requirePostDisable";
@@ -599,6 +602,14 @@ const char MixPortTraits::Attributes::channelsPolicy[] = "channelsPolicy";
 const char MixPortTraits::Attributes::channelPolicyCopy[] = "copy";
 const char MixPortTraits::Attributes::channelPolicyIgnore[] = "ignore";
 const char MixPortTraits::Attributes::channelPolicyAverage[] = "average";
+const char MixPortTraits::Attributes::channelMatrix[] = "channelMatrix";
+const char MixPortTraits::Attributes::adaptiveRate[] = "adaptiveRate";
+const char MixPortTraits::Attributes::mmap[] = "mmap";
+const char MixPortTraits::Attributes::zeroCopy[] = "zeroCopy";
+const char MixPortTraits::Attributes::nonBlocking[] = "nonBlocking";
+const char MixPortTraits::Attributes::idleTimeoutMs[] = "idleTimeoutMs";
+const char MixPortTraits::Attributes::dspLatencyUs[] = "dspLatencyUs";
+const char MixPortTraits::Attributes::writerCpu[] = "writerCpu";
 const char MixPortTraits::Attributes::periodSize[] = "periodSize";
 const char MixPortTraits::Attributes::periodCount[] = "periodCount";
 const char MixPortTraits::Attributes::startThreshold[] = "startThreshold";
@@ -643,9 +654,21 @@ status_t MixPortTraits::deserialize(_xmlDoc *doc, const _xmlNode *child, PtrElem
 
     string device = getXmlAttribute(child, Attributes::device);
 
+    // Simulated card -> no hardware, device name optional
     // Empty device name -> infer user side alsa card
     // Valid device name -> use tiny alsa audio device
-    if (device.empty()) {
+    if (card == Attributes::simulatedCard) {
+        mixPortConfig.deviceId = 0;
+        if (not device.empty() &&
+            not convertTo<string, uint32_t>(device, mixPortConfig.deviceId)) {
+            Log::Error() << __FUNCTION__ << ": Invalid " << device << " for attribute " <<
+                Attributes::device;
+            delete mixPort;
+            return BAD_VALUE;
+        }
+        mixPort->setAlsaDevice(
+            new SimulatedAudioDevice(getXmlAttribute(child, Attributes::simulatedFile)));
+    } else if (device.empty()) {
 #if (defined (USE_ALSA_LIB))
         mixPort->setAlsaDevice(new AlsaAudioDevice());
 #else
@@ -749,6 +772,65 @@ status_t MixPortTraits::deserialize(_xmlDoc *doc, const _xmlNode *child, PtrElem
         delete mixPort;
         return BAD_VALUE;
     }
+    string adaptiveRate = getXmlAttribute(child, Attributes::adaptiveRate);
+    if (not adaptiveRate.empty() &&
+        not convertTo<string, bool>(adaptiveRate, mixPortConfig.adaptiveRate)) {
+        Log::Error() << __FUNCTION__ << ": Invalid " << adaptiveRate << " for attribute "
+                     << Attributes::adaptiveRate;
+        delete mixPort;
+        return BAD_VALUE;
+    }
+    string mmap = getXmlAttribute(child, Attributes::mmap);
+    if (not mmap.empty() && not convertTo<string, bool>(mmap, mixPortConfig.mmap)) {
+        Log::Error() << __FUNCTION__ << ": Invalid " << mmap << " for attribute "
+                     << Attributes::mmap;
+        delete mixPort;
+        return BAD_VALUE;
+    }
+    string zeroCopy = getXmlAttribute(child, Attributes::zeroCopy);
+    if (not zeroCopy.empty() && not convertTo<string, bool>(zeroCopy, mixPortConfig.zeroCopy)) {
+        Log::Error() << __FUNCTION__ << ": Invalid " << zeroCopy << " for attribute "
+                     << Attributes::zeroCopy;
+        delete mixPort;
+        return BAD_VALUE;
+    }
+    string nonBlocking = getXmlAttribute(child, Attributes::nonBlocking);
+    if (not nonBlocking.empty() &&
+        not convertTo<string, bool>(nonBlocking, mixPortConfig.nonBlocking)) {
+        Log::Error() << __FUNCTION__ << ": Invalid " << nonBlocking << " for attribute "
+                     << Attributes::nonBlocking;
+        delete mixPort;
+        return BAD_VALUE;
+    }
+    string idleTimeoutMs = getXmlAttribute(child, Attributes::idleTimeoutMs);
+    if (not idleTimeoutMs.empty() &&
+        not convertTo<string, uint32_t>(idleTimeoutMs, mixPortConfig.idleTimeoutMs)) {
+        Log::Error() << __FUNCTION__ << ": Invalid " << idleTimeoutMs << " for attribute "
+                     << Attributes::idleTimeoutMs;
+        delete mixPort;
+        return BAD_VALUE;
+    }
+    string dspLatencyUs = getXmlAttribute(child, Attributes::dspLatencyUs);
+    if (not dspLatencyUs.empty() &&
+        not convertTo<string, uint32_t>(dspLatencyUs, mixPortConfig.dspLatencyUs)) {
+        Log::Error() << __FUNCTION__ << ": Invalid " << dspLatencyUs << " for attribute "
+                     << Attributes::dspLatencyUs;
+        delete mixPort;
+        return BAD_VALUE;
+    }
+    string writerCpu = getXmlAttribute(child, Attributes::writerCpu);
+    if (not writerCpu.empty() &&
+        not convertTo<string, int32_t>(writerCpu, mixPortConfig.writerCpu)) {
+        Log::Error() << __FUNCTION__ << ": Invalid " << writerCpu << " for attribute "
+                     << Attributes::writerCpu;
+        delete mixPort;
+        return BAD_VALUE;
+    }
+    if (mixPortConfig.mmap) {
+        // Streams requesting mmap mode carry the no-IRQ flag, the route must accept it.
+        mixPortConfig.flagMask |= mixPortConfig.isOut ?
+                                  AUDIO_OUTPUT_FLAG_MMAP_NOIRQ : AUDIO_INPUT_FLAG_MMAP_NOIRQ;
+    }
     mixPortConfig.dynamicChannelMapsControl = getXmlAttribute(child,
                                                               Attributes::dynamicChannelMapsControl);
     mixPortConfig.dynamicFormatsControl = getXmlAttribute(child, Attributes::dynamicFormatsControl);
@@ -803,6 +885,35 @@ status_t MixPortTraits::deserialize(_xmlDoc *doc, const _xmlNode *child, PtrElem
             mixPortConfig.channelsPolicy.push_back(policy);
         }
     }
+    // Matrix rows, i.e. destination channels, are separated by ';', coefficients by ','.
+    string channelMatrix = getXmlAttribute(child, Attributes::channelMatrix);
+    if (not channelMatrix.empty()) {
+        vector<string> rows;
+        collectionFromString<DefaultTraits<string> >(channelMatrix, rows, ";");
+        for (auto &row : rows) {
+            vector<string> coefLiterals;
+            collectionFromString<DefaultTraits<string> >(row, coefLiterals, ",");
+            vector<float> coefs;
+            for (auto &coefLiteral : coefLiterals) {
+                float coef;
+                if (not convertTo<string, float>(coefLiteral, coef)) {
+                    Log::Error() << __FUNCTION__ << ": Invalid " << channelMatrix
+                                 << " for attribute " << Attributes::channelMatrix;
+                    delete mixPort;
+                    return BAD_VALUE;
+                }
+                coefs.push_back(coef);
+            }
+            if (coefs.empty() || (not mixPortConfig.channelMatrix.empty() &&
+                                  coefs.size() != mixPortConfig.channelMatrix[0].size())) {
+                Log::Error() << __FUNCTION__ << ": rows of different sizes in " << channelMatrix
+                             << " for attribute " << Attributes::channelMatrix;
+                delete mixPort;
+                return BAD_VALUE;
+            }
+            mixPortConfig.channelMatrix.push_back(coefs);
+        }
+    }
     AudioProfileTraits::Collection profiles;
     deserializeCollection<AudioProfileTraits>(doc, child, profiles, NULL);
     mixPortConfig.mAudioCapabilities = profiles;
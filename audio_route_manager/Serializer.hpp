@@ -204,6 +204,8 @@ struct MixPortTraits
         static const char card[];
         static const char device[];
         static const char deviceAddress[];
+        static const char simulatedCard[];
+        static const char simulatedFile[];
         static const char flagMask[];
         static const char requirePreEnable[];
         static const char requirePostDisable[];
@@ -212,6 +214,14 @@ struct MixPortTraits
         static const char channelPolicyCopy[];
         static const char channelPolicyIgnore[];
         static const char channelPolicyAverage[];
+        static const char channelMatrix[];
+        static const char adaptiveRate[];
+        static const char mmap[];
+        static const char zeroCopy[];
+        static const char nonBlocking[];
+        static const char idleTimeoutMs[];
+        static const char dspLatencyUs[];
+        static const char writerCpu[];
         static const char periodSize[];
         static const char periodCount[];
         static const char startThreshold[];
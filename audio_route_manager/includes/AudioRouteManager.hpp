@@ -35,6 +35,7 @@ class IoStream;
 struct pcm_config;
 class AudioPlatformState;
 class AudioRouteCollection;
+class AudioDevicePool;
 
 class AudioRouteManager : private IEventListener,
                           private audio_comms::utilities::Observable,
@@ -65,6 +66,14 @@ public:
      */
     void reconsiderRouting(bool isSynchronous = false);
 
+    /**
+     * Opens ahead the audio device of the route expected to route a stream not started yet, so
+     * that routing the stream at its first write does not open it.
+     *
+     * @param[in] stream stream whose devices were just set by a patch.
+     */
+    void prewarmStream(const IoStream &stream);
+
     /**
      * Sets the voice volume.
      * Called from AudioSystem/Policy to apply the volume on the voice call stream which is
@@ -188,6 +197,12 @@ private:
      */
     void executeRouting();
 
+    /**
+     * Closes the audio devices parked for longer than the idle timeout of their route, and sets
+     * the alarm of the event thread to the next expiry.
+     */
+    void releaseIdleDevices();
+
     /**
      * Mute the routes.
      * Mute action will be applied on route pointed by ClosingRoutes criterion.
@@ -275,6 +290,8 @@ private:
 
     AudioPlatformState *mPlatformState; /**< Platform state handler for Route / Audio PFW. */
 
+    AudioDevicePool *mDevicePool; /**< Audio devices kept opened once unrouted. */
+
     /**Socket Id enumerator */
     enum UeventSockDesc
     {
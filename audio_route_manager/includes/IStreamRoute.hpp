@@ -17,6 +17,7 @@
 
 #include <SampleSpec.hpp>
 #include <string>
+#include <vector>
 
 namespace intel_audio
 {
@@ -44,6 +45,58 @@ public:
      */
     virtual uint32_t getOutputSilencePrologMs() const = 0;
 
+    /**
+     * Get the latency of the DSP behind the audio device of the route, after the device for an
+     * output, before the device for an input. It adds to the latency of the ring buffer.
+     *
+     * @return latency in microseconds.
+     */
+    virtual uint32_t getDspLatencyUs() const = 0;
+
+    /**
+     * Get the CPU the writer thread of an asynchronous output stream is bound to on this route.
+     *
+     * @return CPU index, negative for any CPU.
+     */
+    virtual int32_t getWriterCpu() const = 0;
+
+    /**
+     * Get the matrix mixing the channels of the stream into the route, or the route into the
+     * stream for an input, set by the configuration of the route.
+     *
+     * @return one row of coefficients per destination channel, empty if none set.
+     */
+    virtual const std::vector<std::vector<float> > &getChannelMatrix() const = 0;
+
+    /**
+     * Checks if the resampling ratio of the stream must follow the clock of the device.
+     *
+     * @return true if the ratio is corrected from the device buffer fill level, false otherwise.
+     */
+    virtual bool isAdaptiveRate() const = 0;
+
+    /**
+     * Checks if the audio device of the route is opened in mmap no-IRQ mode.
+     *
+     * @return true if the buffer of the device is shared with the stream client, false otherwise.
+     */
+    virtual bool isMmap() const = 0;
+
+    /**
+     * Checks if the audio device of the route gives access to its ring buffer for the stream to
+     * convert the frames in place.
+     *
+     * @return true if the device is opened with mmap access for zero copy, false otherwise.
+     */
+    virtual bool isZeroCopy() const = 0;
+
+    /**
+     * Checks if the audio device of the route is opened in non-blocking mode.
+     *
+     * @return true if the stream may write part of its frames until a deadline, false otherwise.
+     */
+    virtual bool isNonBlocking() const = 0;
+
     virtual IAudioDevice *getAudioDevice() = 0;
 
     virtual ~IStreamRoute() {}
@@ -18,6 +18,7 @@
 #include <AudioCapabilities.hpp>
 #include <SampleSpec.hpp>
 #include <string>
+#include <vector>
 
 namespace intel_audio
 {
@@ -73,6 +74,58 @@ struct MixPortConfig
      */
     std::vector<SampleSpec::ChannelsPolicy> channelsPolicy;
 
+    /**
+     * Optional matrix mixing the channels of the stream into the channels of the route for an
+     * output, or the channels of the route into the channels of the stream for an input.
+     * One row of coefficients per destination channel, one coefficient per source channel.
+     * It replaces the matrix computed from the channel masks when its dimensions match the
+     * conversion, i.e. for a given stream channel count.
+     */
+    std::vector<std::vector<float> > channelMatrix;
+
+    /**
+     * Playback only: the resampling ratio of the streams is fine tuned to compensate the drift
+     * between their clock and the clock of the device, holding the device buffer fill level.
+     */
+    bool adaptiveRate = false;
+
+    /**
+     * The audio device is opened in mmap no-IRQ mode, its ring buffer being shared with the client.
+     * Only streams opened with the MMAP_NOIRQ flag are routed through it.
+     */
+    bool mmap = false;
+
+    /**
+     * The audio device is opened with mmap access: streams convert the frames they write directly
+     * in its ring buffer, and convert the frames they read from it, instead of copying them.
+     */
+    bool zeroCopy = false;
+
+    /**
+     * The audio device is opened in non-blocking mode: a stream writing to it waits for room by
+     * polling the device until a deadline, and may write part of its frames only, instead of
+     * sleeping in the device for a whole period.
+     */
+    bool nonBlocking = false;
+
+    /**
+     * Time in milliseconds the audio device is kept opened and prepared once unrouted, to be
+     * reused if routed again with the same config. Closed at once if null.
+     */
+    uint32_t idleTimeoutMs = 0;
+
+    /**
+     * Time in microseconds the frames take to go through the DSP behind the audio device, from
+     * the device to the output for a playback, from the input to the device for a capture.
+     */
+    uint32_t dspLatencyUs = 0;
+
+    /**
+     * Playback only: CPU the writer thread of an asynchronous stream is bound to while writing on
+     * this route, any CPU if negative.
+     */
+    int32_t writerCpu = -1;
+
     /**
      * Mask of device supported / managed by the stream route.
      * For devices that can be connected / disconnected at runtime, it is mandatory to fill
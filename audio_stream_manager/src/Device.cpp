@@ -25,20 +25,26 @@
 #include <Parameters.hpp>
 #include <hardware/audio_effect.h>
 #include <utilities/Log.hpp>
+#include <property/Property.hpp>
 #include <string>
 #include <unistd.h>
 using namespace std;
 using android::status_t;
 using audio_comms::utilities::Log;
 using audio_comms::utilities::Mutex;
+using audio_comms::utilities::Property;
 
 namespace intel_audio
 {
 
+/** Property to open the audio device of a stream when patched, ahead of its first write. */
+static const char *const gPrewarmRoutesPropName = "audio.route.prewarm";
+
 Device::Device()
     : mEchoReference(NULL),
       mStreamInterface(new AudioRouteManager()),
-      mPrimaryOutput(NULL)
+      mPrimaryOutput(NULL),
+      mPrewarmRoutes(Property<bool>(gPrewarmRoutesPropName, false).getValue())
 {
     mStreamInterface->reconsiderRouting(true);
 
@@ -450,6 +456,10 @@ status_t Device::createAudioPatch(size_t sourcesCount,
     updateParametersSync(patch.hasDevice(AUDIO_PORT_ROLE_SOURCE),
                          patch.hasDevice(AUDIO_PORT_ROLE_SINK),
                          handle);
+    if (mPrewarmRoutes) {
+        prewarmPatchStream(handle, AUDIO_PORT_ROLE_SOURCE);
+        prewarmPatchStream(handle, AUDIO_PORT_ROLE_SINK);
+    }
     // Patch has been created, even if updateParameters failed on one or more parameters, need to
     // return OK to AudioFlinger, unless this patch will not be considered as created and will
     // never be deleted (orphans patch within Audio HAL)
@@ -498,6 +508,27 @@ status_t Device::updateParameters(bool updateSourceDevice, bool updateSinkDevice
     return mStreamInterface->setParameters(pairs.toString(), synchronous);
 }
 
+void Device::prewarmPatchStream(audio_patch_handle_t patchHandle,
+                                audio_port_role_t streamPortRole)
+{
+    Stream *stream = NULL;
+    mPatchCollectionLock.lock();
+    if (hasPatchUnsafe(patchHandle)) {
+        const Patch &patch = getPatchUnsafe(patchHandle);
+        const Port *mixPort = patch.getMixPort(streamPortRole);
+        if (mixPort == NULL || !patch.hasDevice(getOppositeRole(streamPortRole)) ||
+            !getStream(mixPort->getMixIoHandle(), stream)) {
+            stream = NULL;
+        }
+    }
+    mPatchCollectionLock.unlock();
+    if (stream == NULL || stream->isStarted()) {
+
+        return;
+    }
+    mStreamInterface->prewarmStream(*stream);
+}
+
 status_t Device::getAudioPort(struct audio_port & /*port*/) const
 {
     Log::Warning() << __FUNCTION__ << ": no implementation provided yet";
@@ -231,6 +231,15 @@ private:
     void prepareStreamsParameters(audio_port_role_t streamPortRole, KeyValuePairs &pairs,
                                   audio_patch_handle_t handle = AUDIO_PATCH_HANDLE_NONE);
 
+    /**
+     * Opens ahead the audio device of a stream connected by a new patch if not started yet, its
+     * first write or read following the patch.
+     *
+     * @param[in] patchHandle handle of the new patch.
+     * @param[in] streamPortRole role of the mix port of the stream in the patch.
+     */
+    void prewarmPatchStream(audio_patch_handle_t patchHandle, audio_port_role_t streamPortRole);
+
     /**
      * Selects the output devices from streams devices and internal devices. It also take into
      * account the specific role of the primary output and the compress (as not handled by
@@ -373,6 +382,7 @@ private:
     PatchCollection mPatches; /**< Collection of connected patches. */
     PortCollection mPorts; /**< Collection of audio ports. */
     Stream *mPrimaryOutput; /**< Primary output stream, which has a leading routing role. */
+    bool mPrewarmRoutes; /**< Audio devices of the streams are opened ahead when patched. */
 
     static const char *const mDefaultGainPropName; /**< Gain property name. */
     static const float mDefaultGainValue; /**< Default gain value if empty property. */
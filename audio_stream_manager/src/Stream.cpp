@@ -25,6 +25,7 @@
 #include <utilities/Log.hpp>
 #include <property/Property.hpp>
 #include <AudioConversion.hpp>
+#include <IStreamRoute.hpp>
 #include <HalAudioDump.hpp>
 #include <string>
 #include <utils/String8.h>
@@ -51,7 +52,9 @@ const std::string Stream::dumpAfterConvProps[Direction::gNbDirections] = {
 
 Stream::Stream(Device *parent, audio_io_handle_t handle, uint32_t flagMask)
     : mParent(parent),
+      mPositionSequence(0),
       mStandby(true),
+      mLastTransferNs(0),
       mAudioConversion(new AudioConversion),
       mLatencyMs(0),
       mFlagMask(flagMask),
@@ -112,6 +115,12 @@ std::string Stream::getParameters(const std::string &keys) const
     if (pairs.hasKey(key)) {
         returnedPairs.add(key, capabilities.getSupportedRates());
     }
+    if (pairs.hasKey(Parameters::gKeyXrunStatistics)) {
+        returnedPairs.add(Parameters::gKeyXrunStatistics, getXrunStatistics());
+    }
+    if (pairs.hasKey(Parameters::gKeyTimingStatistics)) {
+        returnedPairs.add(Parameters::gKeyTimingStatistics, getTimingStatistics());
+    }
 
     return returnedPairs.toString();
 }
@@ -160,13 +169,12 @@ bool Stream::isRoutedByPolicy() const
 
 uint32_t Stream::getFlagMask() const
 {
-    AutoR lock(mStreamLock);
+    // Set at creation of the stream.
     return mFlagMask;
 }
 
 uint32_t Stream::getUseCaseMask() const
 {
-    AutoR lock(mStreamLock);
     return mUseCaseMask;
 }
 
@@ -227,7 +235,11 @@ status_t Stream::generateSilence(size_t &bytes, void *buffer)
         // Send zeroed buffer
         memset(buffer, 0, bytes);
     }
-    usleep(streamSampleSpec().convertFramesToUsec(streamSampleSpec().convertBytesToFrames(bytes)));
+    // Paced on the deadline of the silence clock: the latency of the caller does not add up.
+    AudioSilenceClock::sleepUntil(
+        mSilenceClock.addFrames(streamSampleSpec().convertBytesToFrames(bytes),
+                                streamSampleSpec().getSampleRate(),
+                                AudioSilenceClock::getNowNs()));
     return android::OK;
 }
 
@@ -267,10 +279,80 @@ status_t Stream::setStandby(bool isSet)
     return mParent->updateStreamsParametersSync(getRole());
 }
 
+status_t Stream::createMmapBuffer(int32_t minSizeFrames, audio_mmap_buffer_info &info)
+{
+    if (!isMmap()) {
+        Log::Error() << __FUNCTION__ << ": stream not flagged as mmap no-IRQ";
+        return android::INVALID_OPERATION;
+    }
+    // The audio device is opened on the route selected for the stream, as for a first write/read.
+    status_t status = setStandby(false);
+    if (status != android::OK) {
+
+        return status;
+    }
+    AutoR lock(mStreamLock);
+    if (!isMmapRoutedL()) {
+        Log::Error() << __FUNCTION__ << ": no route in mmap mode for this stream";
+        return android::INVALID_OPERATION;
+    }
+    // The client reads or writes the device buffer itself, no conversion may take place.
+    if (routeSampleSpec() != streamSampleSpec()) {
+        Log::Error() << __FUNCTION__ << ": stream config does not match mmap route config";
+        return android::INVALID_OPERATION;
+    }
+    status = getMmapBuffer(info);
+    if (status != android::OK) {
+
+        return status;
+    }
+    if (info.buffer_size_frames < minSizeFrames) {
+        Log::Warning() << __FUNCTION__ << ": buffer of " << info.buffer_size_frames
+                       << " frames smaller than the " << minSizeFrames << " frames requested";
+    }
+    return android::OK;
+}
+
+status_t Stream::start()
+{
+    AutoR lock(mStreamLock);
+    if (!isMmapRoutedL()) {
+
+        return android::INVALID_OPERATION;
+    }
+    return pcmStart();
+}
+
+status_t Stream::stop()
+{
+    AutoR lock(mStreamLock);
+    if (!isMmapRoutedL()) {
+
+        return android::INVALID_OPERATION;
+    }
+    return pcmStop();
+}
+
+status_t Stream::getMmapPosition(audio_mmap_position &position)
+{
+    AutoR lock(mStreamLock);
+    if (!isMmapRoutedL()) {
+
+        return android::INVALID_OPERATION;
+    }
+    return getMmapHwPosition(position);
+}
+
+bool Stream::isMmapRoutedL() const
+{
+    return isMmap() && isRoutedL() && getCurrentStreamRoute()->isMmap();
+}
+
 status_t Stream::attachRouteL()
 {
     Log::Verbose() << __FUNCTION__ << ": " << (isOut() ? "output" : "input") << " stream";
     IoStream::attachRouteL();
+    mSilenceClock.stop();
 
     SampleSpec ssSrc;
     SampleSpec ssDst;
@@ -278,13 +360,26 @@ status_t Stream::attachRouteL()
     ssSrc = isOut() ? streamSampleSpec() : routeSampleSpec();
     ssDst = isOut() ? routeSampleSpec() : streamSampleSpec();
 
+    if (getCurrentStreamRoute() != NULL) {
+        mAudioConversion->setChannelMatrix(getCurrentStreamRoute()->getChannelMatrix());
+        mAudioConversion->setAdaptiveRate(isOut() &&
+                                          getCurrentStreamRoute()->isAdaptiveRate());
+    }
     status_t err = configureAudioConversion(ssSrc, ssDst);
     if (err != android::OK) {
         Log::Error() << __FUNCTION__
                      << ": could not initialize audio conversion chain (err=" << err << ")";
         return err;
     }
-
+    // Sized for the transfers of the client, so that they do not allocate once the stream runs.
+    size_t streamFrames = getStreamBufferFramesL();
+    err = isOut() ? mAudioConversion->reserve(streamFrames, 0) :
+          mAudioConversion->reserve(0, streamFrames);
+    if (err != android::OK) {
+        Log::Error() << __FUNCTION__ << ": could not reserve audio conversion buffers (err="
+                     << err << ")";
+        return err;
+    }
     return android::OK;
 }
 
@@ -307,26 +402,100 @@ status_t Stream::getConvertedBuffer(void *dst, const size_t outFrames,
     return mAudioConversion->getConvertedBuffer(dst, outFrames, bufferProvider);
 }
 
+size_t Stream::getConversionLatencyFramesL() const
+{
+    return mAudioConversion->getLatencyFrames();
+}
+
+size_t Stream::getStreamBufferFramesL() const
+{
+    return AudioUtils::alignOn16(AudioUtils::convertSrcToDstInFrames(getBufferSizeInFrames(),
+                                                                     routeSampleSpec(),
+                                                                     streamSampleSpec()));
+}
+
+void Stream::updateRateControlL(size_t writtenFrames)
+{
+    if (!mAudioConversion->isAdaptiveRate()) {
+
+        return;
+    }
+    size_t avail;
+    struct timespec timestamp;
+    if (getFramesAvailable(avail, timestamp) != android::OK) {
+
+        return;
+    }
+    // For output, getFramesAvailable returns available empty frames, more than the buffer size
+    // after an underrun.
+    mAudioConversion->updateRateControl(writtenFrames,
+                                        (ssize_t)getBufferSizeInFrames() - (ssize_t)avail,
+                                        timestamp);
+}
+
+bool Stream::beginWriteInPlaceL(size_t srcFrames, void *&area)
+{
+    area = NULL;
+    if (!isZeroCopyL()) {
+
+        return false;
+    }
+    size_t maxFrames = mAudioConversion->getMaxConvertedFrames(srcFrames);
+    size_t frames = maxFrames;
+    void *deviceArea = NULL;
+    if (beginWrite(deviceArea, frames) != android::OK) {
+
+        // Written the usual way, which reports the error.
+        return false;
+    }
+    if (frames < maxFrames) {
+
+        // The ring buffer wraps within the area needed: the device copies the frames instead.
+        std::string error;
+        commitWrite(0, error);
+        return false;
+    }
+    area = deviceArea;
+    return true;
+}
+
+bool Stream::isZeroCopyL() const
+{
+    return isRoutedL() && getCurrentStreamRoute()->isZeroCopy();
+}
+
+bool Stream::isNonBlockingL() const
+{
+    return isRoutedL() && getCurrentStreamRoute()->isNonBlocking();
+}
+
 status_t Stream::applyAudioConversion(const void *src, void **dst, size_t inFrames,
                                       size_t *outFrames)
 {
-    return mAudioConversion->convert(src, dst, inFrames, outFrames);
+    int64_t startNs = AudioTimingHistogram::getNowNs();
+    status_t status = mAudioConversion->convert(src, dst, inFrames, outFrames);
+    mConversionTiming.record(AudioTimingHistogram::getNowNs() - startNs);
+    return status;
 }
 
 bool Stream::isStarted() const
 {
-    AutoR lock(mStreamLock);
     return !mStandby;
 }
 
 void Stream::setStarted(bool isStarted)
 {
+    int64_t lockNs = AudioTimingHistogram::getNowNs();
     AutoW lock(mStreamLock);
+    mLockTiming.record(AudioTimingHistogram::getNowNs() - lockNs);
     mStandby = !isStarted;
 
     if (isStarted) {
 
         initAudioDump();
+    } else {
+        // The next transfer is the first one, not late on the previous one.
+        mLastTransferNs = 0;
     }
 }
 
@@ -372,6 +541,22 @@ bool Stream::safeSleep(uint32_t sleepTimeUs)
     return nanosleep(&tim, NULL) > 0;
 }
 
+void Stream::recordTransferInterval(int64_t nowNs)
+{
+    int64_t lastNs = mLastTransferNs.exchange(nowNs);
+    if (lastNs != 0) {
+        mIntervalTiming.record(nowNs - lastNs);
+    }
+}
+
+string Stream::getTimingStatistics() const
+{
+    return "interval_us:" + mIntervalTiming.toString() +
+           ",conversion_us:" + mConversionTiming.toString() +
+           ",pcm_us:" + mPcmTiming.toString() +
+           ",lock_us:" + mLockTiming.toString();
+}
+
 void Stream::setPatchHandle(audio_patch_handle_t patchHandle)
 {
     mPatchHandle = patchHandle;
@@ -396,8 +581,34 @@ android::status_t Stream::dump(int fd) const
              InputFlagConverter::maskToString(mFlagMask, ",").c_str());
     result.append(buffer);
     snprintf(buffer, SIZE, "%*s- Use Cases: %s\n", spaces + 2, "", isOut() ? "n/a" :
-             InputSourceConverter::maskToString(mUseCaseMask, ",").c_str());
+             InputSourceConverter::maskToString(mUseCaseMask.load(), ",").c_str());
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- Conversion plans: %u hits, %u misses\n", spaces + 2, "",
+             mAudioConversion->getPlanCacheHits(), mAudioConversion->getPlanCacheMisses());
     result.append(buffer);
+    if (mAudioConversion->isAdaptiveRate()) {
+        snprintf(buffer, SIZE, "%*s- Rate drift: %.1f ppm, correction: %.1f ppm\n", spaces + 2,
+                 "", mAudioConversion->getRateDriftPpm(),
+                 mAudioConversion->getRateCorrectionPpm());
+        result.append(buffer);
+    }
+    const struct
+    {
+        const char *name;
+        const AudioTimingHistogram &timing;
+    } timings[] = {
+        { "Call interval", mIntervalTiming },
+        { "Conversion", mConversionTiming },
+        { "Device transfer", mPcmTiming },
+        { "Stream lock wait", mLockTiming }
+    };
+    for (size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        snprintf(buffer, SIZE, "%*s- %s: %u calls, p50 %u us, p90 %u us, p99 %u us, max %u us\n",
+                 spaces + 2, "", timings[i].name, timings[i].timing.getCount(),
+                 timings[i].timing.getPercentileUs(50), timings[i].timing.getPercentileUs(90),
+                 timings[i].timing.getPercentileUs(99), timings[i].timing.getMaxUs());
+        result.append(buffer);
+    }
     write(fd, result.string(), result.size());
     return IoStream::dump(fd, spaces + 2);
 }
@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include <AudioSilenceClock.hpp>
+#include <AudioTimingHistogram.hpp>
 #include <SampleSpec.hpp>
 #include <StreamInterface.hpp>
 #include <AudioNonCopyable.hpp>
@@ -22,6 +24,7 @@
 #include <IoStream.hpp>
 #include <media/AudioBufferProvider.h>
 #include <hardware/audio.h>
+#include <atomic>
 #include <string>
 #include <utils/RWLock.h>
 
@@ -71,6 +74,12 @@ public:
     /** @note API not used anymore for routing since Routing Control API 3.0. */
     virtual android::status_t setParameters(const std::string &keyValuePairs);
     virtual std::string getParameters(const std::string &keys) const;
+    /** @note mmap APIs require a stream flagged MMAP_NOIRQ, attached to a route in mmap mode. */
+    virtual android::status_t start();
+    virtual android::status_t stop();
+    virtual android::status_t createMmapBuffer(int32_t minSizeFrames,
+                                               audio_mmap_buffer_info &info);
+    virtual android::status_t getMmapPosition(audio_mmap_position &position);
 
     // From IoStream
     virtual bool isRoutedByPolicy() const;
@@ -175,12 +184,68 @@ protected:
     android::status_t getConvertedBuffer(void *dst, const size_t outFrames,
                                          android::AudioBufferProvider *bufferProvider);
 
+    /**
+     * Gets the latency of the conversion chain: group delay of its resampler, and frames converted
+     * ahead of the frames requested, kept for the next call. To be called with the stream lock
+     * held or the route entered.
+     * Playback converts no frame ahead: the latency only changes with the route. Capture does at
+     * each read: audio thread only, the others read the latency published by the stream.
+     *
+     * @return frames in the destination sample specification of the conversion.
+     */
+    size_t getConversionLatencyFramesL() const;
+
+    /**
+     * Gets the size of the buffer of the stream from the period of its route, as the client
+     * transfers it. To be called with the stream lock held, once routed.
+     *
+     * @return frames in the sample specification of the stream, aligned on 16.
+     */
+    size_t getStreamBufferFramesL() const;
+
+    /**
+     * Corrects the resampling ratio from the fill level of the audio device buffer, if the route
+     * requires the ratio to follow the clock of the device. Playback only, to be called after
+     * each write, with the stream lock held.
+     *
+     * @param[in] writtenFrames frames written to the audio device by the last write.
+     */
+    void updateRateControlL(size_t writtenFrames);
+
+    /**
+     * Gets the area of the ring buffer of the audio device to convert the frames of a write in
+     * place, if the route gives zero copy access and the area does not wrap around the end of the
+     * ring buffer. To be called with the stream lock held, followed by commitWrite if true.
+     *
+     * @param[in] srcFrames frames of the write, in the stream sample specification.
+     * @param[out] area address to convert the frames at, NULL if false is returned.
+     *
+     * @return true if the frames may be converted in place, false if they must be written.
+     */
+    bool beginWriteInPlaceL(size_t srcFrames, void *&area);
+
+    /**
+     * Checks if the frames are read in place in the buffer of the audio device.
+     * To be called with the stream lock held.
+     *
+     * @return true if the stream is routed with zero copy access, false otherwise.
+     */
+    bool isZeroCopyL() const;
+
+    /**
+     * Checks if the frames are written to a device opened in non-blocking mode, which may take
+     * part of them only. To be called with the stream lock held.
+     *
+     * @return true if the stream is routed in non-blocking mode, false otherwise.
+     */
+    bool isNonBlockingL() const;
+
     /**
      * Generate silence.
      * According to the direction, the meaning is different. For an output stream, it means
      * trashing audio samples, while for an input stream, it means providing zeroed samples.
-     * To emulate the behavior of the HW and to keep time sync, this function will sleep the time
-     * the HW would have used to read/write the amount of requested bytes.
+     * To emulate the behavior of the HW and to keep time sync, this function will sleep until the
+     * silence clock of the stream has read/written the amount of requested bytes.
      *
      * @param[in,out] bytes amount of byte to set to 0 within the buffer.
      * @param[in,out] buffer: if provided, need to fill with 0 (expected for input)
@@ -243,6 +308,23 @@ protected:
      */
     bool safeSleep(uint32_t sleepTimeUs);
 
+    /**
+     * Records the time since the previous transfer call of the client. To be called at each
+     * write/read: the first one after standby has no previous call.
+     *
+     * @param[in] nowNs time of the call in nanoseconds, monotonic clock.
+     */
+    void recordTransferInterval(int64_t nowNs);
+
+    /**
+     * Gets the timings of the transfers as a parameter value, without any key value pair
+     * separator, each as "count|p50|p90|p99|max" in microseconds: e.g.
+     * "interval_us:480|10000|10239|11263|12004,conversion_us:...,pcm_us:...,lock_us:...".
+     *
+     * @return timings of the transfers of the stream.
+     */
+    std::string getTimingStatistics() const;
+
     Device *mParent; /**< Audio HAL singleton handler. */
 
     /**
@@ -254,6 +336,24 @@ protected:
      */
     android::RWLock mPreProcEffectLock;
 
+    /**
+     * Clock the frames are read/written at without audio device. Stopped once routed, started by
+     * the stream from the last position of its device when unrouted, or from the first silence.
+     */
+    AudioSilenceClock mSilenceClock;
+
+    /**
+     * Odd while the audio thread, or the writer thread of an asynchronous stream, updates the
+     * position of the stream, and even otherwise: a position computed meanwhile is computed again.
+     */
+    std::atomic<uint32_t> mPositionSequence;
+
+    /** Timings of the transfers of the stream, recorded by the audio thread without lock. */
+    AudioTimingHistogram mIntervalTiming; /**< Between two transfer calls of the client. */
+    AudioTimingHistogram mConversionTiming; /**< Converting the frames of a transfer. */
+    AudioTimingHistogram mPcmTiming; /**< Writing/reading the frames to/from the audio device. */
+    mutable AudioTimingHistogram mLockTiming; /**< Waiting for the stream lock. */
+
     static const uint32_t mDefaultSampleRate = 48000; /**< Default HAL sample rate. */
     static const uint32_t mDefaultChannelCount = 2; /**< Default HAL nb of channels. */
     static const audio_format_t mDefaultFormat = AUDIO_FORMAT_PCM_16_BIT; /**< Default HAL format.*/
@@ -280,8 +380,20 @@ private:
      */
     void initAudioDump();
 
+    /**
+     * Checks if the stream is routed on an audio device opened in mmap mode.
+     * Must be called with the stream lock held.
+     *
+     * @return true if the buffer of the audio device may be shared with the client.
+     */
+    bool isMmapRoutedL() const;
+
+
+    /** state of the stream, true if standby, false if started. Read without lock. */
+    std::atomic<bool> mStandby;
 
-    bool mStandby; /**< state of the stream, true if standby, false if started. */
+    /** Time of the last transfer call of the client, 0 if none since standby. */
+    std::atomic<int64_t> mLastTransferNs;
 
     AudioConversion *mAudioConversion; /**< Audio Conversion utility class. */
 
@@ -303,8 +415,9 @@ private:
      *  -for output streams: Not used.
      *  -for input streams: input source translated into a bit.
      *          Note that 0 will be taken as none.
+     * Read without lock.
      */
-    uint32_t mUseCaseMask;
+    std::atomic<uint32_t> mUseCaseMask;
 
     /**
      * Audio dump object used if one of the dump property before
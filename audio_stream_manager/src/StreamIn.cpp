@@ -37,9 +37,9 @@ const std::string StreamIn::mHwEffectImplementor = "IntelLPE";
 StreamIn::StreamIn(Device *parent, audio_io_handle_t handle, uint32_t flagMask,
                    audio_source_t source, audio_devices_t devices, const std::string &address)
     : Stream(parent, handle, flagMask),
-      mFramesLost(0),
-      mFramesIn(0),
       mFramesInCount(0),
+      mHalLatencyFrames(0),
+      mConversionPcmNs(0),
       mProcessingFramesIn(0),
       mProcessingBuffer(NULL),
       mProcessingBufferSizeInFrames(0),
@@ -47,7 +47,8 @@ StreamIn::StreamIn(Device *parent, audio_io_handle_t handle, uint32_t flagMask,
       mReferenceBuffer(NULL),
       mReferenceBufferSizeInFrames(0),
       mPreprocessorsHandlerList(),
-      mHwBuffer(NULL)
+      mHwBuffer(NULL),
+      mHwBufferSize(0)
 {
     setDevices(devices & ~AUDIO_DEVICE_BIT_IN, address);
     setInputSource(source);
@@ -56,7 +57,6 @@ StreamIn::StreamIn(Device *parent, audio_io_handle_t handle, uint32_t flagMask,
 StreamIn::~StreamIn()
 {
     setStandby(true);
-    freeAllocatedBuffers();
 }
 
 status_t StreamIn::set(audio_config_t &config)
@@ -74,6 +74,11 @@ status_t StreamIn::getNextBuffer(AudioBufferProvider::Buffer *buffer)
 
     ssize_t hwFramesToRead = min(maxFrames, buffer->frameCount);
 
+    if (isZeroCopyL()) {
+
+        // Frames are converted where the device captured them, given back on release.
+        return getHwArea(buffer, hwFramesToRead);
+    }
     status_t status = readHwFrames(mHwBuffer, hwFramesToRead);
     if (status < 0) {
 
@@ -85,6 +90,47 @@ status_t StreamIn::getNextBuffer(AudioBufferProvider::Buffer *buffer)
     return android::OK;
 }
 
+void StreamIn::releaseBuffer(AudioBufferProvider::Buffer *buffer)
+{
+    if (!isZeroCopyL()) {
+
+        return;
+    }
+    std::string error;
+    if (commitRead(buffer->frameCount, error) != android::OK) {
+        Log::Error() << __FUNCTION__ << ": commit error: " << error;
+    }
+}
+
+status_t StreamIn::getHwArea(AudioBufferProvider::Buffer *buffer, size_t frames)
+{
+    const void *area = NULL;
+    int64_t pcmNs = AudioTimingHistogram::getNowNs();
+    status_t status = beginRead(area, frames);
+    pcmNs = AudioTimingHistogram::getNowNs() - pcmNs;
+    mPcmTiming.record(pcmNs);
+    mConversionPcmNs += pcmNs;
+    if (status != android::OK) {
+        Log::Error() << __FUNCTION__ << ": error " << status << " - requested " << frames
+                     << " frames";
+        return status;
+    }
+
+    // Dump audio input before eventual conversions
+    // FOR DEBUG PURPOSE ONLY
+    if (getDumpObjectBeforeConv() != NULL) {
+        getDumpObjectBeforeConv()->dumpAudioSamples(area,
+                                                    routeSampleSpec().convertFramesToBytes(frames),
+                                                    isOut(),
+                                                    routeSampleSpec().getSampleRate(),
+                                                    routeSampleSpec().getChannelCount(),
+                                                    "before_conversion");
+    }
+    buffer->raw = const_cast<void *>(area);
+    buffer->frameCount = frames;
+    return android::OK;
+}
+
 status_t StreamIn::readHwFrames(void *buffer, size_t frames)
 {
     status_t ret;
@@ -96,7 +142,11 @@ status_t StreamIn::readHwFrames(void *buffer, size_t frames)
 
     std::string error;
 
+    int64_t pcmNs = AudioTimingHistogram::getNowNs();
     ret = pcmReadFrames(buffer, frames, error);
+    pcmNs = AudioTimingHistogram::getNowNs() - pcmNs;
+    mPcmTiming.record(pcmNs);
+    mConversionPcmNs += pcmNs;
 
     if (ret < 0) {
         Log::Error() << __FUNCTION__ << ": read error: " << error << " - requested " << frames
@@ -140,7 +190,11 @@ status_t StreamIn::readFrames(void *buffer, size_t frames, ssize_t *processedFra
     //
     // Otherwise, request for a converted buffer
     //
+    // The conversion chain reads the audio device as it needs frames: timed apart.
+    int64_t conversionNs = AudioTimingHistogram::getNowNs();
+    mConversionPcmNs = 0;
     status_t status = getConvertedBuffer(buffer, frames, this);
+    mConversionTiming.record(AudioTimingHistogram::getNowNs() - conversionNs - mConversionPcmNs);
     if (status != android::OK) {
 
         return status;
@@ -207,7 +261,7 @@ status_t StreamIn::processFrames(void *buffer, ssize_t frames, ssize_t *processe
 
         if (mProcessingBufferSizeInFrames < frames) {
 
-            status_t ret = allocateProcessingMemory(frames);
+            status_t ret = reserveBuffersL(frames);
             if (ret != android::OK) {
 
                 return ret;
@@ -271,19 +325,23 @@ status_t StreamIn::processFrames(void *buffer, ssize_t frames, ssize_t *processe
 
 status_t StreamIn::read(void *buffer, size_t &bytes)
 {
+    recordTransferInterval(AudioTimingHistogram::getNowNs());
     setStandby(false);
 
-    mStreamLock.readLock();
+    // Never waits for the route manager: while the route is replaced, the stream is not routed.
+    bool routeReady = enterRoute();
 
     status_t status;
     // Check if the audio route is available for this stream
-    if (!isRoutedL()) {
+    if (!routeReady || !isRoutedL()) {
         Log::Warning() << __FUNCTION__ << ": (buffer=" << buffer
                        << ", bytes=" << bytes
                        << ") No route available. Generating silence for stream " << this;
         status = generateSilence(bytes, buffer);
+        // Read by the client as captured, the capture position goes on.
+        mFramesInCount += streamSampleSpec().convertBytesToFrames(bytes);
 
-        mStreamLock.unlock();
+        leaveRoute();
         return status;
     }
 
@@ -306,73 +364,123 @@ status_t StreamIn::read(void *buffer, size_t &bytes)
         Log::Error() << __FUNCTION__ << ": (buffer=" << buffer << ", bytes=" << bytes
                      << ") returns " << received_frames
                      << ". Generating silence for stream " << this;
-        mStreamLock.unlock();
+        leaveRoute();
         generateSilence(bytes, buffer);
         return status;
     }
     bytes = streamSampleSpec().convertFramesToBytes(received_frames);
+    // Published at once to the position: frames given to the client, and kept by the HAL.
+    mPositionSequence++;
     mFramesInCount += received_frames;
+    mHalLatencyFrames = getHalLatencyFramesL();
+    mPositionSequence++;
 
-    mStreamLock.unlock();
+    leaveRoute();
     return android::OK;
 }
 
-void StreamIn::resetFramesLost()
-{
-    // setVoiceVolume and mixing during voice call cannot happen together
-    // need a lock; but deadlock may appear during simultaneous R or W
-    // so remove lock and the reset of mFramesLost which is never updated btw
-}
-
 unsigned int StreamIn::getInputFramesLost() const
 {
-    unsigned int count = mFramesLost;   // set to 0 during construction
-
-    StreamIn *mutable_this = const_cast<StreamIn *>(this);
     // Requirement from AudioHardwareInterface.h:
     // Audio driver is expected to reset the value to 0 and restart counting upon
     // returning the current value by this function call.
-    mutable_this->resetFramesLost();
-    return count;
+    // Frames are lost by the overruns of the audio device, a stream not routed loses none.
+    return takeLostFrames();
 }
 
 status_t StreamIn::getCapturePosition(int64_t &frames, int64_t &time)
 {
-    struct timespec tstamp={0,0};
-    if (clock_gettime(CLOCK_MONOTONIC, &tstamp) != 0)
-    {
-        Log::Error() << __FUNCTION__ << ": Error getting Timestamp";
-        return android::INVALID_OPERATION;
-    }
-    mStreamLock.readLock();
-    frames = (int64_t)mFramesInCount;
-    mStreamLock.unlock();
-    uint64_t now;
-    now = ((tstamp.tv_sec) * 1000000000ull) +
-          (tstamp.tv_nsec);
-    time = (int64_t)now;
+    int64_t lockNs = AudioTimingHistogram::getNowNs();
+    AutoR lock(mStreamLock);
+    mLockTiming.record(AudioTimingHistogram::getNowNs() - lockNs);
+    size_t kernelFrames;
+    struct timespec tstamp;
+    uint32_t sequence;
+    int64_t framesIn;
+    ssize_t halLatencyFrames;
+    bool captured;
+    do {
+        // Computed again if the audio thread read meanwhile.
+        sequence = mPositionSequence;
+        captured = isRoutedL() && getFramesAvailable(kernelFrames, tstamp) == android::OK;
+        framesIn = mFramesInCount;
+        halLatencyFrames = mHalLatencyFrames;
+    } while ((sequence & 1) != 0 || sequence != mPositionSequence);
+
+    if (!captured) {
+
+        // Nothing captured, the frames read are given at the current time.
+        if (clock_gettime(CLOCK_MONOTONIC, &tstamp) != 0) {
+            Log::Error() << __FUNCTION__ << ": Error getting Timestamp";
+            return android::INVALID_OPERATION;
+        }
+        frames = framesIn;
+        time = tstamp.tv_sec * 1000000000ll + tstamp.tv_nsec;
+        return android::OK;
+    }
+    // Frames captured at the time of the device position: the frames read, those still delayed
+    // in the HAL, those waiting in the device, captured at the rate of the route, and those in
+    // the DSP before the device. The frames lost by the overruns are not part of the position, as
+    // never read.
+    int64_t deviceFrames = static_cast<int64_t>(kernelFrames) *
+                           streamSampleSpec().getSampleRate() /
+                           routeSampleSpec().getSampleRate();
+    frames = framesIn + halLatencyFrames + deviceFrames +
+             streamSampleSpec().convertUsecToframes(getDspLatencyUs());
+    time = tstamp.tv_sec * 1000000000ll + tstamp.tv_nsec;
     return android::OK;
 }
 
-
-status_t StreamIn::allocateHwBuffer()
+ssize_t StreamIn::getHalLatencyFramesL() const
 {
-    freeAllocatedBuffers();
+    // Converted frames are in the stream sample spec, as are the frames of the processing buffer.
+    return getConversionLatencyFramesL() + mProcessingFramesIn;
+}
 
-    mHwBufferSize = getBufferSizeInBytes();
+status_t StreamIn::reserveBuffersL(ssize_t frames)
+{
+    size_t hwBytes = std::max<size_t>(getBufferSizeInBytes(), mHwBufferSize);
+    ssize_t streamFrames = std::max(std::max<ssize_t>(frames, getStreamBufferFramesL()),
+                                    std::max(mProcessingBufferSizeInFrames,
+                                             mReferenceBufferSizeInFrames));
+    if (mHwBuffer != NULL && hwBytes == mHwBufferSize &&
+        streamFrames == mProcessingBufferSizeInFrames &&
+        streamFrames == mReferenceBufferSizeInFrames) {
 
-    mHwBuffer = new char[mHwBufferSize];
-    if (!mHwBuffer) {
-        Log::Error() << __FUNCTION__ << ": cannot allocate resampler Hwbuffer";
+        return android::OK;
+    }
+    size_t streamBytes = streamSampleSpec().convertFramesToBytes(streamFrames);
+    AudioArena arena;
+    if (arena.reserve(AudioArena::getAlignedSize(hwBytes) +
+                      2 * AudioArena::getAlignedSize(streamBytes)) != android::OK) {
+        Log::Error() << __FUNCTION__ << ": (frames=" << frames << "): cannot allocate buffers";
         return android::NO_MEMORY;
     }
-    return android::OK;
-}
+    char *hwBuffer = static_cast<char *>(arena.allocate(hwBytes));
+    int16_t *processingBuffer = static_cast<int16_t *>(arena.allocate(streamBytes));
+    int16_t *referenceBuffer = static_cast<int16_t *>(arena.allocate(streamBytes));
+    AUDIOCOMMS_ASSERT(referenceBuffer != NULL, "Arena too small for the buffers");
 
-void StreamIn::freeAllocatedBuffers()
-{
-    delete[] mHwBuffer;
-    mHwBuffer = NULL;
+    // Frames read ahead or pending for the echo reference are kept.
+    if (mProcessingFramesIn > 0) {
+        memcpy(processingBuffer, mProcessingBuffer,
+               streamSampleSpec().convertFramesToBytes(mProcessingFramesIn));
+    }
+    if (mReferenceFramesIn > 0) {
+        memcpy(referenceBuffer, mReferenceBuffer,
+               streamSampleSpec().convertFramesToBytes(mReferenceFramesIn));
+    }
+    mArena.swap(arena);
+    mHwBuffer = hwBuffer;
+    mHwBufferSize = hwBytes;
+    mProcessingBuffer = processingBuffer;
+    mProcessingBufferSizeInFrames = streamFrames;
+    mReferenceBuffer = referenceBuffer;
+    mReferenceBufferSizeInFrames = streamFrames;
+    Log::Debug() << __FUNCTION__ << ": (frames=" << frames << "): " << mArena.getCapacity()
+                 << " bytes for " << hwBytes << " bytes of device buffer and " << streamFrames
+                 << " frames of processing and reference buffers";
+    return android::OK;
 }
 
 status_t StreamIn::attachRouteL()
@@ -382,12 +490,12 @@ status_t StreamIn::attachRouteL()
 
         return status;
     }
-    return allocateHwBuffer();
+    mHalLatencyFrames = getHalLatencyFramesL();
+    return reserveBuffersL(0);
 }
 
 status_t StreamIn::detachRouteL()
 {
-    freeAllocatedBuffers();
     return Stream::detachRouteL();
 }
 
@@ -640,12 +748,13 @@ void StreamIn::getCaptureDelay(struct echo_reference_buffer *buffer)
     // read frames available in audio HAL input buffer
     // add number of frames being read as we want the capture time of first sample
     // in current buffer.
-    buf_delay = streamSampleSpec().convertFramesToUsec(mFramesIn + mProcessingFramesIn);
+    buf_delay = streamSampleSpec().convertFramesToUsec(getHalLatencyFramesL());
 
-    // add delay introduced by kernel
-    kernel_delay = routeSampleSpec().convertFramesToUsec(kernel_frames);
+    // add delay introduced by kernel, and by the DSP before it
+    kernel_delay = routeSampleSpec().convertFramesToUsec(kernel_frames) + getDspLatencyUs();
 
-    delay_ns = kernel_delay + buf_delay;
+    // Both delays are in microseconds.
+    delay_ns = (kernel_delay + buf_delay) * 1000;
 
     buffer->time_stamp = tstamp;
     buffer->delay_ns = delay_ns;
@@ -663,17 +772,9 @@ int32_t StreamIn::updateEchoReference(ssize_t frames, struct echo_reference_itfe
 
     if (mReferenceFramesIn < frames) {
 
-        if (mReferenceBufferSizeInFrames < frames) {
+        if (mReferenceBufferSizeInFrames < frames && reserveBuffersL(frames) != android::OK) {
 
-            mReferenceBufferSizeInFrames = frames;
-            int16_t *referenceBuffer = (int16_t *)realloc(mReferenceBuffer,
-                                                          streamSampleSpec().convertFramesToBytes(
-                                                              mReferenceBufferSizeInFrames));
-            if (referenceBuffer == NULL) {
-                Log::Error() << __FUNCTION__ << ": (frames=" << frames << "): realloc failed";
-                return android::NO_MEMORY;
-            }
-            mReferenceBuffer = referenceBuffer;
+            return android::NO_MEMORY;
         }
 
         b.frame_count = frames - mReferenceFramesIn;
@@ -784,26 +885,4 @@ status_t StreamIn::setPreprocessorEchoDelay(effect_handle_t effect, int32_t dela
     return setPreprocessorParam(effect, *param);
 }
 
-status_t StreamIn::allocateProcessingMemory(ssize_t frames)
-{
-    mProcessingBufferSizeInFrames = frames;
-
-    int16_t *processingBuffer = (int16_t *)realloc(mProcessingBuffer,
-                                                   streamSampleSpec().convertFramesToBytes(
-                                                       mProcessingBufferSizeInFrames));
-    if (processingBuffer == NULL) {
-        Log::Error() << __FUNCTION__ << ": (frames=" << frames
-                     << "): realloc failed errno = " << strerror(errno) << "!";
-        return android::NO_MEMORY;
-    }
-    mProcessingBuffer = processingBuffer;
-    Log::Debug() << __FUNCTION__ << ": (frames=" << frames
-                 << "): mProcessingBuffer=" << mProcessingBuffer
-                 << " size extended to " << mProcessingBufferSizeInFrames
-                 << " frames (i.e. "
-                 << streamSampleSpec().convertFramesToBytes(mProcessingBufferSizeInFrames)
-                 << " bytes)";
-    return android::OK;
-}
-
 } // namespace intel_audio
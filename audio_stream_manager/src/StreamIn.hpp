@@ -17,7 +17,9 @@
 
 #include "Device.hpp"
 #include "Stream.hpp"
+#include <AudioArena.hpp>
 #include <media/AudioBufferProvider.h>
+#include <atomic>
 #include <vector>
 #include <list>
 
@@ -50,8 +52,7 @@ public:
     // From AudioBufferProvider
     virtual android::status_t getNextBuffer(android::AudioBufferProvider::Buffer *buffer);
 
-    /** @note API not implemented in input stream*/
-    virtual void releaseBuffer(android::AudioBufferProvider::Buffer */* buffer */) {}
+    virtual void releaseBuffer(android::AudioBufferProvider::Buffer *buffer);
 
     // From IoStream
     /**
@@ -96,6 +97,18 @@ protected:
 private:
     android::status_t readHwFrames(void *buffer, size_t frames);
 
+    /**
+     * Gives the area of the ring buffer of the audio device holding the next captured frames,
+     * zero copy routes only. The area is given back to the device by releaseBuffer.
+     *
+     * @param[out] buffer area of the captured frames, less than requested where the ring buffer
+     *                    of the device wraps.
+     * @param[in] frames frames requested.
+     *
+     * @return OK if frames are given, error code otherwise.
+     */
+    android::status_t getHwArea(android::AudioBufferProvider::Buffer *buffer, size_t frames);
+
     /**
      * Performs the removal of an effect.
      * It removes the effect from the stream list of requested effects
@@ -186,12 +199,6 @@ private:
         }
     };
 
-    /**
-     * Reset the amount of input frames lost in the audio driver since the last call of
-     * getInputFramesLost.
-     */
-    void resetFramesLost();
-
     /**
      * Read audio frames into the buffer.
      *
@@ -204,25 +211,19 @@ private:
     android::status_t readFrames(void *buffer, size_t frames, ssize_t *processedFrames);
 
     /**
-     * Free internal buffers allocated for read / processing operations.
-     */
-    void freeAllocatedBuffers();
-
-    /**
-     * Allocate memory to process a certain amount of frames.
+     * Reserves the buffers of the stream in its arena: the buffer read from the audio device, and
+     * the processing and reference buffers of the effects. Sized for a period of the route and at
+     * least the given frames, they only grow, keeping the frames they hold. Allocates only if
+     * they grow: once routed, before the first read, or if the client reads more than a period
+     * at once.
+     * The buffers are only used by the audio thread with the route entered, and by the route
+     * manager with the route guard closed: either may call it.
      *
-     * @param[in] frames number of frame that we may process.
+     * @param[in] frames number of frames that we may process.
      *
      * @return OK if successful allocation, error code otherwise.
      */
-    android::status_t allocateProcessingMemory(ssize_t frames);
-
-    /**
-     * Allocate the buffer in which it reads the samples from the audio device.
-     *
-     * @return OK if successful allocation, error code otherwise.
-     */
-    inline android::status_t allocateHwBuffer();
+    android::status_t reserveBuffersL(ssize_t frames);
 
     /**
      * Process audio frames into the buffer.
@@ -301,13 +302,23 @@ private:
     void getCaptureDelay(struct echo_reference_buffer *buffer);
 
     /**
-     * amount of input frames lost in the audio driver (i.e. not provided on time to client).
+     * Gets the latency of the frames read from the audio device until given to the client: frames
+     * kept by the conversion chain and by the processing buffer, and group delay of the
+     * conversion. Audio thread only, route entered, or route manager with the route guard
+     * closed: the other threads read mHalLatencyFrames.
+     *
+     * @return frames in the stream sample specification.
      */
-    unsigned int mFramesLost;
+    ssize_t getHalLatencyFramesL() const;
 
-    ssize_t mFramesIn; /**< frames available in stream input buffer. */
+    /** Total frames read, published with the position. */
+    std::atomic<int64_t> mFramesInCount;
 
-    ssize_t mFramesInCount; /**< Total frames read. */
+    /** Latency of the HAL at the last read, published with the position. */
+    std::atomic<ssize_t> mHalLatencyFrames;
+
+    /** Time reading the audio device during the conversion of the current read. */
+    int64_t mConversionPcmNs;
 
     /**
      * This variable represents the number of frames of in mProcessingBuffer.
@@ -315,7 +326,7 @@ private:
     ssize_t mProcessingFramesIn;
 
     /**
-     * This variable is a dynamic buffer and contains raw data read from input device.
+     * This variable is a buffer of the arena and contains raw data read from input device.
      * It is used as input buffer before application of SW accoustics effects.
      */
     int16_t *mProcessingBuffer;
@@ -331,7 +342,7 @@ private:
     ssize_t mReferenceFramesIn;
 
     /**
-     * This variable is a dynamic buffer and contains the data used as reference for AEC and
+     * This variable is a buffer of the arena and contains the data used as reference for AEC and
      * which are read from AudioEffectHandle::mEchoReference.
      */
     int16_t *mReferenceBuffer;
@@ -347,7 +358,9 @@ private:
     std::vector<AudioEffectHandle> mPreprocessorsHandlerList;
 
     char *mHwBuffer; /**< buffer in which samples are read from audio device. */
-    ssize_t mHwBufferSize; /**< Size of the buffer in which samples are read from audio device. */
+    size_t mHwBufferSize; /**< Size of the buffer in which samples are read from audio device. */
+
+    AudioArena mArena; /**< Memory of the buffers, kept from a route to the next. */
 
     static const std::string mHwEffectImplementor; /**< Implementor name for HW effects. */
 };
@@ -20,6 +20,7 @@
 #include <AudioCommsAssert.hpp>
 #include <HalAudioDump.hpp>
 #include <utilities/Log.hpp>
+#include <algorithm>
 
 using namespace std;
 using android::status_t;
@@ -31,6 +32,9 @@ namespace intel_audio
 const uint32_t StreamOut::mMaxAgainRetry = 2;
 const uint32_t StreamOut::mWaitBeforeRetryUs = 10000; // 10ms
 const uint32_t StreamOut::mUsecPerMsec = 1000;
+const uint32_t StreamOut::mFifoPeriodCount = 2;
+const uint32_t StreamOut::mWriterPriority = 2;
+const uint32_t StreamOut::mFifoPollUs = 1000;
 
 StreamOut::StreamOut(Device *parent,
                      audio_io_handle_t handle,
@@ -38,14 +42,27 @@ StreamOut::StreamOut(Device *parent,
                      audio_devices_t devices, const std::string &address)
     : Stream(parent, handle, flagMask),
       mFrameCount(0),
+      mPendingFrameCount(0),
       mEchoReference(NULL),
-      mIsMuted(false)
+      mIsMuted(false),
+      mIsAsync((flagMask & AUDIO_OUTPUT_FLAG_NON_BLOCKING) &&
+               !(flagMask & AUDIO_OUTPUT_FLAG_COMPRESS_OFFLOAD)),
+      mWriter(*this),
+      mWriterPeriodFrames(0),
+      mWriterCpu(-1),
+      mDrainedFrames(0),
+      mFlushedBytes(0),
+      mWriteReadyRequested(false),
+      mDrainRequested(false),
+      mCallback(NULL),
+      mCallbackCookie(NULL)
 {
     setDevices(devices, address);
 }
 
 StreamOut::~StreamOut()
 {
+    mWriter.stop();
     setStandby(true);
 }
 
@@ -89,22 +106,52 @@ status_t StreamOut::write(const void *buffer, size_t &bytes)
         Log::Error() << __FUNCTION__ << ": NULL client buffer";
         return android::BAD_VALUE;
     }
+    recordTransferInterval(AudioTimingHistogram::getNowNs());
     setStandby(false);
+    if (mIsAsync) {
 
-    mStreamLock.readLock();
+        return writeAsync(buffer, bytes);
+    }
+
+    // Never waits for the route manager: while the route is replaced, the stream is not routed.
+    bool routeReady = enterRoute();
     status_t status;
     const ssize_t srcFrames = streamSampleSpec().convertBytesToFrames(bytes);
 
     // Check if the audio route is available for this stream or if the stream is muted
-    if (!isRoutedL() || isMuted()) {
+    if (!routeReady || !isRoutedL() || isMuted()) {
         Log::Warning() << __FUNCTION__ << ": Trashing " << bytes << " bytes for stream " << this
                        << (isMuted() ? ": Stream muted" : ": No route available");
-        mStreamLock.unlock();
+        leaveRoute();
         status = generateSilence(bytes);
         mFrameCount += srcFrames;
         return status;
     }
 
+    std::string error;
+    bool nonBlocking = isNonBlockingL();
+    int64_t deadlineNs = 0;
+    if (nonBlocking) {
+
+        // Waits no longer than the duration of the frames given: the caller paces itself on the
+        // frames reported written.
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        deadlineNs = now.tv_sec * 1000000000LL + now.tv_nsec +
+                     streamSampleSpec().convertFramesToUsec(srcFrames) * 1000LL;
+        if (writePendingFramesL(deadlineNs, error) != android::OK) {
+            Log::Warning() << __FUNCTION__ << ": dropping pending frames: " << error;
+            clearPendingFramesL();
+        }
+        if (!mPendingFrames.empty()) {
+
+            // The device is still full: none of the frames given is taken.
+            leaveRoute();
+            bytes = 0;
+            return android::OK;
+        }
+    }
+
     size_t dstFrames = 0;
     char *dstBuf = NULL;
 
@@ -121,18 +168,52 @@ status_t StreamOut::write(const void *buffer, size_t &bytes)
                                                     "before_conversion");
     }
 
+    // The last converter outputs directly in the ring buffer of the device if possible.
+    void *area = NULL;
+    bool inPlace = beginWriteInPlaceL(srcFrames, area);
+    dstBuf = static_cast<char *>(area);
+
     status = applyAudioConversion(buffer, (void **)&dstBuf, srcFrames, &dstFrames);
 
     if (status != android::OK) {
-        mStreamLock.unlock();
+        if (inPlace) {
+            commitWrite(0, error);
+        }
+        leaveRoute();
         return status;
     }
     Log::Verbose() << __FUNCTION__ << ": srcFrames=" << srcFrames << ", bytes=" << bytes
-                   << " dstFrames=" << dstFrames;
-
-    std::string error;
-
-    status = pcmWriteFrames(dstBuf, dstFrames, error);
+                   << " dstFrames=" << dstFrames << (inPlace ? " in place" : "");
+
+    size_t writtenFrames = dstFrames;
+    int64_t pcmNs = AudioTimingHistogram::getNowNs();
+    if (inPlace) {
+        status = commitWrite(dstFrames, error);
+    } else if (nonBlocking) {
+        status = pcmWriteFramesUntil(dstBuf, writtenFrames, deadlineNs, error);
+        if (status == android::OK && writtenFrames < dstFrames) {
+
+            // Already converted, hence consumed: written first by the next write.
+            const char *left = dstBuf + routeSampleSpec().convertFramesToBytes(writtenFrames);
+            mPendingFrames.assign(left, left + routeSampleSpec().convertFramesToBytes(
+                                      dstFrames - writtenFrames));
+        }
+    } else {
+        status = pcmWriteFrames(dstBuf, dstFrames, error);
+    }
+    mPcmTiming.record(AudioTimingHistogram::getNowNs() - pcmNs);
+    if (status >= 0) {
+        // Published at once to the position: frames taken by the device, left, and given.
+        mPositionSequence++;
+        mLatencyModel.addWrittenFrames(writtenFrames);
+        mPendingFrameCount = routeSampleSpec().convertBytesToFrames(mPendingFrames.size());
+        if (mFrameCount > (std::numeric_limits<uint64_t>::max() - srcFrames)) {
+            Log::Error() << __FUNCTION__ << ": overflow detected, resetting framecount";
+            mFrameCount = 0;
+        }
+        mFrameCount += srcFrames;
+        mPositionSequence++;
+    }
 
     if (status < 0) {
         Log::Error() << __FUNCTION__ << ": write error: " << error
@@ -148,11 +229,13 @@ status_t StreamOut::write(const void *buffer, size_t &bytes)
         AUDIOCOMMS_ASSERT(error.find(strerror(EBADF)) == std::string::npos,
                           "Audio Device handle closed not by Audio HAL."
                           " A corruption might have happenned, investigation required");
-        mStreamLock.unlock();
+        leaveRoute();
         generateSilence(bytes);
         return android::DEAD_OBJECT;
     }
 
+    updateRateControlL(dstFrames);
+
     Log::Verbose() << __FUNCTION__ << ": returns " << streamSampleSpec().convertFramesToBytes(
         AudioUtils::convertSrcToDstInFrames(status, routeSampleSpec(), streamSampleSpec()));
 
@@ -167,18 +250,263 @@ status_t StreamOut::write(const void *buffer, size_t &bytes)
                                                    routeSampleSpec().getChannelCount(),
                                                    "after_conversion");
     }
-    if (mFrameCount > (std::numeric_limits<uint64_t>::max() - srcFrames)) {
-        Log::Error() << __FUNCTION__ << ": overflow detected, resetting framecount";
-        mFrameCount = 0;
-    }
-    mFrameCount += srcFrames;
-    mStreamLock.unlock();
+    leaveRoute();
     return status;
 }
 
+status_t StreamOut::writePendingFramesL(int64_t deadlineNs, std::string &error)
+{
+    if (mPendingFrames.empty()) {
+
+        return android::OK;
+    }
+    size_t writtenFrames = routeSampleSpec().convertBytesToFrames(mPendingFrames.size());
+    int64_t pcmNs = AudioTimingHistogram::getNowNs();
+    status_t status = pcmWriteFramesUntil(&mPendingFrames[0], writtenFrames, deadlineNs, error);
+    mPcmTiming.record(AudioTimingHistogram::getNowNs() - pcmNs);
+    if (status != android::OK) {
+
+        return status;
+    }
+    mPendingFrames.erase(mPendingFrames.begin(),
+                         mPendingFrames.begin() +
+                         routeSampleSpec().convertFramesToBytes(writtenFrames));
+    mPositionSequence++;
+    mLatencyModel.addWrittenFrames(writtenFrames);
+    mPendingFrameCount = routeSampleSpec().convertBytesToFrames(mPendingFrames.size());
+    mPositionSequence++;
+    return android::OK;
+}
+
+void StreamOut::clearPendingFramesL()
+{
+    mPendingFrames.clear();
+    mPendingFrameCount = 0;
+}
+
+status_t StreamOut::writeAsync(const void *buffer, size_t &bytes)
+{
+    if (!mWriter.isStarted()) {
+        status_t status = startWriter();
+        if (status != android::OK) {
+
+            return status;
+        }
+    }
+    const char *frames = static_cast<const char *>(buffer);
+    size_t writtenBytes = 0;
+    for (;;) {
+        size_t chunkBytes = mFifo.write(frames + writtenBytes, bytes - writtenBytes);
+        writtenBytes += chunkBytes;
+        if (chunkBytes > 0 && mFifo.getReadableBytes() <= chunkBytes) {
+
+            // The writer thread drained the fifo before these frames, and sleeps until woken.
+            mWriter.wake();
+        }
+        if (writtenBytes == bytes) {
+
+            break;
+        }
+        if (mCallback != NULL) {
+
+            // Notified once the writer thread makes room. Room made before the request is seen
+            // is taken at once instead.
+            mWriteReadyRequested = true;
+            if (mFifo.getWritableBytes() == 0) {
+
+                break;
+            }
+        } else {
+            // Room is made within a period, at the pace of the output.
+            usleep(mFifoPollUs);
+        }
+    }
+    bytes = writtenBytes;
+    mFrameCount += streamSampleSpec().convertBytesToFrames(writtenBytes);
+    return android::OK;
+}
+
+status_t StreamOut::startWriter()
+{
+    size_t periodBytes = getBufferSize();
+    if (periodBytes == 0) {
+        Log::Error() << __FUNCTION__ << ": no period to size the fifo of stream " << this;
+        return android::NO_INIT;
+    }
+    mWriterPeriodFrames = streamSampleSpec().convertBytesToFrames(periodBytes);
+    mFifo.resize(periodBytes * mFifoPeriodCount);
+    return mWriter.start("StreamOutWriter", mWriterPriority);
+}
+
+uint32_t StreamOut::onWriterCycle()
+{
+    bool routeReady = enterRoute();
+    bool routed = routeReady && isRoutedL();
+    const size_t frameBytes = streamSampleSpec().getFrameSize();
+
+    uint64_t flushedBytes = mFlushedBytes;
+    if (mFifo.getReleasedBytes() < flushedBytes) {
+
+        // The frames queued in the device are dropped with the frames flushed.
+        dropFifoFrames((flushedBytes - mFifo.getReleasedBytes()) / frameBytes);
+        if (routed) {
+            pcmStop();
+        }
+    }
+    uint32_t sleepUs;
+    bool drained = mFifo.getReadableBytes() == 0;
+    if (!routed || isMuted()) {
+
+        // Dropped at the pace of the silence clock, as written without route.
+        size_t frames = std::min(mFifo.getReadableBytes() / frameBytes, mWriterPeriodFrames);
+        dropFifoFrames(frames);
+        sleepUs = 0;
+        if (frames > 0) {
+            int64_t nowNs = AudioSilenceClock::getNowNs();
+            int64_t deadlineNs = mSilenceClock.addFrames(frames,
+                                                         streamSampleSpec().getSampleRate(),
+                                                         nowNs);
+            sleepUs = std::max<int64_t>((deadlineNs - nowNs) / 1000, 1);
+        }
+    } else {
+        sleepUs = writeFifoFramesL();
+        if (drained) {
+            size_t avail;
+            struct timespec timestamp;
+            drained = getFramesAvailable(avail, timestamp) != android::OK ||
+                      avail >= getBufferSizeInFrames();
+        }
+    }
+    leaveRoute();
+
+    if (mWriteReadyRequested && mFifo.getWritableBytes() > 0 &&
+        mWriteReadyRequested.exchange(false)) {
+        mCallback(STREAM_CBK_EVENT_WRITE_READY, NULL, mCallbackCookie);
+    }
+    if (mDrainRequested) {
+        if (drained && mDrainRequested.exchange(false)) {
+            mCallback(STREAM_CBK_EVENT_DRAIN_READY, NULL, mCallbackCookie);
+        } else if (sleepUs == 0) {
+
+            // Checks the device again a period later.
+            sleepUs = streamSampleSpec().convertFramesToUsec(mWriterPeriodFrames);
+        }
+    }
+    return sleepUs;
+}
+
+uint32_t StreamOut::writeFifoFramesL()
+{
+    int32_t cpu = getWriterCpu();
+    if (cpu != mWriterCpu) {
+        AudioWriterThread::bindToCpu(cpu);
+        mWriterCpu = cpu;
+    }
+    const size_t frameBytes = streamSampleSpec().getFrameSize();
+    for (;;) {
+        size_t readableBytes;
+        const void *frames = mFifo.getReadArea(readableBytes);
+        size_t srcFrames = std::min(readableBytes / frameBytes, mWriterPeriodFrames);
+        if (srcFrames == 0) {
+
+            return 0;
+        }
+        size_t avail;
+        struct timespec timestamp;
+        if (getFramesAvailable(avail, timestamp) != android::OK) {
+            Log::Error() << __FUNCTION__ << ": cannot get room in the device of stream " << this;
+            return streamSampleSpec().convertFramesToUsec(mWriterPeriodFrames);
+        }
+        // Room at the rate of the stream, less a frame the resampler may round up.
+        size_t roomFrames = AudioUtils::convertSrcToDstInFrames(avail, routeSampleSpec(),
+                                                                streamSampleSpec());
+        if (routeSampleSpec().getSampleRate() != streamSampleSpec().getSampleRate()) {
+            roomFrames = roomFrames > 0 ? roomFrames - 1 : 0;
+        }
+        if (roomFrames < srcFrames) {
+
+            // Written at the next period boundary, once the device has played the missing room.
+            return std::max<uint32_t>(streamSampleSpec().convertFramesToUsec(srcFrames -
+                                                                             roomFrames),
+                                      mFifoPollUs);
+        }
+        pushEchoReference(frames, srcFrames);
+        if (getDumpObjectBeforeConv() != NULL) {
+            getDumpObjectBeforeConv()->dumpAudioSamples(frames,
+                                                        srcFrames * frameBytes,
+                                                        isOut(),
+                                                        streamSampleSpec().getSampleRate(),
+                                                        streamSampleSpec().getChannelCount(),
+                                                        "before_conversion");
+        }
+        void *dstBuf = NULL;
+        size_t dstFrames = 0;
+        status_t status = applyAudioConversion(frames, &dstBuf, srcFrames, &dstFrames);
+        if (status != android::OK) {
+            Log::Error() << __FUNCTION__ << ": dropping " << srcFrames << " unconverted frames";
+            dropFifoFrames(srcFrames);
+            continue;
+        }
+        std::string error;
+        // Within the room of the device: the write does not wait for the device.
+        int64_t pcmNs = AudioTimingHistogram::getNowNs();
+        status = pcmWriteFrames(dstBuf, dstFrames, error);
+        mPcmTiming.record(AudioTimingHistogram::getNowNs() - pcmNs);
+
+        // Published at once to the position: frames taken by the device, and drained.
+        mPositionSequence++;
+        if (status >= 0) {
+            mLatencyModel.addWrittenFrames(dstFrames);
+        }
+        mFifo.release(srcFrames * frameBytes);
+        mDrainedFrames += srcFrames;
+        mPositionSequence++;
+
+        if (status < 0) {
+            Log::Error() << __FUNCTION__ << ": write error: " << error << " - dropping "
+                         << srcFrames << " frames";
+            if (error.find(strerror(EIO)) != std::string::npos) {
+                // Dump hw registers debug file info in console
+                mParent->printPlatformFwErrorInfo();
+            }
+            return streamSampleSpec().convertFramesToUsec(srcFrames);
+        }
+        updateRateControlL(dstFrames);
+        if (getDumpObjectAfterConv() != NULL) {
+            getDumpObjectAfterConv()->dumpAudioSamples(dstBuf,
+                                                       routeSampleSpec().convertFramesToBytes(
+                                                           dstFrames),
+                                                       isOut(),
+                                                       routeSampleSpec().getSampleRate(),
+                                                       routeSampleSpec().getChannelCount(),
+                                                       "after_conversion");
+        }
+    }
+}
+
+void StreamOut::dropFifoFrames(size_t frames)
+{
+    mPositionSequence++;
+    mFifo.release(streamSampleSpec().convertFramesToBytes(frames));
+    mDrainedFrames += frames;
+    mPositionSequence++;
+}
+
 uint32_t StreamOut::getLatency()
 {
-    return getLatencyMs();
+    int64_t lockNs = AudioTimingHistogram::getNowNs();
+    AutoR lock(mStreamLock);
+    mLockTiming.record(AudioTimingHistogram::getNowNs() - lockNs);
+    if (!isRoutedL()) {
+
+        return getLatencyMs();
+    }
+    // The latency of the route, ring buffer and DSP, plus the group delay of the conversion, plus
+    // the fifo of an asynchronous stream.
+    return getLatencyMs() +
+           routeSampleSpec().convertFramesToUsec(getConversionLatencyFramesL()) / mUsecPerMsec +
+           streamSampleSpec().convertFramesToUsec(
+               streamSampleSpec().convertBytesToFrames(mFifo.getCapacity())) / mUsecPerMsec;
 }
 
 status_t StreamOut::attachRouteL()
@@ -190,6 +518,7 @@ status_t StreamOut::attachRouteL()
     }
     // Need to generate silence?
     uint32_t silenceMs = getOutputSilencePrologMs();
+    size_t prologFrames = 0;
     if (silenceMs) {
 
         // Allocate a 1Ms buffer in stack
@@ -203,16 +532,42 @@ status_t StreamOut::attachRouteL()
             status = pcmWriteFrames(silenceBuffer, bufferSizeInFrames, writeError);
             if (status < 0) {
                 Log::Error() << "Write error when writing silence : " << writeError;
+            } else {
+                prologFrames += bufferSizeInFrames;
             }
         }
     }
+    // Frames played by the device are delayed by the conversion, then by the DSP.
+    mLatencyModel.reset(prologFrames, getConversionLatencyFramesL() +
+                        routeSampleSpec().convertUsecToframes(getDspLatencyUs()));
+
+    // Frames left by a non-blocking write are at most the converted frames of a write: kept
+    // without allocating, as clear and assign do not give the capacity back.
+    mPendingFrames.reserve(routeSampleSpec().convertFramesToBytes(
+                               AudioUtils::convertSrcToDstInFrames(getStreamBufferFramesL(),
+                                                                   streamSampleSpec(),
+                                                                   routeSampleSpec()) + 1));
 
     return android::OK;
 }
 
 status_t StreamOut::detachRouteL()
 {
+    // The position goes on at the pace of the silence clock, from the last position of the device.
+    uint64_t givenFrames = mIsAsync ? mDrainedFrames.load() : mFrameCount.load();
+    uint64_t presentedFrames;
+    struct timespec timestamp;
+    int64_t timeNs;
+    if (getPresentationPositionL(presentedFrames, timestamp) == android::OK) {
+        timeNs = timestamp.tv_sec * 1000000000LL + timestamp.tv_nsec;
+    } else {
+        presentedFrames = givenFrames;
+        timeNs = AudioSilenceClock::getNowNs();
+    }
+    mSilenceClock.start(presentedFrames, timeNs, givenFrames, streamSampleSpec().getSampleRate());
+
     removeEchoReference(mEchoReference);
+    clearPendingFramesL();
     return Stream::detachRouteL();
 }
 
@@ -227,26 +582,60 @@ status_t StreamOut::getPresentationPosition(uint64_t &frames, struct timespec &t
     /** Take the stream lock in read mode to avoid the route manager unrouting this stream,
      * and closing the audio device while dealing with it.
      */
+    int64_t lockNs = AudioTimingHistogram::getNowNs();
     AutoR lock(mStreamLock);
+    mLockTiming.record(AudioTimingHistogram::getNowNs() - lockNs);
     // Check if the audio route is available for this stream (i.e. an audio device is assign to it).
     if (!isRoutedL()) {
-        return android::NOT_ENOUGH_DATA;
-    }
-    size_t avail;
-    status_t error = getFramesAvailable(avail, timestamp);
-    if (error != android::OK) {
-        return error;
+
+        // Presented without device at the pace of the silence clock, if started.
+        int64_t nowNs = AudioSilenceClock::getNowNs();
+        if (!mSilenceClock.getPresentedFrames(nowNs, frames)) {
+            return android::NOT_ENOUGH_DATA;
+        }
+        timestamp.tv_sec = nowNs / 1000000000LL;
+        timestamp.tv_nsec = nowNs % 1000000000LL;
+        return android::OK;
     }
-    size_t kernelBufferSize = getBufferSizeInFrames();
-    // FIXME This calculation is incorrect if there is buffering after app processor
-    int64_t signedFrames = mFrameCount - kernelBufferSize + avail;
+    return getPresentationPositionL(frames, timestamp);
+}
+
+status_t StreamOut::getPresentationPositionL(uint64_t &frames, struct timespec &timestamp) const
+{
+    uint32_t sequence;
+    uint64_t givenFrames;
+    size_t unpresentedFrames;
+    do {
+        // Computed again if the thread writing to the device, the client or the writer thread of
+        // an asynchronous stream, updated the position meanwhile.
+        sequence = mPositionSequence;
+        size_t avail;
+        status_t error = getFramesAvailable(avail, timestamp);
+        if (error != android::OK) {
+            return error;
+        }
+        size_t kernelBufferSize = getBufferSizeInFrames();
+        if (avail > kernelBufferSize) {
+            Log::Error() << __FUNCTION__ << ": avail=" << avail
+                         << " unusual value, please check avail implementation within driver."
+                         << ": kernelBufferSize=" << kernelBufferSize;
+            return android::BAD_VALUE;
+        }
+        // Frames consumed but left for a non-blocking device are not played yet.
+        unpresentedFrames = mLatencyModel.getUnpresentedFrames(kernelBufferSize - avail,
+                                                               mPendingFrameCount);
+        // The frames in the fifo of an asynchronous stream are not given to the device yet.
+        givenFrames = mIsAsync ? mDrainedFrames.load() : mFrameCount.load();
+    } while ((sequence & 1) != 0 || sequence != mPositionSequence);
+
+    // Counted at the rate of the route, given at the rate of the stream.
+    int64_t signedFrames = static_cast<int64_t>(givenFrames) -
+                           static_cast<int64_t>(unpresentedFrames) *
+                           streamSampleSpec().getSampleRate() / routeSampleSpec().getSampleRate();
     if (signedFrames < 0) {
-        Log::Error() << __FUNCTION__ << ": signedFrames=" << signedFrames
-                     << " unusual negative value, please check avail implementation within driver."
-                     << ": mFrameCount=" << mFrameCount
-                     << ": kernelBufferSize=" << kernelBufferSize
-                     << ": avail=" << avail;
-        return android::BAD_VALUE;
+
+        // First frames still on their way to the output.
+        return android::NOT_ENOUGH_DATA;
     }
     frames = signedFrames;
     return android::OK;
@@ -290,14 +679,45 @@ status_t StreamOut::getNextWriteTimestamp(int64_t &ts) const
     return android::OK;
 }
 
+status_t StreamOut::setCallback(stream_callback_t callback, void *cookie)
+{
+    mCallback = callback;
+    mCallbackCookie = cookie;
+    return android::OK;
+}
+
+status_t StreamOut::drain(audio_drain_type_t)
+{
+    if (!mIsAsync || mCallback == NULL) {
+
+        return android::OK;
+    }
+    if (!mWriter.isStarted()) {
+
+        // Nothing written.
+        mCallback(STREAM_CBK_EVENT_DRAIN_READY, NULL, mCallbackCookie);
+        return android::OK;
+    }
+    mDrainRequested = true;
+    mWriter.wake();
+    return android::OK;
+}
+
 status_t StreamOut::flush()
 {
+    if (mIsAsync) {
+
+        // The writer thread, reading the fifo and writing the device, drops the frames.
+        mFlushedBytes = mFifo.getWrittenBytes();
+        mWriter.wake();
+        return android::OK;
+    }
     AutoR lock(mStreamLock);
     if (!isRoutedL()) {
 
         return android::OK;
     }
-
+    clearPendingFramesL();
     return pcmStop();
 }
 
@@ -347,8 +767,14 @@ int StreamOut::getPlaybackDelay(ssize_t frames, struct echo_reference_buffer *bu
     /* adjust render time stamp with delay added by current driver buffer.
      * Add the duration of current frame as we want the render time of the last
      * sample being written.
+     * The frames are delayed by the conversion before the driver buffer, and by the DSP after it.
+     * Kernel and conversion frames are at the rate of the route, the frames written at the rate
+     * of the stream.
      */
-    buffer->delay_ns = streamSampleSpec().convertFramesToUsec(kernelFrames + frames);
+    buffer->delay_ns = (routeSampleSpec().convertFramesToUsec(kernelFrames +
+                                                              getConversionLatencyFramesL()) +
+                        getDspLatencyUs()) * 1000LL +
+                       streamSampleSpec().convertFramesToUsec(frames) * 1000LL;
 
     Log::Verbose() << __FUNCTION__
                    << ": kernel_frames=" << kernelFrames
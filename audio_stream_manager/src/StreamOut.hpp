@@ -17,13 +17,23 @@
 
 #include "Stream.hpp"
 #include "Device.hpp"
+#include <AudioFifo.hpp>
+#include <AudioLatencyModel.hpp>
+#include <AudioWriterThread.hpp>
+#include <atomic>
+#include <vector>
 
 struct echo_reference_itfe;
 
 namespace intel_audio
 {
 
-class StreamOut : public StreamOutInterface, public Stream
+/**
+ * Output stream. A stream opened with the NON_BLOCKING flag is asynchronous: write hands the frames
+ * over to a real time writer thread through a bounded fifo, the writer thread converts them and
+ * feeds the audio device, period after period.
+ */
+class StreamOut : public StreamOutInterface, public Stream, private IAudioWriterClient
 {
 public:
     StreamOut(Device *parent, audio_io_handle_t handle, uint32_t flagMask, audio_devices_t devices,
@@ -41,14 +51,20 @@ public:
     virtual android::status_t getRenderPosition(uint32_t &dspFrames) const;
     virtual android::status_t getNextWriteTimestamp(int64_t &ts) const;
     virtual android::status_t flush();
-    /** @note API not implemented in our Audio HAL */
-    virtual android::status_t setCallback(stream_callback_t, void *) { return android::OK; }
+    /**
+     * @note Used by asynchronous streams only. To be set before the first write, the writer thread
+     * reads it without lock.
+     */
+    virtual android::status_t setCallback(stream_callback_t callback, void *cookie);
     /** @note API implemented in our Audio HAL only for direct streams */
     virtual android::status_t pause();
     /** @note API implemented in our Audio HAL only for direct streams */
     virtual android::status_t resume();
-    /** @note API not implemented in our Audio HAL */
-    virtual android::status_t drain(audio_drain_type_t) { return android::OK; }
+    /**
+     * @note API implemented in our Audio HAL only for asynchronous streams with a callback,
+     * both types waiting for all the frames written to be played.
+     */
+    virtual android::status_t drain(audio_drain_type_t type);
     virtual android::status_t getPresentationPosition(uint64_t &, struct timespec &) const;
     virtual android::status_t setDevice(audio_devices_t device);
 
@@ -85,17 +101,9 @@ public:
      */
     virtual bool isMuted() const { return mIsMuted; }
 
-    void mute()
-    {
-        AutoW lock(mStreamLock);
-        mIsMuted = true;
-    }
+    void mute() { mIsMuted = true; }
 
-    void unMute()
-    {
-        AutoW lock(mStreamLock);
-        mIsMuted = false;
-    }
+    void unMute() { mIsMuted = false; }
 
 protected:
     /**
@@ -136,7 +144,95 @@ private:
      */
     int getPlaybackDelay(ssize_t frames, struct echo_reference_buffer *buffer);
 
-    uint64_t mFrameCount; /**< number of audio frames written by AudioFlinger. */
+    /**
+     * Writes the frames left by the previous write to a non-blocking device, as many as it takes
+     * until the deadline.
+     *
+     * @param[in] deadlineNs time to return by in nanoseconds, monotonic clock.
+     * @param[out] error readable error, if any.
+     *
+     * @return OK if written, error code of the device otherwise.
+     */
+    android::status_t writePendingFramesL(int64_t deadlineNs, std::string &error);
+
+    /** Drops the frames left by the previous write to a non-blocking device. */
+    void clearPendingFramesL();
+
+    /**
+     * Gets the position of the frames presented by the device the stream is routed on.
+     * To be called with the stream lock held.
+     *
+     * @param[out] frames frames presented, at the rate of the stream.
+     * @param[out] timestamp time of the position, monotonic clock.
+     *
+     * @return OK if the position is valid, error code otherwise.
+     */
+    android::status_t getPresentationPositionL(uint64_t &frames, struct timespec &timestamp) const;
+
+    /**
+     * Writes frames in the fifo of an asynchronous stream, starting the writer thread first if
+     * needed. Without callback, waits for room in the fifo, otherwise writes as many frames as it
+     * takes and requests a write ready event for the rest.
+     *
+     * @param[in] buffer frames to write.
+     * @param[in,out] bytes size of the buffer, bytes written.
+     *
+     * @return OK if written, error code otherwise.
+     */
+    android::status_t writeAsync(const void *buffer, size_t &bytes);
+
+    /**
+     * Sizes the fifo of an asynchronous stream after the period of its route, and starts the
+     * writer thread.
+     *
+     * @return OK if started, error code otherwise.
+     */
+    android::status_t startWriter();
+
+    /**
+     * Cycle of the writer thread: drops the frames flushed, writes the frames of the fifo to the
+     * device, or drops them at the pace of the output if not routed, then notifies the client.
+     * From IAudioWriterClient.
+     *
+     * @return time to sleep before the next cycle in microseconds, null to sleep until woken.
+     */
+    virtual uint32_t onWriterCycle();
+
+    /**
+     * Converts and writes the frames of the fifo as long as the device has room for a period.
+     * Writer thread only, route entered.
+     *
+     * @return time to sleep until the device has room for a period in microseconds, null if the
+     *         fifo is empty.
+     */
+    uint32_t writeFifoFramesL();
+
+    /**
+     * Drops frames from the fifo, counted as written to the device. Writer thread only.
+     *
+     * @param[in] frames frames to drop, no more than readable.
+     */
+    void dropFifoFrames(size_t frames);
+
+    /** number of audio frames written by AudioFlinger, read by the position without lock. */
+    std::atomic<uint64_t> mFrameCount;
+
+    /**
+     * Frames converted but not taken by a non-blocking device yet, in the route format.
+     * Only used by the thread of the client, which never calls write and flush at once, and by
+     * the route manager while the route guard is closed: the position reads mPendingFrameCount.
+     */
+    std::vector<char> mPendingFrames;
+
+    /** Frames of mPendingFrames, published with the position. */
+    std::atomic<size_t> mPendingFrameCount;
+
+    /**
+     * Frames written but not presented yet, from the stream to the output of the route. Counted
+     * by the audio thread with the position, reset by the route manager with the route guard
+     * closed and the stream lock held for writing.
+     */
+    AudioLatencyModel mLatencyModel;
 
     struct echo_reference_itfe *mEchoReference; /**< echo reference pointer, for SW AEC effect. */
 
@@ -144,6 +240,29 @@ private:
     static const uint32_t mWaitBeforeRetryUs; /**< Time to wait before retrial. */
     static const uint32_t mUsecPerMsec; /**< time conversion constant. */
 
-    bool mIsMuted;
+    std::atomic<bool> mIsMuted; /**< Read by the audio thread without lock. */
+
+    const bool mIsAsync; /**< Opened non-blocking, written through the writer thread. */
+
+    AudioFifo mFifo; /**< Frames written by the client, taken by the writer thread. */
+    AudioWriterThread mWriter; /**< Writer thread of an asynchronous stream. */
+    size_t mWriterPeriodFrames; /**< Frames written at once by the writer thread. */
+    int32_t mWriterCpu; /**< CPU the writer thread is bound to, negative for any CPU. */
+
+    /** Frames taken from the fifo by the writer thread, written or dropped. */
+    std::atomic<uint64_t> mDrainedFrames;
+
+    /** Bytes of the fifo up to which the frames are flushed, as written when flush is called. */
+    std::atomic<uint64_t> mFlushedBytes;
+
+    std::atomic<bool> mWriteReadyRequested; /**< A write was partial, the client awaits room. */
+    std::atomic<bool> mDrainRequested; /**< The client awaits the frames written to be played. */
+
+    stream_callback_t mCallback; /**< Callback of the client of an asynchronous stream. */
+    void *mCallbackCookie; /**< Cookie given back to the callback. */
+
+    static const uint32_t mFifoPeriodCount; /**< Periods of frames the fifo holds. */
+    static const uint32_t mWriterPriority; /**< SCHED_FIFO priority of the writer thread. */
+    static const uint32_t mFifoPollUs; /**< Time to wait for room by a blocking client. */
 };
 } // namespace intel_audio
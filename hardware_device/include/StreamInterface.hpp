@@ -135,6 +135,42 @@ public:
      * @return OK if succeed, error code else.
      */
     virtual android::status_t removeAudioEffect(effect_handle_t effect) = 0;
+
+    /** Start a stream operating in mmap mode.
+     * createMmapBuffer() must be called before calling start().
+     *
+     * @return OK if succeed, INVALID_OPERATION if the stream has no mmap buffer,
+     *         error code else.
+     */
+    virtual android::status_t start() = 0;
+
+    /** Stop a stream operating in mmap mode. Must be called after start().
+     *
+     * @return OK if succeed, INVALID_OPERATION if the stream has no mmap buffer,
+     *         error code else.
+     */
+    virtual android::status_t stop() = 0;
+
+    /** Retrieve information on the data buffer shared with the audio driver in mmap mode.
+     * The stream must be opened with AUDIO_*_FLAG_MMAP_NOIRQ and attached to an mmap route.
+     *
+     * @param[in] minSizeFrames minimum buffer size requested. The actual buffer size returned
+     *                          can be larger.
+     * @param[out] info address, shared memory file descriptor, size and burst size of the buffer.
+     * @return OK if succeed, INVALID_OPERATION if the stream does not support mmap mode,
+     *         error code else.
+     */
+    virtual android::status_t createMmapBuffer(int32_t minSizeFrames,
+                                               audio_mmap_buffer_info &info) = 0;
+
+    /** Read the position of the audio driver in the mmap buffer, with its timestamp.
+     *
+     * @param[out] position frames transferred by the audio driver since start(), and
+     *                      CLOCK_MONOTONIC time at which they were.
+     * @return OK if succeed, INVALID_OPERATION if the stream is not started in mmap mode,
+     *         error code else.
+     */
+    virtual android::status_t getMmapPosition(audio_mmap_position &position) = 0;
 };
 
 /** Audio output stream interface. */
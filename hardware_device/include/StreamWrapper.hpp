@@ -176,6 +176,12 @@ private:
     static int wrapDrain(audio_stream_out_t *stream, audio_drain_type_t type);
     static int wrapGetPresentationPosition(const audio_stream_out_t *stream,
                                            uint64_t *frames, struct timespec *timestamp);
+    static int wrapStart(const audio_stream_out_t *stream);
+    static int wrapStop(const audio_stream_out_t *stream);
+    static int wrapCreateMmapBuffer(const audio_stream_out_t *stream, int32_t minSizeFrames,
+                                    audio_mmap_buffer_info *info);
+    static int wrapGetMmapPosition(const audio_stream_out_t *stream,
+                                   audio_mmap_position *position);
 };
 
 /** Audio input stream wrapper. */
@@ -193,6 +199,12 @@ private:
     static uint32_t wrapGetInputFramesLost(audio_stream_in_t *stream);
     static int wrapGetCapturePosition(const audio_stream_in *stream,
                                                int64_t *frames, int64_t *time);
+    static int wrapStart(const audio_stream_in_t *stream);
+    static int wrapStop(const audio_stream_in_t *stream);
+    static int wrapCreateMmapBuffer(const audio_stream_in_t *stream, int32_t minSizeFrames,
+                                    audio_mmap_buffer_info *info);
+    static int wrapGetMmapPosition(const audio_stream_in_t *stream,
+                                   audio_mmap_position *position);
 };
 
 template <class Trait>
@@ -40,10 +40,10 @@ OutputStreamWrapper::OutputStreamWrapper(StreamOutInterface *cppOutputStream)
     stream.resume = wrapResume;
     stream.drain = wrapDrain;
     stream.get_presentation_position = wrapGetPresentationPosition;
-    stream.start = NULL;
-    stream.stop = NULL;
-    stream.create_mmap_buffer = NULL;
-    stream.get_mmap_position = NULL;
+    stream.start = wrapStart;
+    stream.stop = wrapStop;
+    stream.create_mmap_buffer = wrapCreateMmapBuffer;
+    stream.get_mmap_position = wrapGetMmapPosition;
 }
 
 uint32_t OutputStreamWrapper::wrapGetLatency(const audio_stream_out_t *stream)
@@ -116,6 +116,34 @@ int OutputStreamWrapper::wrapGetPresentationPosition(const audio_stream_out_t *s
         getCppStream(stream).getPresentationPosition(*frames, *timestamp));
 }
 
+int OutputStreamWrapper::wrapStart(const audio_stream_out_t *stream)
+{
+    return static_cast<int>(getCppStream(stream).start());
+}
+
+int OutputStreamWrapper::wrapStop(const audio_stream_out_t *stream)
+{
+    return static_cast<int>(getCppStream(stream).stop());
+}
+
+int OutputStreamWrapper::wrapCreateMmapBuffer(const audio_stream_out_t *stream,
+                                              int32_t minSizeFrames, audio_mmap_buffer_info *info)
+{
+    if (info == NULL || minSizeFrames <= 0) {
+        return -EINVAL;
+    }
+    return static_cast<int>(getCppStream(stream).createMmapBuffer(minSizeFrames, *info));
+}
+
+int OutputStreamWrapper::wrapGetMmapPosition(const audio_stream_out_t *stream,
+                                             audio_mmap_position *position)
+{
+    if (position == NULL) {
+        return -EINVAL;
+    }
+    return static_cast<int>(getCppStream(stream).getMmapPosition(*position));
+}
+
 //
 // InputStreamWrapper class C/C++ wrapping
 //
@@ -129,10 +157,10 @@ InputStreamWrapper::InputStreamWrapper(StreamInInterface *cppInputStream)
     stream.read = wrapRead;
     stream.get_input_frames_lost = wrapGetInputFramesLost;
     stream.get_capture_position = wrapGetCapturePosition;
-    stream.start = NULL;
-    stream.stop = NULL;
-    stream.create_mmap_buffer = NULL;
-    stream.get_mmap_position = NULL;
+    stream.start = wrapStart;
+    stream.stop = wrapStop;
+    stream.create_mmap_buffer = wrapCreateMmapBuffer;
+    stream.get_mmap_position = wrapGetMmapPosition;
 }
 
 int InputStreamWrapper::wrapSetGain(audio_stream_in_t *stream, float gain)
@@ -160,5 +188,33 @@ int InputStreamWrapper::wrapGetCapturePosition(const audio_stream_in *stream,
     return static_cast<int>(getCppStream(stream).getCapturePosition(*frames, *time));
 }
 
+int InputStreamWrapper::wrapStart(const audio_stream_in_t *stream)
+{
+    return static_cast<int>(getCppStream(stream).start());
+}
+
+int InputStreamWrapper::wrapStop(const audio_stream_in_t *stream)
+{
+    return static_cast<int>(getCppStream(stream).stop());
+}
+
+int InputStreamWrapper::wrapCreateMmapBuffer(const audio_stream_in_t *stream, int32_t minSizeFrames,
+                                             audio_mmap_buffer_info *info)
+{
+    if (info == NULL || minSizeFrames <= 0) {
+        return -EINVAL;
+    }
+    return static_cast<int>(getCppStream(stream).createMmapBuffer(minSizeFrames, *info));
+}
+
+int InputStreamWrapper::wrapGetMmapPosition(const audio_stream_in_t *stream,
+                                            audio_mmap_position *position)
+{
+    if (position == NULL) {
+        return -EINVAL;
+    }
+    return static_cast<int>(getCppStream(stream).getMmapPosition(*position));
+}
+
 
 } // namespace intel_audio
@@ -42,6 +42,22 @@ public:
     }
     virtual android::status_t addAudioEffect(effect_handle_t effect) { return android::OK; }
     virtual android::status_t removeAudioEffect(effect_handle_t effect) { return android::OK; }
+    virtual android::status_t start() { return android::OK; }
+    virtual android::status_t stop() { return android::OK; }
+    virtual android::status_t createMmapBuffer(int32_t minSizeFrames,
+                                               audio_mmap_buffer_info &info)
+    {
+        info.shared_memory_fd = 42;
+        info.buffer_size_frames = minSizeFrames;
+        info.burst_size_frames = 96;
+        return android::OK;
+    }
+    virtual android::status_t getMmapPosition(audio_mmap_position &position)
+    {
+        position.position_frames = 1024;
+        position.time_nanoseconds = 123456789;
+        return android::OK;
+    }
 
     virtual uint32_t getLatency() { return 888u; }
     virtual android::status_t setVolume(float left, float right) { return android::OK; }
@@ -84,6 +100,22 @@ public:
     }
     virtual android::status_t addAudioEffect(effect_handle_t effect) { return android::OK; }
     virtual android::status_t removeAudioEffect(effect_handle_t effect) { return android::OK; }
+    virtual android::status_t start() { return android::OK; }
+    virtual android::status_t stop() { return android::OK; }
+    virtual android::status_t createMmapBuffer(int32_t minSizeFrames,
+                                               audio_mmap_buffer_info &info)
+    {
+        info.shared_memory_fd = 42;
+        info.buffer_size_frames = minSizeFrames;
+        info.burst_size_frames = 48;
+        return android::OK;
+    }
+    virtual android::status_t getMmapPosition(audio_mmap_position &position)
+    {
+        position.position_frames = 2048;
+        position.time_nanoseconds = 123456789;
+        return android::OK;
+    }
 
     virtual android::status_t getPresentationPosition(uint64_t &frames,
                                                       struct timespec &timestamp) const
@@ -93,6 +125,10 @@ public:
     virtual android::status_t setGain(float gain) { return android::OK; }
     virtual android::status_t read(void *buffer, size_t &bytes) { return android::OK; }
     virtual uint32_t getInputFramesLost() const { return 15; }
+    virtual android::status_t getCapturePosition(int64_t &frames, int64_t &time)
+    {
+        return android::OK;
+    }
 };
 
 } // namespace intel_audio
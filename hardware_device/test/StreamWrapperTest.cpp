@@ -125,4 +125,33 @@ TEST_F(StreamWrapperTest, InputWrapper)
     EXPECT_EQ(mCInStream->get_input_frames_lost(mCInStream), static_cast<uint32_t>(15));
 }
 
+TEST_F(StreamWrapperTest, MmapWrappers)
+{
+    audio_mmap_buffer_info info;
+    audio_mmap_position position;
+
+    EXPECT_EQ(mCOutStream->create_mmap_buffer(mCOutStream, 192, &info), 0);
+    EXPECT_EQ(info.shared_memory_fd, 42);
+    EXPECT_EQ(info.buffer_size_frames, 192);
+    EXPECT_EQ(info.burst_size_frames, 96);
+    EXPECT_EQ(mCOutStream->start(mCOutStream), 0);
+    EXPECT_EQ(mCOutStream->get_mmap_position(mCOutStream, &position), 0);
+    EXPECT_EQ(position.position_frames, 1024);
+    EXPECT_EQ(mCOutStream->stop(mCOutStream), 0);
+
+    EXPECT_EQ(mCInStream->create_mmap_buffer(mCInStream, 96, &info), 0);
+    EXPECT_EQ(info.buffer_size_frames, 96);
+    EXPECT_EQ(info.burst_size_frames, 48);
+    EXPECT_EQ(mCInStream->start(mCInStream), 0);
+    EXPECT_EQ(mCInStream->get_mmap_position(mCInStream, &position), 0);
+    EXPECT_EQ(position.position_frames, 2048);
+    EXPECT_EQ(position.time_nanoseconds, 123456789);
+    EXPECT_EQ(mCInStream->stop(mCInStream), 0);
+
+    // Invalid arguments are rejected by the wrappers
+    EXPECT_EQ(mCOutStream->create_mmap_buffer(mCOutStream, 0, &info), -EINVAL);
+    EXPECT_EQ(mCOutStream->create_mmap_buffer(mCOutStream, 192, NULL), -EINVAL);
+    EXPECT_EQ(mCInStream->get_mmap_position(mCInStream, NULL), -EINVAL);
+}
+
 }
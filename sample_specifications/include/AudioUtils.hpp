@@ -89,6 +89,8 @@ public:
      *
      * @return format in tiny alsa domain.
      *         It returns PCM_FORMAT_S16_LE format in case of unrecognized tiny alsa format.
+     *         Note that tiny alsa has no float format, so AUDIO_FORMAT_PCM_FLOAT falls back on
+     *         the default format: routes working in float must rely on the reformatter.
      */
     static pcm_format convertHalToTinyFormat(audio_format_t format);
 
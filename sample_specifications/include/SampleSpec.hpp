@@ -53,7 +53,8 @@ public:
     {
 
         return !memcmp(mSampleSpec, right.mSampleSpec, sizeof(mSampleSpec)) &&
-               (mChannelsPolicy == right.mChannelsPolicy);
+               !memcmp(mChannelsPolicy, right.mChannelsPolicy,
+                       getChannelCount() * sizeof(mChannelsPolicy[0]));
     }
 
     /**
@@ -138,9 +139,12 @@ public:
     }
 
     void setChannelsPolicy(const std::vector<ChannelsPolicy> &channelsPolicy);
-    const std::vector<ChannelsPolicy> &getChannelsPolicy() const
+
+    /** @return policy of each channel, built on each call: not for the audio path. */
+    std::vector<ChannelsPolicy> getChannelsPolicy() const
     {
-        return mChannelsPolicy;
+        return std::vector<ChannelsPolicy>(mChannelsPolicy,
+                                           mChannelsPolicy + getChannelCount());
     }
     ChannelsPolicy getChannelsPolicy(uint32_t channelIndex) const;
 
@@ -227,6 +231,12 @@ public:
     android::status_t dump(const int fd, bool isOut, int spaces) const;
 
 private:
+    static const uint32_t mUsecPerSec = 1000000; /**<  to convert sec to-from microseconds. */
+    static const uint32_t mDefaultChannels = 2; /**< default channel used is stereo. */
+    static const uint32_t mDefaultFormat = AUDIO_FORMAT_PCM_16_BIT; /**< default format is 16bits.*/
+    static const uint32_t mDefaultRate = 48000; /**< default rate is 48 kHz. */
+    static const uint32_t mMaxChannels = 32; /**< supports until 32 channels. */
+
     uint32_t mSampleSpec[NbSampleSpecItems]; /**< Array of sample spec items:
                                               *         -channel number
                                               *         -format
@@ -234,13 +244,11 @@ private:
 
     audio_channel_mask_t mChannelMask; /**< Bit field that defines the channels used. */
 
-    std::vector<ChannelsPolicy> mChannelsPolicy; /**< channels policy array. */
-
-    static const uint32_t mUsecPerSec = 1000000; /**<  to convert sec to-from microseconds. */
-    static const uint32_t mDefaultChannels = 2; /**< default channel used is stereo. */
-    static const uint32_t mDefaultFormat = AUDIO_FORMAT_PCM_16_BIT; /**< default format is 16bits.*/
-    static const uint32_t mDefaultRate = 48000; /**< default rate is 48 kHz. */
-    static const uint32_t mMaxChannels = 32; /**< supports until 32 channels. */
+    /**
+     * Policy of each channel, held in place so that copying a sample spec, e.g. on the audio
+     * path, never allocates. Only the first channel count entries are meaningful.
+     */
+    ChannelsPolicy mChannelsPolicy[mMaxChannels];
 };
 
 } // namespace intel_audio
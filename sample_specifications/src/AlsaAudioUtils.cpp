@@ -37,6 +37,12 @@ audio_format_t AlsaAudioUtils::convertAlsaToHalFormat(snd_pcm_format_t format)
     case SND_PCM_FORMAT_S32_LE:
         convFormat = AUDIO_FORMAT_PCM_32_BIT;
         break;
+    case SND_PCM_FORMAT_S24_3LE:
+        convFormat = AUDIO_FORMAT_PCM_24_BIT_PACKED;
+        break;
+    case SND_PCM_FORMAT_FLOAT_LE:
+        convFormat = AUDIO_FORMAT_PCM_FLOAT;
+        break;
     default:
         Log::Error() << __FUNCTION__ << ": format not recognized";
         convFormat = AUDIO_FORMAT_INVALID;
@@ -59,6 +65,12 @@ snd_pcm_format_t AlsaAudioUtils::convertHalToAlsaFormat(audio_format_t format)
     case AUDIO_FORMAT_PCM_32_BIT:
         convFormat = SND_PCM_FORMAT_S32_LE;
         break;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        convFormat = SND_PCM_FORMAT_S24_3LE; /* SND_PCM_FORMAT_S24_3LE is 24-bits in 3-bytes */
+        break;
+    case AUDIO_FORMAT_PCM_FLOAT:
+        convFormat = SND_PCM_FORMAT_FLOAT_LE;
+        break;
     default:
         Log::Error() << __FUNCTION__ << ": format not recognized";
         convFormat = SND_PCM_FORMAT_S16_LE;
@@ -81,6 +81,9 @@ audio_format_t AudioUtils::convertTinyToHalFormat(pcm_format format)
     case PCM_FORMAT_S32_LE:
         convFormat = AUDIO_FORMAT_PCM_32_BIT;
         break;
+    case PCM_FORMAT_S24_3LE:
+        convFormat = AUDIO_FORMAT_PCM_24_BIT_PACKED;
+        break;
     default:
         Log::Error() << __FUNCTION__ << ": format not recognized";
         convFormat = AUDIO_FORMAT_INVALID;
@@ -104,6 +107,9 @@ pcm_format AudioUtils::convertHalToTinyFormat(audio_format_t format)
     case AUDIO_FORMAT_PCM_32_BIT:
         convFormat = PCM_FORMAT_S32_LE;
         break;
+    case AUDIO_FORMAT_PCM_24_BIT_PACKED:
+        convFormat = PCM_FORMAT_S24_3LE; /* PCM_FORMAT_S24_3LE is 24-bits in 3-bytes */
+        break;
     default:
         Log::Error() << __FUNCTION__ << ": format not recognized";
         convFormat = PCM_FORMAT_S16_LE;
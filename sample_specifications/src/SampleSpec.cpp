@@ -19,6 +19,7 @@
 #include <typeconverter/TypeConverter.hpp>
 #include <AudioCommsAssert.hpp>
 #include <utilities/Log.hpp>
+#include <algorithm>
 #include <stdint.h>
 #include <errno.h>
 #include <limits>
@@ -58,8 +59,9 @@ void SampleSpec::setSampleSpecItem(SampleSpecItem sampleSpecItem, uint32_t value
         AUDIOCOMMS_ASSERT(value < mMaxChannels, "Max channel number reached");
 
         // Reset all the channels policy to copy by default
-        mChannelsPolicy.clear();
-        mChannelsPolicy = std::vector<ChannelsPolicy>(value, Copy);
+        for (uint32_t channel = 0; channel < mMaxChannels; channel++) {
+            mChannelsPolicy[channel] = Copy;
+        }
     }
     mSampleSpec[sampleSpecItem] = value;
 }
@@ -70,12 +72,12 @@ void SampleSpec::setChannelsPolicy(const vector<ChannelsPolicy> &channelsPolicy)
         Log::Warning() << __FUNCTION__ << ": Cannot set requested channel policy";
         return;
     }
-    mChannelsPolicy = channelsPolicy;
+    std::copy(channelsPolicy.begin(), channelsPolicy.end(), mChannelsPolicy);
 }
 
 SampleSpec::ChannelsPolicy SampleSpec::getChannelsPolicy(uint32_t channelIndex) const
 {
-    AUDIOCOMMS_ASSERT(channelIndex < mChannelsPolicy.size(),
+    AUDIOCOMMS_ASSERT(channelIndex < getChannelCount(),
                       "request of channel policy outside channel numbers");
     return mChannelsPolicy[channelIndex];
 }
@@ -138,7 +140,8 @@ bool SampleSpec::isSampleSpecItemEqual(SampleSpecItem sampleSpecItem,
     }
 
     return (sampleSpecItem != ChannelCountSampleSpecItem) ||
-           ssSrc.getChannelsPolicy() == ssDst.getChannelsPolicy();
+           std::equal(ssSrc.mChannelsPolicy, ssSrc.mChannelsPolicy + ssSrc.getChannelCount(),
+                      ssDst.mChannelsPolicy);
 }
 
 android::status_t SampleSpec::dump(const int fd, bool isOut, int spaces) const
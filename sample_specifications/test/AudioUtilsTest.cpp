@@ -69,6 +69,8 @@ TEST(AudioUtils, formatConversion)
     EXPECT_EQ(AUDIO_FORMAT_PCM_16_BIT, AudioUtils::convertTinyToHalFormat(PCM_FORMAT_S16_LE));
     EXPECT_EQ(AUDIO_FORMAT_PCM_8_24_BIT, AudioUtils::convertTinyToHalFormat(PCM_FORMAT_S24_LE));
     EXPECT_EQ(AUDIO_FORMAT_PCM_32_BIT, AudioUtils::convertTinyToHalFormat(PCM_FORMAT_S32_LE));
+    EXPECT_EQ(AUDIO_FORMAT_PCM_24_BIT_PACKED,
+              AudioUtils::convertTinyToHalFormat(PCM_FORMAT_S24_3LE));
 
     // Tiny format not supported by AudioHAL
     EXPECT_EQ(AUDIO_FORMAT_INVALID, AudioUtils::convertTinyToHalFormat(PCM_FORMAT_MAX));
@@ -80,6 +82,11 @@ TEST(AudioUtils, formatConversion)
     // Valid AudioHAL format
     EXPECT_EQ(PCM_FORMAT_S16_LE, AudioUtils::convertHalToTinyFormat(AUDIO_FORMAT_PCM_16_BIT));
     EXPECT_EQ(PCM_FORMAT_S24_LE, AudioUtils::convertHalToTinyFormat(AUDIO_FORMAT_PCM_8_24_BIT));
+    EXPECT_EQ(PCM_FORMAT_S24_3LE,
+              AudioUtils::convertHalToTinyFormat(AUDIO_FORMAT_PCM_24_BIT_PACKED));
+
+    // No float format in Tiny alsa, returns default
+    EXPECT_EQ(PCM_FORMAT_S16_LE, AudioUtils::convertHalToTinyFormat(AUDIO_FORMAT_PCM_FLOAT));
 
     // Invalid format, returns default
     EXPECT_EQ(PCM_FORMAT_S16_LE, AudioUtils::convertHalToTinyFormat(AUDIO_FORMAT_PCM_8_BIT));
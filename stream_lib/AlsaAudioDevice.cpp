@@ -20,6 +20,9 @@
 #include <SampleSpec.hpp>
 #include <AudioCommsAssert.hpp>
 #include <utilities/Log.hpp>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
 
 using audio_comms::utilities::Log;
 using namespace std;
@@ -33,9 +36,15 @@ android::status_t AlsaAudioDevice::open(const char *deviceName, uint32_t /*devic
     AUDIOCOMMS_ASSERT(mPcmDevice == NULL, "alsa device already opened");
     AUDIOCOMMS_ASSERT(deviceName != NULL, "Null card name");
 
+    if (routeConfig.mmap) {
+        Log::Error() << __FUNCTION__ << ": mmap mode not supported by alsa device " << deviceName;
+        return android::INVALID_OPERATION;
+    }
     snd_pcm_stream_t stream = (isOut ? SND_PCM_STREAM_PLAYBACK : SND_PCM_STREAM_CAPTURE);
 
-    int err = snd_pcm_open(&mPcmDevice, deviceName, stream, SND_PCM_ASYNC);
+    mNonBlocking = routeConfig.nonBlocking;
+    int err = snd_pcm_open(&mPcmDevice, deviceName, stream,
+                           mNonBlocking ? SND_PCM_NONBLOCK : SND_PCM_ASYNC);
     if (err) {
         Log::Error() << __FUNCTION__
                      << ": Cannot open alsa (" << deviceName
@@ -45,12 +54,32 @@ android::status_t AlsaAudioDevice::open(const char *deviceName, uint32_t /*devic
         goto close_device;
     }
 
-    err = setPcmParams(stream, routeConfig, SND_PCM_ACCESS_RW_INTERLEAVED, 0);
+    mIsOut = isOut;
+    mRate = routeConfig.getRate();
+    mZeroCopy = routeConfig.zeroCopy;
+    mStartThreshold = routeConfig.startThreshold;
+    err = setPcmParams(stream, routeConfig,
+                       mZeroCopy ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED,
+                       0);
 
     if (err) {
         Log::Debug() << __FUNCTION__ << " unable to configure properly the pcm device";
         goto close_device;
     }
+    mBufferSize = getBufferSizeInFrames();
+    if (mNonBlocking) {
+        int count = snd_pcm_poll_descriptors_count(mPcmDevice);
+        if (count <= 0) {
+            Log::Error() << __FUNCTION__ << ": no descriptor to poll for non-blocking mode";
+            goto close_device;
+        }
+        mPollFds.resize(count);
+        if (snd_pcm_poll_descriptors(mPcmDevice, &mPollFds[0], count) != count) {
+            Log::Error() << __FUNCTION__ << ": unable to get the descriptors to poll";
+            goto close_device;
+        }
+    }
+    resetClock();
     Log::Debug() << __FUNCTION__ << ": pcm device successfully initialized: "
                  << "\n\t card (" << deviceName
                  << ") \n\t config (rate=" << routeConfig.getRate()
@@ -198,6 +227,7 @@ int AlsaAudioDevice::setPcmParams(snd_pcm_stream_t stream, const MixPortConfig &
                      << snd_strerror(err);
         return err;
     }
+    selectAudioTimestampType(params);
 
     /* get the current swparams */
     err = snd_pcm_sw_params_current(mPcmDevice, swparams);
@@ -228,6 +258,17 @@ int AlsaAudioDevice::setPcmParams(snd_pcm_stream_t stream, const MixPortConfig &
                      << snd_strerror(err);
         return err;
     }
+    /* timestamp the position on the monotonic clock, as the timestamps of the framework */
+    err = snd_pcm_sw_params_set_tstamp_mode(mPcmDevice, swparams, SND_PCM_TSTAMP_ENABLE);
+    if (err >= 0) {
+        err = snd_pcm_sw_params_set_tstamp_type(mPcmDevice, swparams,
+                                                SND_PCM_TSTAMP_TYPE_MONOTONIC);
+    }
+    if (err < 0) {
+        Log::Error() << __FUNCTION__ << " Unable to set timestamp mode for " << s << " :"
+                     << snd_strerror(err);
+        return err;
+    }
     /* write the parameters to the playback device */
     err = snd_pcm_sw_params(mPcmDevice, swparams);
     if (err < 0) {
@@ -238,6 +279,69 @@ int AlsaAudioDevice::setPcmParams(snd_pcm_stream_t stream, const MixPortConfig &
     return 0;
 }
 
+void AlsaAudioDevice::selectAudioTimestampType(const snd_pcm_hw_params_t *params)
+{
+    // Most accurate first. Plugins without driver, as ioplug, support none of them.
+    static const snd_pcm_audio_tstamp_type_t types[] = {
+        SND_PCM_AUDIO_TSTAMP_TYPE_LINK_ABSOLUTE,
+        SND_PCM_AUDIO_TSTAMP_TYPE_LINK,
+        SND_PCM_AUDIO_TSTAMP_TYPE_LINK_ESTIMATED
+    };
+    mLinkTimestamps = false;
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (snd_pcm_hw_params_supports_audio_ts_type(params, types[i])) {
+            mLinkTimestamps = true;
+            mAudioTimestampType = types[i];
+            break;
+        }
+    }
+    Log::Debug() << __FUNCTION__ << ": "
+                 << (mLinkTimestamps ? "link audio timestamps" : "timestamps from clock model");
+}
+
+void AlsaAudioDevice::addApplFrames(snd_pcm_sframes_t frames) const
+{
+    std::lock_guard<std::mutex> lock(mClockLock);
+    mApplFrames += frames;
+}
+
+void AlsaAudioDevice::resetClock() const
+{
+    std::lock_guard<std::mutex> lock(mClockLock);
+    mApplFrames = 0;
+    mClockModel.reset();
+}
+
+int AlsaAudioDevice::recover(int err, int silent) const
+{
+    if (err != -EPIPE && err != -ESTRPIPE) {
+
+        return snd_pcm_recover(mPcmDevice, err, silent);
+    }
+    // Prepared again, the position restarts from zero.
+    resetClock();
+
+    // The trigger timestamp of a device stopped on xrun or suspended is the time it stopped.
+    int64_t xrunNs = 0;
+    snd_pcm_status_t *status;
+    snd_pcm_status_alloca(&status);
+    if (snd_pcm_status(mPcmDevice, status) == 0) {
+        snd_htimestamp_t trigger;
+        snd_pcm_status_get_trigger_htstamp(status, &trigger);
+        xrunNs = trigger.tv_sec * 1000000000ll + trigger.tv_nsec;
+    }
+    int recovered = snd_pcm_recover(mPcmDevice, err, silent);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t recoveredNs = now.tv_sec * 1000000000ll + now.tv_nsec;
+    if (xrunNs <= 0 || xrunNs > recoveredNs) {
+        xrunNs = recoveredNs;
+    }
+    mXrunStatistics.addXrun(xrunNs, recoveredNs,
+                            XrunStatistics::estimateLostFrames(recoveredNs - xrunNs, mRate, mIsOut,
+                                                               mBufferSize));
+    return recovered;
+}
 
 bool AlsaAudioDevice::isOpened()
 {
@@ -250,9 +354,11 @@ android::status_t AlsaAudioDevice::close()
         return android::DEAD_OBJECT;
     }
     Log::Debug() << __FUNCTION__;
+    setBlocking();
     snd_pcm_drain(mPcmDevice);
     snd_pcm_close(mPcmDevice);
     mPcmDevice = NULL;
+    mPollFds.clear();
 
     return android::OK;
 }
@@ -264,17 +370,23 @@ android::status_t AlsaAudioDevice::pcmReadFrames(void *buffer, size_t frames, st
         return android::BAD_VALUE;
     }
 
+    if (mNonBlocking) {
+
+        return transferAll(buffer, frames, error);
+    }
     snd_pcm_sframes_t frames_read;
-    frames_read = snd_pcm_readi(mPcmDevice, (char *)buffer, frames);
+    frames_read = mZeroCopy ? snd_pcm_mmap_readi(mPcmDevice, buffer, frames) :
+                              snd_pcm_readi(mPcmDevice, (char *)buffer, frames);
 
     if (frames_read < 0) {
         error = snd_strerror(frames_read);
-        if (snd_pcm_recover(mPcmDevice, frames_read, 0) != android::OK) {
+        if (recover(frames_read, 0) != android::OK) {
             Log::Error() << "Unable to recover from pcm_read, error: " << snd_strerror(frames_read);
         }
         return frames_read;
     }
 
+    addApplFrames(frames_read);
     if ((size_t)frames_read < frames) {
         Log::Warning() << " We read " << frames_read << " instead of " << frames;
     }
@@ -284,19 +396,121 @@ android::status_t AlsaAudioDevice::pcmReadFrames(void *buffer, size_t frames, st
 
 android::status_t AlsaAudioDevice::pcmWriteFrames(void *buffer, ssize_t frames, string &error) const
 {
-    snd_pcm_sframes_t frames_written = snd_pcm_writei(mPcmDevice, (char *)buffer, frames);
+    if (mNonBlocking) {
+
+        return transferAll(buffer, frames > 0 ? frames : 0, error);
+    }
+    snd_pcm_sframes_t frames_written =
+        mZeroCopy ? snd_pcm_mmap_writei(mPcmDevice, buffer, frames) :
+                    snd_pcm_writei(mPcmDevice, (char *)buffer, frames);
     if (frames_written < 0) {
         error = snd_strerror(frames_written);
-        if (snd_pcm_recover(mPcmDevice, frames_written, 0) != android::OK) {
+        if (recover(frames_written, 0) != android::OK) {
             Log::Error() << "Unable to recover from pcm_write, error: " << snd_strerror(
                 frames_written);
         }
         return frames_written;
     }
+    addApplFrames(frames_written);
 
     return android::OK;
 }
 
+android::status_t AlsaAudioDevice::pcmWriteFramesUntil(void *buffer, size_t &frames,
+                                                       int64_t deadlineNs, string &error) const
+{
+    if (!mNonBlocking) {
+
+        return pcmWriteFrames(buffer, frames, error);
+    }
+    return transferUntil(buffer, frames, deadlineNs, error);
+}
+
+android::status_t AlsaAudioDevice::transferUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                                 string &error) const
+{
+    char *data = static_cast<char *>(buffer);
+    size_t transferred = 0;
+    android::status_t status = android::OK;
+    while (transferred < frames) {
+        char *chunk = data + snd_pcm_frames_to_bytes(mPcmDevice, transferred);
+        size_t remaining = frames - transferred;
+        snd_pcm_sframes_t ret;
+        if (mIsOut) {
+            ret = mZeroCopy ? snd_pcm_mmap_writei(mPcmDevice, chunk, remaining) :
+                  snd_pcm_writei(mPcmDevice, chunk, remaining);
+        } else {
+            ret = mZeroCopy ? snd_pcm_mmap_readi(mPcmDevice, chunk, remaining) :
+                  snd_pcm_readi(mPcmDevice, chunk, remaining);
+        }
+        if (ret > 0) {
+            addApplFrames(ret);
+            transferred += ret;
+            continue;
+        }
+        if (ret < 0 && ret != -EAGAIN) {
+            // Prepared again after an xrun or interrupted, the transfer goes on within the
+            // deadline.
+            error = snd_strerror(ret);
+            if (recover(ret, 0) < 0) {
+                Log::Error() << __FUNCTION__ << ": unable to recover, error: " << error;
+                status = ret;
+                break;
+            }
+            continue;
+        }
+        // No room or frames yet: polled for until the deadline.
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t leftNs = deadlineNs - (now.tv_sec * 1000000000ll + now.tv_nsec);
+        if (leftNs <= 0) {
+
+            break;
+        }
+        int err = poll(&mPollFds[0], mPollFds.size(), (leftNs + 999999) / 1000000);
+        if (err < 0 && errno != EINTR) {
+            error = strerror(errno);
+            status = -errno;
+            break;
+        }
+        // Events are checked for the driver to update its state; an xrun is reported by the
+        // next transfer.
+        unsigned short revents = 0;
+        if (err > 0) {
+            snd_pcm_poll_descriptors_revents(mPcmDevice, &mPollFds[0], mPollFds.size(), &revents);
+        }
+    }
+    frames = transferred;
+    return status;
+}
+
+android::status_t AlsaAudioDevice::transferAll(void *buffer, size_t frames, string &error) const
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t deadlineNs = now.tv_sec * 1000000000ll + now.tv_nsec + mWaitTimeoutMs * 1000000ll;
+    size_t transferred = frames;
+    android::status_t status = transferUntil(buffer, transferred, deadlineNs, error);
+    if (status != android::OK) {
+
+        return status;
+    }
+    if (transferred < frames) {
+        error = "timeout";
+        Log::Error() << __FUNCTION__ << ": timeout, transferred " << transferred << " of "
+                     << frames << " frames";
+        return android::TIMED_OUT;
+    }
+    return android::OK;
+}
+
+void AlsaAudioDevice::setBlocking() const
+{
+    if (mNonBlocking) {
+        snd_pcm_nonblock(mPcmDevice, 0);
+    }
+}
+
 uint32_t AlsaAudioDevice::getBufferSizeInBytes() const
 {
     return snd_pcm_frames_to_bytes(mPcmDevice, getBufferSizeInFrames());
@@ -315,24 +529,57 @@ size_t AlsaAudioDevice::getBufferSizeInFrames() const
 
 android::status_t AlsaAudioDevice::getFramesAvailable(size_t &avail, struct timespec &tStamp) const
 {
-#if 0
-    snd_pcm_uframes_t availFrames;
-    int err =  snd_pcm_htimestamp(mPcmDevice, &availFrames, &tStamp);
-    if (err < 0) {
-        Log::Error() << __FUNCTION__ << ": Unable to get available frames";
+    if (mLinkTimestamps) {
+
+        // Avail and timestamp of the same update of the position, made by the driver.
+        snd_pcm_status_t *status;
+        snd_pcm_status_alloca(&status);
+        snd_pcm_audio_tstamp_config_t config;
+        config.type_requested = mAudioTimestampType;
+        config.report_delay = 0;
+        snd_pcm_status_set_audio_htstamp_config(status, &config);
+        int err = snd_pcm_status(mPcmDevice, status);
+        if (err < 0) {
+            Log::Error() << __FUNCTION__ << ": Unable to get status: " << snd_strerror(err);
+            return android::INVALID_OPERATION;
+        }
+        avail = snd_pcm_status_get_avail(status);
+        snd_pcm_status_get_htstamp(status, &tStamp);
+        return android::OK;
+    }
+    // snd_pcm_htimestamp is not supported by ioplug: the position is read, then timestamped by
+    // the clock model of the device.
+    snd_pcm_sframes_t availFrames = snd_pcm_avail(mPcmDevice);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (availFrames < 0) {
+        Log::Error() << __FUNCTION__ << ": Unable to get available frames: "
+                     << snd_strerror(availFrames);
         return android::INVALID_OPERATION;
     }
     avail = availFrames;
-#endif
-    // @todo snd_pcm_htimestamp not supported by ioplug so emulating the behavior
-    clock_gettime(CLOCK_MONOTONIC, &tStamp);
-    snd_pcm_uframes_t availFrames = snd_pcm_avail(mPcmDevice);
-    avail = availFrames;
+    int64_t nowNs = now.tv_sec * 1000000000ll + now.tv_nsec;
+    if (snd_pcm_state(mPcmDevice) != SND_PCM_STATE_RUNNING) {
+
+        // The position does not move, the clock of the device is not measured.
+        std::lock_guard<std::mutex> lock(mClockLock);
+        mClockModel.reset();
+        tStamp = now;
+        return android::OK;
+    }
+    std::lock_guard<std::mutex> lock(mClockLock);
+    // Frames the hardware transferred since prepared, from the frames queued.
+    int64_t hwFrames = mIsOut ? mApplFrames - static_cast<int64_t>(mBufferSize - availFrames) :
+                       mApplFrames + availFrames;
+    int64_t timestampNs = mClockModel.update(hwFrames, nowNs);
+    tStamp.tv_sec = timestampNs / 1000000000ll;
+    tStamp.tv_nsec = timestampNs % 1000000000ll;
     return android::OK;
 }
 
 android::status_t AlsaAudioDevice::pcmStop() const
 {
+    setBlocking();
     int err = snd_pcm_drain(mPcmDevice);
     Log::Error() << __FUNCTION__ << " draining samples returned " << snd_strerror(err);
     err = snd_pcm_close(mPcmDevice);
@@ -341,4 +588,155 @@ android::status_t AlsaAudioDevice::pcmStop() const
     return err;
 }
 
+android::status_t AlsaAudioDevice::pcmPrepare() const
+{
+    if (mPcmDevice == NULL) {
+
+        return android::DEAD_OBJECT;
+    }
+    if (mIsOut) {
+        setBlocking();
+        snd_pcm_drain(mPcmDevice);
+        if (mNonBlocking) {
+            snd_pcm_nonblock(mPcmDevice, 1);
+        }
+    } else {
+        snd_pcm_drop(mPcmDevice);
+    }
+    int err = snd_pcm_prepare(mPcmDevice);
+    if (err < 0) {
+        Log::Error() << __FUNCTION__ << ": prepare failed: " << snd_strerror(err);
+        return android::INVALID_OPERATION;
+    }
+    resetClock();
+    return android::OK;
+}
+
+android::status_t AlsaAudioDevice::pcmStart() const
+{
+    Log::Error() << __FUNCTION__ << ": mmap mode not supported";
+    return android::INVALID_OPERATION;
+}
+
+android::status_t AlsaAudioDevice::getMmapBuffer(audio_mmap_buffer_info &/*info*/) const
+{
+    Log::Error() << __FUNCTION__ << ": mmap mode not supported";
+    return android::INVALID_OPERATION;
+}
+
+android::status_t AlsaAudioDevice::getMmapPosition(audio_mmap_position &/*position*/) const
+{
+    return android::INVALID_OPERATION;
+}
+
+android::status_t AlsaAudioDevice::waitMmapFrames(size_t frames)
+{
+    for (;;) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(mPcmDevice);
+        if (avail < 0) {
+            int err = recover(avail, 1);
+            if (err < 0) {
+                Log::Error() << __FUNCTION__ << ": unable to recover, error " << snd_strerror(err);
+                return err;
+            }
+            continue;
+        }
+        if (static_cast<size_t>(avail) >= frames) {
+
+            return android::OK;
+        }
+        if (snd_pcm_state(mPcmDevice) != SND_PCM_STATE_RUNNING) {
+
+            // Capture not started yet, or playback buffer full below the start threshold.
+            int err = snd_pcm_start(mPcmDevice);
+            if (err < 0) {
+                Log::Error() << __FUNCTION__ << ": start failed, error " << snd_strerror(err);
+                return err;
+            }
+            continue;
+        }
+        int err = snd_pcm_wait(mPcmDevice, mWaitTimeoutMs);
+        if (err == 0) {
+            Log::Error() << __FUNCTION__ << ": timeout waiting for " << frames << " frames";
+            return android::TIMED_OUT;
+        }
+        if (err < 0 && (err = recover(err, 1)) < 0) {
+            Log::Error() << __FUNCTION__ << ": unable to recover, error " << snd_strerror(err);
+            return err;
+        }
+    }
+}
+
+android::status_t AlsaAudioDevice::beginMmapTransfer(void *&area, size_t &frames)
+{
+    if (!mZeroCopy) {
+
+        return android::INVALID_OPERATION;
+    }
+    android::status_t status = waitMmapFrames(frames);
+    if (status != android::OK) {
+
+        return status;
+    }
+    const snd_pcm_channel_area_t *areas = NULL;
+    snd_pcm_uframes_t contiguous = frames;
+    int err = snd_pcm_mmap_begin(mPcmDevice, &areas, &mMmapOffset, &contiguous);
+    if (err < 0) {
+        Log::Error() << __FUNCTION__ << ": mmap failed, error " << snd_strerror(err);
+        return err;
+    }
+    // Interleaved access: all channels share the area of the first one.
+    area = static_cast<char *>(areas[0].addr) + (areas[0].first + mMmapOffset * areas[0].step) / 8;
+    frames = contiguous;
+    return android::OK;
+}
+
+android::status_t AlsaAudioDevice::beginWrite(void *&area, size_t &frames)
+{
+    return beginMmapTransfer(area, frames);
+}
+
+android::status_t AlsaAudioDevice::commitWrite(size_t frames, string &error)
+{
+    snd_pcm_sframes_t committed = snd_pcm_mmap_commit(mPcmDevice, mMmapOffset, frames);
+    if (committed < 0 || static_cast<size_t>(committed) != frames) {
+        int err = committed < 0 ? committed : -EPIPE;
+        error = snd_strerror(err);
+        recover(err, 1);
+        return err;
+    }
+    addApplFrames(committed);
+    if (snd_pcm_state(mPcmDevice) == SND_PCM_STATE_PREPARED) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(mPcmDevice);
+        int err = 0;
+        if ((avail >= 0) && (getBufferSizeInFrames() - avail >= mStartThreshold) &&
+            ((err = snd_pcm_start(mPcmDevice)) < 0)) {
+            error = snd_strerror(err);
+            return err;
+        }
+    }
+    return android::OK;
+}
+
+android::status_t AlsaAudioDevice::beginRead(const void *&area, size_t &frames)
+{
+    void *buffer = NULL;
+    android::status_t status = beginMmapTransfer(buffer, frames);
+    area = buffer;
+    return status;
+}
+
+android::status_t AlsaAudioDevice::commitRead(size_t frames, string &error)
+{
+    snd_pcm_sframes_t committed = snd_pcm_mmap_commit(mPcmDevice, mMmapOffset, frames);
+    if (committed < 0 || static_cast<size_t>(committed) != frames) {
+        int err = committed < 0 ? committed : -EPIPE;
+        error = snd_strerror(err);
+        recover(err, 1);
+        return err;
+    }
+    addApplFrames(committed);
+    return android::OK;
+}
+
 } // namespace intel_audio
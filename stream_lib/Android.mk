@@ -24,8 +24,19 @@ LOCAL_PATH := $(call my-dir)
 component_export_include_dir := $(LOCAL_PATH)/include
 
 component_src_files :=  \
+    AudioArena.cpp \
+    AudioClockModel.cpp \
+    AudioDevicePool.cpp \
+    AudioFifo.cpp \
+    AudioLatencyModel.cpp \
+    AudioRouteGuard.cpp \
+    AudioSilenceClock.cpp \
+    AudioTimingHistogram.cpp \
+    AudioWriterThread.cpp \
     IoStream.cpp \
-    TinyAlsaAudioDevice.cpp 
+    SimulatedAudioDevice.cpp \
+    TinyAlsaAudioDevice.cpp \
+    XrunStatistics.cpp
 
 ifeq ($(USE_ALSA_LIB), 1)
 component_src_files += AlsaAudioDevice.cpp
@@ -111,3 +122,48 @@ LOCAL_MODULE_TAGS := optional
 include $(OPTIONAL_QUALITY_COVERAGE_JUMPER)
 
 include $(BUILD_STATIC_LIBRARY)
+
+
+#######################################################################
+# Component Functional Test Host Build
+# Runs on the virtual clock of the simulated audio device, no sound hardware needed.
+
+ifeq (ENABLE_HOST_VERSION,1)
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := stream_lib_fcttest_host
+LOCAL_MODULE_OWNER := intel
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES := \
+    test/AudioArenaTest.cpp \
+    test/AudioClockModelTest.cpp \
+    test/AudioDevicePoolTest.cpp \
+    test/AudioFifoTest.cpp \
+    test/AudioLatencyModelTest.cpp \
+    test/AudioRouteGuardTest.cpp \
+    test/AudioSilenceClockTest.cpp \
+    test/AudioTimingHistogramTest.cpp \
+    test/AudioWriterThreadTest.cpp \
+    test/SimulatedAudioDeviceTest.cpp \
+    test/XrunStatisticsTest.cpp
+LOCAL_C_INCLUDES := \
+    $(component_includes_dir_host) \
+    bionic/libc/kernel/common \
+    external/gtest/include
+LOCAL_CFLAGS := $(component_cflags)
+LOCAL_STATIC_LIBRARIES := \
+    libstream_static_host \
+    libaudioroutemanager_host \
+    libaudioconversion_static_host \
+    $(component_static_lib_host) \
+    libgtest_host \
+    libgtest_main_host \
+    liblog
+
+include $(OPTIONAL_QUALITY_COVERAGE_JUMPER)
+# Cannot use $(BUILD_HOST_NATIVE_TEST) because of compilation flag
+# misalignment against gtest mk files
+
+include $(BUILD_HOST_EXECUTABLE)
+endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioArena.hpp"
+#include <utilities/Log.hpp>
+#include <algorithm>
+#include <stdlib.h>
+
+using audio_comms::utilities::Log;
+
+namespace intel_audio
+{
+
+const size_t AudioArena::mAlignment;
+
+AudioArena::AudioArena()
+    : mBlock(NULL), mCapacity(0), mUsedBytes(0)
+{
+}
+
+AudioArena::~AudioArena()
+{
+    free(mBlock);
+}
+
+android::status_t AudioArena::reserve(size_t bytes)
+{
+    mUsedBytes = 0;
+    if (bytes <= mCapacity) {
+
+        return android::OK;
+    }
+    free(mBlock);
+    mBlock = NULL;
+    mCapacity = 0;
+
+    void *block = NULL;
+    if (posix_memalign(&block, mAlignment, getAlignedSize(bytes)) != 0) {
+        Log::Error() << __FUNCTION__ << ": could not reserve " << bytes << " bytes";
+        return android::NO_MEMORY;
+    }
+    mBlock = static_cast<char *>(block);
+    mCapacity = getAlignedSize(bytes);
+    return android::OK;
+}
+
+void *AudioArena::allocate(size_t bytes)
+{
+    size_t alignedBytes = getAlignedSize(bytes);
+    if (alignedBytes > mCapacity - mUsedBytes) {
+
+        return NULL;
+    }
+    void *buffer = mBlock + mUsedBytes;
+    mUsedBytes += alignedBytes;
+    return buffer;
+}
+
+void AudioArena::swap(AudioArena &other)
+{
+    std::swap(mBlock, other.mBlock);
+    std::swap(mCapacity, other.mCapacity);
+    std::swap(mUsedBytes, other.mUsedBytes);
+}
+
+} // namespace intel_audio
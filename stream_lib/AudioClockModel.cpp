@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioClockModel.hpp"
+#include <algorithm>
+
+namespace intel_audio
+{
+
+AudioClockModel::AudioClockModel()
+{
+    reset();
+}
+
+void AudioClockModel::reset()
+{
+    mMeasures = 0;
+    mNext = 0;
+    mLastNs = 0;
+}
+
+int64_t AudioClockModel::update(int64_t frames, int64_t timeNs)
+{
+    mFrames[mNext] = frames;
+    mTimesNs[mNext] = timeNs;
+    mNext = (mNext + 1) % mMaxMeasures;
+    if (mMeasures < mMaxMeasures) {
+        mMeasures++;
+    }
+
+    int64_t estimateNs = timeNs;
+    if (mMeasures >= mMinMeasures) {
+
+        // Least squares fit of the frames against the time, relative to the last measure to keep
+        // the precision of the sums.
+        double sumT = 0, sumF = 0, sumTT = 0, sumTF = 0;
+        for (size_t i = 0; i < mMeasures; i++) {
+            double t = mTimesNs[i] - timeNs;
+            double f = mFrames[i] - frames;
+            sumT += t;
+            sumF += f;
+            sumTT += t * t;
+            sumTF += t * f;
+        }
+        double varT = mMeasures * sumTT - sumT * sumT;
+        double slope = varT > 0 ? (mMeasures * sumTF - sumT * sumF) / varT : 0;
+        if (slope > 0) {
+
+            // A position read is never ahead of the device: the line goes through the measure
+            // the most ahead, i.e. the one read the soonest after an update of the position.
+            double intercept = mFrames[0] - frames - slope * (mTimesNs[0] - timeNs);
+            for (size_t i = 1; i < mMeasures; i++) {
+                intercept = std::max(intercept,
+                                     mFrames[i] - frames - slope * (mTimesNs[i] - timeNs));
+            }
+            // Time at which the line reaches the position measured.
+            estimateNs = timeNs - static_cast<int64_t>(intercept / slope);
+        }
+    }
+    mLastNs = std::max(mLastNs, std::min(estimateNs, timeNs));
+    return mLastNs;
+}
+
+} // namespace intel_audio
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "AudioDevicePool"
+
+#include "AudioDevicePool.hpp"
+#include "AudioDevice.hpp"
+#include <utilities/Log.hpp>
+#include <utils/String8.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+using audio_comms::utilities::Log;
+
+namespace intel_audio
+{
+
+static int64_t getMonotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+AudioDevicePool::AudioDevicePool()
+    : mOpens(0), mOpenNs(0), mReuses(0), mParkNs(0), mPrewarmHits(0), mPrewarmMisses(0)
+{
+}
+
+android::status_t AudioDevicePool::open(IAudioDevice &device, const char *cardName,
+                                        uint32_t deviceId, const MixPortConfig &config, bool isOut)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    size_t index = findL(device);
+    if (index < mDevices.size()) {
+        PooledDevice &pooled = mDevices[index];
+        if (pooled.parked && pooled.cardName == cardName && pooled.deviceId == deviceId &&
+            pooled.isOut == isOut && isSameConfig(pooled.config, config)) {
+
+            Log::Debug() << __FUNCTION__ << ": reusing device " << deviceId << " of card "
+                         << cardName;
+            if (pooled.prewarmed) {
+                mPrewarmHits++;
+                pooled.prewarmed = false;
+            }
+            pooled.parked = false;
+            mReuses++;
+            return android::OK;
+        }
+        releaseL(index);
+    }
+    return openL(device, cardName, deviceId, config, isOut);
+}
+
+android::status_t AudioDevicePool::close(IAudioDevice &device, uint32_t idleTimeoutMs,
+                                         int64_t nowNs)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    size_t index = findL(device);
+    if (index == mDevices.size()) {
+
+        // Not opened through the pool.
+        return device.close();
+    }
+    if (idleTimeoutMs == 0) {
+        android::status_t status = device.close();
+        mDevices.erase(mDevices.begin() + index);
+        return status;
+    }
+    return parkL(index, idleTimeoutMs, nowNs);
+}
+
+android::status_t AudioDevicePool::prewarm(IAudioDevice &device, const char *cardName,
+                                           uint32_t deviceId, const MixPortConfig &config,
+                                           bool isOut, uint32_t idleTimeoutMs, int64_t nowNs)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (findL(device) < mDevices.size()) {
+
+        // Already opened, or parked.
+        return android::INVALID_OPERATION;
+    }
+    android::status_t status = openL(device, cardName, deviceId, config, isOut);
+    if (status != android::OK) {
+
+        return status;
+    }
+    size_t index = mDevices.size() - 1;
+    mDevices[index].prewarmed = true;
+    return parkL(index, idleTimeoutMs, nowNs);
+}
+
+int64_t AudioDevicePool::releaseIdle(int64_t nowNs)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t nextExpiryNs = -1;
+    for (size_t i = mDevices.size(); i-- > 0;) {
+        if (!mDevices[i].parked) {
+
+            continue;
+        }
+        if (mDevices[i].expiryNs <= nowNs) {
+            Log::Debug() << __FUNCTION__ << ": closing idle device " << mDevices[i].deviceId
+                         << " of card " << mDevices[i].cardName;
+            releaseL(i);
+        } else if (nextExpiryNs < 0 || mDevices[i].expiryNs < nextExpiryNs) {
+            nextExpiryNs = mDevices[i].expiryNs;
+        }
+    }
+    // Rounded up, not to wake up before the expiry.
+    return nextExpiryNs < 0 ? -1 : (nextExpiryNs - nowNs + 999999) / 1000000;
+}
+
+void AudioDevicePool::releaseAll()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    for (size_t i = mDevices.size(); i-- > 0;) {
+        if (mDevices[i].parked) {
+            releaseL(i);
+        }
+    }
+}
+
+size_t AudioDevicePool::getParkedCount() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    size_t parked = 0;
+    for (const auto &pooled : mDevices) {
+        if (pooled.parked) {
+            parked++;
+        }
+    }
+    return parked;
+}
+
+uint32_t AudioDevicePool::getReuseCount() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mReuses;
+}
+
+uint32_t AudioDevicePool::getPrewarmHitCount() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mPrewarmHits;
+}
+
+uint32_t AudioDevicePool::getPrewarmMissCount() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mPrewarmMisses;
+}
+
+int64_t AudioDevicePool::getSavedNs() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mOpens == 0) {
+
+        return 0;
+    }
+    return mReuses * (mOpenNs / mOpens) - mParkNs;
+}
+
+android::status_t AudioDevicePool::dump(const int fd, int spaces) const
+{
+    int64_t savedNs = getSavedNs();
+    std::lock_guard<std::mutex> lock(mLock);
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    android::String8 result;
+
+    snprintf(buffer, SIZE, "%*sDevice Pool:\n", spaces, "");
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- Opened: %u, mean open time: %lld us\n", spaces + 4, "", mOpens,
+             static_cast<long long>(mOpens == 0 ? 0 : mOpenNs / mOpens / 1000));
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- Reused: %u, reroute time saved: %lld us\n", spaces + 4, "",
+             mReuses, static_cast<long long>(savedNs / 1000));
+    result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- Prewarmed: used %u, closed unused %u\n", spaces + 4, "",
+             mPrewarmHits, mPrewarmMisses);
+    result.append(buffer);
+    int64_t nowNs = getMonotonicNs();
+    for (const auto &pooled : mDevices) {
+        if (!pooled.parked) {
+
+            continue;
+        }
+        snprintf(buffer, SIZE, "%*s- Parked: card %s device %u %s, closed in %lld ms\n",
+                 spaces + 4, "", pooled.cardName.c_str(), pooled.deviceId,
+                 pooled.isOut ? "playback" : "capture",
+                 static_cast<long long>((pooled.expiryNs - nowNs) / 1000000));
+        result.append(buffer);
+    }
+    write(fd, result.string(), result.size());
+    return android::OK;
+}
+
+bool AudioDevicePool::isSameConfig(const MixPortConfig &opened, const MixPortConfig &requested)
+{
+    return opened.getRate() == requested.getRate() &&
+           opened.getFormat() == requested.getFormat() &&
+           opened.getChannelMask() == requested.getChannelMask() &&
+           opened.periodSize == requested.periodSize &&
+           opened.periodCount == requested.periodCount &&
+           opened.startThreshold == requested.startThreshold &&
+           opened.stopThreshold == requested.stopThreshold &&
+           opened.silenceThreshold == requested.silenceThreshold &&
+           opened.availMin == requested.availMin &&
+           opened.mmap == requested.mmap &&
+           opened.zeroCopy == requested.zeroCopy &&
+           opened.nonBlocking == requested.nonBlocking;
+}
+
+size_t AudioDevicePool::findL(const IAudioDevice &device) const
+{
+    size_t index = 0;
+    while (index < mDevices.size() && mDevices[index].device != &device) {
+        index++;
+    }
+    return index;
+}
+
+void AudioDevicePool::releaseL(size_t index)
+{
+    if (mDevices[index].prewarmed) {
+        mPrewarmMisses++;
+    }
+    mDevices[index].device->close();
+    mDevices.erase(mDevices.begin() + index);
+}
+
+android::status_t AudioDevicePool::openL(IAudioDevice &device, const char *cardName,
+                                         uint32_t deviceId, const MixPortConfig &config,
+                                         bool isOut)
+{
+    // A PCM is opened once at a time: another device parked on it is closed first.
+    for (size_t i = mDevices.size(); i-- > 0;) {
+        const PooledDevice &pooled = mDevices[i];
+        if (pooled.parked && pooled.cardName == cardName && pooled.deviceId == deviceId &&
+            pooled.isOut == isOut) {
+            releaseL(i);
+        }
+    }
+    int64_t startNs = getMonotonicNs();
+    android::status_t status = device.open(cardName, deviceId, config, isOut);
+    if (status != android::OK) {
+
+        return status;
+    }
+    mOpens++;
+    mOpenNs += getMonotonicNs() - startNs;
+
+    PooledDevice pooled;
+    pooled.device = &device;
+    pooled.cardName = cardName;
+    pooled.deviceId = deviceId;
+    pooled.isOut = isOut;
+    pooled.config = config;
+    pooled.parked = false;
+    pooled.prewarmed = false;
+    pooled.expiryNs = 0;
+    mDevices.push_back(pooled);
+    return android::OK;
+}
+
+android::status_t AudioDevicePool::parkL(size_t index, uint32_t idleTimeoutMs, int64_t nowNs)
+{
+    int64_t startNs = getMonotonicNs();
+    if (mDevices[index].device->pcmPrepare() != android::OK) {
+        Log::Warning() << __FUNCTION__ << ": unable to prepare device "
+                       << mDevices[index].deviceId << ", closing it";
+        releaseL(index);
+        return android::OK;
+    }
+    mParkNs += getMonotonicNs() - startNs;
+    mDevices[index].parked = true;
+    mDevices[index].expiryNs = nowNs + idleTimeoutMs * 1000000ll;
+    return android::OK;
+}
+
+} // namespace intel_audio
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioFifo.hpp"
+#include <algorithm>
+#include <string.h>
+
+namespace intel_audio
+{
+
+AudioFifo::AudioFifo()
+    : mWrittenBytes(0), mReleasedBytes(0)
+{
+}
+
+void AudioFifo::resize(size_t bytes)
+{
+    mBuffer.assign(bytes, 0);
+    mWrittenBytes.store(0, std::memory_order_relaxed);
+    mReleasedBytes.store(0, std::memory_order_relaxed);
+}
+
+size_t AudioFifo::write(const void *buffer, size_t bytes)
+{
+    bytes = std::min(bytes, getWritableBytes());
+    if (bytes == 0) {
+
+        return 0;
+    }
+    uint64_t written = mWrittenBytes.load(std::memory_order_relaxed);
+    size_t back = written % mBuffer.size();
+    size_t firstBytes = std::min(bytes, mBuffer.size() - back);
+    memcpy(&mBuffer[back], buffer, firstBytes);
+    memcpy(&mBuffer[0], static_cast<const char *>(buffer) + firstBytes, bytes - firstBytes);
+    // Published once copied.
+    mWrittenBytes.store(written + bytes, std::memory_order_release);
+    return bytes;
+}
+
+size_t AudioFifo::getWritableBytes() const
+{
+    return mBuffer.size() - getReadableBytes();
+}
+
+size_t AudioFifo::getReadableBytes() const
+{
+    // Released count first: the written count read after it is never behind it.
+    uint64_t released = mReleasedBytes.load(std::memory_order_acquire);
+    return mWrittenBytes.load(std::memory_order_acquire) - released;
+}
+
+const void *AudioFifo::getReadArea(size_t &bytes) const
+{
+    if (mBuffer.empty()) {
+
+        bytes = 0;
+        return NULL;
+    }
+    size_t front = mReleasedBytes.load(std::memory_order_relaxed) % mBuffer.size();
+    bytes = std::min(getReadableBytes(), mBuffer.size() - front);
+    return &mBuffer[front];
+}
+
+void AudioFifo::release(size_t bytes)
+{
+    bytes = std::min(bytes, getReadableBytes());
+    mReleasedBytes.store(mReleasedBytes.load(std::memory_order_relaxed) + bytes,
+                         std::memory_order_release);
+}
+
+} // namespace intel_audio
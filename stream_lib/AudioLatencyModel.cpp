@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioLatencyModel.hpp"
+
+namespace intel_audio
+{
+
+AudioLatencyModel::AudioLatencyModel()
+    : mWrittenFrames(0), mPrologFrames(0), mDelayFrames(0)
+{
+}
+
+void AudioLatencyModel::reset(size_t prologFrames, size_t delayFrames)
+{
+    mWrittenFrames = prologFrames;
+    mPrologFrames = prologFrames;
+    mDelayFrames = delayFrames;
+}
+
+void AudioLatencyModel::addWrittenFrames(size_t frames)
+{
+    mWrittenFrames += frames;
+}
+
+size_t AudioLatencyModel::getUnpresentedFrames(size_t queuedFrames, size_t heldFrames) const
+{
+    uint64_t writtenFrames = mWrittenFrames;
+    if (queuedFrames > writtenFrames) {
+
+        // No more frames queued than written since reset.
+        queuedFrames = writtenFrames;
+    }
+    // The prolog is played first: the frames queued are the last ones written.
+    uint64_t playedFrames = writtenFrames - queuedFrames;
+    size_t queuedPrologFrames = playedFrames < mPrologFrames ? mPrologFrames - playedFrames : 0;
+    return queuedFrames - queuedPrologFrames + heldFrames + mDelayFrames;
+}
+
+} // namespace intel_audio
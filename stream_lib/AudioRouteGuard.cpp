@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioRouteGuard.hpp"
+#include <unistd.h>
+
+namespace intel_audio
+{
+
+AudioRouteGuard::AudioRouteGuard()
+    : mThreadsIn(0), mClosed(false), mClosedEntries(0)
+{
+}
+
+bool AudioRouteGuard::enter() const
+{
+    // Counted in before checking the guard, the closing thread checks in the reverse order: either
+    // the guard is seen closed, or the closing thread sees this thread in and waits for it.
+    mThreadsIn.fetch_add(1, std::memory_order_seq_cst);
+    if (mClosed.load(std::memory_order_seq_cst)) {
+
+        mClosedEntries.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AudioRouteGuard::leave() const
+{
+    mThreadsIn.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void AudioRouteGuard::close()
+{
+    mClosed.store(true, std::memory_order_seq_cst);
+    // A thread in for a transfer leaves within a period of the device.
+    while (mThreadsIn.load(std::memory_order_seq_cst) != 0) {
+        usleep(mGracePollUs);
+    }
+}
+
+void AudioRouteGuard::open()
+{
+    mClosed.store(false, std::memory_order_seq_cst);
+}
+
+uint32_t AudioRouteGuard::getClosedEntryCount() const
+{
+    return mClosedEntries.load(std::memory_order_relaxed);
+}
+
+} // namespace intel_audio
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioSilenceClock.hpp"
+#include <errno.h>
+#include <time.h>
+
+namespace intel_audio
+{
+
+static const int64_t gNsPerSec = 1000000000LL;
+
+AudioSilenceClock::AudioSilenceClock()
+    : mStarted(false), mOriginFrames(0), mOriginNs(0), mWrittenFrames(0), mRate(0)
+{
+}
+
+void AudioSilenceClock::start(uint64_t presentedFrames, int64_t timeNs, uint64_t writtenFrames,
+                              uint32_t rate)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mOriginFrames = presentedFrames < writtenFrames ? presentedFrames : writtenFrames;
+    mOriginNs = timeNs;
+    mWrittenFrames = writtenFrames;
+    mRate = rate;
+    mStarted = rate != 0;
+}
+
+void AudioSilenceClock::stop()
+{
+    mStarted = false;
+}
+
+int64_t AudioSilenceClock::addFrames(size_t frames, uint32_t rate, int64_t nowNs)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mStarted) {
+        mOriginFrames = mWrittenFrames;
+        mOriginNs = nowNs;
+        mRate = rate;
+        mStarted = rate != 0;
+        if (!mStarted) {
+
+            return nowNs;
+        }
+    }
+    // Due once the previous frames are presented.
+    int64_t dueNs = getDeadlineNsL();
+    mWrittenFrames += frames;
+    int64_t deadlineNs = getDeadlineNsL();
+    if (nowNs - dueNs > deadlineNs - dueNs) {
+
+        // Late by more than the duration of the frames, e.g. idle meanwhile: the previous frames
+        // are presented, these ones from now.
+        mOriginFrames = mWrittenFrames - frames;
+        mOriginNs = nowNs;
+        deadlineNs = getDeadlineNsL();
+    }
+    return deadlineNs;
+}
+
+bool AudioSilenceClock::getPresentedFrames(int64_t nowNs, uint64_t &frames) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mStarted) {
+
+        return false;
+    }
+    int64_t elapsedNs = nowNs > mOriginNs ? nowNs - mOriginNs : 0;
+    uint64_t elapsedFrames = elapsedNs / gNsPerSec * mRate +
+                             elapsedNs % gNsPerSec * mRate / gNsPerSec;
+    frames = mOriginFrames + elapsedFrames;
+    if (frames > mWrittenFrames) {
+        frames = mWrittenFrames;
+    }
+    return true;
+}
+
+int64_t AudioSilenceClock::getDeadlineNsL() const
+{
+    uint64_t frames = mWrittenFrames - mOriginFrames;
+    return mOriginNs + static_cast<int64_t>(frames / mRate * gNsPerSec +
+                                            frames % mRate * gNsPerSec / mRate);
+}
+
+int64_t AudioSilenceClock::getNowNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * gNsPerSec + now.tv_nsec;
+}
+
+void AudioSilenceClock::sleepUntil(int64_t deadlineNs)
+{
+    struct timespec deadline;
+    deadline.tv_sec = deadlineNs / gNsPerSec;
+    deadline.tv_nsec = deadlineNs % gNsPerSec;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+    }
+}
+
+} // namespace intel_audio
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioTimingHistogram.hpp"
+#include <sstream>
+#include <time.h>
+
+using std::string;
+
+namespace intel_audio
+{
+
+/** Bits of the sub bucket in a duration, below its most significant bit. */
+static const uint32_t gSubBucketBits = 3;
+
+AudioTimingHistogram::AudioTimingHistogram()
+    : mMaxUs(0)
+{
+    static_assert((1u << gSubBucketBits) == mSubBuckets, "sub buckets not matching their bits");
+    for (size_t i = 0; i < mBucketCount; i++) {
+        mBuckets[i] = 0;
+    }
+}
+
+void AudioTimingHistogram::record(int64_t durationNs)
+{
+    int64_t durationUs = durationNs > 0 ? durationNs / 1000 : 0;
+    uint32_t us = durationUs < UINT32_MAX ? static_cast<uint32_t>(durationUs) : UINT32_MAX;
+    mBuckets[getBucket(us)].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t maxUs = mMaxUs.load(std::memory_order_relaxed);
+    while (us > maxUs &&
+           !mMaxUs.compare_exchange_weak(maxUs, us, std::memory_order_relaxed)) {
+    }
+}
+
+uint32_t AudioTimingHistogram::getCount() const
+{
+    uint32_t count = 0;
+    for (size_t i = 0; i < mBucketCount; i++) {
+        count += mBuckets[i].load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+uint32_t AudioTimingHistogram::getPercentileUs(uint32_t percent) const
+{
+    // Read once: the buckets may be recorded meanwhile.
+    uint32_t buckets[mBucketCount];
+    uint64_t count = 0;
+    for (size_t i = 0; i < mBucketCount; i++) {
+        buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+        count += buckets[i];
+    }
+    if (count == 0) {
+
+        return 0;
+    }
+    uint64_t rank = (count * (percent < 100 ? percent : 100) + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint32_t maxUs = mMaxUs.load(std::memory_order_relaxed);
+    uint64_t below = 0;
+    for (size_t i = 0; i < mBucketCount; i++) {
+        below += buckets[i];
+        if (below >= rank) {
+
+            uint32_t bucketMaxUs = getBucketMaxUs(i);
+            return bucketMaxUs < maxUs ? bucketMaxUs : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+string AudioTimingHistogram::toString() const
+{
+    std::ostringstream stream;
+    stream << getCount() << "|" << getPercentileUs(50) << "|" << getPercentileUs(90) << "|"
+           << getPercentileUs(99) << "|" << getMaxUs();
+    return stream.str();
+}
+
+int64_t AudioTimingHistogram::getNowNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+size_t AudioTimingHistogram::getBucket(uint32_t durationUs)
+{
+    if (durationUs < mSubBuckets) {
+
+        return durationUs;
+    }
+    // Power of two of the duration, then its next bits.
+    uint32_t msb = 31 - __builtin_clz(durationUs);
+    size_t bucket = (msb - gSubBucketBits + 1) * mSubBuckets +
+                    ((durationUs >> (msb - gSubBucketBits)) & (mSubBuckets - 1));
+    return bucket < mBucketCount ? bucket : mBucketCount - 1;
+}
+
+uint32_t AudioTimingHistogram::getBucketMaxUs(size_t bucket)
+{
+    if (bucket < mSubBuckets) {
+
+        return bucket;
+    }
+    if (bucket == mBucketCount - 1) {
+
+        return UINT32_MAX;
+    }
+    uint32_t shift = bucket / mSubBuckets - 1;
+    uint32_t minUs = (mSubBuckets + bucket % mSubBuckets) << shift;
+    return minUs + (1u << shift) - 1;
+}
+
+} // namespace intel_audio
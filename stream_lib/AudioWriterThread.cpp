@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AudioWriterThread.hpp"
+#include <utilities/Log.hpp>
+#include <chrono>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+using audio_comms::utilities::Log;
+
+namespace intel_audio
+{
+
+AudioWriterThread::AudioWriterThread(IAudioWriterClient &client)
+    : mClient(client), mWakeRequested(false), mStopRequested(false)
+{
+}
+
+AudioWriterThread::~AudioWriterThread()
+{
+    stop();
+}
+
+android::status_t AudioWriterThread::start(const std::string &name, uint32_t priority)
+{
+    if (isStarted()) {
+        Log::Error() << __FUNCTION__ << ": " << name << " already started";
+        return android::INVALID_OPERATION;
+    }
+    mStopRequested = false;
+    mWakeRequested = false;
+    mThread = std::thread(&AudioWriterThread::run, this, name, priority);
+    return android::OK;
+}
+
+void AudioWriterThread::stop()
+{
+    if (!isStarted()) {
+
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopRequested = true;
+    }
+    mWakeCondition.notify_one();
+    mThread.join();
+}
+
+void AudioWriterThread::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mWakeRequested = true;
+    }
+    mWakeCondition.notify_one();
+}
+
+android::status_t AudioWriterThread::bindToCpu(int32_t cpu)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+    if (cpu >= cpuCount) {
+        Log::Error() << __FUNCTION__ << ": no cpu " << cpu << " out of " << cpuCount;
+        return android::BAD_VALUE;
+    }
+    if (cpu < 0) {
+        for (long i = 0; i < cpuCount && i < CPU_SETSIZE; i++) {
+            CPU_SET(i, &cpus);
+        }
+    } else {
+        CPU_SET(cpu, &cpus);
+    }
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        Log::Error() << __FUNCTION__ << ": cannot bind to cpu " << cpu << ": " << strerror(errno);
+        return android::UNKNOWN_ERROR;
+    }
+    return android::OK;
+}
+
+void AudioWriterThread::run(std::string name, uint32_t priority)
+{
+    prctl(PR_SET_NAME, (unsigned long)name.c_str(), 0, 0, 0);
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error != 0) {
+        Log::Warning() << __FUNCTION__ << ": " << name << " not in SCHED_FIFO policy: "
+                       << strerror(error);
+    }
+
+    std::unique_lock<std::mutex> lock(mLock);
+    while (!mStopRequested) {
+        mWakeRequested = false;
+        lock.unlock();
+        uint32_t sleepUs = mClient.onWriterCycle();
+        lock.lock();
+
+        // A wake request made during the cycle runs the next one at once.
+        if (sleepUs == 0) {
+            mWakeCondition.wait(lock, [this]() { return mStopRequested || mWakeRequested; });
+        } else {
+            mWakeCondition.wait_for(lock, std::chrono::microseconds(sleepUs),
+                                    [this]() { return mStopRequested || mWakeRequested; });
+        }
+    }
+}
+
+} // namespace intel_audio
@@ -22,6 +22,7 @@
 #include <utils/RWLock.h>
 #include <utilities/Log.hpp>
 #include <utils/String8.h>
+#include <string.h>
 
 using audio_comms::utilities::Log;
 using std::string;
@@ -49,14 +50,21 @@ bool IoStream::isNewRouteAvailable() const
 android::status_t IoStream::attachRoute()
 {
     AutoW lock(mStreamLock);
-    return attachRouteL();
+    // Waits for the audio thread to leave the route, it does without it until attached.
+    mRouteGuard.close();
+    android::status_t status = attachRouteL();
+    mRouteGuard.open();
+    return status;
 }
 
 
 android::status_t IoStream::detachRoute()
 {
     AutoW lock(mStreamLock);
-    return detachRouteL();
+    mRouteGuard.close();
+    android::status_t status = detachRouteL();
+    mRouteGuard.open();
+    return status;
 }
 
 android::status_t IoStream::attachRouteL()
@@ -104,6 +112,16 @@ uint32_t IoStream::getOutputSilencePrologMs() const
     return mCurrentStreamRoute->getOutputSilencePrologMs();
 }
 
+uint32_t IoStream::getDspLatencyUs() const
+{
+    return mCurrentStreamRoute == NULL ? 0 : mCurrentStreamRoute->getDspLatencyUs();
+}
+
+int32_t IoStream::getWriterCpu() const
+{
+    return mCurrentStreamRoute == NULL ? -1 : mCurrentStreamRoute->getWriterCpu();
+}
+
 android::status_t IoStream::setDevices(audio_devices_t devices, const std::string &address)
 {
     AutoW lock(mStreamLock);
@@ -146,6 +164,12 @@ android::status_t IoStream::pcmWriteFrames(void *buffer, ssize_t frames, string
     return mAudioDevice->pcmWriteFrames(buffer, frames, error);
 }
 
+android::status_t IoStream::pcmWriteFramesUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                                string &error) const
+{
+    return mAudioDevice->pcmWriteFramesUntil(buffer, frames, deadlineNs, error);
+}
+
 uint32_t IoStream::getBufferSizeInBytes() const
 {
     return mAudioDevice->getBufferSizeInBytes();
@@ -161,11 +185,68 @@ android::status_t IoStream::getFramesAvailable(size_t &avail, struct timespec &t
     return mAudioDevice->getFramesAvailable(avail, tStamp);
 }
 
+string IoStream::getXrunStatistics() const
+{
+    AutoR lock(mStreamLock);
+    if (!isRoutedL()) {
+
+        return "";
+    }
+    return mAudioDevice->getXrunStatistics().toString();
+}
+
+uint32_t IoStream::takeLostFrames() const
+{
+    AutoR lock(mStreamLock);
+    if (!isRoutedL() || mRouteSampleSpec.getSampleRate() == 0) {
+
+        return 0;
+    }
+    // Lost at the rate of the device.
+    int64_t lostFrames = mAudioDevice->getXrunStatistics().takeLostFrames();
+    return lostFrames * mSampleSpec.getSampleRate() / mRouteSampleSpec.getSampleRate();
+}
+
 android::status_t IoStream::pcmStop() const
 {
     return mAudioDevice->pcmStop();
 }
 
+android::status_t IoStream::pcmStart() const
+{
+    return mAudioDevice->pcmStart();
+}
+
+android::status_t IoStream::getMmapBuffer(audio_mmap_buffer_info &info) const
+{
+    return mAudioDevice->getMmapBuffer(info);
+}
+
+android::status_t IoStream::getMmapHwPosition(audio_mmap_position &position) const
+{
+    return mAudioDevice->getMmapPosition(position);
+}
+
+android::status_t IoStream::beginWrite(void *&area, size_t &frames) const
+{
+    return mAudioDevice->beginWrite(area, frames);
+}
+
+android::status_t IoStream::commitWrite(size_t frames, std::string &error) const
+{
+    return mAudioDevice->commitWrite(frames, error);
+}
+
+android::status_t IoStream::beginRead(const void *&area, size_t &frames) const
+{
+    return mAudioDevice->beginRead(area, frames);
+}
+
+android::status_t IoStream::commitRead(size_t frames, std::string &error) const
+{
+    return mAudioDevice->commitRead(frames, error);
+}
+
 void IoStream::setNeedReconfigure()
 {
     if (not isRoutedL()) {
@@ -188,6 +269,9 @@ android::status_t IoStream::dump(const int fd, int spaces) const
     snprintf(buffer, SIZE, "%*s- is attached to route: %s\n", spaces, "",
              (mCurrentStreamRoute == nullptr ? "none" : mCurrentStreamRoute->getName().c_str()));
     result.append(buffer);
+    snprintf(buffer, SIZE, "%*s- transfers without route while rerouted: %u\n", spaces, "",
+             mRouteGuard.getClosedEntryCount());
+    result.append(buffer);
     snprintf(buffer, SIZE, "%*s- will be attached to route: %s\n", spaces, "",
              (mNewStreamRoute == nullptr ? "none" : mNewStreamRoute->getName().c_str()));
     result.append(buffer);
@@ -202,6 +286,11 @@ android::status_t IoStream::dump(const int fd, int spaces) const
 
     mSampleSpec.dump(fd, isOut(), spaces + 2);
 
+    if (isRoutedL()) {
+        snprintf(buffer, SIZE, "%*s- Device Xruns: \n", spaces, "");
+        write(fd, buffer, strlen(buffer));
+        mAudioDevice->getXrunStatistics().dump(fd, spaces + 2);
+    }
     return android::OK;
 }
 
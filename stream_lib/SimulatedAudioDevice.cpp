@@ -0,0 +1,605 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SimulatedAudioDevice.hpp"
+#include <MixPortConfig.hpp>
+#include <AudioCommsAssert.hpp>
+#include <utilities/Log.hpp>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using audio_comms::utilities::Log;
+using namespace std;
+
+namespace intel_audio
+{
+
+static struct timespec toTimespec(int64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ll;
+    ts.tv_nsec = ns % 1000000000ll;
+    return ts;
+}
+
+SimulatedAudioDevice::SimulatedAudioDevice(const string &file, bool realTime)
+    : mFile(file), mRealTime(realTime), mOpened(false), mIsOut(true), mMmap(false),
+      mNonBlocking(false), mRate(0), mFrameSize(0), mPeriodSize(0), mBufferSize(0),
+      mStartThreshold(0), mRunning(false), mXrun(false), mApplPosition(0), mHwPosition(0),
+      mNominalWakeupNs(0), mNextWakeupNs(0), mLastWakeupNs(0), mVirtualNs(0), mTransferOffset(0),
+      mDriftPpm(0), mMaxJitterNs(0), mJitterSeed(0x5EED), mXrunInjected(false), mXruns(0),
+      mXrunNs(0), mCaptureOffset(0), mPlaybackReadback(false), mPlayedFile(NULL)
+{}
+
+SimulatedAudioDevice::~SimulatedAudioDevice()
+{
+    close();
+}
+
+android::status_t SimulatedAudioDevice::open(const char *cardName, uint32_t deviceId,
+                                             const MixPortConfig &config, bool isOut)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    AUDIOCOMMS_ASSERT(!mOpened, "Simulated device already opened");
+
+    mRate = config.getRate();
+    mFrameSize = audio_bytes_per_sample(config.getFormat()) * config.getChannelCount();
+    if (mRate == 0 || mFrameSize == 0 || config.periodSize == 0 || config.periodCount == 0) {
+        Log::Error() << __FUNCTION__ << ": invalid config for simulated device (" << cardName
+                     << ", " << deviceId << ")";
+        return android::BAD_VALUE;
+    }
+    mIsOut = isOut;
+    mMmap = config.mmap;
+    mNonBlocking = config.nonBlocking;
+    mPeriodSize = config.periodSize;
+    mBufferSize = config.periodSize * config.periodCount;
+    // Same default as tiny alsa, capped as a playback would otherwise start on a full buffer only.
+    mStartThreshold = config.startThreshold != 0 ?
+                      min<size_t>(config.startThreshold, mBufferSize) : mBufferSize / 2;
+    mRing.assign(mBufferSize * mFrameSize, 0);
+
+    if (!mFile.empty()) {
+        FILE *file = fopen(mFile.c_str(), isOut ? "ab" : "rb");
+        if (file == NULL) {
+            Log::Error() << __FUNCTION__ << ": cannot open " << mFile;
+            return android::BAD_VALUE;
+        }
+        if (isOut) {
+            mPlayedFile = file;
+        } else {
+            mCaptureSource.clear();
+            uint8_t chunk[4096];
+            size_t read;
+            while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+                mCaptureSource.insert(mCaptureSource.end(), chunk, chunk + read);
+            }
+            mCaptureSource.resize(mCaptureSource.size() - mCaptureSource.size() % mFrameSize);
+            fclose(file);
+        }
+    }
+    mCaptureOffset = 0;
+    prepareL();
+    mOpened = true;
+
+    Log::Debug() << __FUNCTION__ << ": simulated card (" << cardName << ", " << deviceId
+                 << ") rate=" << mRate << " frame size=" << mFrameSize
+                 << " periodSize=" << mPeriodSize << " nbPeriod=" << config.periodCount
+                 << (mRealTime ? "" : " on virtual clock");
+    return android::OK;
+}
+
+bool SimulatedAudioDevice::isOpened()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mOpened;
+}
+
+android::status_t SimulatedAudioDevice::close()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mOpened) {
+
+        return android::DEAD_OBJECT;
+    }
+    if (mPlayedFile != NULL) {
+        fclose(mPlayedFile);
+        mPlayedFile = NULL;
+    }
+    mRunning = false;
+    mOpened = false;
+    return android::OK;
+}
+
+int64_t SimulatedAudioDevice::getTimeNsL() const
+{
+    if (!mRealTime) {
+
+        return mVirtualNs;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+void SimulatedAudioDevice::updateL() const
+{
+    int64_t now = getTimeNsL();
+    while (mRunning && mNextWakeupNs <= now) {
+        wakeupL();
+    }
+}
+
+void SimulatedAudioDevice::wakeupL() const
+{
+    mLastWakeupNs = mNextWakeupNs;
+    scheduleWakeupL();
+
+    if (mXrunInjected) {
+
+        mXrunInjected = false;
+        if (!mMmap) {
+            xrunL();
+            return;
+        }
+        // A device in mmap no-IRQ mode runs on, the xrun is only counted.
+        mXruns++;
+    }
+    if (mMmap) {
+
+        // The application pointer is not used, the whole ring buffer is transferred in loop.
+        mIsOut ? consumeL(mPeriodSize) : produceL(mPeriodSize);
+        return;
+    }
+    if (mIsOut) {
+
+        size_t queued = mApplPosition - mHwPosition;
+        consumeL(min(queued, mPeriodSize));
+        if (queued < mPeriodSize) {
+            xrunL();
+        }
+    } else {
+
+        if (mBufferSize - getAvailL() < mPeriodSize) {
+            xrunL();
+            return;
+        }
+        produceL(mPeriodSize);
+    }
+}
+
+void SimulatedAudioDevice::scheduleWakeupL() const
+{
+    mNominalWakeupNs += mPeriodSize * 1e9 / (mRate * (1 + mDriftPpm / 1e6));
+    int64_t jitter = mMaxJitterNs > 0 ? rand_r(&mJitterSeed) % (mMaxJitterNs + 1) : 0;
+    mNextWakeupNs = max(mLastWakeupNs, static_cast<int64_t>(mNominalWakeupNs) + jitter);
+}
+
+void SimulatedAudioDevice::consumeL(size_t frames) const
+{
+    while (frames > 0) {
+        size_t offset = mHwPosition % mBufferSize;
+        size_t chunk = min(frames, mBufferSize - offset);
+        const uint8_t *area = &mRing[offset * mFrameSize];
+        if (mPlayedFile != NULL) {
+            fwrite(area, mFrameSize, chunk, mPlayedFile);
+        } else if (mPlaybackReadback) {
+            mPlayed.insert(mPlayed.end(), area, area + chunk * mFrameSize);
+        }
+        mHwPosition += chunk;
+        frames -= chunk;
+    }
+}
+
+void SimulatedAudioDevice::produceL(size_t frames) const
+{
+    while (frames > 0) {
+        size_t offset = mHwPosition % mBufferSize;
+        size_t chunk = min(frames, mBufferSize - offset);
+        uint8_t *area = &mRing[offset * mFrameSize];
+        size_t bytes = chunk * mFrameSize;
+        if (mCaptureSource.empty()) {
+            memset(area, 0, bytes);
+        }
+        while (!mCaptureSource.empty() && bytes > 0) {
+            size_t copied = min(bytes, mCaptureSource.size() - mCaptureOffset);
+            memcpy(area, &mCaptureSource[mCaptureOffset], copied);
+            mCaptureOffset = (mCaptureOffset + copied) % mCaptureSource.size();
+            area += copied;
+            bytes -= copied;
+        }
+        mHwPosition += chunk;
+        frames -= chunk;
+    }
+}
+
+void SimulatedAudioDevice::startL() const
+{
+    mRunning = true;
+    mLastWakeupNs = getTimeNsL();
+    mNominalWakeupNs = mLastWakeupNs;
+    scheduleWakeupL();
+}
+
+void SimulatedAudioDevice::xrunL() const
+{
+    Log::Warning() << __FUNCTION__ << ": simulated " << (mIsOut ? "underrun" : "overrun");
+    mXruns++;
+    mXrun = true;
+    mXrunNs = mLastWakeupNs;
+    mRunning = false;
+}
+
+void SimulatedAudioDevice::prepareL() const
+{
+    mRunning = false;
+    mXrun = false;
+    mApplPosition = 0;
+    mHwPosition = 0;
+}
+
+size_t SimulatedAudioDevice::getAvailL() const
+{
+    size_t queued = mIsOut ? mApplPosition - mHwPosition : mHwPosition - mApplPosition;
+    return mIsOut ? mBufferSize - queued : queued;
+}
+
+android::status_t SimulatedAudioDevice::waitFramesL(std::unique_lock<std::mutex> &lock,
+                                                    size_t frames, int64_t deadlineNs) const
+{
+    for (;;) {
+        updateL();
+        if (mXrun) {
+
+            Log::Warning() << __FUNCTION__ << ": xrun, preparing the device again";
+            prepareL();
+            int64_t now = getTimeNsL();
+            mXrunStatistics.addXrun(mXrunNs, now,
+                                    XrunStatistics::estimateLostFrames(now - mXrunNs, mRate,
+                                                                       mIsOut, mBufferSize));
+        }
+        if (getAvailL() >= frames) {
+
+            return android::OK;
+        }
+        if (!mRunning) {
+
+            // Capture not started yet, or playback buffer full below the start threshold.
+            startL();
+            continue;
+        }
+        if (mNextWakeupNs > deadlineNs) {
+
+            return android::TIMED_OUT;
+        }
+        if (!mRealTime) {
+
+            mVirtualNs = mNextWakeupNs;
+            continue;
+        }
+        struct timespec wakeup = toTimespec(mNextWakeupNs);
+        lock.unlock();
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL);
+        lock.lock();
+    }
+}
+
+android::status_t SimulatedAudioDevice::beginTransfer(void *&area, size_t &frames,
+                                                      int64_t deadlineNs) const
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    if (!mOpened || mMmap) {
+
+        return android::INVALID_OPERATION;
+    }
+    frames = min(frames, mBufferSize);
+    bool partial = deadlineNs != 0;
+    android::status_t status = waitFramesL(lock, partial ? 1 : frames,
+                                           partial ? deadlineNs : getTimeNsL() + mWaitTimeoutNs);
+    if (status == android::TIMED_OUT && !partial) {
+        Log::Error() << __FUNCTION__ << ": timeout waiting for " << frames << " frames";
+    }
+    if (status != android::OK) {
+
+        return status;
+    }
+    if (partial) {
+        frames = min(frames, getAvailL());
+    }
+    mTransferOffset = mApplPosition % mBufferSize;
+    frames = min(frames, mBufferSize - mTransferOffset);
+    area = &mRing[mTransferOffset * mFrameSize];
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::commitTransfer(size_t frames, string &error) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (frames > mBufferSize - mTransferOffset) {
+        error = "simulated device: committing more frames than given";
+        return android::BAD_VALUE;
+    }
+    mApplPosition += frames;
+    if (mIsOut && !mRunning && !mXrun &&
+        static_cast<size_t>(mApplPosition - mHwPosition) >= mStartThreshold) {
+        startL();
+    }
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::pcmReadFrames(void *buffer, size_t frames,
+                                                      string &error) const
+{
+    if (frames == 0) {
+        Log::Error() << "Invalid frame number to read (" << frames << ")";
+        return android::BAD_VALUE;
+    }
+    uint8_t *dst = static_cast<uint8_t *>(buffer);
+    while (frames > 0) {
+        void *area = NULL;
+        size_t chunk = frames;
+        android::status_t status = beginTransfer(area, chunk);
+        if (status != android::OK) {
+            error = "simulated device: no frames to read";
+            return status;
+        }
+        memcpy(dst, area, chunk * mFrameSize);
+        status = commitTransfer(chunk, error);
+        if (status != android::OK) {
+
+            return status;
+        }
+        dst += chunk * mFrameSize;
+        frames -= chunk;
+    }
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::pcmWriteFrames(void *buffer, ssize_t frames,
+                                                       string &error) const
+{
+    const uint8_t *src = static_cast<const uint8_t *>(buffer);
+    size_t remaining = frames > 0 ? frames : 0;
+    while (remaining > 0) {
+        void *area = NULL;
+        size_t chunk = remaining;
+        android::status_t status = beginTransfer(area, chunk);
+        if (status != android::OK) {
+            error = "simulated device: no room to write";
+            return status;
+        }
+        memcpy(area, src, chunk * mFrameSize);
+        status = commitTransfer(chunk, error);
+        if (status != android::OK) {
+
+            return status;
+        }
+        src += chunk * mFrameSize;
+        remaining -= chunk;
+    }
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::pcmWriteFramesUntil(void *buffer, size_t &frames,
+                                                            int64_t deadlineNs,
+                                                            string &error) const
+{
+    if (!mNonBlocking) {
+
+        return pcmWriteFrames(buffer, frames, error);
+    }
+    const uint8_t *src = static_cast<const uint8_t *>(buffer);
+    size_t written = 0;
+    while (written < frames) {
+        void *area = NULL;
+        size_t chunk = frames - written;
+        android::status_t status = beginTransfer(area, chunk, deadlineNs);
+        if (status == android::TIMED_OUT) {
+
+            // No room before the deadline, the frames written are reported.
+            break;
+        }
+        if (status != android::OK) {
+            error = "simulated device: no room to write";
+            frames = written;
+            return status;
+        }
+        memcpy(area, src + written * mFrameSize, chunk * mFrameSize);
+        status = commitTransfer(chunk, error);
+        if (status != android::OK) {
+            frames = written;
+            return status;
+        }
+        written += chunk;
+    }
+    frames = written;
+    return android::OK;
+}
+
+uint32_t SimulatedAudioDevice::getBufferSizeInBytes() const
+{
+    return mBufferSize * mFrameSize;
+}
+
+size_t SimulatedAudioDevice::getBufferSizeInFrames() const
+{
+    return mBufferSize;
+}
+
+android::status_t SimulatedAudioDevice::getFramesAvailable(size_t &avail,
+                                                           struct timespec &tStamp) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    updateL();
+    if (!mRunning) {
+        Log::Error() << __FUNCTION__ << ": Unable to get available frames";
+        return android::INVALID_OPERATION;
+    }
+    avail = getAvailL();
+    tStamp = toTimespec(mLastWakeupNs);
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::pcmStop() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    prepareL();
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::pcmPrepare() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mOpened) {
+
+        return android::DEAD_OBJECT;
+    }
+    prepareL();
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::pcmStart() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mOpened) {
+
+        return android::INVALID_OPERATION;
+    }
+    if (!mRunning) {
+        startL();
+    }
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::getMmapBuffer(audio_mmap_buffer_info &info) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mOpened || !mMmap) {
+
+        return android::INVALID_OPERATION;
+    }
+    // Start from silence. Not backed by shared memory, the buffer is for in process clients only.
+    memset(&mRing[0], 0, mRing.size());
+    info.shared_memory_address = &mRing[0];
+    info.shared_memory_fd = -1;
+    info.buffer_size_frames = mBufferSize;
+    info.burst_size_frames = mPeriodSize;
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::getMmapPosition(audio_mmap_position &position) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    updateL();
+    if (!mRunning) {
+
+        return android::INVALID_OPERATION;
+    }
+    position.position_frames = static_cast<int32_t>(mHwPosition);
+    position.time_nanoseconds = mLastWakeupNs;
+    return android::OK;
+}
+
+android::status_t SimulatedAudioDevice::beginWrite(void *&area, size_t &frames)
+{
+    return beginTransfer(area, frames);
+}
+
+android::status_t SimulatedAudioDevice::commitWrite(size_t frames, string &error)
+{
+    return commitTransfer(frames, error);
+}
+
+android::status_t SimulatedAudioDevice::beginRead(const void *&area, size_t &frames)
+{
+    void *buffer = NULL;
+    android::status_t status = beginTransfer(buffer, frames);
+    area = buffer;
+    return status;
+}
+
+android::status_t SimulatedAudioDevice::commitRead(size_t frames, string &error)
+{
+    return commitTransfer(frames, error);
+}
+
+void SimulatedAudioDevice::setDriftPpm(double driftPpm)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mDriftPpm = driftPpm;
+}
+
+void SimulatedAudioDevice::setJitter(int64_t maxJitterNs)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mMaxJitterNs = maxJitterNs;
+}
+
+void SimulatedAudioDevice::injectXrun()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mXrunInjected = mRunning;
+}
+
+uint32_t SimulatedAudioDevice::getXrunCount() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mXruns;
+}
+
+int64_t SimulatedAudioDevice::getTimeNs() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return getTimeNsL();
+}
+
+void SimulatedAudioDevice::advance(int64_t durationNs)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    int64_t until = getTimeNsL() + durationNs;
+    if (mRealTime) {
+        struct timespec wakeup = toTimespec(until);
+        lock.unlock();
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL);
+        lock.lock();
+    } else {
+        mVirtualNs = until;
+    }
+    updateL();
+}
+
+void SimulatedAudioDevice::setCaptureSource(const vector<uint8_t> &source)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mCaptureSource = source;
+    mCaptureOffset = 0;
+}
+
+void SimulatedAudioDevice::setPlaybackReadback(bool enable)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mPlaybackReadback = enable;
+}
+
+void SimulatedAudioDevice::getPlayedFrames(vector<uint8_t> &played) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    played = mPlayed;
+}
+
+} // namespace intel_audio
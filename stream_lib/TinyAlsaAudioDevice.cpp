@@ -20,6 +20,10 @@
 #include <SampleSpec.hpp>
 #include <AudioCommsAssert.hpp>
 #include <utilities/Log.hpp>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
 
 using audio_comms::utilities::Log;
 using namespace std;
@@ -27,6 +31,13 @@ using namespace std;
 namespace intel_audio
 {
 
+static int64_t getMonotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
 android::status_t TinyAlsaAudioDevice::open(const char *cardName,
                                             uint32_t deviceId,
                                             const MixPortConfig &routeConfig,
@@ -46,6 +57,24 @@ android::status_t TinyAlsaAudioDevice::open(const char *cardName,
     config.silence_threshold = routeConfig.silenceThreshold;
     config.silence_size = 0;
     config.avail_min = routeConfig.availMin;
+    if (routeConfig.mmap) {
+        // The device runs freely on its ring buffer: started explicitly, never stopped on xrun.
+        config.start_threshold = 0;
+        config.stop_threshold = INT_MAX;
+        config.silence_threshold = 0;
+        config.avail_min = routeConfig.periodSize;
+    }
+    mPeriodSize = routeConfig.periodSize;
+    mIsOut = isOut;
+    mRate = config.rate;
+    mLastTransferNs = 0;
+    // Threshold tiny alsa defaults to, as it does not give back the configuration it applies.
+    mStartThreshold = config.start_threshold != 0 ?
+                      config.start_threshold : config.period_count * config.period_size / 2;
+    mZeroCopy = routeConfig.zeroCopy && !routeConfig.mmap;
+    if (routeConfig.nonBlocking) {
+        Log::Warning() << __FUNCTION__ << ": non-blocking mode not supported, writes block";
+    }
 
     Log::Debug() << __FUNCTION__ << ": card (" << cardName << ", " << deviceId
                  << ") \n\t config (rate=" << config.rate
@@ -63,6 +92,11 @@ android::status_t TinyAlsaAudioDevice::open(const char *cardName,
     // it will return a reference on a "bad pcm" structure
     //
     uint32_t flags = (isOut ? PCM_OUT : PCM_IN) | PCM_MONOTONIC;
+    if (routeConfig.mmap) {
+        flags |= PCM_MMAP | PCM_NOIRQ;
+    } else if (mZeroCopy) {
+        flags |= PCM_MMAP;
+    }
     int cardIndex = AudioUtils::getCardIndexByName(cardName);
     if (cardIndex < 0) {
         return android::BAD_VALUE;
@@ -88,6 +122,7 @@ android::status_t TinyAlsaAudioDevice::open(const char *cardName,
                        << "(frames), expected by AudioHAL and AudioFlinger = "
                        << config.period_count * config.period_size << " (frames)";
     }
+    mBufferSize = pcm_get_buffer_size(mPcmDevice);
     return android::OK;
 
 close_device:
@@ -122,13 +157,22 @@ android::status_t TinyAlsaAudioDevice::pcmReadFrames(void *buffer, size_t frames
         return android::BAD_VALUE;
     }
 
-    android::status_t ret;
-    ret = pcm_read(mPcmDevice, (char *)buffer, pcm_frames_to_bytes(mPcmDevice, frames));
+    android::status_t ret = recoverXrun();
+    if (ret != android::OK) {
+        error = pcm_get_error(mPcmDevice);
+        return ret;
+    }
+    if (mZeroCopy) {
+        ret = pcm_mmap_read(mPcmDevice, buffer, pcm_frames_to_bytes(mPcmDevice, frames));
+    } else {
+        ret = pcm_read(mPcmDevice, (char *)buffer, pcm_frames_to_bytes(mPcmDevice, frames));
+    }
 
     if (ret < 0) {
         error = pcm_get_error(mPcmDevice);
         return ret;
     }
+    setTransferred();
 
     return android::OK;
 }
@@ -136,18 +180,34 @@ android::status_t TinyAlsaAudioDevice::pcmReadFrames(void *buffer, size_t frames
 android::status_t TinyAlsaAudioDevice::pcmWriteFrames(void *buffer, ssize_t frames,
                                                       string &error) const
 {
-    android::status_t ret;
-
-    ret = pcm_write(mPcmDevice, (char *)buffer, pcm_frames_to_bytes(mPcmDevice, frames));
+    android::status_t ret = recoverXrun();
+    if (ret != android::OK) {
+        error = pcm_get_error(mPcmDevice);
+        return ret;
+    }
+    if (mZeroCopy) {
+        ret = pcm_mmap_write(mPcmDevice, buffer, pcm_frames_to_bytes(mPcmDevice, frames));
+    } else {
+        ret = pcm_write(mPcmDevice, (char *)buffer, pcm_frames_to_bytes(mPcmDevice, frames));
+    }
 
     if (ret < 0) {
         error = pcm_get_error(mPcmDevice);
         return ret;
     }
+    setTransferred();
 
     return android::OK;
 }
 
+android::status_t TinyAlsaAudioDevice::pcmWriteFramesUntil(void *buffer, size_t &frames,
+                                                           int64_t /*deadlineNs*/,
+                                                           string &error) const
+{
+    // Opened in blocking mode, all the frames are written.
+    return pcmWriteFrames(buffer, frames, error);
+}
+
 uint32_t TinyAlsaAudioDevice::getBufferSizeInBytes() const
 {
     return pcm_frames_to_bytes(mPcmDevice, getBufferSizeInFrames());
@@ -176,4 +236,202 @@ android::status_t TinyAlsaAudioDevice::pcmStop() const
     return pcm_stop(mPcmDevice);
 }
 
+android::status_t TinyAlsaAudioDevice::pcmPrepare() const
+{
+    if (mPcmDevice == NULL) {
+
+        return android::DEAD_OBJECT;
+    }
+    // Tiny alsa does not drain: the frames queued are dropped, as when closed.
+    pcm_stop(mPcmDevice);
+    if (pcm_prepare(mPcmDevice) != 0) {
+        Log::Error() << __FUNCTION__ << ": prepare failed with error " << pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    mLastTransferNs = 0;
+    return android::OK;
+}
+
+android::status_t TinyAlsaAudioDevice::pcmStart() const
+{
+    if (pcm_start(mPcmDevice) != 0) {
+        Log::Error() << __FUNCTION__ << ": start failed with error " << pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    return android::OK;
+}
+
+android::status_t TinyAlsaAudioDevice::getMmapBuffer(audio_mmap_buffer_info &info) const
+{
+    void *address = NULL;
+    unsigned int offset = 0;
+    unsigned int frames = 0;
+    if (pcm_mmap_begin(mPcmDevice, &address, &offset, &frames) != 0) {
+        Log::Error() << __FUNCTION__ << ": mmap failed with error " << pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    info.shared_memory_address = address;
+    // The client maps the data area of the ring buffer from the file descriptor of the pcm.
+    info.shared_memory_fd = pcm_get_poll_fd(mPcmDevice);
+    info.buffer_size_frames = pcm_get_buffer_size(mPcmDevice);
+    info.burst_size_frames = mPeriodSize;
+
+    // Start from silence, the application pointer is not used any more once started.
+    memset(address, 0, pcm_frames_to_bytes(mPcmDevice, info.buffer_size_frames));
+    if (pcm_mmap_commit(mPcmDevice, 0, mPeriodSize) < 0) {
+        Log::Error() << __FUNCTION__ << ": commit failed with error "
+                     << pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    return android::OK;
+}
+
+android::status_t TinyAlsaAudioDevice::getMmapPosition(audio_mmap_position &position) const
+{
+    unsigned int hwPointer = 0;
+    struct timespec timestamp = { 0, 0 };
+    if (pcm_mmap_get_hw_ptr(mPcmDevice, &hwPointer, &timestamp) != 0) {
+        return android::INVALID_OPERATION;
+    }
+    position.position_frames = static_cast<int32_t>(hwPointer);
+    position.time_nanoseconds = timestamp.tv_sec * 1000000000ll + timestamp.tv_nsec;
+    return android::OK;
+}
+
+android::status_t TinyAlsaAudioDevice::waitMmapFrames(size_t frames)
+{
+    for (;;) {
+        // The device stopped on underrun or overrun restarts from an empty buffer.
+        android::status_t status = recoverXrun();
+        if (status != android::OK) {
+
+            return status;
+        }
+        int avail = pcm_mmap_avail(mPcmDevice);
+        if (avail < 0) {
+            Log::Error() << __FUNCTION__ << ": error " << pcm_get_error(mPcmDevice);
+            return avail;
+        }
+        if (static_cast<size_t>(avail) >= frames) {
+
+            return android::OK;
+        }
+        if (pcm_state(mPcmDevice) != PCM_STATE_RUNNING) {
+
+            // Capture not started yet, or playback buffer full below the start threshold.
+            if (pcm_start(mPcmDevice) != 0) {
+                Log::Error() << __FUNCTION__ << ": start failed with error "
+                             << pcm_get_error(mPcmDevice);
+                return android::INVALID_OPERATION;
+            }
+            continue;
+        }
+        int ret = pcm_wait(mPcmDevice, mMmapWaitTimeoutMs);
+        if (ret == 0) {
+            Log::Error() << __FUNCTION__ << ": timeout waiting for " << frames << " frames";
+            return android::TIMED_OUT;
+        }
+        // An xrun is recovered on next loop.
+        if (ret < 0 && ret != -EPIPE) {
+
+            return ret;
+        }
+    }
+}
+
+android::status_t TinyAlsaAudioDevice::beginMmapTransfer(void *&area, size_t &frames)
+{
+    if (!mZeroCopy) {
+
+        return android::INVALID_OPERATION;
+    }
+    android::status_t status = waitMmapFrames(frames);
+    if (status != android::OK) {
+
+        return status;
+    }
+    void *buffer = NULL;
+    unsigned int contiguous = frames;
+    if (pcm_mmap_begin(mPcmDevice, &buffer, &mMmapOffset, &contiguous) < 0) {
+        Log::Error() << __FUNCTION__ << ": mmap failed with error " << pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    area = static_cast<char *>(buffer) + pcm_frames_to_bytes(mPcmDevice, mMmapOffset);
+    frames = contiguous;
+    return android::OK;
+}
+
+android::status_t TinyAlsaAudioDevice::beginWrite(void *&area, size_t &frames)
+{
+    return beginMmapTransfer(area, frames);
+}
+
+android::status_t TinyAlsaAudioDevice::commitWrite(size_t frames, string &error)
+{
+    if (pcm_mmap_commit(mPcmDevice, mMmapOffset, frames) < 0) {
+        error = pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    setTransferred();
+    if ((pcm_state(mPcmDevice) != PCM_STATE_RUNNING) &&
+        (pcm_get_buffer_size(mPcmDevice) - pcm_mmap_avail(mPcmDevice) >= mStartThreshold) &&
+        (pcm_start(mPcmDevice) != 0)) {
+        error = pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    return android::OK;
+}
+
+android::status_t TinyAlsaAudioDevice::beginRead(const void *&area, size_t &frames)
+{
+    void *buffer = NULL;
+    android::status_t status = beginMmapTransfer(buffer, frames);
+    area = buffer;
+    return status;
+}
+
+android::status_t TinyAlsaAudioDevice::commitRead(size_t frames, string &error)
+{
+    if (pcm_mmap_commit(mPcmDevice, mMmapOffset, frames) < 0) {
+        error = pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    setTransferred();
+    return android::OK;
+}
+
+android::status_t TinyAlsaAudioDevice::recoverXrun() const
+{
+    if (pcm_state(mPcmDevice) != PCM_STATE_XRUN) {
+
+        return android::OK;
+    }
+    Log::Warning() << __FUNCTION__ << ": " << (mIsOut ? "underrun" : "overrun")
+                   << ", preparing the device again";
+    int64_t detectedNs = getMonotonicNs();
+    if (pcm_prepare(mPcmDevice) != 0) {
+        Log::Error() << __FUNCTION__ << ": prepare failed with error "
+                     << pcm_get_error(mPcmDevice);
+        return android::INVALID_OPERATION;
+    }
+    int64_t recoveredNs = getMonotonicNs();
+
+    // Tiny alsa gives no time of the stop: the buffer, about full or empty at the last transfer,
+    // drained or filled up at the latest a buffer duration after it.
+    int64_t xrunNs = detectedNs;
+    if (mLastTransferNs > 0 && mRate > 0) {
+        xrunNs = min(detectedNs, mLastTransferNs + static_cast<int64_t>(mBufferSize) *
+                     1000000000 / mRate);
+    }
+    mXrunStatistics.addXrun(xrunNs, recoveredNs,
+                            XrunStatistics::estimateLostFrames(recoveredNs - xrunNs, mRate, mIsOut,
+                                                               mBufferSize));
+    return android::OK;
+}
+
+void TinyAlsaAudioDevice::setTransferred() const
+{
+    mLastTransferNs = getMonotonicNs();
+}
+
 } // namespace intel_audio
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "XrunStatistics.hpp"
+#include <utils/String8.h>
+#include <sstream>
+#include <stdio.h>
+#include <unistd.h>
+
+using std::string;
+
+namespace intel_audio
+{
+
+const int64_t XrunStatistics::mRecoveryBoundsMs[mRecoveryBuckets - 1] = {
+    1, 2, 5, 10, 20, 50, 100
+};
+
+XrunStatistics::XrunStatistics()
+    : mXruns(0), mLostFrames(0), mUnreportedLostFrames(0)
+{
+    for (size_t i = 0; i < mMaxLastXruns; i++) {
+        mLastXrunsNs[i] = 0;
+    }
+    for (size_t i = 0; i < mRecoveryBuckets; i++) {
+        mRecoveries[i] = 0;
+    }
+}
+
+void XrunStatistics::addXrun(int64_t xrunNs, int64_t recoveredNs, int64_t lostFrames)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mLastXrunsNs[mXruns % mMaxLastXruns] = xrunNs;
+    mXruns++;
+
+    size_t bucket = 0;
+    while (bucket < mRecoveryBuckets - 1 &&
+           recoveredNs - xrunNs >= mRecoveryBoundsMs[bucket] * 1000000) {
+        bucket++;
+    }
+    mRecoveries[bucket]++;
+
+    if (lostFrames > 0) {
+        mLostFrames += lostFrames;
+        mUnreportedLostFrames += lostFrames;
+    }
+}
+
+int64_t XrunStatistics::estimateLostFrames(int64_t durationNs, uint32_t rate, bool isOut,
+                                           size_t bufferSize)
+{
+    int64_t lostFrames = durationNs > 0 ? durationNs * rate / 1000000000 : 0;
+    return isOut ? lostFrames : lostFrames + bufferSize;
+}
+
+uint32_t XrunStatistics::getXrunCount() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mXruns;
+}
+
+int64_t XrunStatistics::getLostFrames() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mLostFrames;
+}
+
+int64_t XrunStatistics::takeLostFrames()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t lostFrames = mUnreportedLostFrames;
+    mUnreportedLostFrames = 0;
+    return lostFrames;
+}
+
+string XrunStatistics::toString() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    std::ostringstream stream;
+    stream << "count:" << mXruns << ",lost_frames:" << mLostFrames << ",recovery_ms:";
+    for (size_t i = 0; i < mRecoveryBuckets; i++) {
+        stream << (i == 0 ? "" : "|") << mRecoveries[i];
+    }
+    stream << ",last_ns:";
+    // Oldest first.
+    size_t last = mXruns < mMaxLastXruns ? mXruns : mMaxLastXruns;
+    for (size_t i = 0; i < last; i++) {
+        stream << (i == 0 ? "" : "|") << mLastXrunsNs[(mXruns - last + i) % mMaxLastXruns];
+    }
+    return stream.str();
+}
+
+android::status_t XrunStatistics::dump(const int fd, int spaces) const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    const size_t SIZE = 256;
+    char buffer[SIZE];
+    android::String8 result;
+
+    snprintf(buffer, SIZE, "%*s- Xruns: %u, lost frames: %lld\n", spaces, "", mXruns,
+             static_cast<long long>(mLostFrames));
+    result.append(buffer);
+    if (mXruns == 0) {
+
+        write(fd, result.string(), result.size());
+        return android::OK;
+    }
+    string recoveries;
+    for (size_t i = 0; i < mRecoveryBuckets; i++) {
+        if (i < mRecoveryBuckets - 1) {
+            snprintf(buffer, SIZE, " <%lldms: %u", static_cast<long long>(mRecoveryBoundsMs[i]),
+                     mRecoveries[i]);
+        } else {
+            snprintf(buffer, SIZE, " >=%lldms: %u",
+                     static_cast<long long>(mRecoveryBoundsMs[i - 1]), mRecoveries[i]);
+        }
+        recoveries += buffer;
+    }
+    snprintf(buffer, SIZE, "%*s- Recovery times:%s\n", spaces, "", recoveries.c_str());
+    result.append(buffer);
+    size_t last = mXruns < mMaxLastXruns ? mXruns : mMaxLastXruns;
+    for (size_t i = 0; i < last; i++) {
+        int64_t xrunNs = mLastXrunsNs[(mXruns - last + i) % mMaxLastXruns];
+        snprintf(buffer, SIZE, "%*s- Xrun at: %lld ns\n", spaces, "",
+                 static_cast<long long>(xrunNs));
+        result.append(buffer);
+    }
+    write(fd, result.string(), result.size());
+    return android::OK;
+}
+
+} // namespace intel_audio
@@ -15,8 +15,13 @@
  */
 #pragma once
 
+#include "AudioClockModel.hpp"
 #include "AudioDevice.hpp"
+#include "XrunStatistics.hpp"
 #include <alsa/asoundlib.h>
+#include <mutex>
+#include <poll.h>
+#include <vector>
 
 namespace intel_audio
 {
@@ -26,7 +31,12 @@ struct MixPortConfig;
 class AlsaAudioDevice : public IAudioDevice
 {
 public:
-    AlsaAudioDevice() : mPcmDevice(NULL) {}
+    AlsaAudioDevice()
+        : mPcmDevice(NULL), mZeroCopy(false), mStartThreshold(0), mMmapOffset(0), mIsOut(true),
+          mRate(0), mBufferSize(0), mLinkTimestamps(false),
+          mAudioTimestampType(SND_PCM_AUDIO_TSTAMP_TYPE_DEFAULT), mNonBlocking(false),
+          mApplFrames(0)
+    {}
 
     virtual android::status_t open(const char *cardName, uint32_t deviceId,
                                    const MixPortConfig &config, bool isOut);
@@ -42,6 +52,9 @@ public:
     virtual android::status_t pcmWriteFrames(void *buffer, ssize_t frames,
                                              std::string &error) const;
 
+    virtual android::status_t pcmWriteFramesUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                                  std::string &error) const;
+
     virtual uint32_t getBufferSizeInBytes() const;
 
     virtual size_t getBufferSizeInFrames() const;
@@ -50,11 +63,140 @@ public:
 
     virtual android::status_t pcmStop() const;
 
+    virtual android::status_t pcmPrepare() const;
+
+    virtual android::status_t pcmStart() const;
+
+    virtual android::status_t getMmapBuffer(audio_mmap_buffer_info &info) const;
+
+    virtual android::status_t getMmapPosition(audio_mmap_position &position) const;
+
+    virtual android::status_t beginWrite(void *&area, size_t &frames);
+
+    virtual android::status_t commitWrite(size_t frames, std::string &error);
+
+    virtual android::status_t beginRead(const void *&area, size_t &frames);
+
+    virtual android::status_t commitRead(size_t frames, std::string &error);
+
+    virtual XrunStatistics &getXrunStatistics() const { return mXrunStatistics; }
+
 private:
     int setPcmParams(snd_pcm_stream_t stream, const MixPortConfig &config,
                      snd_pcm_access_t access, int soft_resample);
 
+    /**
+     * Checks whether the device gives the audio timestamps of its link, i.e. timestamps taken
+     * by the driver when it reads the position of the hardware, and keeps the most accurate type.
+     *
+     * @param[in] params hardware parameters of the device.
+     */
+    void selectAudioTimestampType(const snd_pcm_hw_params_t *params);
+
+    /**
+     * Recovers from an error of a transfer, and restarts the position of the device. An xrun is
+     * recorded in the statistics of the device, from the time the device stopped on.
+     *
+     * @param[in] err error of the transfer.
+     * @param[in] silent true not to print the error.
+     *
+     * @return 0 if recovered, error code otherwise.
+     */
+    int recover(int err, int silent) const;
+
+    /**
+     * Transfers frames with a device opened in non-blocking mode, polling it for room or frames
+     * until a deadline. Xruns are recovered.
+     *
+     * @param[in] buffer frames to write, or to read into.
+     * @param[in,out] frames frames to transfer; frames transferred, fewer if the deadline is met.
+     * @param[in] deadlineNs time to return at the latest, in nanoseconds, monotonic clock.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if transferred, even partly, error code otherwise.
+     */
+    android::status_t transferUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                    std::string &error) const;
+
+    /**
+     * Transfers all the frames with a device opened in non-blocking mode, as a blocking transfer
+     * would, waiting no longer than mWaitTimeoutMs.
+     *
+     * @param[in] buffer frames to write, or to read into.
+     * @param[in] frames frames to transfer.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if all transferred, error code otherwise.
+     */
+    android::status_t transferAll(void *buffer, size_t frames, std::string &error) const;
+
+    /** Sets a device opened in non-blocking mode blocking, to drain it. */
+    void setBlocking() const;
+
+    /**
+     * Counts the frames transferred by the application.
+     *
+     * @param[in] frames frames written or read.
+     */
+    void addApplFrames(snd_pcm_sframes_t frames) const;
+
+    /** Restarts the position of the application and the clock model, as the device is prepared. */
+    void resetClock() const;
+
+    /**
+     * Waits until frames may be transferred in the ring buffer of a device opened with zero copy
+     * access, recovering it on xrun and starting it if it would wait forever.
+     *
+     * @param[in] frames frames to write or read.
+     *
+     * @return OK if the frames may be transferred, error code otherwise.
+     */
+    android::status_t waitMmapFrames(size_t frames);
+
+    /**
+     * Gets an area of the ring buffer of a device opened with zero copy access.
+     *
+     * @param[out] area address of the area.
+     * @param[in,out] frames frames requested; frames of the area.
+     *
+     * @return OK if an area is given, error code otherwise.
+     */
+    android::status_t beginMmapTransfer(void *&area, size_t &frames);
+
     snd_pcm_t *mPcmDevice; /**< Handle on alsa PCM device. */
+    bool mZeroCopy; /**< Opened with mmap access, frames may be transferred in place. */
+    snd_pcm_uframes_t mStartThreshold; /**< Frames to queue before starting a playback. */
+    snd_pcm_uframes_t mMmapOffset; /**< Offset in frames of the area given by the last begin. */
+    bool mIsOut; /**< Playback device, capture otherwise. */
+    uint32_t mRate; /**< Rate of the device in frames per second. */
+    snd_pcm_uframes_t mBufferSize; /**< Frames of the ring buffer. */
+    bool mLinkTimestamps; /**< The position is timestamped by the driver with its audio time. */
+    snd_pcm_audio_tstamp_type_t mAudioTimestampType; /**< Audio timestamp requested. */
+    bool mNonBlocking; /**< Opened in non-blocking mode, transfers poll for room or frames. */
+
+    /** Descriptors polled for room or frames in non-blocking mode, their events set by poll. */
+    mutable std::vector<struct pollfd> mPollFds;
+
+    /**
+     * Guards mApplFrames and mClockModel: they are updated by the transfers, from the audio thread
+     * or the writer thread, and by getFramesAvailable, also called by the position queries.
+     */
+    mutable std::mutex mClockLock;
+
+    /**
+     * Frames transferred by the application since the device was prepared, locating the position
+     * of the hardware from the available frames. Counted by the const transfers.
+     */
+    mutable int64_t mApplFrames;
+
+    /** Clock of the device, for the timestamps when the driver gives none. */
+    mutable AudioClockModel mClockModel;
+
+    /** Xruns met by the const transfers. */
+    mutable XrunStatistics mXrunStatistics;
+
+    /** Longest wait for room or frames in zero copy or non-blocking mode, far above a period. */
+    static const int mWaitTimeoutMs = 1000;
 };
 
 } // namespace intel_audio
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <utils/Errors.h>
+#include <stddef.h>
+
+namespace intel_audio
+{
+
+/**
+ * Memory of the buffers of a stream, allocated once as a single block.
+ *
+ * The block is reserved when the stream gets a route, out of the audio path, from the period of
+ * the route. The buffers are then carved from it one after the other, aligned on cache lines, and
+ * given back all together: carving never allocates, so that the transfers of the stream do not
+ * once the stream runs.
+ *
+ * Not thread safe: used under the lock of the stream.
+ */
+class AudioArena
+{
+public:
+    AudioArena();
+    ~AudioArena();
+
+    /**
+     * Reserves a block for buffers of a given size, keeping the current block if large enough.
+     * The buffers carved so far are released. Allocates: not for the audio path.
+     *
+     * @param[in] bytes size of the buffers to carve, each aligned with getAlignedSize().
+     *
+     * @return OK if reserved, NO_MEMORY otherwise, leaving the arena empty.
+     */
+    android::status_t reserve(size_t bytes);
+
+    /**
+     * Carves a buffer from the block.
+     *
+     * @param[in] bytes size of the buffer.
+     *
+     * @return buffer aligned on mAlignment, NULL if not enough room left.
+     */
+    void *allocate(size_t bytes);
+
+    /** Releases all the buffers carved, keeping the block. */
+    void release() { mUsedBytes = 0; }
+
+    size_t getCapacity() const { return mCapacity; }
+
+    size_t getUsedBytes() const { return mUsedBytes; }
+
+    /** Exchanges the blocks and buffers of two arenas, without allocating. */
+    void swap(AudioArena &other);
+
+    /** @return size taken in the block by a buffer of a given size. */
+    static size_t getAlignedSize(size_t bytes)
+    {
+        return (bytes + mAlignment - 1) & ~(mAlignment - 1);
+    }
+
+    static const size_t mAlignment = 64; /**< Cache line, power of 2. */
+
+private:
+    AudioArena(const AudioArena &);
+    AudioArena &operator=(const AudioArena &);
+
+    char *mBlock;
+    size_t mCapacity; /**< Size of the block in bytes. */
+    size_t mUsedBytes; /**< Bytes carved from the block so far. */
+};
+
+} // namespace intel_audio
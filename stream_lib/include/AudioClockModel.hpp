@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+/**
+ * Model of the clock of an audio device which gives no timestamp of its position, for devices
+ * whose position is read with the time taken afterwards.
+ *
+ * The position read lags the hardware by the granularity of its updates, and the time taken
+ * after it by the scheduling of the reader. The rate of the device is thus given by a linear
+ * regression of the positions measured against their times, over the last measures, and the
+ * line is raised onto the measure the most ahead, as none is ahead of the device. The time a
+ * position was reached at is taken from the line rather than from the measure: it neither
+ * jitters with the measures nor goes backward.
+ */
+class AudioClockModel
+{
+public:
+    AudioClockModel();
+
+    /** Forgets the measures, as the position of the device restarted. */
+    void reset();
+
+    /**
+     * Adds a measure of the position of the device.
+     *
+     * @param[in] frames frames transferred by the device since started, not decreasing.
+     * @param[in] timeNs time the position was read at in nanoseconds, monotonic clock.
+     *
+     * @return time at which the device reached the position according to the model, the time of
+     *         the measure until enough measures are made. Never decreasing, never after the
+     *         time of the measure.
+     */
+    int64_t update(int64_t frames, int64_t timeNs);
+
+private:
+    /** Measures the regression is made over: about a second of 20ms periods. */
+    static const size_t mMaxMeasures = 64;
+
+    /** Measures needed before using the regression. */
+    static const size_t mMinMeasures = 8;
+
+    int64_t mFrames[mMaxMeasures]; /**< Positions measured, the oldest overwritten first. */
+    int64_t mTimesNs[mMaxMeasures]; /**< Times of the positions measured. */
+    size_t mMeasures; /**< Measures held, up to mMaxMeasures. */
+    size_t mNext; /**< Index of the next measure. */
+    int64_t mLastNs; /**< Last time returned. */
+};
+
+} // namespace intel_audio
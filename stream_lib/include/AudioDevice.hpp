@@ -15,9 +15,12 @@
  */
 #pragma once
 
+#include "XrunStatistics.hpp"
 #include <MixPortConfig.hpp>
+#include <system/audio.h>
 #include <stdint.h>
 #include <utils/Errors.h>
+#include <string>
 
 namespace intel_audio
 {
@@ -46,6 +49,20 @@ public:
     virtual android::status_t pcmWriteFrames(void *buffer, ssize_t frames,
                                              std::string &error) const = 0;
 
+    /**
+     * Writes frames, waiting for room until a deadline if the device is opened in non-blocking
+     * mode, i.e. whose route config has nonBlocking set. A device in blocking mode writes them all.
+     *
+     * @param[in] buffer frames to write.
+     * @param[in,out] frames frames to write; frames written, fewer if the deadline is met.
+     * @param[in] deadlineNs time to return at the latest, in nanoseconds, monotonic clock.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if written, even partly, error code otherwise.
+     */
+    virtual android::status_t pcmWriteFramesUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                                  std::string &error) const = 0;
+
     virtual uint32_t getBufferSizeInBytes() const = 0;
 
     virtual size_t getBufferSizeInFrames() const = 0;
@@ -53,6 +70,94 @@ public:
     virtual android::status_t getFramesAvailable(size_t &avail, struct timespec &tStamp) const = 0;
 
     virtual android::status_t pcmStop() const = 0;
+
+    /**
+     * Stops the device, a playback playing the frames written first, and prepares it again: it is
+     * then in the state it was opened in, ready to be used again with the same config.
+     *
+     * @return OK if prepared, error code otherwise.
+     */
+    virtual android::status_t pcmPrepare() const = 0;
+
+    /**
+     * Starts the transfer of a device opened in mmap mode, the frames are then consumed or
+     * produced by the device in the mmap buffer without any write or read.
+     */
+    virtual android::status_t pcmStart() const = 0;
+
+    /**
+     * Retrieves the buffer of a device opened in mmap mode, i.e. whose route config has mmap set.
+     * The buffer is cleared, an output thus plays silence until written.
+     *
+     * @param[out] info address, shared memory file descriptor, size and burst size of the buffer.
+     *
+     * @return OK if the buffer is mapped, error code otherwise.
+     */
+    virtual android::status_t getMmapBuffer(audio_mmap_buffer_info &info) const = 0;
+
+    /**
+     * Retrieves the position of the hardware in the mmap buffer.
+     *
+     * @param[out] position frames transferred by the hardware since started, and the monotonic
+     *                      time at which they were.
+     *
+     * @return OK if the position is valid, error code otherwise.
+     */
+    virtual android::status_t getMmapPosition(audio_mmap_position &position) const = 0;
+
+    /**
+     * Gets an area of the ring buffer of a device opened with zero copy access, i.e. whose route
+     * config has zeroCopy set, to write frames in place. Waits for room if needed.
+     * Must be followed by commitWrite, even if nothing is written.
+     *
+     * @param[out] area address to write the frames at.
+     * @param[in,out] frames frames requested; frames that may be written in the area, less than
+     *                       requested where the ring buffer wraps.
+     *
+     * @return OK if an area is given, error code otherwise.
+     */
+    virtual android::status_t beginWrite(void *&area, size_t &frames) = 0;
+
+    /**
+     * Hands the frames written in the area given by beginWrite over to the device, and starts it
+     * once its start threshold is reached.
+     *
+     * @param[in] frames frames written, no more than the frames of the area, may be null.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if committed, error code otherwise.
+     */
+    virtual android::status_t commitWrite(size_t frames, std::string &error) = 0;
+
+    /**
+     * Gets an area of the ring buffer of a device opened with zero copy access holding captured
+     * frames, to read them in place. Waits for the frames if needed.
+     * Must be followed by commitRead, even if nothing is read.
+     *
+     * @param[out] area address to read the frames at.
+     * @param[in,out] frames frames requested; frames that may be read in the area, less than
+     *                       requested where the ring buffer wraps.
+     *
+     * @return OK if an area is given, error code otherwise.
+     */
+    virtual android::status_t beginRead(const void *&area, size_t &frames) = 0;
+
+    /**
+     * Gives the frames read in the area given by beginRead back to the device.
+     *
+     * @param[in] frames frames read, no more than the frames of the area, may be null.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if committed, error code otherwise.
+     */
+    virtual android::status_t commitRead(size_t frames, std::string &error) = 0;
+
+    /**
+     * Gets the statistics of the xruns of the device since constructed, recorded by its transfers.
+     *
+     * @return statistics of the xruns.
+     */
+    virtual XrunStatistics &getXrunStatistics() const = 0;
 };
 
 } // namespace intel_audio
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <MixPortConfig.hpp>
+#include <utils/Errors.h>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace intel_audio
+{
+
+class IAudioDevice;
+
+/**
+ * Pool of the audio devices left opened and prepared when their route is unrouted, so that a
+ * route coming back with the same config reuses its device instead of opening it again: opening
+ * a PCM negotiates its hw and sw params, and prepares it.
+ *
+ * A device is parked for the idle timeout of its route, then closed. A parked device is closed
+ * as soon as another device opens the same PCM, a PCM being opened once at a time.
+ * Called from the routing thread, dumped from any thread.
+ */
+class AudioDevicePool
+{
+public:
+    AudioDevicePool();
+
+    /**
+     * Opens a device, or takes it back if it is parked with the same PCM and config.
+     *
+     * @param[in] device device of the route.
+     * @param[in] cardName card of the PCM.
+     * @param[in] deviceId device of the PCM on its card.
+     * @param[in] config config of the route.
+     * @param[in] isOut true for a playback, false for a capture.
+     *
+     * @return OK if the device is opened, error code of the open otherwise.
+     */
+    android::status_t open(IAudioDevice &device, const char *cardName, uint32_t deviceId,
+                           const MixPortConfig &config, bool isOut);
+
+    /**
+     * Closes a device, or parks it prepared until its idle timeout if any.
+     *
+     * @param[in] device device of the route.
+     * @param[in] idleTimeoutMs time to keep the device opened, closed at once if null.
+     * @param[in] nowNs current time in nanoseconds, monotonic clock.
+     *
+     * @return OK if closed or parked, error code of the close otherwise.
+     */
+    android::status_t close(IAudioDevice &device, uint32_t idleTimeoutMs, int64_t nowNs);
+
+    /**
+     * Opens a device ahead of its routing and parks it, speculating that its route is about to be
+     * used with this config. The speculation is right if the device is taken back by an open,
+     * wrong if it is closed first.
+     *
+     * @param[in] device device of the route.
+     * @param[in] cardName card of the PCM.
+     * @param[in] deviceId device of the PCM on its card.
+     * @param[in] config config the route is expected to be used with.
+     * @param[in] isOut true for a playback, false for a capture.
+     * @param[in] idleTimeoutMs time to keep the device opened if not taken back.
+     * @param[in] nowNs current time in nanoseconds, monotonic clock.
+     *
+     * @return OK if opened and parked, error code otherwise.
+     */
+    android::status_t prewarm(IAudioDevice &device, const char *cardName, uint32_t deviceId,
+                              const MixPortConfig &config, bool isOut, uint32_t idleTimeoutMs,
+                              int64_t nowNs);
+
+    /**
+     * Closes the devices parked for longer than their idle timeout.
+     *
+     * @param[in] nowNs current time in nanoseconds, monotonic clock.
+     *
+     * @return time in milliseconds until the next device expires, negative if none is parked.
+     */
+    int64_t releaseIdle(int64_t nowNs);
+
+    /** Closes all the devices parked, e.g. when the audio subsystem went down. */
+    void releaseAll();
+
+    /** @return devices parked. */
+    size_t getParkedCount() const;
+
+    /** @return devices taken back from the pool instead of opened. */
+    uint32_t getReuseCount() const;
+
+    /** @return devices prewarmed then taken back by their route. */
+    uint32_t getPrewarmHitCount() const;
+
+    /** @return devices prewarmed then closed without being used. */
+    uint32_t getPrewarmMissCount() const;
+
+    /**
+     * Gets the routing time saved by the reuses: the mean time of the opens for each reuse, less
+     * the time taken to prepare the devices parked.
+     *
+     * @return time saved in nanoseconds.
+     */
+    int64_t getSavedNs() const;
+
+    /**
+     * Dumps the devices parked and the time saved.
+     *
+     * @param[in] fd file descriptor to write to.
+     * @param[in] spaces indentation of the lines.
+     *
+     * @return OK.
+     */
+    android::status_t dump(const int fd, int spaces) const;
+
+private:
+    struct PooledDevice
+    {
+        IAudioDevice *device;
+        std::string cardName;
+        uint32_t deviceId;
+        bool isOut;
+        MixPortConfig config; /**< Config the device was opened with. */
+        bool parked; /**< Opened and prepared, not routed. */
+        bool prewarmed; /**< Opened ahead of its routing, not taken back yet. */
+        int64_t expiryNs; /**< Time to close a parked device at. */
+    };
+
+    /**
+     * Checks if a device opened with a config may be used again with another.
+     *
+     * @return true if the PCM would be opened with the same params, false otherwise.
+     */
+    static bool isSameConfig(const MixPortConfig &opened, const MixPortConfig &requested);
+
+    /** @return index of the device in the pool, the count of devices if not in. */
+    size_t findL(const IAudioDevice &device) const;
+
+    /** Closes the device at the given index and removes it. To be called with the lock held. */
+    void releaseL(size_t index);
+
+    /** Opens a device and adds it to the pool. To be called with the lock held. */
+    android::status_t openL(IAudioDevice &device, const char *cardName, uint32_t deviceId,
+                            const MixPortConfig &config, bool isOut);
+
+    /** Prepares the device at the given index and parks it. To be called with the lock held. */
+    android::status_t parkL(size_t index, uint32_t idleTimeoutMs, int64_t nowNs);
+
+    mutable std::mutex mLock;
+    std::vector<PooledDevice> mDevices; /**< Devices opened through the pool. */
+    uint32_t mOpens; /**< Devices opened. */
+    int64_t mOpenNs; /**< Time taken by the opens. */
+    uint32_t mReuses; /**< Devices taken back from the pool. */
+    int64_t mParkNs; /**< Time taken to prepare the devices parked. */
+    uint32_t mPrewarmHits; /**< Devices prewarmed then taken back. */
+    uint32_t mPrewarmMisses; /**< Devices prewarmed then closed unused. */
+};
+
+} // namespace intel_audio
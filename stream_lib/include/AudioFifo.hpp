@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace intel_audio
+{
+
+/**
+ * Bounded ring of bytes between one producer thread and one consumer thread, without lock.
+ *
+ * The producer writes at the back of the ring, the consumer reads at the front in place, and
+ * releases what it read. Each side only updates its own count of bytes, the other side sees the
+ * bytes once the count is updated.
+ * A ring holding frames keeps them whole as long as its capacity, and every write and release, is
+ * a multiple of the frame size.
+ */
+class AudioFifo
+{
+public:
+    AudioFifo();
+
+    /**
+     * Sets the capacity of the ring and empties it. Neither side may use it meanwhile.
+     *
+     * @param[in] bytes capacity of the ring.
+     */
+    void resize(size_t bytes);
+
+    /** @return capacity of the ring in bytes. */
+    size_t getCapacity() const { return mBuffer.size(); }
+
+    /**
+     * Writes at the back of the ring, producer only. Never waits.
+     *
+     * @param[in] buffer bytes to write.
+     * @param[in] bytes size of the buffer.
+     *
+     * @return bytes written, less than requested if the ring is full.
+     */
+    size_t write(const void *buffer, size_t bytes);
+
+    /** @return bytes the producer may write. */
+    size_t getWritableBytes() const;
+
+    /** @return bytes the consumer may read. */
+    size_t getReadableBytes() const;
+
+    /**
+     * Gets the front of the ring to read in place, consumer only.
+     *
+     * @param[out] bytes readable bytes from the front, less than readable where the ring wraps.
+     *
+     * @return address of the front of the ring.
+     */
+    const void *getReadArea(size_t &bytes) const;
+
+    /**
+     * Releases bytes read from the front of the ring, consumer only.
+     *
+     * @param[in] bytes bytes to release, no more than readable.
+     */
+    void release(size_t bytes);
+
+    /** @return bytes written since resized. */
+    uint64_t getWrittenBytes() const { return mWrittenBytes.load(std::memory_order_acquire); }
+
+    /** @return bytes released since resized. */
+    uint64_t getReleasedBytes() const { return mReleasedBytes.load(std::memory_order_acquire); }
+
+private:
+    std::vector<char> mBuffer; /**< Bytes of the ring. */
+
+    /** Bytes written since resized, updated by the producer once the bytes are copied. */
+    std::atomic<uint64_t> mWrittenBytes;
+
+    /** Bytes released since resized, updated by the consumer once the bytes are read. */
+    std::atomic<uint64_t> mReleasedBytes;
+};
+
+} // namespace intel_audio
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+/**
+ * Latency model of a playback route, giving the frames of a stream written but not presented yet
+ * at the output of the platform, in frames of the route.
+ *
+ * Frames written are held by the stream until taken by the audio device, queued in the device,
+ * then delayed by the group delay of the conversion chain and the latency of the DSP behind the
+ * device. The silence prolog written when the stream is routed is queued ahead of its frames and
+ * played first, without being part of them.
+ * The frames written are counted by a single thread and read by any thread. The reset is to be
+ * done while none of them uses the model.
+ */
+class AudioLatencyModel
+{
+public:
+    AudioLatencyModel();
+
+    /**
+     * Starts the model for a new route.
+     *
+     * @param[in] prologFrames frames of silence written to the device ahead of the stream frames.
+     * @param[in] delayFrames fixed delay of the frames played by the device: group delay of the
+     *                        conversion and latency of the DSP.
+     */
+    void reset(size_t prologFrames, size_t delayFrames);
+
+    /**
+     * Records frames of the stream taken by the device.
+     *
+     * @param[in] frames frames written to the device.
+     */
+    void addWrittenFrames(size_t frames);
+
+    /**
+     * Gets the frames of the stream written but not presented yet.
+     *
+     * @param[in] queuedFrames frames queued in the device, not played yet.
+     * @param[in] heldFrames frames converted by the stream but not written to the device yet.
+     *
+     * @return frames in the route sample spec.
+     */
+    size_t getUnpresentedFrames(size_t queuedFrames, size_t heldFrames) const;
+
+    /** @return fixed delay of the frames played by the device, in frames of the route. */
+    size_t getDelayFrames() const { return mDelayFrames; }
+
+private:
+    /** Frames written to the device since reset, prolog included. */
+    std::atomic<uint64_t> mWrittenFrames;
+    size_t mPrologFrames; /**< Frames of silence written first. */
+    size_t mDelayFrames; /**< Fixed delay beyond the device. */
+};
+
+} // namespace intel_audio
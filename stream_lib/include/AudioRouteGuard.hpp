@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+/**
+ * Guard of the route of a stream, used by the audio thread without ever waiting, and replaced by
+ * the routing thread once the audio thread is out of it, as a read-copy-update would.
+ *
+ * The audio thread enters the guard before using the route, and leaves it after. Entering only
+ * counts the thread in: if the guard is closed, the route is being replaced and the audio thread
+ * does without it, as if not routed, instead of waiting for it.
+ * The routing thread closes the guard, then waits for the audio threads in it to leave, i.e. for
+ * a grace period, before replacing the route, and opens the guard again once the route is set.
+ */
+class AudioRouteGuard
+{
+public:
+    AudioRouteGuard();
+
+    /**
+     * Enters the guard, wait-free. To be followed by leave, whatever the result.
+     *
+     * @return true if the route may be used, false if it is being replaced.
+     */
+    bool enter() const;
+
+    /** Leaves the guard, wait-free. */
+    void leave() const;
+
+    /**
+     * Closes the guard and waits for the threads in it to leave. Only one thread may close it.
+     * Entries made meanwhile find it closed.
+     */
+    void close();
+
+    /** Opens the guard again, the route being set. */
+    void open();
+
+    /** @return entries that found the guard closed. */
+    uint32_t getClosedEntryCount() const;
+
+private:
+    mutable std::atomic<uint32_t> mThreadsIn; /**< Threads between enter and leave. */
+    std::atomic<bool> mClosed; /**< The route is being replaced. */
+    mutable std::atomic<uint32_t> mClosedEntries; /**< Entries that found the guard closed. */
+
+    /** Time to sleep between two checks of the threads in, while waiting for them to leave. */
+    static const uint32_t mGracePollUs = 500;
+};
+
+} // namespace intel_audio
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+/**
+ * Virtual audio device clock of a stream without audio device, i.e. unrouted, muted, or failing.
+ *
+ * The frames written without device are presented at the rate of the stream from an origin, as a
+ * device would play them: each write has the deadline its frames are presented by, following the
+ * deadline of the previous write, so that sleeping until it does not accumulate the scheduling
+ * latency of the writes. A write is due at the deadline of the previous one: one late by more than
+ * its own duration, e.g. after an idle time, starts from the time of the write instead.
+ * Started at the last position of the device of the stream when it loses its route, it keeps the
+ * position of the stream continuous.
+ *
+ * Written by the audio thread, read by any thread.
+ */
+class AudioSilenceClock
+{
+public:
+    AudioSilenceClock();
+
+    /**
+     * Starts the clock from a position.
+     *
+     * @param[in] presentedFrames frames presented at the time of the origin.
+     * @param[in] timeNs time of the origin in nanoseconds, monotonic clock.
+     * @param[in] writtenFrames frames written, presented or not.
+     * @param[in] rate rate of the frames.
+     */
+    void start(uint64_t presentedFrames, int64_t timeNs, uint64_t writtenFrames, uint32_t rate);
+
+    /** Stops the clock, once the stream is routed again. */
+    void stop();
+
+    bool isStarted() const { return mStarted; }
+
+    /**
+     * Writes frames to the clock, starting it from the time of the write, with all the frames
+     * written presented, if stopped.
+     *
+     * @param[in] frames frames written.
+     * @param[in] rate rate of the frames, used if starting.
+     * @param[in] nowNs time of the write in nanoseconds, monotonic clock.
+     *
+     * @return deadline the frames are presented by in nanoseconds, monotonic clock.
+     */
+    int64_t addFrames(size_t frames, uint32_t rate, int64_t nowNs);
+
+    /**
+     * Gets the frames presented at a time, no more than the frames written.
+     *
+     * @param[in] nowNs time in nanoseconds, monotonic clock.
+     * @param[out] frames frames presented.
+     *
+     * @return true if started, false otherwise.
+     */
+    bool getPresentedFrames(int64_t nowNs, uint64_t &frames) const;
+
+    /** @return current time in nanoseconds, monotonic clock. */
+    static int64_t getNowNs();
+
+    /**
+     * Sleeps until a deadline, whatever the latency of the caller to get to sleep.
+     *
+     * @param[in] deadlineNs time to wake up at in nanoseconds, monotonic clock.
+     */
+    static void sleepUntil(int64_t deadlineNs);
+
+private:
+    /** @return time the frames written so far are presented by. */
+    int64_t getDeadlineNsL() const;
+
+    mutable std::mutex mLock; /**< Protects the position, never held while sleeping. */
+    std::atomic<bool> mStarted;
+    uint64_t mOriginFrames; /**< Frames presented at the origin. */
+    int64_t mOriginNs; /**< Time of the origin, monotonic clock. */
+    uint64_t mWrittenFrames; /**< Frames written, presented or not. */
+    uint32_t mRate; /**< Rate of the frames. */
+};
+
+} // namespace intel_audio
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace intel_audio
+{
+
+/**
+ * Histogram of durations, recorded by the audio thread without lock nor allocation, read by any
+ * thread.
+ *
+ * The buckets are log-linear on microseconds: exact below mSubBuckets microseconds, then each
+ * power of two split in mSubBuckets buckets, i.e. a resolution of an eighth of the duration up to
+ * seconds. The last bucket holds all the longer durations. A percentile is given as the longest
+ * duration of its bucket, no longer than the longest duration recorded.
+ */
+class AudioTimingHistogram
+{
+public:
+    AudioTimingHistogram();
+
+    /**
+     * Records a duration.
+     *
+     * @param[in] durationNs duration in nanoseconds, negative taken as zero.
+     */
+    void record(int64_t durationNs);
+
+    /** @return durations recorded. */
+    uint32_t getCount() const;
+
+    /** @return longest duration recorded in microseconds. */
+    uint32_t getMaxUs() const { return mMaxUs; }
+
+    /**
+     * Gets the duration not exceeded by a percentage of the durations recorded.
+     *
+     * @param[in] percent percentage of the durations, from 0 to 100.
+     *
+     * @return duration in microseconds, 0 if nothing recorded.
+     */
+    uint32_t getPercentileUs(uint32_t percent) const;
+
+    /**
+     * Gets the histogram as a parameter value, without any key value pair separator:
+     * "count|p50|p90|p99|max", durations in microseconds, e.g. "480|10000|10239|11263|12004".
+     *
+     * @return summary of the durations.
+     */
+    std::string toString() const;
+
+    /** @return current time in nanoseconds, monotonic clock, to time a duration with. */
+    static int64_t getNowNs();
+
+    /** Buckets per power of two, a power of two. */
+    static const uint32_t mSubBuckets = 8;
+
+    /** Buckets of the histogram, the last one beyond about four seconds. */
+    static const size_t mBucketCount = 160;
+
+private:
+    /** @return bucket of a duration in microseconds. */
+    static size_t getBucket(uint32_t durationUs);
+
+    /** @return longest duration in microseconds of a bucket. */
+    static uint32_t getBucketMaxUs(size_t bucket);
+
+    std::atomic<uint32_t> mBuckets[mBucketCount]; /**< Durations recorded per bucket. */
+    std::atomic<uint32_t> mMaxUs; /**< Longest duration recorded. */
+};
+
+} // namespace intel_audio
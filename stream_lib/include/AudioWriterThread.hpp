@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <utils/Errors.h>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+namespace intel_audio
+{
+
+/**
+ * Work done by a writer thread, cycle after cycle.
+ */
+class IAudioWriterClient
+{
+public:
+    /**
+     * Runs a cycle of the writer thread, i.e. feeds the audio device with the frames at hand.
+     *
+     * @return time to sleep before the next cycle in microseconds, null to sleep until woken.
+     */
+    virtual uint32_t onWriterCycle() = 0;
+
+protected:
+    virtual ~IAudioWriterClient() {}
+};
+
+/**
+ * Real time thread writing the frames of an output stream to its audio device on behalf of the
+ * client of the stream, which hands the frames over without waiting for the device.
+ */
+class AudioWriterThread
+{
+public:
+    explicit AudioWriterThread(IAudioWriterClient &client);
+
+    /** Stops the thread if started. */
+    ~AudioWriterThread();
+
+    /**
+     * Starts the thread in SCHED_FIFO policy, or in the policy of the caller if not permitted.
+     *
+     * @param[in] name name of the thread.
+     * @param[in] priority SCHED_FIFO priority of the thread.
+     *
+     * @return OK if started, error code otherwise.
+     */
+    android::status_t start(const std::string &name, uint32_t priority);
+
+    /** Stops the thread once its current cycle is done, and waits for it. */
+    void stop();
+
+    bool isStarted() const { return mThread.joinable(); }
+
+    /** Wakes the thread up if sleeping, to run a cycle at once. */
+    void wake();
+
+    /**
+     * Binds the calling thread to a CPU.
+     *
+     * @param[in] cpu CPU index, negative for any CPU.
+     *
+     * @return OK if bound, error code otherwise.
+     */
+    static android::status_t bindToCpu(int32_t cpu);
+
+private:
+    void run(std::string name, uint32_t priority);
+
+    IAudioWriterClient &mClient;
+    std::thread mThread;
+
+    std::mutex mLock; /**< Protects the requests to the thread, never held during a cycle. */
+    std::condition_variable mWakeCondition; /**< Signaled on wake and stop requests. */
+    bool mWakeRequested; /**< The thread is to run a cycle at once. */
+    bool mStopRequested; /**< The thread is to exit. */
+};
+
+} // namespace intel_audio
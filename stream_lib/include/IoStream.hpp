@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include "AudioRouteGuard.hpp"
 #include <SampleSpec.hpp>
 #include <system/audio.h>
 #include <utils/RWLock.h>
@@ -106,6 +107,17 @@ public:
      */
     inline bool isDirect() const { return isOut() && (getFlagMask() & AUDIO_OUTPUT_FLAG_DIRECT); }
 
+    /**
+     * Checks if a stream has been created with MMAP_NOIRQ flag attribute, i.e. sharing the buffer
+     * of the audio device with its client instead of writing or reading it.
+     * @return true if the stream is flagged as mmap no-IRQ, false otherwise.
+     */
+    inline bool isMmap() const
+    {
+        return getFlagMask() &
+               (isOut() ? AUDIO_OUTPUT_FLAG_MMAP_NOIRQ : AUDIO_INPUT_FLAG_MMAP_NOIRQ);
+    }
+
     /**
      * Use Case.
      * For an input stream, use case is known as the input source.
@@ -125,6 +137,20 @@ public:
      */
     uint32_t getOutputSilencePrologMs() const;
 
+    /**
+     * Get the latency of the DSP behind the audio device of the route.
+     *
+     * @return latency in microseconds, null if not routed.
+     */
+    uint32_t getDspLatencyUs() const;
+
+    /**
+     * Get the CPU the writer thread of an asynchronous output stream is bound to on the route.
+     *
+     * @return CPU index, negative for any CPU or if not routed.
+     */
+    int32_t getWriterCpu() const;
+
     /**
      * Adds an effect to the mask of requested effect.
      *
@@ -149,18 +175,20 @@ public:
 
     /**
      * Get the sample specifications of the stream route.
+     * Given by reference, not copied: used on each transfer.
      *
      * @return sample specifications.
      */
-    SampleSpec routeSampleSpec() const { return mRouteSampleSpec; }
+    const SampleSpec &routeSampleSpec() const { return mRouteSampleSpec; }
 
     /**
      * Get the stream sample specification.
      * Stream Sample specification is the sample spec in which the client gives/receives samples
+     * Given by reference, not copied: used on each transfer.
      *
      * @return sample specifications.
      */
-    SampleSpec streamSampleSpec() const
+    const SampleSpec &streamSampleSpec() const
     {
         return mSampleSpec;
     }
@@ -303,8 +331,87 @@ public:
      */
     android::status_t pcmWriteFrames(void *buffer, ssize_t frames, std::string &error) const;
 
+    /**
+     * Write frames to audio device until a deadline. A device opened in non-blocking mode writes
+     * the frames it has room for by then, others write them all.
+     *
+     * @param[in] buffer: audio samples buffer to render on audio device.
+     * @param[in,out] frames: number of frames to render, number of frames rendered.
+     * @param[in] deadlineNs: time to return by in nanoseconds, monotonic clock.
+     * @param[out] error: string containing readable error, if any is set
+     *
+     * @return status_t error code of the pcm write operation.
+     */
+    android::status_t pcmWriteFramesUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                          std::string &error) const;
+
     android::status_t pcmStop() const;
 
+    /**
+     * Starts the audio device, mmap mode only.
+     */
+    android::status_t pcmStart() const;
+
+    /**
+     * Retrieves the buffer of the audio device, mmap mode only.
+     *
+     * @param[out] info address, shared memory file descriptor, size and burst size of the buffer.
+     *
+     * @return OK if the buffer is mapped, error code otherwise.
+     */
+    android::status_t getMmapBuffer(audio_mmap_buffer_info &info) const;
+
+    /**
+     * Retrieves the position of the audio device in its buffer, mmap mode only.
+     *
+     * @param[out] position frames transferred since started and their monotonic time.
+     *
+     * @return OK if the position is valid, error code otherwise.
+     */
+    android::status_t getMmapHwPosition(audio_mmap_position &position) const;
+
+    /**
+     * Gets an area of the ring buffer of the audio device to write frames in place, zero copy
+     * routes only. Must be followed by commitWrite.
+     *
+     * @param[out] area address to write the frames at.
+     * @param[in,out] frames frames requested; frames of the area, less where the buffer wraps.
+     *
+     * @return OK if an area is given, error code otherwise.
+     */
+    android::status_t beginWrite(void *&area, size_t &frames) const;
+
+    /**
+     * Hands the frames written in place over to the audio device.
+     *
+     * @param[in] frames frames written in the area given by beginWrite.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if committed, error code otherwise.
+     */
+    android::status_t commitWrite(size_t frames, std::string &error) const;
+
+    /**
+     * Gets an area of the ring buffer of the audio device to read frames in place, zero copy
+     * routes only. Must be followed by commitRead.
+     *
+     * @param[out] area address to read the frames at.
+     * @param[in,out] frames frames requested; frames of the area, less where the buffer wraps.
+     *
+     * @return OK if an area is given, error code otherwise.
+     */
+    android::status_t beginRead(const void *&area, size_t &frames) const;
+
+    /**
+     * Gives the frames read in place back to the audio device.
+     *
+     * @param[in] frames frames read in the area given by beginRead.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if committed, error code otherwise.
+     */
+    android::status_t commitRead(size_t frames, std::string &error) const;
+
     /**
      * Returns available frames in pcm buffer and corresponding time stamp.
      * For an input stream, frames available are frames ready for the
@@ -314,6 +421,21 @@ public:
      */
     android::status_t getFramesAvailable(size_t &avail, struct timespec &tStamp) const;
 
+    /**
+     * Gets the statistics of the xruns of the audio device the stream is routed on.
+     *
+     * @return statistics as a parameter value, empty if not routed.
+     */
+    std::string getXrunStatistics() const;
+
+    /**
+     * Gets the frames lost by the xruns of the audio device the stream is routed on since the
+     * previous call, and starts counting them again.
+     *
+     * @return frames lost at the rate of the stream, null if not routed.
+     */
+    uint32_t takeLostFrames() const;
+
     IStreamRoute *getCurrentStreamRoute() const { return mCurrentStreamRoute; }
 
     IStreamRoute *getNewStreamRoute() const { return mNewStreamRoute; }
@@ -384,12 +506,30 @@ protected:
      */
     virtual android::status_t detachRouteL();
 
+    /**
+     * Enters the route of the stream from the audio thread, without waiting for the route manager.
+     * To be followed by leaveRoute, whatever the result.
+     *
+     * @return true if the route and its dependant parameters may be used, false if the stream is
+     *         being attached or detached, in which case it is to be handled as not routed.
+     */
+    bool enterRoute() const { return mRouteGuard.enter(); }
+
+    /** Leaves the route of the stream entered by enterRoute. */
+    void leaveRoute() const { mRouteGuard.leave(); }
+
     /**
      * Lock to protect not only the access to pcm device but also any access to device dependant
      * parameters as sample specification.
      */
     mutable android::RWLock mStreamLock;
 
+    /**
+     * Guard of the route for the audio thread, closed while attaching or detaching the route,
+     * with the stream lock held.
+     */
+    AudioRouteGuard mRouteGuard;
+
     virtual ~IoStream() {}
 
     SampleSpec mSampleSpec; /**< stream sample specifications. */
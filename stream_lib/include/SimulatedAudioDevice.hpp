@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "AudioDevice.hpp"
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace intel_audio
+{
+
+struct MixPortConfig;
+
+/**
+ * Audio device without any hardware behind, for host tests and benchmarks.
+ *
+ * The device transfers its frames against a clock running at the rate of the route config,
+ * period by period as a DMA would: at each period wakeup, a playback consumes a period from its
+ * ring buffer and a capture produces one. The available frames and their timestamp are those of
+ * the last wakeup. Like an alsa device, a playback starts once its start threshold is reached, a
+ * capture on first read, and both stop on xrun, until the next transfer prepares them again.
+ *
+ * The clock is either the monotonic clock, transfers then block as long as on a real device, or a
+ * virtual clock, which jumps to the next wakeup instead of waiting for it, to run tests faster
+ * than real time. Drift and wakeup jitter of the clock, and xruns, may be injected.
+ *
+ * Played frames are appended to a file if any is given, or kept to be read back by tests once
+ * enabled, dropped otherwise. Captured frames are taken in loop from a source given as a buffer
+ * or a file, silence otherwise.
+ */
+class SimulatedAudioDevice : public IAudioDevice
+{
+public:
+    /**
+     * @param[in] file played frames are appended to, or captured frames read from; may be empty.
+     * @param[in] realTime true to run on the monotonic clock, false on a virtual clock.
+     */
+    SimulatedAudioDevice(const std::string &file = "", bool realTime = true);
+
+    virtual ~SimulatedAudioDevice();
+
+    virtual android::status_t open(const char *cardName, uint32_t deviceId,
+                                   const MixPortConfig &config, bool isOut);
+
+    virtual bool isOpened();
+
+    virtual android::status_t close();
+
+    virtual android::status_t pcmReadFrames(void *buffer, size_t frames, std::string &error) const;
+
+    virtual android::status_t pcmWriteFrames(void *buffer, ssize_t frames,
+                                             std::string &error) const;
+
+    virtual android::status_t pcmWriteFramesUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                                  std::string &error) const;
+
+    virtual uint32_t getBufferSizeInBytes() const;
+
+    virtual size_t getBufferSizeInFrames() const;
+
+    virtual android::status_t getFramesAvailable(size_t &avail, struct timespec &tStamp) const;
+
+    virtual android::status_t pcmStop() const;
+
+    virtual android::status_t pcmPrepare() const;
+
+    virtual android::status_t pcmStart() const;
+
+    virtual android::status_t getMmapBuffer(audio_mmap_buffer_info &info) const;
+
+    virtual android::status_t getMmapPosition(audio_mmap_position &position) const;
+
+    virtual android::status_t beginWrite(void *&area, size_t &frames);
+
+    virtual android::status_t commitWrite(size_t frames, std::string &error);
+
+    virtual android::status_t beginRead(const void *&area, size_t &frames);
+
+    virtual android::status_t commitRead(size_t frames, std::string &error);
+
+    virtual XrunStatistics &getXrunStatistics() const { return mXrunStatistics; }
+
+    /**
+     * Sets the drift of the device clock, the period wakeups are then closer if positive.
+     *
+     * @param[in] driftPpm drift in parts per million relative to the nominal rate.
+     */
+    void setDriftPpm(double driftPpm);
+
+    /**
+     * Delays each period wakeup by a random time, the frames transferred are unchanged.
+     *
+     * @param[in] maxJitterNs longest delay in nanoseconds, null to disable.
+     */
+    void setJitter(int64_t maxJitterNs);
+
+    /** Stops the device on xrun at its next period wakeup, if running. */
+    void injectXrun();
+
+    /** @return xruns since the device was constructed, either detected or injected. */
+    uint32_t getXrunCount() const;
+
+    /** @return current time of the device clock in nanoseconds. */
+    int64_t getTimeNs() const;
+
+    /**
+     * Lets the device clock run, processing the period wakeups met. The virtual clock jumps, the
+     * monotonic clock is slept on.
+     *
+     * @param[in] durationNs time to run in nanoseconds.
+     */
+    void advance(int64_t durationNs);
+
+    /**
+     * Sets the frames a capture produces, in loop. The capture file, if any, is read again on open.
+     *
+     * @param[in] source frames in the format of the route config, empty for silence.
+     */
+    void setCaptureSource(const std::vector<uint8_t> &source);
+
+    /**
+     * Keeps the frames consumed by a playback, unless written to a file, to be read back by
+     * getPlayedFrames. For tests only: the frames are kept without bound. Off by default.
+     *
+     * @param[in] enable true to keep the played frames, false to drop them.
+     */
+    void setPlaybackReadback(bool enable);
+
+    /**
+     * Gets the frames consumed by a playback while the readback was enabled.
+     *
+     * @param[out] played frames in the format of the route config.
+     */
+    void getPlayedFrames(std::vector<uint8_t> &played) const;
+
+private:
+    /** @return current time of the device clock, lock held. */
+    int64_t getTimeNsL() const;
+
+    /** Processes the period wakeups met until the current time of the device clock, lock held. */
+    void updateL() const;
+
+    /** Processes a period wakeup, at time mNextWakeupNs, lock held. */
+    void wakeupL() const;
+
+    /** Sets the time of the next period wakeup from the drift and the jitter, lock held. */
+    void scheduleWakeupL() const;
+
+    /**
+     * Consumes frames of a playback at the hardware pointer, lock held.
+     *
+     * @param[in] frames frames to consume, no more than the ring buffer.
+     */
+    void consumeL(size_t frames) const;
+
+    /**
+     * Produces frames of a capture at the hardware pointer, lock held.
+     *
+     * @param[in] frames frames to produce, no more than the ring buffer.
+     */
+    void produceL(size_t frames) const;
+
+    /** Starts the transfer from the current time, lock held. */
+    void startL() const;
+
+    /** Stops on xrun at the time of the last wakeup, lock held. */
+    void xrunL() const;
+
+    /** Empties the ring buffer after a stop or an xrun, lock held. */
+    void prepareL() const;
+
+    /**
+     * Waits until frames may be transferred in the ring buffer, preparing the device after an xrun
+     * and starting it if it would wait forever.
+     *
+     * @param[in] lock lock held, released while the monotonic clock is slept on.
+     * @param[in] frames frames to write or read.
+     * @param[in] deadlineNs time of the device clock to wait until.
+     *
+     * @return OK if the frames may be transferred, TIMED_OUT if not before the deadline, error
+     *         code otherwise.
+     */
+    android::status_t waitFramesL(std::unique_lock<std::mutex> &lock, size_t frames,
+                                  int64_t deadlineNs) const;
+
+    /**
+     * Gets an area of the ring buffer at the application pointer.
+     *
+     * @param[out] area address of the area.
+     * @param[in,out] frames frames requested; frames of the area.
+     * @param[in] deadlineNs time of the device clock to wait until for some of the frames, the
+     *                       area then holding the frames available only; null to wait for all of
+     *                       them, no longer than mWaitTimeoutNs.
+     *
+     * @return OK if an area is given, error code otherwise.
+     */
+    android::status_t beginTransfer(void *&area, size_t &frames, int64_t deadlineNs = 0) const;
+
+    /**
+     * Moves the application pointer past the frames transferred, and starts a playback once its
+     * start threshold is reached.
+     *
+     * @param[in] frames frames transferred.
+     * @param[out] error string containing readable error, if any is set.
+     *
+     * @return OK if committed, error code otherwise.
+     */
+    android::status_t commitTransfer(size_t frames, std::string &error) const;
+
+    /** @return frames that may be transferred by the application, lock held. */
+    size_t getAvailL() const;
+
+    /*
+     * The transfer functions of IAudioDevice are const, while they run the simulated hardware:
+     * its state is thus mutable, and guarded by mLock.
+     */
+    mutable std::mutex mLock;
+    const std::string mFile; /**< File played frames are appended to, or captured ones read from. */
+    const bool mRealTime; /**< Runs on the monotonic clock, on the virtual clock otherwise. */
+    bool mOpened; /**< Opened by a route. */
+    bool mIsOut; /**< Playback, capture otherwise. */
+    bool mMmap; /**< Opened in mmap no-IRQ mode, never stops on xrun. */
+    bool mNonBlocking; /**< Opened in non-blocking mode, writes may be partial. */
+    uint32_t mRate; /**< Nominal rate in frames per second. */
+    size_t mFrameSize; /**< Size of a frame in bytes. */
+    size_t mPeriodSize; /**< Frames transferred at each wakeup. */
+    size_t mBufferSize; /**< Frames of the ring buffer. */
+    size_t mStartThreshold; /**< Frames to queue before starting a playback. */
+    mutable std::vector<uint8_t> mRing; /**< Ring buffer shared with the application. */
+    mutable bool mRunning; /**< Transferring frames at each wakeup. */
+    mutable bool mXrun; /**< Stopped on xrun, prepared again on next transfer. */
+    mutable int64_t mApplPosition; /**< Frames transferred by the application since prepared. */
+    mutable int64_t mHwPosition; /**< Frames transferred by the device since prepared. */
+    mutable double mNominalWakeupNs; /**< Time of the next period wakeup, without jitter. */
+    mutable int64_t mNextWakeupNs; /**< Time of the next period wakeup. */
+    mutable int64_t mLastWakeupNs; /**< Time of the last period wakeup, timestamp of the frames. */
+    mutable int64_t mVirtualNs; /**< Current time of the virtual clock. */
+    mutable size_t mTransferOffset; /**< Offset in frames of the area given by the last begin. */
+    double mDriftPpm; /**< Drift of the clock relative to the nominal rate. */
+    int64_t mMaxJitterNs; /**< Longest delay of a period wakeup. */
+    mutable unsigned int mJitterSeed; /**< Seed of the jitter, fixed for reproducible runs. */
+    mutable bool mXrunInjected; /**< Xrun to raise at next wakeup. */
+    mutable uint32_t mXruns; /**< Xruns since constructed. */
+    mutable int64_t mXrunNs; /**< Time of the last stop on xrun. */
+    mutable XrunStatistics mXrunStatistics; /**< Xruns the device stopped on and recovered from. */
+    std::vector<uint8_t> mCaptureSource; /**< Frames captured in loop, silence if empty. */
+    mutable size_t mCaptureOffset; /**< Offset in bytes of the next frame to capture. */
+    bool mPlaybackReadback; /**< Played frames are kept in mPlayed. */
+    mutable std::vector<uint8_t> mPlayed; /**< Frames consumed by a playback. */
+    FILE *mPlayedFile; /**< File played frames are appended to, if any. */
+
+    /** Longest wait for room or frames, far above a period. */
+    static const int64_t mWaitTimeoutNs = 1000000000ll;
+};
+
+} // namespace intel_audio
@@ -16,6 +16,7 @@
 #pragma once
 
 #include "AudioDevice.hpp"
+#include "XrunStatistics.hpp"
 #include <tinyalsa/asoundlib.h>
 
 namespace intel_audio
@@ -26,7 +27,10 @@ struct MixPortConfig;
 class TinyAlsaAudioDevice : public IAudioDevice
 {
 public:
-    TinyAlsaAudioDevice() : mPcmDevice(NULL) {}
+    TinyAlsaAudioDevice()
+        : mPcmDevice(NULL), mPeriodSize(0), mZeroCopy(false), mStartThreshold(0), mMmapOffset(0),
+          mIsOut(true), mRate(0), mBufferSize(0), mLastTransferNs(0)
+    {}
 
     virtual android::status_t open(const char *cardName, uint32_t deviceId,
                                    const MixPortConfig &config, bool isOut);
@@ -40,6 +44,9 @@ public:
     virtual android::status_t pcmWriteFrames(void *buffer, ssize_t frames,
                                              std::string &error) const;
 
+    virtual android::status_t pcmWriteFramesUntil(void *buffer, size_t &frames, int64_t deadlineNs,
+                                                  std::string &error) const;
+
     virtual uint32_t getBufferSizeInBytes() const;
 
     virtual size_t getBufferSizeInFrames() const;
@@ -48,8 +55,71 @@ public:
 
     virtual android::status_t pcmStop() const;
 
+    virtual android::status_t pcmPrepare() const;
+
+    virtual android::status_t pcmStart() const;
+
+    virtual android::status_t getMmapBuffer(audio_mmap_buffer_info &info) const;
+
+    virtual android::status_t getMmapPosition(audio_mmap_position &position) const;
+
+    virtual android::status_t beginWrite(void *&area, size_t &frames);
+
+    virtual android::status_t commitWrite(size_t frames, std::string &error);
+
+    virtual android::status_t beginRead(const void *&area, size_t &frames);
+
+    virtual android::status_t commitRead(size_t frames, std::string &error);
+
+    virtual XrunStatistics &getXrunStatistics() const { return mXrunStatistics; }
+
 private:
+    /**
+     * Prepares the device again if it stopped on xrun, and records the xrun in the statistics of
+     * the device. Tiny alsa would restart it silently on next transfer.
+     *
+     * @return OK if the device did not stop or is prepared again, error code otherwise.
+     */
+    android::status_t recoverXrun() const;
+
+    /** Keeps the time of a transfer, the device may not stop on xrun before its buffer drains. */
+    void setTransferred() const;
+
+    /**
+     * Waits until frames may be transferred in the ring buffer of a device opened with zero copy
+     * access, restarting it on xrun and starting it if it would wait forever.
+     *
+     * @param[in] frames frames to write or read.
+     *
+     * @return OK if the frames may be transferred, error code otherwise.
+     */
+    android::status_t waitMmapFrames(size_t frames);
+
+    /**
+     * Gets an area of the ring buffer of a device opened with zero copy access.
+     *
+     * @param[out] area address of the area.
+     * @param[in,out] frames frames requested; frames of the area.
+     *
+     * @return OK if an area is given, error code otherwise.
+     */
+    android::status_t beginMmapTransfer(void *&area, size_t &frames);
+
     pcm *mPcmDevice; /**< Handle on tiny alsa PCM device. */
+    uint32_t mPeriodSize; /**< Period size in frames, burst size of the mmap buffer. */
+    bool mZeroCopy; /**< Opened with mmap access, frames may be transferred in place. */
+    uint32_t mStartThreshold; /**< Frames to queue before starting a zero copy playback. */
+    unsigned int mMmapOffset; /**< Offset in frames of the area given by the last begin. */
+    bool mIsOut; /**< Playback device, capture otherwise. */
+    uint32_t mRate; /**< Rate of the device in frames per second. */
+    size_t mBufferSize; /**< Frames of the ring buffer. */
+    mutable int64_t mLastTransferNs; /**< Time of the last transfer, null if none since opened. */
+
+    /** Xruns met by the const transfers. */
+    mutable XrunStatistics mXrunStatistics;
+
+    /** Longest wait for room or frames in zero copy, far above a period. */
+    static const int mMmapWaitTimeoutMs = 1000;
 };
 
 } // namespace intel_audio
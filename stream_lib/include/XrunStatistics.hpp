@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <utils/Errors.h>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace intel_audio
+{
+
+/**
+ * Statistics of the xruns of an audio device: count, times of the last ones, histogram of the
+ * time taken to recover, and estimate of the frames lost.
+ *
+ * An xrun lasts from the time the device stopped until it is prepared again: a playback plays
+ * silence meanwhile, a capture drops the frames of its buffer and captures nothing. Recorded by
+ * the transfers of the device, read by the stream from any thread.
+ */
+class XrunStatistics
+{
+public:
+    XrunStatistics();
+
+    /**
+     * Records an xrun.
+     *
+     * @param[in] xrunNs time the device stopped in nanoseconds, monotonic clock.
+     * @param[in] recoveredNs time the device was prepared again.
+     * @param[in] lostFrames frames not played or captured because of the xrun.
+     */
+    void addXrun(int64_t xrunNs, int64_t recoveredNs, int64_t lostFrames);
+
+    /**
+     * Estimates the frames lost by an xrun: a playback plays silence until prepared again, a
+     * capture captures nothing meanwhile and drops the frames of its full buffer when prepared.
+     *
+     * @param[in] durationNs time from the stop of the device until prepared again.
+     * @param[in] rate rate of the device in frames per second.
+     * @param[in] isOut true for a playback, false for a capture.
+     * @param[in] bufferSize frames of the ring buffer of the device.
+     *
+     * @return frames lost.
+     */
+    static int64_t estimateLostFrames(int64_t durationNs, uint32_t rate, bool isOut,
+                                      size_t bufferSize);
+
+    /** @return xruns recorded. */
+    uint32_t getXrunCount() const;
+
+    /** @return frames lost by all the xruns recorded. */
+    int64_t getLostFrames() const;
+
+    /**
+     * Gets the frames lost since the previous call, and starts counting them again, as the input
+     * frames lost are reported.
+     *
+     * @return frames lost since the previous call.
+     */
+    int64_t takeLostFrames();
+
+    /**
+     * Gets the statistics as a parameter value, without any key value pair separator: e.g.
+     * "count:2,lost_frames:1440,recovery_ms:0|1|1|0|0|0|0|0,last_ns:1000|2000".
+     *
+     * @return statistics of the xruns.
+     */
+    std::string toString() const;
+
+    /**
+     * Dumps the statistics.
+     *
+     * @param[in] fd file descriptor to write to.
+     * @param[in] spaces indentation of the lines.
+     *
+     * @return OK.
+     */
+    android::status_t dump(const int fd, int spaces) const;
+
+    /** Times of the last xruns kept. */
+    static const size_t mMaxLastXruns = 8;
+
+    /** Buckets of the recovery histogram, the last one beyond the longest bound. */
+    static const size_t mRecoveryBuckets = 8;
+
+    /** Upper bound in milliseconds of each bucket of the recovery histogram but the last. */
+    static const int64_t mRecoveryBoundsMs[mRecoveryBuckets - 1];
+
+private:
+    mutable std::mutex mLock;
+    uint32_t mXruns; /**< Xruns recorded. */
+    int64_t mLastXrunsNs[mMaxLastXruns]; /**< Times of the last xruns, oldest overwritten first. */
+    uint32_t mRecoveries[mRecoveryBuckets]; /**< Xruns per bucket of recovery time. */
+    int64_t mLostFrames; /**< Frames lost by all the xruns. */
+    int64_t mUnreportedLostFrames; /**< Frames lost since last taken. */
+};
+
+} // namespace intel_audio
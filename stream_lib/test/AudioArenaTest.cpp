@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioArena.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+TEST(AudioArena, carvesAlignedBuffers)
+{
+    AudioArena arena;
+    EXPECT_EQ(NULL, arena.allocate(1));
+
+    ASSERT_EQ(android::OK, arena.reserve(AudioArena::getAlignedSize(100) +
+                                         AudioArena::getAlignedSize(30)));
+    char *first = static_cast<char *>(arena.allocate(100));
+    char *second = static_cast<char *>(arena.allocate(30));
+    ASSERT_TRUE(first != NULL);
+    ASSERT_TRUE(second != NULL);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) % AudioArena::mAlignment);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(second) % AudioArena::mAlignment);
+    EXPECT_EQ(first + AudioArena::getAlignedSize(100), second);
+    EXPECT_EQ(arena.getCapacity(), arena.getUsedBytes());
+
+    // No room left: the block is never grown by carving.
+    EXPECT_EQ(NULL, arena.allocate(1));
+    arena.release();
+    EXPECT_EQ(first, arena.allocate(100));
+}
+
+TEST(AudioArena, keepsLargeEnoughBlock)
+{
+    AudioArena arena;
+    ASSERT_EQ(android::OK, arena.reserve(1000));
+    void *block = arena.allocate(1000);
+    ASSERT_TRUE(block != NULL);
+
+    // Smaller: same block, buffers released.
+    ASSERT_EQ(android::OK, arena.reserve(500));
+    EXPECT_EQ(0u, arena.getUsedBytes());
+    EXPECT_EQ(block, arena.allocate(500));
+
+    ASSERT_EQ(android::OK, arena.reserve(5000));
+    EXPECT_LE(5000u, arena.getCapacity());
+    EXPECT_TRUE(arena.allocate(5000) != NULL);
+}
+
+TEST(AudioArena, swapsBlocks)
+{
+    AudioArena arena;
+    AudioArena other;
+    ASSERT_EQ(android::OK, other.reserve(256));
+    void *buffer = other.allocate(64);
+
+    arena.swap(other);
+    EXPECT_EQ(0u, other.getCapacity());
+    EXPECT_EQ(NULL, other.allocate(1));
+    EXPECT_EQ(256u, arena.getCapacity());
+    EXPECT_EQ(64u, arena.getUsedBytes());
+    EXPECT_EQ(static_cast<char *>(buffer) + 64, arena.allocate(64));
+}
+
+} // namespace intel_audio
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioClockModel.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace intel_audio
+{
+
+static const int64_t gRate = 48000;
+static const int64_t gPeriod = 960;
+
+/**
+ * Reads the position of a device updated by periods every 2ms to 30ms, the time being taken up to
+ * 3ms after, and checks that the time of the positions given by the model is more accurate than
+ * the time of the measures.
+ */
+TEST(AudioClockModel, filtersMeasures)
+{
+    AudioClockModel model;
+    unsigned int seed = 0xC10C;
+    int64_t readNs = 0;
+    int64_t previousNs = 0;
+    double measureError = 0;
+    double modelError = 0;
+    const int measures = 2000;
+    for (int i = 0; i < measures; i++) {
+        readNs += 2000000 + rand_r(&seed) % 28000000;
+        int64_t frames = readNs * gRate / 1000000000 / gPeriod * gPeriod;
+        int64_t measureNs = readNs + rand_r(&seed) % 3000000;
+
+        int64_t timeNs = model.update(frames, measureNs);
+        EXPECT_GE(timeNs, previousNs);
+        EXPECT_LE(timeNs, measureNs);
+        previousNs = timeNs;
+
+        int64_t reachedNs = frames * 1000000000 / gRate;
+        if (i >= 100) {
+            measureError += llabs(measureNs - reachedNs);
+            modelError += llabs(timeNs - reachedNs);
+        }
+    }
+    measureError /= measures - 100;
+    modelError /= measures - 100;
+    // Measures are late by half a period and half the latency on average.
+    EXPECT_GT(measureError, 10000000);
+    EXPECT_LT(modelError, 2000000);
+}
+
+TEST(AudioClockModel, measuresUntilEnough)
+{
+    AudioClockModel model;
+    EXPECT_EQ(1000, model.update(0, 1000));
+    EXPECT_EQ(2000, model.update(0, 2000));
+
+    // Stalled device: no rate, the time of the measures is given.
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(3000 + i, model.update(0, 3000 + i));
+    }
+
+    // Restarted device, its position starts from zero again.
+    model.reset();
+    EXPECT_EQ(500, model.update(0, 500));
+}
+
+} // namespace intel_audio
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioDevicePool.hpp>
+#include <SimulatedAudioDevice.hpp>
+#include <MixPortConfig.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace intel_audio
+{
+
+static const int64_t gSecondNs = 1000000000;
+
+static MixPortConfig getConfig(uint32_t rate)
+{
+    MixPortConfig config;
+    config.isOut = true;
+    config.periodSize = 480;
+    config.periodCount = 4;
+    config.startThreshold = 960;
+    config.stopThreshold = 1920;
+    config.silenceThreshold = 0;
+    config.availMin = 480;
+    config.mCurrentRate = rate;
+    config.mCurrentFormat = AUDIO_FORMAT_PCM_16_BIT;
+    config.mCurrentChannelMask = AUDIO_CHANNEL_OUT_STEREO;
+    return config;
+}
+
+TEST(AudioDevicePool, reusesParkedDevice)
+{
+    AudioDevicePool pool;
+    SimulatedAudioDevice device("", false);
+    ASSERT_EQ(android::OK, pool.open(device, "simulated", 0, getConfig(48000), true));
+
+    std::string error;
+    std::vector<uint8_t> frames(960 * 4);
+    ASSERT_EQ(android::OK, device.pcmWriteFrames(&frames[0], 960, error));
+
+    // Parked prepared: the frames written are dropped, the device stays opened.
+    ASSERT_EQ(android::OK, pool.close(device, 1000, 0));
+    EXPECT_TRUE(device.isOpened());
+    EXPECT_EQ(1u, pool.getParkedCount());
+    size_t avail = 0;
+    struct timespec timestamp;
+    EXPECT_NE(android::OK, device.getFramesAvailable(avail, timestamp));
+
+    ASSERT_EQ(android::OK, pool.open(device, "simulated", 0, getConfig(48000), true));
+    EXPECT_EQ(1u, pool.getReuseCount());
+    EXPECT_EQ(0u, pool.getParkedCount());
+    EXPECT_GE(pool.getSavedNs(), -gSecondNs);
+
+    // Closed at once without idle timeout.
+    ASSERT_EQ(android::OK, pool.close(device, 0, 0));
+    EXPECT_FALSE(device.isOpened());
+}
+
+TEST(AudioDevicePool, reopensOnOtherConfig)
+{
+    AudioDevicePool pool;
+    SimulatedAudioDevice device("", false);
+    ASSERT_EQ(android::OK, pool.open(device, "simulated", 0, getConfig(48000), true));
+    ASSERT_EQ(android::OK, pool.close(device, 1000, 0));
+
+    ASSERT_EQ(android::OK, pool.open(device, "simulated", 0, getConfig(44100), true));
+    EXPECT_EQ(0u, pool.getReuseCount());
+    EXPECT_TRUE(device.isOpened());
+}
+
+TEST(AudioDevicePool, releasesOtherDeviceOnSamePcm)
+{
+    AudioDevicePool pool;
+    SimulatedAudioDevice first("", false);
+    SimulatedAudioDevice second("", false);
+    ASSERT_EQ(android::OK, pool.open(first, "simulated", 0, getConfig(48000), true));
+    ASSERT_EQ(android::OK, pool.close(first, 1000, 0));
+
+    ASSERT_EQ(android::OK, pool.open(second, "simulated", 0, getConfig(44100), true));
+    EXPECT_FALSE(first.isOpened());
+    EXPECT_EQ(0u, pool.getParkedCount());
+}
+
+TEST(AudioDevicePool, releasesIdleDevices)
+{
+    AudioDevicePool pool;
+    SimulatedAudioDevice first("", false);
+    SimulatedAudioDevice second("", false);
+    ASSERT_EQ(android::OK, pool.open(first, "simulated", 0, getConfig(48000), true));
+    ASSERT_EQ(android::OK, pool.open(second, "simulated", 1, getConfig(48000), true));
+    EXPECT_LT(pool.releaseIdle(0), 0);
+
+    ASSERT_EQ(android::OK, pool.close(first, 100, 0));
+    ASSERT_EQ(android::OK, pool.close(second, 300, 0));
+    EXPECT_EQ(100, pool.releaseIdle(0));
+    EXPECT_EQ(150, pool.releaseIdle(150000000));
+    EXPECT_FALSE(first.isOpened());
+    EXPECT_TRUE(second.isOpened());
+
+    pool.releaseAll();
+    EXPECT_FALSE(second.isOpened());
+    EXPECT_EQ(0u, pool.getParkedCount());
+}
+
+TEST(AudioDevicePool, countsPrewarmHitsAndMisses)
+{
+    AudioDevicePool pool;
+    SimulatedAudioDevice device("", false);
+    ASSERT_EQ(android::OK, pool.prewarm(device, "simulated", 0, getConfig(48000), true, 1000, 0));
+    EXPECT_TRUE(device.isOpened());
+    EXPECT_NE(android::OK,
+              pool.prewarm(device, "simulated", 0, getConfig(48000), true, 1000, 0));
+
+    // Routed as speculated.
+    ASSERT_EQ(android::OK, pool.open(device, "simulated", 0, getConfig(48000), true));
+    EXPECT_EQ(1u, pool.getPrewarmHitCount());
+    ASSERT_EQ(android::OK, pool.close(device, 0, 0));
+
+    // Routed with another config, then never routed.
+    ASSERT_EQ(android::OK, pool.prewarm(device, "simulated", 0, getConfig(48000), true, 1000, 0));
+    ASSERT_EQ(android::OK, pool.open(device, "simulated", 0, getConfig(44100), true));
+    ASSERT_EQ(android::OK, pool.close(device, 0, 0));
+    ASSERT_EQ(android::OK, pool.prewarm(device, "simulated", 0, getConfig(48000), true, 1000, 0));
+    EXPECT_LT(pool.releaseIdle(1000000000), 0);
+    EXPECT_FALSE(device.isOpened());
+    EXPECT_EQ(1u, pool.getPrewarmHitCount());
+    EXPECT_EQ(2u, pool.getPrewarmMissCount());
+}
+
+} // namespace intel_audio
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioFifo.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+namespace intel_audio
+{
+
+TEST(AudioFifo, boundedAndWrapping)
+{
+    AudioFifo fifo;
+    fifo.resize(8);
+    const char bytes[] = "abcdefghij";
+    EXPECT_EQ(6u, fifo.write(bytes, 6));
+    EXPECT_EQ(2u, fifo.write(bytes + 6, 4));
+    EXPECT_EQ(0u, fifo.getWritableBytes());
+    EXPECT_EQ(0u, fifo.write(bytes, 1));
+
+    size_t readable;
+    const char *area = static_cast<const char *>(fifo.getReadArea(readable));
+    ASSERT_EQ(8u, readable);
+    EXPECT_EQ(0, memcmp(area, bytes, 8));
+    fifo.release(5);
+
+    // The next bytes wrap: the front area stops at the end of the ring.
+    EXPECT_EQ(2u, fifo.write(bytes + 8, 2));
+    EXPECT_EQ(5u, fifo.getReadableBytes());
+    area = static_cast<const char *>(fifo.getReadArea(readable));
+    ASSERT_EQ(3u, readable);
+    EXPECT_EQ(0, memcmp(area, "fgh", 3));
+    fifo.release(3);
+    area = static_cast<const char *>(fifo.getReadArea(readable));
+    ASSERT_EQ(2u, readable);
+    EXPECT_EQ(0, memcmp(area, "ij", 2));
+    fifo.release(2);
+
+    EXPECT_EQ(0u, fifo.getReadableBytes());
+    EXPECT_EQ(10u, fifo.getWrittenBytes());
+    EXPECT_EQ(10u, fifo.getReleasedBytes());
+}
+
+/**
+ * A producer thread writes a sequence of bytes as the ring takes them, a consumer thread reads
+ * them: it gets the whole sequence in order.
+ */
+TEST(AudioFifo, transfersBetweenThreads)
+{
+    AudioFifo fifo;
+    fifo.resize(96);
+    const size_t total = 100000;
+
+    std::thread producer([&]() {
+        uint8_t chunk[40];
+        size_t sent = 0;
+        while (sent < total) {
+            size_t bytes = std::min(sizeof(chunk), total - sent);
+            for (size_t i = 0; i < bytes; i++) {
+                chunk[i] = static_cast<uint8_t>(sent + i);
+            }
+            size_t written = 0;
+            while (written < bytes) {
+                size_t copied = fifo.write(chunk + written, bytes - written);
+                if (copied == 0) {
+                    // Full: lets the consumer run, even on a single CPU.
+                    std::this_thread::yield();
+                }
+                written += copied;
+            }
+            sent += bytes;
+        }
+    });
+
+    size_t received = 0;
+    size_t mismatches = 0;
+    while (received < total) {
+        size_t readable;
+        const uint8_t *area = static_cast<const uint8_t *>(fifo.getReadArea(readable));
+        if (readable == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < readable; i++) {
+            if (area[i] != static_cast<uint8_t>(received + i)) {
+                mismatches++;
+            }
+        }
+        fifo.release(readable);
+        received += readable;
+    }
+    producer.join();
+
+    EXPECT_EQ(total, received);
+    EXPECT_EQ(0u, mismatches);
+}
+
+} // namespace intel_audio
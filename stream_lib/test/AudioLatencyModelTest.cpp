@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioLatencyModel.hpp>
+#include <SimulatedAudioDevice.hpp>
+#include <MixPortConfig.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace intel_audio
+{
+
+static const size_t gPeriod = 480;
+static const int64_t gPeriodNs = 10000000;
+static const size_t gFrameSize = 4;
+
+static MixPortConfig getConfig()
+{
+    MixPortConfig config;
+    config.isOut = true;
+    config.periodSize = gPeriod;
+    config.periodCount = 4;
+    config.startThreshold = 2 * gPeriod;
+    config.mCurrentRate = 48000;
+    config.mCurrentFormat = AUDIO_FORMAT_PCM_16_BIT;
+    config.mCurrentChannelMask = AUDIO_CHANNEL_OUT_STEREO;
+    return config;
+}
+
+/**
+ * Plays a silence prolog then the frames of a stream on a simulated device, and checks that the
+ * frames presented given by the model are the frames of the stream played by the device, after the
+ * prolog, less the delay beyond the device.
+ */
+TEST(AudioLatencyModel, followsSimulatedPlayback)
+{
+    SimulatedAudioDevice device("", false);
+    device.setPlaybackReadback(true);
+    ASSERT_EQ(android::OK, device.open("simulated", 0, getConfig(), true));
+    const size_t bufferSize = device.getBufferSizeInFrames();
+
+    std::string error;
+    std::vector<uint8_t> period(gPeriod * gFrameSize);
+    const size_t prologFrames = 3 * gPeriod / 2;
+    ASSERT_EQ(android::OK, device.pcmWriteFrames(&period[0], prologFrames, error));
+    const int64_t delayFrames = 100;
+    AudioLatencyModel model;
+    model.reset(prologFrames, delayFrames);
+
+    int64_t writtenFrames = 0;
+    for (size_t i = 0; i < 20; i++) {
+        ASSERT_EQ(android::OK, device.pcmWriteFrames(&period[0], gPeriod, error));
+        model.addWrittenFrames(gPeriod);
+        writtenFrames += gPeriod;
+
+        size_t avail;
+        struct timespec timestamp;
+        ASSERT_EQ(android::OK, device.getFramesAvailable(avail, timestamp));
+        std::vector<uint8_t> played;
+        device.getPlayedFrames(played);
+        int64_t playedFrames = played.size() / gFrameSize;
+
+        int64_t presented = writtenFrames -
+                            static_cast<int64_t>(model.getUnpresentedFrames(bufferSize - avail,
+                                                                            0));
+        int64_t playedStreamFrames = std::max<int64_t>(playedFrames - prologFrames, 0);
+        EXPECT_EQ(playedStreamFrames - delayFrames, presented) << "after " << i + 1 << " periods";
+    }
+    EXPECT_EQ(0u, device.getXrunCount());
+}
+
+TEST(AudioLatencyModel, countsHeldFrames)
+{
+    AudioLatencyModel model;
+    model.reset(0, 10);
+    model.addWrittenFrames(1000);
+    EXPECT_EQ(10u, model.getDelayFrames());
+    EXPECT_EQ(10u, model.getUnpresentedFrames(0, 0));
+    EXPECT_EQ(510u, model.getUnpresentedFrames(400, 100));
+
+    // Flushed device: more room than ever written.
+    model.reset(200, 0);
+    EXPECT_EQ(0u, model.getUnpresentedFrames(1000, 0));
+}
+
+} // namespace intel_audio
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioRouteGuard.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <unistd.h>
+
+namespace intel_audio
+{
+
+TEST(AudioRouteGuard, closedEntryDoesWithoutRoute)
+{
+    AudioRouteGuard guard;
+    EXPECT_TRUE(guard.enter());
+    guard.leave();
+
+    guard.close();
+    EXPECT_FALSE(guard.enter());
+    guard.leave();
+    EXPECT_EQ(1u, guard.getClosedEntryCount());
+
+    guard.open();
+    EXPECT_TRUE(guard.enter());
+    guard.leave();
+}
+
+/**
+ * An audio thread uses the route in a loop while the routing thread replaces it: the audio thread
+ * never sees a route being replaced, and the routing thread waits for it to leave the guard.
+ */
+TEST(AudioRouteGuard, routeReplacedOutOfAudioThread)
+{
+    AudioRouteGuard guard;
+    // Route of the stream, plain variables as the members of the stream.
+    int route = 1;
+    int routeCopy = 1;
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> inconsistencies(0);
+    std::atomic<uint32_t> transfers(0);
+
+    std::thread audioThread([&]() {
+        while (!stop.load()) {
+            if (guard.enter()) {
+                if (route != routeCopy || route == 0) {
+                    inconsistencies++;
+                }
+                transfers++;
+            }
+            guard.leave();
+        }
+    });
+
+    for (int i = 2; i < 200; i++) {
+        guard.close();
+        // Detached, then attached again.
+        route = 0;
+        usleep(10);
+        route = i;
+        routeCopy = i;
+        guard.open();
+        usleep(100);
+    }
+    stop = true;
+    audioThread.join();
+
+    EXPECT_EQ(0u, inconsistencies.load());
+    EXPECT_GT(transfers.load(), 0u);
+}
+
+} // namespace intel_audio
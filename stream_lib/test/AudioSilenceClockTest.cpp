@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioSilenceClock.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+static const uint32_t gRate = 48000;
+static const size_t gPeriod = 480;
+static const int64_t gPeriodNs = 10000000;
+
+/**
+ * Writes periods of silence after waking up late from each deadline, and working: the deadlines
+ * follow the rate of the stream, the work and the wake up latency do not add up.
+ */
+TEST(AudioSilenceClock, pacesWithoutDrift)
+{
+    AudioSilenceClock clock;
+    const int64_t startNs = 1000000000;
+    int64_t nowNs = startNs;
+    for (int i = 0; i < 50; i++) {
+        int64_t deadlineNs = clock.addFrames(gPeriod, gRate, nowNs);
+        EXPECT_EQ(startNs + (i + 1) * gPeriodNs, deadlineNs);
+        nowNs = deadlineNs + (i % 5) * 1000000 + 2000000;
+    }
+}
+
+TEST(AudioSilenceClock, sleepsUntilDeadline)
+{
+    int64_t deadlineNs = AudioSilenceClock::getNowNs() + 2000000;
+    AudioSilenceClock::sleepUntil(deadlineNs);
+    EXPECT_GE(AudioSilenceClock::getNowNs(), deadlineNs);
+}
+
+TEST(AudioSilenceClock, restartsWhenLate)
+{
+    AudioSilenceClock clock;
+    const int64_t startNs = 1000000000;
+    EXPECT_EQ(startNs + gPeriodNs, clock.addFrames(gPeriod, gRate, startNs));
+    // Early: follows the previous deadline.
+    EXPECT_EQ(startNs + 2 * gPeriodNs, clock.addFrames(gPeriod, gRate, startNs + 5000000));
+    // Due at the previous deadline, late by its own duration: still follows it.
+    EXPECT_EQ(startNs + 3 * gPeriodNs, clock.addFrames(gPeriod, gRate, startNs + 3 * gPeriodNs));
+    // Late by more than its own duration: from the time of the write.
+    const int64_t lateNs = startNs + 4 * gPeriodNs + 1000;
+    EXPECT_EQ(lateNs + gPeriodNs, clock.addFrames(gPeriod, gRate, lateNs));
+
+    uint64_t frames;
+    ASSERT_TRUE(clock.getPresentedFrames(lateNs + gPeriodNs / 2, frames));
+    EXPECT_EQ(3 * gPeriod + gPeriod / 2, frames);
+}
+
+/**
+ * Started from the last position of a device holding frames, the clock presents them first, then
+ * the frames written meanwhile, never more than written.
+ */
+TEST(AudioSilenceClock, continuesDevicePosition)
+{
+    AudioSilenceClock clock;
+    uint64_t frames;
+    EXPECT_FALSE(clock.getPresentedFrames(0, frames));
+
+    const int64_t originNs = 2000000000;
+    clock.start(10000, originNs, 10000 + 2 * gPeriod, gRate);
+    ASSERT_TRUE(clock.getPresentedFrames(originNs + gPeriodNs, frames));
+    EXPECT_EQ(10000 + gPeriod, frames);
+
+    // The frames held by the device are presented before the frames written.
+    EXPECT_EQ(originNs + 3 * gPeriodNs, clock.addFrames(gPeriod, gRate, originNs + gPeriodNs));
+    ASSERT_TRUE(clock.getPresentedFrames(originNs + 10 * gPeriodNs, frames));
+    EXPECT_EQ(10000 + 3 * gPeriod, frames);
+
+    clock.stop();
+    EXPECT_FALSE(clock.isStarted());
+    EXPECT_FALSE(clock.getPresentedFrames(originNs, frames));
+}
+
+} // namespace intel_audio
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioTimingHistogram.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <thread>
+
+namespace intel_audio
+{
+
+TEST(AudioTimingHistogram, empty)
+{
+    AudioTimingHistogram histogram;
+    EXPECT_EQ(0u, histogram.getCount());
+    EXPECT_EQ(0u, histogram.getPercentileUs(50));
+    EXPECT_EQ("0|0|0|0|0", histogram.toString());
+}
+
+/**
+ * Short durations are exact, longer ones within an eighth of their duration, never beyond the
+ * longest one recorded.
+ */
+TEST(AudioTimingHistogram, percentiles)
+{
+    AudioTimingHistogram histogram;
+    for (int i = 0; i < 90; i++) {
+        histogram.record(5000);
+    }
+    for (int i = 0; i < 9; i++) {
+        histogram.record(10000000);
+    }
+    histogram.record(25000000);
+    histogram.record(-1);
+
+    EXPECT_EQ(101u, histogram.getCount());
+    EXPECT_EQ(0u, histogram.getPercentileUs(0));
+    EXPECT_EQ(5u, histogram.getPercentileUs(50));
+    EXPECT_EQ(5u, histogram.getPercentileUs(90));
+    uint32_t p99 = histogram.getPercentileUs(99);
+    EXPECT_GE(p99, 10000u);
+    EXPECT_LT(p99, 10000u + 10000u / 8);
+    EXPECT_EQ(25000u, histogram.getPercentileUs(100));
+    EXPECT_EQ(25000u, histogram.getMaxUs());
+
+    // Beyond the last bucket.
+    histogram.record(3600LL * 1000000000LL);
+    EXPECT_EQ(3600000000u, histogram.getPercentileUs(100));
+}
+
+TEST(AudioTimingHistogram, recordsFromThreads)
+{
+    AudioTimingHistogram histogram;
+    const int records = 10000;
+    std::thread other([&]() {
+        for (int i = 0; i < records; i++) {
+            histogram.record(i * 1000);
+        }
+    });
+    for (int i = 0; i < records; i++) {
+        histogram.record(i * 1000);
+    }
+    other.join();
+    EXPECT_EQ(2u * records, histogram.getCount());
+    EXPECT_EQ(static_cast<uint32_t>(records - 1), histogram.getMaxUs());
+}
+
+} // namespace intel_audio
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <AudioWriterThread.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdint.h>
+#include <unistd.h>
+
+namespace intel_audio
+{
+
+/** Client running a given number of cycles a millisecond apart, then sleeping until woken. */
+class CountingClient : public IAudioWriterClient
+{
+public:
+    CountingClient() : mCycles(0), mBusyCycles(0) {}
+
+    virtual uint32_t onWriterCycle()
+    {
+        mCycles++;
+        if (mBusyCycles == 0) {
+
+            return 0;
+        }
+        mBusyCycles--;
+        return 1000;
+    }
+
+    std::atomic<uint32_t> mCycles;
+    std::atomic<uint32_t> mBusyCycles;
+};
+
+static bool waitForCycles(const CountingClient &client, uint32_t cycles)
+{
+    for (int i = 0; i < 1000 && client.mCycles < cycles; i++) {
+        usleep(1000);
+    }
+    return client.mCycles >= cycles;
+}
+
+TEST(AudioWriterThread, sleepsUntilWoken)
+{
+    CountingClient client;
+    client.mBusyCycles = 3;
+    AudioWriterThread thread(client);
+    ASSERT_EQ(android::OK, thread.start("writer test", 2));
+    EXPECT_TRUE(thread.isStarted());
+
+    // Three cycles paced by the client, then one finding nothing to do.
+    ASSERT_TRUE(waitForCycles(client, 4));
+    usleep(20000);
+    EXPECT_EQ(4u, client.mCycles);
+
+    thread.wake();
+    ASSERT_TRUE(waitForCycles(client, 5));
+
+    thread.stop();
+    EXPECT_FALSE(thread.isStarted());
+    EXPECT_EQ(5u, client.mCycles);
+}
+
+TEST(AudioWriterThread, bindsToCpu)
+{
+    EXPECT_EQ(android::OK, AudioWriterThread::bindToCpu(0));
+    EXPECT_EQ(android::OK, AudioWriterThread::bindToCpu(-1));
+    EXPECT_EQ(android::BAD_VALUE, AudioWriterThread::bindToCpu(100000));
+}
+
+} // namespace intel_audio
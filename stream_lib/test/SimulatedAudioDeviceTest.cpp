@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <SimulatedAudioDevice.hpp>
+#include <MixPortConfig.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace intel_audio
+{
+
+static const uint32_t gRate = 48000;
+static const size_t gPeriod = 480;
+static const int64_t gPeriodNs = 10000000;
+static const size_t gFrameSize = 4;
+
+static MixPortConfig getConfig(bool isOut)
+{
+    MixPortConfig config;
+    config.isOut = isOut;
+    config.periodSize = gPeriod;
+    config.periodCount = 4;
+    config.startThreshold = 2 * gPeriod;
+    config.mCurrentRate = gRate;
+    config.mCurrentFormat = AUDIO_FORMAT_PCM_16_BIT;
+    config.mCurrentChannelMask = isOut ? AUDIO_CHANNEL_OUT_STEREO : AUDIO_CHANNEL_IN_STEREO;
+    return config;
+}
+
+/** Period of frames whose bytes all hold the index of the period. */
+static std::vector<uint8_t> getPeriod(size_t index)
+{
+    return std::vector<uint8_t>(gPeriod * gFrameSize, static_cast<uint8_t>(index));
+}
+
+TEST(SimulatedAudioDevice, playbackConsumesAtRate)
+{
+    SimulatedAudioDevice device("", false);
+    device.setPlaybackReadback(true);
+    ASSERT_EQ(android::OK, device.open("simulated", 0, getConfig(true), true));
+    EXPECT_EQ(4 * gPeriod, device.getBufferSizeInFrames());
+    EXPECT_EQ(4 * gPeriod * gFrameSize, device.getBufferSizeInBytes());
+
+    std::string error;
+    for (size_t i = 0; i < 100; i++) {
+        std::vector<uint8_t> period = getPeriod(i);
+        ASSERT_EQ(android::OK, device.pcmWriteFrames(&period[0], gPeriod, error));
+    }
+    // Started on the second period, writes block once the buffer is full.
+    EXPECT_EQ(96 * gPeriodNs, device.getTimeNs());
+
+    size_t avail = 0;
+    struct timespec timestamp;
+    ASSERT_EQ(android::OK, device.getFramesAvailable(avail, timestamp));
+    EXPECT_EQ(0u, avail);
+    EXPECT_EQ(96 * gPeriodNs, timestamp.tv_sec * 1000000000ll + timestamp.tv_nsec);
+
+    device.advance(25000000);
+    ASSERT_EQ(android::OK, device.getFramesAvailable(avail, timestamp));
+    EXPECT_EQ(2 * gPeriod, avail);
+    EXPECT_EQ(98 * gPeriodNs, timestamp.tv_sec * 1000000000ll + timestamp.tv_nsec);
+
+    std::vector<uint8_t> played;
+    device.getPlayedFrames(played);
+    ASSERT_EQ(98 * gPeriod * gFrameSize, played.size());
+    for (size_t i = 0; i < 98; i++) {
+        EXPECT_EQ(getPeriod(i), std::vector<uint8_t>(played.begin() + i * gPeriod * gFrameSize,
+                                                     played.begin() + (i + 1) * gPeriod *
+                                                     gFrameSize));
+    }
+    EXPECT_EQ(0u, device.getXrunCount());
+    EXPECT_EQ(android::OK, device.close());
+    EXPECT_FALSE(device.isOpened());
+}
+
+TEST(SimulatedAudioDevice, underrunAndRecovery)
+{
+    SimulatedAudioDevice device("", false);
+    ASSERT_EQ(android::OK, device.open("simulated", 0, getConfig(true), true));
+
+    std::string error;
+    std::vector<uint8_t> period = getPeriod(1);
+    ASSERT_EQ(android::OK, device.pcmWriteFrames(&period[0], gPeriod, error));
+    ASSERT_EQ(android::OK, device.pcmWriteFrames(&period[0], gPeriod, error));
+
+    // Late writer: the device stops on underrun, then starts again on the next writes.
+    device.advance(30 * gPeriodNs);
+    EXPECT_EQ(1u, device.getXrunCount());
+    size_t avail;
+    struct timespec timestamp;
+    EXPECT_NE(android::OK, device.getFramesAvailable(avail, timestamp));
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(android::OK, device.pcmWriteFrames(&period[0], gPeriod, error));
+    }
+    EXPECT_EQ(1u, device.getXrunCount());
+    // Silence played from the underrun, at the third period wakeup, until prepared again.
+    const XrunStatistics &statistics = device.getXrunStatistics();
+    EXPECT_EQ(1u, statistics.getXrunCount());
+    EXPECT_EQ(static_cast<int64_t>(27 * gPeriod), statistics.getLostFrames());
+
+    device.injectXrun();
+    device.advance(gPeriodNs);
+    EXPECT_EQ(2u, device.getXrunCount());
+    ASSERT_EQ(android::OK, device.pcmWriteFrames(&period[0], gPeriod, error));
+
+    // Played frames are not kept unless the readback is enabled.
+    std::vector<uint8_t> played;
+    device.getPlayedFrames(played);
+    EXPECT_TRUE(played.empty());
+}
+
+TEST(SimulatedAudioDevice, nonBlockingWritesUntilDeadline)
+{
+    SimulatedAudioDevice device("", false);
+    MixPortConfig config = getConfig(true);
+    config.nonBlocking = true;
+    ASSERT_EQ(android::OK, device.open("simulated", 0, config, true));
+
+    std::string error;
+    std::vector<uint8_t> frames(8 * gPeriod * gFrameSize);
+    size_t written = 8 * gPeriod;
+    ASSERT_EQ(android::OK, device.pcmWriteFramesUntil(&frames[0], written, 1, error));
+    // Buffer filled at once, no time given to play any frame.
+    EXPECT_EQ(4 * gPeriod, written);
+    EXPECT_EQ(0, device.getTimeNs());
+
+    // Room for the periods played until the deadline only.
+    written = 8 * gPeriod;
+    int64_t deadlineNs = device.getTimeNs() + 25000000;
+    ASSERT_EQ(android::OK, device.pcmWriteFramesUntil(&frames[0], written, deadlineNs, error));
+    EXPECT_EQ(2 * gPeriod, written);
+    EXPECT_LE(device.getTimeNs(), deadlineNs);
+    EXPECT_EQ(0u, device.getXrunCount());
+}
+
+TEST(SimulatedAudioDevice, captureLoopsSource)
+{
+    SimulatedAudioDevice device("", false);
+    std::vector<uint8_t> source;
+    for (size_t i = 0; i < 3; i++) {
+        std::vector<uint8_t> period = getPeriod(i);
+        source.insert(source.end(), period.begin(), period.end());
+    }
+    device.setCaptureSource(source);
+    ASSERT_EQ(android::OK, device.open("simulated", 0, getConfig(false), false));
+
+    std::string error;
+    std::vector<uint8_t> period(gPeriod * gFrameSize);
+    for (size_t i = 0; i < 10; i++) {
+        ASSERT_EQ(android::OK, device.pcmReadFrames(&period[0], gPeriod, error));
+        EXPECT_EQ(getPeriod(i % 3), period);
+    }
+    // Started on first read, a read blocks until its period is captured.
+    EXPECT_EQ(10 * gPeriodNs, device.getTimeNs());
+
+    // Late reader: the device stops on overrun.
+    device.advance(10 * gPeriodNs);
+    EXPECT_EQ(1u, device.getXrunCount());
+    ASSERT_EQ(android::OK, device.pcmReadFrames(&period[0], gPeriod, error));
+    // Buffer dropped, and nothing captured from the overrun, at the fifth period wakeup, until
+    // prepared again.
+    EXPECT_EQ(1u, device.getXrunStatistics().getXrunCount());
+    EXPECT_EQ(static_cast<int64_t>(9 * gPeriod), device.getXrunStatistics().takeLostFrames());
+}
+
+TEST(SimulatedAudioDevice, drift)
+{
+    SimulatedAudioDevice device("", false);
+    device.setDriftPpm(1000);
+    ASSERT_EQ(android::OK, device.open("simulated", 0, getConfig(false), false));
+
+    std::string error;
+    std::vector<uint8_t> period(gPeriod * gFrameSize);
+    for (size_t i = 0; i < 1000; i++) {
+        ASSERT_EQ(android::OK, device.pcmReadFrames(&period[0], gPeriod, error));
+    }
+    // A clock faster by 1000ppm captures 1000 periods in 1000/1001 of the nominal time.
+    EXPECT_NEAR(1000 * gPeriodNs / 1.001, device.getTimeNs(), 1000);
+}
+
+TEST(SimulatedAudioDevice, jitter)
+{
+    SimulatedAudioDevice device("", false);
+    device.setJitter(gPeriodNs / 2);
+    ASSERT_EQ(android::OK, device.open("simulated", 0, getConfig(false), false));
+
+    std::string error;
+    std::vector<uint8_t> period(gPeriod * gFrameSize);
+    int64_t previous = 0;
+    bool jittered = false;
+    for (size_t i = 1; i <= 100; i++) {
+        ASSERT_EQ(android::OK, device.pcmReadFrames(&period[0], gPeriod, error));
+        int64_t wakeup = device.getTimeNs();
+        // Wakeups are late but not drifting.
+        EXPECT_GE(wakeup, static_cast<int64_t>(i * gPeriodNs));
+        EXPECT_LE(wakeup, static_cast<int64_t>(i * gPeriodNs + gPeriodNs / 2));
+        EXPECT_GE(wakeup, previous);
+        jittered |= wakeup != static_cast<int64_t>(i * gPeriodNs);
+        previous = wakeup;
+    }
+    EXPECT_TRUE(jittered);
+    EXPECT_EQ(0u, device.getXrunCount());
+}
+
+TEST(SimulatedAudioDevice, zeroCopy)
+{
+    SimulatedAudioDevice device("", false);
+    device.setPlaybackReadback(true);
+    ASSERT_EQ(android::OK, device.open("simulated", 0, getConfig(true), true));
+
+    std::string error;
+    for (size_t i = 0; i < 10; i++) {
+        void *area = NULL;
+        size_t frames = gPeriod;
+        ASSERT_EQ(android::OK, device.beginWrite(area, frames));
+        ASSERT_EQ(gPeriod, frames);
+        std::vector<uint8_t> period = getPeriod(i);
+        memcpy(area, &period[0], period.size());
+        ASSERT_EQ(android::OK, device.commitWrite(frames, error));
+    }
+    device.advance(gPeriodNs);
+
+    std::vector<uint8_t> played;
+    device.getPlayedFrames(played);
+    ASSERT_LE(7 * gPeriod * gFrameSize, played.size());
+    EXPECT_EQ(getPeriod(6), std::vector<uint8_t>(played.begin() + 6 * gPeriod * gFrameSize,
+                                                 played.begin() + 7 * gPeriod * gFrameSize));
+}
+
+TEST(SimulatedAudioDevice, mmap)
+{
+    SimulatedAudioDevice device("", false);
+    MixPortConfig config = getConfig(true);
+    config.mmap = true;
+    ASSERT_EQ(android::OK, device.open("simulated", 0, config, true));
+
+    audio_mmap_buffer_info info;
+    ASSERT_EQ(android::OK, device.getMmapBuffer(info));
+    EXPECT_EQ(4 * gPeriod, static_cast<size_t>(info.buffer_size_frames));
+    EXPECT_EQ(gPeriod, static_cast<size_t>(info.burst_size_frames));
+
+    audio_mmap_position position;
+    EXPECT_NE(android::OK, device.getMmapPosition(position));
+    ASSERT_EQ(android::OK, device.pcmStart());
+    device.advance(55000000);
+    ASSERT_EQ(android::OK, device.getMmapPosition(position));
+    EXPECT_EQ(5 * gPeriod, static_cast<size_t>(position.position_frames));
+    EXPECT_EQ(5 * gPeriodNs, position.time_nanoseconds);
+
+    // Free running, never stopped on xrun.
+    device.advance(1000000000);
+    ASSERT_EQ(android::OK, device.getMmapPosition(position));
+    EXPECT_EQ(0u, device.getXrunCount());
+    ASSERT_EQ(android::OK, device.pcmStop());
+    EXPECT_NE(android::OK, device.getMmapPosition(position));
+}
+
+} // namespace intel_audio
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <XrunStatistics.hpp>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+namespace intel_audio
+{
+
+TEST(XrunStatistics, empty)
+{
+    XrunStatistics statistics;
+    EXPECT_EQ(0u, statistics.getXrunCount());
+    EXPECT_EQ(0, statistics.getLostFrames());
+    EXPECT_EQ(0, statistics.takeLostFrames());
+    EXPECT_EQ("count:0,lost_frames:0,recovery_ms:0|0|0|0|0|0|0|0,last_ns:",
+              statistics.toString());
+}
+
+TEST(XrunStatistics, recordsXruns)
+{
+    XrunStatistics statistics;
+    statistics.addXrun(1000000, 1500000, 24);
+    statistics.addXrun(10000000, 13000000, 144);
+    statistics.addXrun(20000000, 220000000, 9600);
+    EXPECT_EQ(3u, statistics.getXrunCount());
+    EXPECT_EQ(9768, statistics.getLostFrames());
+    EXPECT_EQ("count:3,lost_frames:9768,recovery_ms:1|0|1|0|0|0|0|1,"
+              "last_ns:1000000|10000000|20000000", statistics.toString());
+
+    // Lost frames are taken once, but still counted.
+    EXPECT_EQ(9768, statistics.takeLostFrames());
+    EXPECT_EQ(0, statistics.takeLostFrames());
+    statistics.addXrun(30000000, 30000000, 48);
+    EXPECT_EQ(48, statistics.takeLostFrames());
+    EXPECT_EQ(9816, statistics.getLostFrames());
+}
+
+TEST(XrunStatistics, keepsLastXruns)
+{
+    XrunStatistics statistics;
+    for (int64_t i = 1; i <= 10; i++) {
+        statistics.addXrun(i, i, 0);
+    }
+    EXPECT_EQ(10u, statistics.getXrunCount());
+    EXPECT_EQ("count:10,lost_frames:0,recovery_ms:10|0|0|0|0|0|0|0,last_ns:3|4|5|6|7|8|9|10",
+              statistics.toString());
+}
+
+TEST(XrunStatistics, estimateLostFrames)
+{
+    // A playback plays silence until prepared, a capture also drops its buffer.
+    EXPECT_EQ(480, XrunStatistics::estimateLostFrames(10000000, 48000, true, 1920));
+    EXPECT_EQ(2400, XrunStatistics::estimateLostFrames(10000000, 48000, false, 1920));
+    EXPECT_EQ(1920, XrunStatistics::estimateLostFrames(-1, 48000, false, 1920));
+}
+
+} // namespace intel_audio
@@ -59,6 +59,12 @@ public:
     /** PreProc Parameter Key. */
     static const std::string &gKeyPreProcRequested;
 
+    /** Xrun statistics of the audio device of a stream, read only. */
+    static const std::string &gKeyXrunStatistics;
+
+    /** Timing percentiles of the transfers of a stream, read only. */
+    static const std::string &gKeyTimingStatistics;
+
     /** Always Listening Route/VTSV Parameters Keys */
     static const std::string &gkeyAlwaysListeningRoute;
     static const std::string &gKeyLpalDevice;
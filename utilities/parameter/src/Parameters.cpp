@@ -43,6 +43,10 @@ const std::string &Parameters::gKeyVoipBandType = "voip_band_type";
 
 const std::string &Parameters::gKeyPreProcRequested = "pre_proc_requested";
 
+const std::string &Parameters::gKeyXrunStatistics = "xrun_statistics";
+
+const std::string &Parameters::gKeyTimingStatistics = "timing_statistics";
+
 const std::string &Parameters::gkeyAlwaysListeningRoute = "vtsv_route";
 
 const std::string &Parameters::gKeyLpalDevice = "lpal_device";
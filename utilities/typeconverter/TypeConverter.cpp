@@ -92,6 +92,7 @@ const OutputFlagConverter::Table OutputFlagConverter::mTypeConversion = {
     { "AUDIO_OUTPUT_FLAG_RAW", AUDIO_OUTPUT_FLAG_RAW },
     { "AUDIO_OUTPUT_FLAG_SYNC", AUDIO_OUTPUT_FLAG_SYNC },
     { "AUDIO_OUTPUT_FLAG_IEC958_NONAUDIO", AUDIO_OUTPUT_FLAG_IEC958_NONAUDIO },
+    { "AUDIO_OUTPUT_FLAG_MMAP_NOIRQ", AUDIO_OUTPUT_FLAG_MMAP_NOIRQ },
 };
 
 template <>
@@ -101,6 +102,7 @@ const InputFlagConverter::Table InputFlagConverter::mTypeConversion = {
     { "AUDIO_INPUT_FLAG_RAW", AUDIO_INPUT_FLAG_RAW },
     { "AUDIO_INPUT_FLAG_SYNC", AUDIO_INPUT_FLAG_SYNC },
     { "AUDIO_INPUT_FLAG_PRIMARY", AUDIO_INPUT_FLAG_PRIMARY },
+    { "AUDIO_INPUT_FLAG_MMAP_NOIRQ", AUDIO_INPUT_FLAG_MMAP_NOIRQ },
 };
 
 template <>